@@ -6,43 +6,21 @@
 #include "floor_manager.h"
 #include "calibration_manager.h"
 #include "comm_interface.h"
+#include "step_bench.h"
+#include "logger.h"
+#include "command_queue.h"
+#include "lift_protocol.h"
+#include "lift_snapshot.h"
+#include "telemetry.h"
 
 #include <WiFi.h>
 #include <esp_now.h>
 #include <esp_wifi.h>
 #include <esp_mac.h>
 
-// ======= Протокол лифт <-> пульт (должен быть ИДЕНТИЧЕН на обоих ESP) =======
-
-// Типы команд (пульт -> база)
-enum CommandType : uint8_t {
-  CMD_NONE             = 0,
-  CMD_CALL_FLOOR       = 1, // arg = 1,2,3
-  CMD_STOP             = 2,
-  CMD_CALIB            = 3,
-  CMD_CALIB_DOWN_START = 4,
-  CMD_CALIB_DOWN_SAVE  = 5,
-  CMD_MANUAL_UP        = 6,
-  CMD_MANUAL_DOWN      = 7,
-  CMD_MANUAL_STOP      = 8
-};
-
-struct RemoteCommand {
-  uint8_t  type;   // CommandType
-  uint8_t  arg;    // этаж (1..3) или 0
-  uint16_t seq;    // счётчик, можно просто печатать
-};
-
-struct LiftStatus {
-  uint8_t state;
-  uint8_t currentFloor;
-  uint8_t targetFloor;
-  int8_t  direction;
-  uint8_t error;
-  uint8_t speedPercent;
-  uint8_t needCalib;
-  uint32_t uptimeMs;
-};
+// ======= Протокол лифт <-> пульт =======
+// Кадры, команды, статус — lift_protocol.h (одинаковый с пультом).
+// Пульту за проход loop() уходит не больше одного кадра: ACK + статус или движение.
 
 // ======= Глобалы ESP-NOW на базе =======
 
@@ -50,37 +28,57 @@ struct LiftStatus {
 static uint8_t g_remoteMac[6] = {0};
 static bool    g_haveRemoteMac = false;
 static bool    g_remotePeerAdded = false;  // ДОБАВЬ ЭТО
-// Для периодической отправки статуса (зарезервировано)
+// Статус пульту — по событию: смена состояния / этажа / цели / ошибки / вызовов уходит
+// в том же проходе loop(). Изменения чаще STATUS_MIN_GAP_MS склеиваются (уходит последнее).
+// Без изменений — редкий heartbeat; на ходу — короткие кадры движения.
+static const unsigned long STATUS_MIN_GAP_MS   = 20;
+static const unsigned long STATUS_HEARTBEAT_MS = 1000;
+static const unsigned long MOTION_PERIOD_MS    = 100;
+
+static LiftStatus    g_lastSentStatus;
+static bool          g_statusSentOnce   = false;
+static volatile bool g_statusRequested  = false;  // CMD_STATUS_REQUEST: ставит движение, снимает связь
 static unsigned long g_lastStatusSentMs = 0;
-static const unsigned long STATUS_PERIOD_MS = 200; // пока не используем
+static unsigned long g_lastMotionSentMs = 0;
+static long          g_lastMotionPos    = 0;
 
 // Тик автомата
 static unsigned long g_lastTick = 0;
 static const unsigned long TICK_INTERVAL_MS = 20;
 
-// --- Кнопка полной перекалибровки на базе ---
-const uint8_t PIN_CALIB_RESET           = 33;
+// --- Кнопка полной перекалибровки на базе (пин и антидребезг — io_manager) ---
 const unsigned long CALIB_LONG_PRESS_MS = 3000;
 
-bool          g_calibBtnPrev            = false;
 bool          g_calibLongPressTriggered = false;
 unsigned long g_calibPressStart         = 0;
 
+#if defined(ARDUINO_ARCH_ESP32)
+// Движение и безопасность (входы, мотор, команды, автомат) — своя задача на ядре 1 с приоритетом
+// выше всего остального там; связь, Serial, лог и статус пульту — задача на ядре 0, рядом с WiFi.
+// Общее у них — очереди команд (SPSC), кольцо лога и снимок состояния (seqlock), без замков.
+// При STEP_POLL задача движения крутится без пауз — тогда она на приоритете IDLE, иначе IDLE1
+// (сторож задач, idle-хуки) на ядре 1 не получит времени.
+static const BaseType_t  MOTION_CORE          = 1;
+static const BaseType_t  COMM_CORE            = 0;
+static const UBaseType_t MOTION_PRIORITY      = configMAX_PRIORITIES - 4;
+static const UBaseType_t MOTION_POLL_PRIORITY = tskIDLE_PRIORITY;
+static const UBaseType_t COMM_PRIORITY        = 2;
+static const uint32_t    MOTION_STACK         = 6144;
+static const uint32_t    COMM_STACK           = 6144;
+#endif
+
 // ==== Прототипы локальных функций ====
 void handleRemoteCommand(const RemoteCommand &cmd);
+void execRemoteCommand(const int32_t *arg);
 void onDataSentBase(const wifi_tx_info_t *info, esp_now_send_status_t status);
 void onDataRecvBase(const esp_now_recv_info *recv_info, const uint8_t *incomingData, int len);
 void commInitBase();
+void onIoSwitch(IoSwitch sw, bool active, uint32_t atUs);
 
 // ================== ЛОГИКА ОБРАБОТКИ КОМАНД ОТ ПУЛЬТА ==================
 
 void handleRemoteCommand(const RemoteCommand &cmd) {
-  Serial.print(F("[RCV CMD] type="));
-  Serial.print(cmd.type);
-  Serial.print(F(" arg="));
-  Serial.print(cmd.arg);
-  Serial.print(F(" seq="));
-  Serial.println(cmd.seq);
+  LOG(RCV_CMD, cmd.type, cmd.arg, cmd.seq);
 
   LiftState st = smGetState();
 
@@ -91,15 +89,14 @@ void handleRemoteCommand(const RemoteCommand &cmd) {
       if (st == STATE_NEED_CALIB ||
           st == STATE_CALIB_HOMING_UP ||
           st == STATE_CALIB_MOVING_DOWN) {
-        Serial.println(F("[ACT] Ignored: floor call during calibration"));
+        LOG(ACT_FLOOR_IN_CALIB);
         break;
       }
-      if (cmd.arg >= 1 && cmd.arg <= 3) {
-        Serial.print(F("[ACT] Move to floor "));
-        Serial.println(cmd.arg);
+      if (cmd.arg >= 1 && cmd.arg <= floorGetCount()) {
+        LOG(ACT_MOVE_TO_FLOOR, cmd.arg);
         smCommandMoveToFloor(cmd.arg);
       } else {
-        Serial.println(F("[WARN] Invalid floor in CMD_CALL_FLOOR"));
+        LOG(ACT_INVALID_FLOOR);
       }
       break;
 
@@ -107,15 +104,15 @@ void handleRemoteCommand(const RemoteCommand &cmd) {
     case CMD_MANUAL_UP:
       if (st == STATE_NEED_CALIB) {
         // Нужна калибровка → UP запускает калибровку вверх
-        Serial.println(F("[ACT] NEED_CALIB: start calibration (UP)"));
+        LOG(ACT_CALIB_UP);
         smCommandStartCalib();
       } else if (st == STATE_CALIB_HOMING_UP ||
                  st == STATE_CALIB_MOVING_DOWN) {
         // Во время калибровки игнорируем обычный UP
-        Serial.println(F("[ACT] Ignored: UP during calibration"));
+        LOG(ACT_UP_IN_CALIB);
       } else {
         // Обычный режим: ручной подъём
-        Serial.println(F("[ACT] Manual UP start"));
+        LOG(ACT_MANUAL_UP);
         smCommandManualUpStart();
       }
       break;
@@ -123,15 +120,15 @@ void handleRemoteCommand(const RemoteCommand &cmd) {
     // --- Кнопка ВНИЗ ---
     case CMD_MANUAL_DOWN:
       if (st == STATE_NEED_CALIB) {
-        Serial.println(F("[ACT] Ignored: DOWN in NEED_CALIB (press UP first)"));
+        LOG(ACT_DOWN_NEED_CALIB);
       } else if (st == STATE_CALIB_HOMING_UP) {
-        Serial.println(F("[ACT] Ignored: DOWN during CALIB_HOMING_UP"));
+        LOG(ACT_DOWN_HOMING);
       } else if (st == STATE_CALIB_MOVING_DOWN) {
         // В калибровке вниз: DOWN запускает движение вниз
-        Serial.println(F("[ACT] CALIB_MOVING_DOWN: start auto down"));
+        LOG(ACT_CALIB_DOWN);
         smCommandCalibDownStart();
       } else {
-        Serial.println(F("[ACT] Manual DOWN start"));
+        LOG(ACT_MANUAL_DOWN);
         smCommandManualDownStart();
       }
       break;
@@ -141,71 +138,91 @@ void handleRemoteCommand(const RemoteCommand &cmd) {
       if (st == STATE_NEED_CALIB ||
           st == STATE_CALIB_HOMING_UP ||
           st == STATE_CALIB_MOVING_DOWN) {
-        Serial.println(F("[ACT] Ignored: Manual STOP during calibration"));
+        LOG(ACT_STOP_IN_CALIB);
       } else {
-        Serial.println(F("[ACT] Manual move STOP"));
+        LOG(ACT_MANUAL_STOP);
         smCommandManualStop();
       }
       break;
 
     // --- Явные калибровочные команды (резерв) ---
     case CMD_CALIB:
-      Serial.println(F("[ACT] Start calibration (explicit CMD_CALIB)"));
+      LOG(ACT_CALIB);
       smCommandStartCalib();
       break;
 
     case CMD_CALIB_DOWN_START:
-      Serial.println(F("[ACT] Calib: move down (explicit CMD_CALIB_DOWN_START)"));
+      LOG(ACT_CALIB_DOWN_START);
       smCommandCalibDownStart();
       break;
 
     case CMD_CALIB_DOWN_SAVE:
-      Serial.println(F("[ACT] Calib: save bottom (explicit CMD_CALIB_DOWN_SAVE)"));
+      LOG(ACT_CALIB_DOWN_SAVE);
       smCommandCalibDownSave();
       break;
 
-    // --- STOP (экстренный) ---
+    // --- STOP: торможение с ускорением профиля ---
     case CMD_STOP:
-      Serial.println(F("[ACT] EMERGENCY STOP"));
+      LOG(ACT_STOP);
       smCommandStop();
       break;
 
+    // --- ESTOP (аварийный): шаги прекращаются сразу ---
+    case CMD_ESTOP:
+      LOG(ACT_EMERGENCY_STOP);
+      smCommandEmergencyStop();
+      break;
+
+    // --- Пульт проснулся: полный статус в ближайшем кадре ---
+    case CMD_STATUS_REQUEST:
+      LOG(ACT_STATUS_REQUEST);
+      g_statusRequested = true;
+      break;
+
     case CMD_NONE:
     default:
-      Serial.println(F("[ACT] CMD_NONE or unknown cmd"));
+      LOG(ACT_UNKNOWN);
       break;
   }
 
   // Доп. логика: в режиме калибровки вниз, нажатие F1 завершает калибровку
   if (cmd.type == CMD_CALL_FLOOR && cmd.arg == 1 && st == STATE_CALIB_MOVING_DOWN) {
-    Serial.println(F("[ACT] CALIB_MOVING_DOWN: F1 pressed, save bottom & finish"));
+    LOG(ACT_F1_SAVE);
     smCommandCalibDownSave();
   }
 }
 
+// Исполнитель из очереди команд (loop()): arg = type, arg, seq кадра
+void execRemoteCommand(const int32_t *arg) {
+  RemoteCommand cmd;
+  cmd.type = (uint8_t)arg[0];
+  cmd.arg  = (uint8_t)arg[1];
+  cmd.seq  = (uint16_t)arg[2];
+  handleRemoteCommand(cmd);
+}
+
 // ================== ESP-NOW КОЛБЭКИ ==================
 
 void onDataSentBase(const wifi_tx_info_t *info, esp_now_send_status_t status) {
-  Serial.print(F("[ESP-NOW BASE] Send status: "));
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? F("SUCCESS") : F("FAIL"));
+  // Колбэк из задачи WiFi — только запись в кольцо лога и счётчики канала
+  LOG(ESPNOW_SEND_STATUS, status);
+  commOnTxDone(status == ESP_NOW_SEND_SUCCESS);
 }
 
 void onDataRecvBase(const esp_now_recv_info *recv_info, const uint8_t *incomingData, int len) {
-  Serial.print(F("[ESP-NOW BASE] Data received, len="));
-  Serial.println(len);
+  LOG(ESPNOW_RECV, len);
 
   // Запоминаем MAC отправителя (пульта) — потом можно будет слать ему статус
     if (recv_info != nullptr) {
+    // MAC в лог — только когда пульт сменился, а не на каждый пакет
+    if (!g_haveRemoteMac || memcmp(g_remoteMac, recv_info->src_addr, 6) != 0) {
+      const uint8_t *m = recv_info->src_addr;
+      LOG(ESPNOW_REMOTE_MAC, ((int32_t)m[0] << 16) | (m[1] << 8) | m[2],
+                             ((int32_t)m[3] << 16) | (m[4] << 8) | m[5]);
+    }
     memcpy(g_remoteMac, recv_info->src_addr, 6);
     g_haveRemoteMac = true;
 
-    Serial.print(F("  From MAC: "));
-    for (int i = 0; i < 6; i++) {
-      if (i) Serial.print(":");
-      Serial.printf("%02X", g_remoteMac[i]);
-    }
-    Serial.println();
-
     // Добавляем пульт как peer для отправки статуса
     if (!g_remotePeerAdded) {
       esp_now_peer_info_t peerInfo = {};
@@ -216,36 +233,45 @@ void onDataRecvBase(const esp_now_recv_info *recv_info, const uint8_t *incomingD
       esp_err_t r = esp_now_add_peer(&peerInfo);
       if (r == ESP_OK) {
         g_remotePeerAdded = true;
-        Serial.println(F("[COMM] Remote peer added for status TX"));
+        LOG(COMM_PEER_ADDED);
       } else {
-        Serial.print(F("[COMM] Failed to add remote peer, err="));
-        Serial.println((int)r);
+        LOG(COMM_PEER_FAILED, (int32_t)r);
       }
     }
   }
 
 
-  if (len == sizeof(RemoteCommand)) {
-    RemoteCommand cmd;
-    memcpy(&cmd, incomingData, sizeof(RemoteCommand));
-    handleRemoteCommand(cmd);
-  } else {
-    Serial.println(F("  Unknown packet size, ignoring"));
+  FrameReader rd;
+  FrameError err = rd.open(incomingData, len);
+  if (err != FRAME_OK) {
+    commOnBadFrame(err, len);
+    return;
+  }
+  // Колбэк из задачи WiFi: автомат не трогаем, только ставим в очередь для loop().
+  // Повтор (потерялся наш ACK) только подтверждается, второй раз не выполняется.
+  const uint8_t *mac = recv_info ? recv_info->src_addr : g_remoteMac;
+  FrameRecord rec;
+  while (rd.next(rec)) {
+    if (const RemoteCommand *cmd = rec.as<RemoteCommand>()) {
+      commOnCommand(mac, cmd->type, cmd->arg, cmd->seq, execRemoteCommand);
+    }
+    // Остальные записи от пульта базе пока не нужны — пропускаем
   }
 }
 
-void sendStatusToRemoteIfNeeded() {
-  if (!g_haveRemoteMac || !g_remotePeerAdded) return;  // <--- важно
-
-  unsigned long now = millis();
-  if (now - g_lastStatusSentMs < STATUS_PERIOD_MS) return;
-  g_lastStatusSentMs = now;
+static uint8_t speedPercentOf(long speed, long maxSpeed) {
+  if (speed < 0) speed = -speed;
+  if (maxSpeed <= 0 || speed == 0) return 0;
+  long pct = (speed * 100 + maxSpeed / 2) / maxSpeed;
+  return (uint8_t)(pct > 100 ? 100 : pct);
+}
 
-  LiftStatus st;
-  LiftState s = smGetState();
-  st.state        = (uint8_t)s;
-  st.currentFloor = smGetCurrentFloor();
-  st.targetFloor  = smGetTargetFloor();
+// Статус — из снимка задачи движения: автомат и мотор с этого ядра не читаем
+static void buildStatus(LiftStatus &st, const LiftSnapshot &snap, unsigned long now) {
+  LiftState s = (LiftState)snap.state;
+  st.state        = snap.state;
+  st.currentFloor = snap.currentFloor;
+  st.targetFloor  = snap.targetFloor;
 
   st.direction = 0;
   if (s == STATE_MOVING) {
@@ -254,17 +280,95 @@ void sendStatusToRemoteIfNeeded() {
   }
 
   st.error       = (s == STATE_ERROR) ? 1 : 0;
-  st.speedPercent= 0;
+  st.speedPercent= speedPercentOf(snap.speed, snap.maxSpeed);
   st.needCalib   = (s == STATE_NEED_CALIB) ? 1 : 0;
   st.uptimeMs    = now;
+  st.pendingCalls = snap.pendingCalls;
+  st.floorCount   = snap.floorCount;
+  st.etaMs        = snap.etaMs;
+}
+
+// Что видит пульт (скорость, время и ETA сюда не входят — они меняются постоянно)
+static bool statusChanged(const LiftStatus &a, const LiftStatus &b) {
+  return a.state != b.state || a.currentFloor != b.currentFloor || a.targetFloor != b.targetFloor ||
+         a.direction != b.direction || a.error != b.error || a.needCalib != b.needCalib ||
+         a.pendingCalls != b.pendingCalls || a.floorCount != b.floorCount;
+}
+
+// Кадр пульту: ACK на принятые команды + полный статус (по изменению / heartbeat)
+// или кадр движения. Всё одним esp_now_send().
+void sendStatusToRemoteIfNeeded() {
+  if (!g_haveRemoteMac || !g_remotePeerAdded) return;  // <--- важно
+
+  if (g_statusRequested) {
+    g_statusRequested = false;
+    g_statusSentOnce  = false;
+  }
+  unsigned long now = millis();
+  unsigned long sinceStatus = now - g_lastStatusSentMs;
+
+  uint8_t frame[LIFT_FRAME_MAX];
+  FrameWriter w;
+  w.begin(frame, sizeof(frame));
+  uint8_t acks = commAppendAcks(w);
 
-  esp_err_t res = esp_now_send(g_remoteMac, (uint8_t*)&st, sizeof(LiftStatus));
+  LiftSnapshot snap;
+  snapshotRead(snap);
+  LiftStatus st;
+  buildStatus(st, snap, now);
+  bool changed = !g_statusSentOnce || statusChanged(st, g_lastSentStatus);
+  bool sendStatus = (changed && sinceStatus >= STATUS_MIN_GAP_MS) || sinceStatus >= STATUS_HEARTBEAT_MS;
+  long pos = snap.position;
+  bool sendMotion = false;
+
+  if (sendStatus) {
+    *w.add<LiftStatus>() = st;
+  } else if (snap.busy && now - g_lastMotionSentMs >= MOTION_PERIOD_MS && pos != g_lastMotionPos) {
+    // На ходу — позиция и скорость; стоим — ничего, хватает heartbeat
+    long speed = snap.speed;
+    LiftMotion *m = w.add<LiftMotion>();
+    m->position     = (int32_t)pos;
+    m->speed        = (uint16_t)(speed < 0 ? -speed : speed);
+    m->speedPercent = speedPercentOf(speed, snap.maxSpeed);
+    m->direction    = (speed > 0) ? 1 : (speed < 0 ? -1 : 0);
+    sendMotion = true;
+  } else if (!acks) {
+    return;
+  }
+
+  uint8_t len = w.finish();
+  commOnTxStart();
+  esp_err_t res = esp_now_send(g_remoteMac, frame, len);
   if (res != ESP_OK) {
-    Serial.print(F("[COMM] Status send ERR="));
-    Serial.println((int)res);
+    // Статус повторим на следующем проходе; ACK пропали — пульт повторит команду,
+    // повтор будет отсеян и подтверждён
+    LOG(COMM_STATUS_SEND_ERR, (int32_t)res, acks);
+    return;
+  }
+  if (sendStatus) {
+    g_lastSentStatus   = st;
+    g_statusSentOnce   = true;
+    g_lastStatusSentMs = now;
+  }
+  if (sendStatus || sendMotion) {
+    g_lastMotionSentMs = now;  // полный статус заменяет кадр движения
+    g_lastMotionPos    = pos;
   }
 }
 
+// ================== ВХОДЫ ==================
+
+// Фронт кнопки / концевика после антидребезга (из ioUpdate(), в loop())
+void onIoSwitch(IoSwitch sw, bool active, uint32_t atUs) {
+  uint32_t ageUs = micros() - atUs;
+  if (sw == IO_SW_CALIB && active) {
+    // Долгое нажатие — от первого отсчёта нажатия, а не от прохода loop(), где его заметили
+    g_calibPressStart = millis() - ageUs / 1000;
+    g_calibLongPressTriggered = false;
+  }
+  if (sw == IO_SW_TOP) LOG(IO_TOP_SWITCH, active, (int32_t)ageUs);
+}
+
 // ================== SETUP / LOOP ==================
 
 void setup() {
@@ -273,8 +377,6 @@ void setup() {
   Serial.println();
   Serial.println(F("[LIFT] Booting..."));
 
-  pinMode(PIN_CALIB_RESET, INPUT_PULLUP);
-
   ioInit();
   motorInit();
   floorInit();
@@ -285,27 +387,33 @@ void setup() {
 
   Serial.println(F("[LIFT] Setup core done, init ESP-NOW base..."));
   commInitBase();
+  ioOnSwitchChange(onIoSwitch);
+  snapshotPublish();  // сторона связи с первого прохода видит настоящее состояние
+
+#if defined(ARDUINO_ARCH_ESP32)
+  xTaskCreatePinnedToCore(motionTask, "motion", MOTION_STACK, nullptr, MOTION_PRIORITY, nullptr, MOTION_CORE);
+  xTaskCreatePinnedToCore(commTask,   "comm",   COMM_STACK,   nullptr, COMM_PRIORITY,   nullptr, COMM_CORE);
+#endif
   Serial.println(F("[LIFT] Setup done."));
 }
 
-void loop() {
-  // Обновляем вводы (кнопки, концевики, потенциометр и т.д.)
+// ---- Сторона движения: входы, мотор, команды, автомат. Один проход. ----
+static void motionLoop() {
+  uint32_t passStart = micros();
+  benchLoopTick();
+
+  // Снимок входов (отсчёты идут в фоне) и уведомления об изменениях: ручка скорости, кнопки
   ioUpdate();
 
   // --- Обработка длинного нажатия кнопки перекалибровки на базе ---
-  bool pressed = (digitalRead(PIN_CALIB_RESET) == LOW);
+  // Начало нажатия ставит onIoSwitch() по метке фронта
+  bool pressed = ioReadCalibButton();
   unsigned long now = millis();
 
-  if (pressed && !g_calibBtnPrev) {
-    // начало нажатия
-    g_calibPressStart = now;
-    g_calibLongPressTriggered = false;
-  }
-
   if (pressed && !g_calibLongPressTriggered) {
     if (now - g_calibPressStart >= CALIB_LONG_PRESS_MS) {
       g_calibLongPressTriggered = true;
-      Serial.println(F("[CALIB] Base button long press: FULL RECALIBRATION"));
+      LOG(CALIB_BUTTON_RESET);
 
       // 1) Сброс калибровки (верх/низ/этажи — через floor_manager/calibration_manager)
       calibForceReset();
@@ -315,20 +423,12 @@ void loop() {
     }
   }
 
-  if (!pressed && g_calibBtnPrev) {
-    // кнопка отпущена – можно что-то залогировать, если надо
-  }
-
-  g_calibBtnPrev = pressed;
-
   // Обслуживаем движение мотора
   motorService();
+  benchService();
 
-  // Обновляем приём команд по Serial (парсер)
-  serialUpdate();
-
-  // Обновление связи с пультом (если что-то есть в comm_interface)
-  commUpdate();
+  // Все команды (пульт + Serial) выполняются здесь, по порядку поступления
+  cmdQueueDispatch();
 
   // Периодический тик автомата состояний
   unsigned long now2 = millis();
@@ -336,10 +436,72 @@ void loop() {
     g_lastTick = now2;
     smTick();
   }
-    // ... после smTick()
+
+  // Итог прохода — стороне связи
+  snapshotPublish();
+  telemetrySample(micros() - passStart);
+}
+
+// ---- Сторона связи: приём Serial, кадр пульту, лог. Один проход. ----
+static void commLoop() {
+  // Обновляем приём команд по Serial (парсер) — команды уходят в очередь стороне движения
+  serialUpdate();
+
+  // Кадр пульту (ACK + статус) — из свежего снимка, чтобы изменения уходили без задержки
   sendStatusToRemoteIfNeeded();
+
+  // Ответы STATUS / FLOORS, лог и кадры телеметрии — в последнюю очередь и только в свободное
+  // место TX FIFO
+  serialService();
+  logService();
+  telemetryService();
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+static void motionTask(void *) {
+  bool polling = false;
+  for (;;) {
+    motionLoop();
+    // Шаги — в ISR / RMT, здесь только планирование: проход раз в тик хватает с запасом.
+    // Опрос шагов из цикла (STEP_POLL) крутится без пауз, но вровень с IDLE1 и уступая ей
+    // каждый проход — ядро 1 не захвачено целиком.
+    bool poll = stepGenGetMode() == STEPGEN_POLLING;
+    if (poll != polling) {
+      polling = poll;
+      vTaskPrioritySet(nullptr, polling ? MOTION_POLL_PRIORITY : MOTION_PRIORITY);
+    }
+    if (polling) {
+      taskYIELD();
+    } else {
+      vTaskDelay(1);
+    }
+  }
+}
+
+static void commTask(void *) {
+  for (;;) {
+    commLoop();
+    vTaskDelay(1);
+  }
 }
 
+void loop() {
+  // Работа — в motionTask / commTask; задаче Arduino на ядре 1 делать нечего
+  vTaskDelete(nullptr);
+}
+
+#else  // ---- Симулятор: обе стороны по очереди в одном loop() ----
+
+// Связь первой: строка Serial, принятая в этом проходе, в нём же и выполняется (как на
+// ESP32, где стороны идут одновременно); статус уходит из снимка прошлого прохода.
+void loop() {
+  commLoop();
+  motionLoop();
+}
+
+#endif
+
 // ================== ИНИЦИАЛИЗАЦИЯ ESP-NOW НА БАЗЕ ==================
 
 void commInitBase() {
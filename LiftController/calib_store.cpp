@@ -0,0 +1,103 @@
+#include "calib_store.h"
+#include "logger.h"
+#include <Preferences.h>
+
+static const char *NVS_NAMESPACE = "lift";
+static const char *NVS_KEY       = "calib";
+
+static Preferences g_prefs;
+static bool        g_open       = false;
+static CalibRecord g_saved;              // копия того, что сейчас лежит в NVS
+static bool        g_haveSaved  = false;
+static uint32_t    g_writeCount = 0;
+
+// CRC32 (IEEE 802.3, отражённый полином), побитно — запись маленькая и пишется редко
+static uint32_t crc32(const uint8_t *data, size_t len) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t recordCrc(const CalibRecord &rec) {
+  return crc32((const uint8_t *)&rec, offsetof(CalibRecord, crc));
+}
+
+void calibStoreInit() {
+  if (!g_open) g_open = g_prefs.begin(NVS_NAMESPACE, false);  // повторный begin() вернул бы false
+  g_haveSaved = false;
+  if (!g_open) {
+    Serial.println("[NVS] Open FAILED, calibration will not persist");
+  }
+}
+
+bool calibStoreLoad(CalibRecord *out) {
+  if (!g_open) return false;
+
+  size_t len = g_prefs.getBytesLength(NVS_KEY);
+  if (len == 0) {
+    Serial.println("[NVS] No calibration record");
+    return false;
+  }
+  if (len != sizeof(CalibRecord)) {
+    Serial.print("[NVS] Calibration record size mismatch: ");
+    Serial.println((unsigned)len);
+    return false;
+  }
+
+  CalibRecord rec;
+  g_prefs.getBytes(NVS_KEY, &rec, sizeof(rec));
+  if (rec.magic != CALIB_RECORD_MAGIC || rec.version != CALIB_RECORD_VERSION) {
+    Serial.print("[NVS] Calibration record version ");
+    Serial.print(rec.version);
+    Serial.println(" not supported");
+    return false;
+  }
+  if (rec.crc != recordCrc(rec)) {
+    Serial.println("[NVS] Calibration record CRC mismatch");
+    return false;
+  }
+  if (rec.floorCount < 2 || rec.floorCount > FLOOR_MAX || rec.fullTravelSteps <= 0) {
+    Serial.println("[NVS] Calibration record out of range");
+    return false;
+  }
+
+  g_saved     = rec;
+  g_haveSaved = true;
+  *out = rec;
+  return true;
+}
+
+void calibStoreSave(CalibRecord *rec) {
+  rec->magic    = CALIB_RECORD_MAGIC;
+  rec->version  = CALIB_RECORD_VERSION;
+  rec->reserved = 0;
+  rec->crc      = recordCrc(*rec);
+
+  if (!g_open) return;
+  if (g_haveSaved && memcmp(&g_saved, rec, sizeof(CalibRecord)) == 0) return;
+
+  if (g_prefs.putBytes(NVS_KEY, rec, sizeof(CalibRecord)) != sizeof(CalibRecord)) {
+    LOG(NVS_WRITE_FAILED);
+    return;
+  }
+  g_saved     = *rec;
+  g_haveSaved = true;
+  g_writeCount++;
+}
+
+void calibStoreErase() {
+  g_haveSaved = false;
+  if (!g_open) return;
+  g_prefs.remove(NVS_KEY);
+  g_writeCount++;
+  LOG(NVS_ERASED);
+}
+
+uint32_t calibStoreWriteCount() {
+  return g_writeCount;
+}
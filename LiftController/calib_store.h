@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+#include "floor_manager.h"
+
+// Хранение калибровки в NVS (Preferences): одна версионированная запись с CRC32.
+// NVS сама распределяет запись по страницам (wear levelling); мы дополнительно
+// пишем только если запись изменилась.
+
+static const uint16_t CALIB_RECORD_MAGIC   = 0x4C43;  // 'LC'
+static const uint8_t  CALIB_RECORD_VERSION = 1;
+
+struct CalibRecord {
+  uint16_t magic;
+  uint8_t  version;
+  uint8_t  floorCount;
+  int32_t  fullTravelSteps;
+  int32_t  topMarginSteps;            // от верхнего этажа до концевика
+  int32_t  floorPos[FLOOR_MAX + 1];   // 1..floorCount
+  int32_t  lastPosition;              // позиция кабины при последней остановке
+  uint8_t  cleanShutdown;             // 1 — стояли на месте, lastPosition верна
+  uint8_t  floorTaught;
+  uint16_t reserved;
+  uint32_t crc;                       // CRC32 всех полей выше
+};
+
+void calibStoreInit();
+// false — записи нет, другая версия или CRC не сошёлся
+bool calibStoreLoad(CalibRecord *out);
+// Заполняет magic/version/crc; пишет в NVS, только если запись отличается от сохранённой
+void calibStoreSave(CalibRecord *rec);
+void calibStoreErase();
+
+uint32_t calibStoreWriteCount();  // сколько раз реально писали в NVS с загрузки
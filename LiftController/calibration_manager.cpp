@@ -1,85 +1,131 @@
 #include "calibration_manager.h"
 #include "motor_controller.h"
 #include "floor_manager.h"
+#include "calib_store.h"
+#include "logger.h"
 
-// Запас от верхнего концевика до 3-го этажа (в шагах)
+// Запас от верхнего концевика до верхнего этажа (в шагах)
 static const long TOP_MARGIN_STEPS = 200;   // подберёшь опытно
 static const long MIN_TRAVEL_STEPS = 200;   // минимальный допустимый ход
 
 // Наш внутренний флаг валидности калибровки
 static bool g_calibValid = false;
+static bool g_bootPositionTrusted = false;
+static long g_topMargin = TOP_MARGIN_STEPS;  // из NVS — тот, с которым калибровали
 
 void calibInit() {
   Serial.println("[CALIB] Init");
+  calibStoreInit();
 
-  // Синхронизируем флаг с менеджером этажей.
-  // floorHasValidCalibration() уже знает, есть ли сохранённая калибровка.
+  g_calibValid = false;
+  g_bootPositionTrusted = false;
+  g_topMargin = TOP_MARGIN_STEPS;
+
+  CalibRecord rec;
+  if (!calibStoreLoad(&rec)) return;
+
+  long pos[FLOOR_MAX + 1];
+  for (uint8_t f = 0; f <= FLOOR_MAX; f++) pos[f] = rec.floorPos[f];
+  if (!floorRestore(rec.fullTravelSteps, rec.floorCount, pos, rec.floorTaught != 0)) {
+    Serial.println("[CALIB] Stored floor table invalid, calibration needed");
+    return;
+  }
+  g_topMargin  = rec.topMarginSteps;
   g_calibValid = floorHasValidCalibration();
+
+  if (rec.cleanShutdown) {
+    motorSetCurrentPosition(rec.lastPosition);
+    g_bootPositionTrusted = true;
+  }
+  Serial.print("[CALIB] Restored from NVS, ");
+  Serial.println(rec.cleanShutdown ? "position trusted" : "position unknown (unclean shutdown)");
 }
 
 bool calibHasValidData() {
   return g_calibValid;
 }
 
+bool calibBootPositionTrusted() {
+  return g_bootPositionTrusted;
+}
+
+long calibGetTopSwitchPosition() {
+  return floorGetFullTravelSteps() + g_topMargin;
+}
+
+void calibPersist(bool atRest) {
+  if (!g_calibValid) return;
+
+  CalibRecord rec;
+  memset(&rec, 0, sizeof(rec));  // неиспользуемые этажи — нули, чтобы сравнение было честным
+  rec.floorCount      = floorGetCount();
+  rec.fullTravelSteps = floorGetFullTravelSteps();
+  rec.topMarginSteps  = g_topMargin;
+  for (uint8_t f = 1; f <= rec.floorCount; f++) {
+    rec.floorPos[f] = floorGetPositionForFloor(f);
+  }
+  rec.lastPosition  = motorGetCurrentPosition();
+  rec.cleanShutdown = atRest ? 1 : 0;
+  rec.floorTaught   = floorIsTaught() ? 1 : 0;
+  calibStoreSave(&rec);
+}
+
 void calibForceReset() {
-  Serial.println("[CALIB] Force reset calibration");
+  LOG(CALIB_FORCE_RESET);
 
   // Сброс хода лифта.
   // 0 шагов однозначно означает "нет калибровки" для floor_manager.
   floorSetFullTravelSteps(0);
+  calibStoreErase();
 
   g_calibValid = false;
+  g_bootPositionTrusted = false;
 }
 
 // Шаг 1: старт хоминга вверх до концевика
 void calibStartHomingUp() {
-  Serial.println("[CALIB] Homing UP: manual up");
+  LOG(CALIB_HOMING_UP);
   // Едем вверх в ручном режиме.
   // Направление вверх задано в motorManualUp() (через знак скорости).
   motorManualUp();
 }
 
 // Вызывается, когда в STATE_CALIB_HOMING_UP сработал верхний концевик
-void calibOnTopReached() {
+void calibOnTopReached(long pastSwitch) {
   // Останавливаемся на концевике
-  motorStop();
+  motorEmergencyStop();
 
-  // Считаем точку концевика как 0 для калибровки
-  motorSetCurrentPosition(0);
-  Serial.println("[CALIB] Top reached, position set to 0 (TopSwitch)");
+  // Считаем точку концевика как 0 для калибровки; кабина уже на pastSwitch выше неё
+  motorSetCurrentPosition(pastSwitch);
+  LOG(CALIB_TOP_REACHED);
 }
 
 // Шаг 2: команда на движение вниз в калибровке
 void calibStartMovingDown() {
-  Serial.println("[CALIB] Moving DOWN for calibration (manual down)");
+  LOG(CALIB_MOVING_DOWN);
   // Просто едем вниз. Позиция будет уходить в минус.
   motorCalibDownFast();
 }
 
 // Шаг 3: остановка внизу и сохранение калибровки
 void calibSaveBottom() {
-  // Остановить движение
-  motorStop();
+  // Остановить движение (сразу: позиция здесь и есть низ хода)
+  motorEmergencyStop();
 
   // Текущая позиция (будет отрицательной, т.к. от 0 (верх) поехали вниз)
   long bottomPos = motorGetCurrentPosition();
 
-  Serial.print("[CALIB] Bottom raw position = ");
-  Serial.println(bottomPos);
+  LOG(CALIB_BOTTOM_RAW, bottomPos);
 
   long distanceBottomToTopSwitch = labs(bottomPos);
 
-  Serial.print("[CALIB] Distance Bottom -> TopSwitch = ");
-  Serial.println(distanceBottomToTopSwitch);
+  LOG(CALIB_DISTANCE, distanceBottomToTopSwitch);
 
-  // Учитываем запас сверху от концевика до 3-го этажа
+  // Учитываем запас сверху от концевика до верхнего этажа
   long full = distanceBottomToTopSwitch - TOP_MARGIN_STEPS;
 
   if (full < MIN_TRAVEL_STEPS) {
-    Serial.print("[CALIB] WARNING: fullTravelSteps too small (");
-    Serial.print(full);
-    Serial.print("), forcing to MIN_TRAVEL_STEPS=");
-    Serial.println(MIN_TRAVEL_STEPS);
+    LOG(CALIB_TRAVEL_TOO_SMALL, full, MIN_TRAVEL_STEPS);
     full = MIN_TRAVEL_STEPS;
   }
 
@@ -89,12 +135,12 @@ void calibSaveBottom() {
   // Переносим систему координат: низ = 0
   motorSetCurrentPosition(0);
 
-  // Калибровка теперь валидна
+  // Калибровка теперь валидна — сохраняем (кабина стоит внизу)
   g_calibValid = true;
+  g_topMargin  = TOP_MARGIN_STEPS;
+  calibPersist(true);
 
-  Serial.print("[CALIB] Calibration done. fullTravelSteps=");
-  Serial.println(full);
-  Serial.println("[CALIB] Floor1=0, Floor2=full/2, Floor3=full (below top switch)");
+  LOG(CALIB_DONE, full);
 }
 
 void calibUpdate() {
@@ -6,7 +6,7 @@ void calibInit();
 
 // Шаги процесса калибровки
 void calibStartHomingUp();   // старт хоминга вверх до концевика
-void calibOnTopReached();    // вызов при срабатывании верхнего концевика в режиме калибровки
+void calibOnTopReached(long pastSwitch);  // верхний концевик в режиме калибровки; pastSwitch — шагов проехали после фронта
 void calibStartMovingDown(); // старт движения вниз в режиме калибровки
 void calibSaveBottom();      // остановка внизу и сохранение калибровки
 void motorCalibDownFast();   // теперь вниз ×2
@@ -15,6 +15,14 @@ void calibUpdate();
 
 // Статус калибровки
 bool calibHasValidData();  // есть ли валидная калибровка (по нашим данным)
+// Позиция кабины восстановлена из NVS после чистой остановки (иначе её надо искать хомингом)
+bool calibBootPositionTrusted();
+// Позиция верхнего концевика в координатах этажей (низ = 0)
+long calibGetTopSwitchPosition();
+
+// Сохранить калибровку и текущую позицию в NVS (пишется только изменившееся).
+// atRest = true — кабина стоит и позиция точна; false — перед началом движения.
+void calibPersist(bool atRest);
 
 // Сброс калибровки (для долгого нажатия кнопки на базе)
 void calibForceReset();    // стереть калибровку и пометить как "нет калибровки"
@@ -1,11 +1,99 @@
 #include "comm_interface.h"
-#include <Arduino.h>
+#include "reliable_link.h"
+#include "spsc_queue.h"
+#include "logger.h"
+#include <esp_now.h>
+
+// ACK ждут отправки из loop() (кладёт задача WiFi) и уходят в кадре статуса
+// тому пульту, от которого был последний пакет
+static CommandReceiver                                  g_receiver;   // только задача WiFi
+static SpscQueue<CommandAck, LIFT_MAX_ACKS_PER_FRAME>   g_ackQueue;
+
+// Счётчики: rx* — задача WiFi, ack* — loop(), tx* — колбэк отправки
+struct LinkStats {
+  uint32_t rxCommands;   // новые команды, поставлены в очередь
+  uint32_t rxDuplicates; // повторы (ACK ушёл, команда не выполнялась)
+  uint32_t rxNoAck;      // очередь команд полна — без ACK, пульт повторит
+  uint32_t rxBadFrames;  // не прошли проверку кадра
+  uint32_t rxBadVersion; // из них — чужая версия протокола
+  uint32_t ackSent;      // записей ACK в отправленных кадрах
+  uint32_t txDone;       // кадров базы с ответом MAC-уровня
+  uint32_t txFailed;
+};
+
+static LinkStats             g_stats;
+static RttHistogram          g_txRtt;
+static std::atomic<uint32_t> g_txStartUs{0};  // 0 — нет кадра в полёте
 
 void commInit() {
-  // Пока заглушка. Здесь будет ESP-NOW / пульт.
-  Serial.println("[COMM] Init (stub)");
+  g_receiver.reset();
+  g_txRtt.reset();
+  memset(&g_stats, 0, sizeof(g_stats));
+  Serial.printf("[COMM] Init: protocol v%u, command ACK + duplicate window\r\n", LIFT_PROTO_VERSION);
+}
+
+void commOnCommand(const uint8_t mac[6], uint8_t type, uint8_t arg, uint16_t seq, CommandExec exec) {
+  CommandAck ack;
+  ack.seq  = seq;
+  ack.type = type;
+
+  if (g_receiver.check(mac, seq) == SEQ_DUPLICATE) {
+    g_stats.rxDuplicates++;
+    LOG(COMM_DUPLICATE, seq, type);
+    ack.status = LINK_ACK_DUPLICATE;
+  } else if (cmdQueuePush(CMD_SRC_REMOTE, exec, type, arg, seq)) {
+    g_receiver.accept(mac, seq);
+    g_stats.rxCommands++;
+    ack.status = LINK_ACK_OK;
+  } else {
+    g_stats.rxNoAck++;
+    return;
+  }
+  // Очередь ACK полна — пульт не дождётся и повторит, повтор будет отсеян
+  g_ackQueue.push(ack);
+}
+
+uint8_t commAppendAcks(FrameWriter &w) {
+  uint8_t n = 0;
+  while (const CommandAck *a = g_ackQueue.peek()) {
+    CommandAck *rec = w.add<CommandAck>();
+    if (!rec) break;
+    *rec = *a;
+    g_ackQueue.drop();
+    n++;
+  }
+  g_stats.ackSent += n;
+  return n;
+}
+
+void commOnBadFrame(FrameError err, int len) {
+  g_stats.rxBadFrames++;
+  if (err == FRAME_BAD_VERSION) g_stats.rxBadVersion++;
+  LOG(ESPNOW_BAD_FRAME, (int32_t)err, len);
+}
+
+void commOnTxStart() {
+  uint32_t now = micros();
+  g_txStartUs.store(now ? now : 1, std::memory_order_relaxed);
+}
+
+void commOnTxDone(bool ok) {
+  uint32_t start = g_txStartUs.exchange(0, std::memory_order_relaxed);
+  if (!ok) {
+    g_stats.txFailed++;
+    return;
+  }
+  g_stats.txDone++;
+  if (start) g_txRtt.add(micros() - start);
 }
 
-void commUpdate() {
-  // Пока ничего, но каркас есть.
+void commPrintStats(Stream &out) {
+  out.printf("[LINK] rx %lu cmds, %lu duplicates, %lu not acked (queue full); ack %lu sent\r\n",
+             (unsigned long)g_stats.rxCommands, (unsigned long)g_stats.rxDuplicates,
+             (unsigned long)g_stats.rxNoAck, (unsigned long)g_stats.ackSent);
+  out.printf("[LINK] rx %lu bad frames (%lu wrong version, want v%u)\r\n",
+             (unsigned long)g_stats.rxBadFrames, (unsigned long)g_stats.rxBadVersion, LIFT_PROTO_VERSION);
+  out.printf("[LINK] tx %lu delivered, %lu failed (MAC-level)\r\n",
+             (unsigned long)g_stats.txDone, (unsigned long)g_stats.txFailed);
+  g_txRtt.printTo(out, "[LINK] tx");
 }
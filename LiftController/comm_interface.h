@@ -1,4 +1,28 @@
 #pragma once
+#include <Arduino.h>
+#include "command_queue.h"
+#include "lift_protocol.h"
+
+// Связь с пультом на стороне базы: приём команд с подтверждением (ACK),
+// отсев повторов и статистика канала (Serial: LINK).
+// Протокол повторов — reliable_link.h, формат кадров — lift_protocol.h.
 
 void commInit();
-void commUpdate();
+
+// Из loop(): накопившиеся ACK — записями в кадр пульту (вместе со статусом).
+// Возвращает, сколько добавлено; что не влезло — в следующий кадр.
+uint8_t commAppendAcks(FrameWriter &w);
+
+// Из колбэка приёма ESP-NOW (задача WiFi). Повтор — только ACK, без выполнения.
+// Новая команда ставится в очередь команд; ACK — только если встала
+// (очередь полна → без ACK, пульт повторит).
+void commOnCommand(const uint8_t mac[6], uint8_t type, uint8_t arg, uint16_t seq, CommandExec exec);
+
+// Замер RTT кадров базы: перед esp_now_send() и из колбэка отправки
+void commOnTxStart();
+void commOnTxDone(bool ok);
+
+// Из колбэка приёма: кадр не прошёл проверку (версия, CRC, длина)
+void commOnBadFrame(FrameError err, int len);
+
+void commPrintStats(Stream &out);
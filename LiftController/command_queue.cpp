@@ -0,0 +1,75 @@
+#include "command_queue.h"
+#include "spsc_queue.h"
+#include "logger.h"
+
+// Пульт шлёт по нажатию кнопки — 16 хватает с запасом на пачку повторов.
+// Serial сам не переполняет очередь: serialUpdate() не читает строку, пока нет места.
+static const uint16_t CMDQ_REMOTE_SIZE = 16;
+static const uint16_t CMDQ_SERIAL_SIZE = 8;
+
+// Сколько команд выполнить за один проход loop() (остальные — на следующем)
+static const uint8_t CMDQ_MAX_PER_DISPATCH = 8;
+
+static SpscQueue<QueuedCommand, CMDQ_REMOTE_SIZE> g_remoteQueue;
+static SpscQueue<QueuedCommand, CMDQ_SERIAL_SIZE> g_serialQueue;
+
+static std::atomic<uint32_t> g_ticket{0};
+static std::atomic<uint32_t> g_pushed[CMD_SRC_COUNT];
+static uint16_t              g_highWater[CMD_SRC_COUNT] = {0};
+
+bool IRAM_ATTR cmdQueuePush(CommandSource src, CommandExec exec, int32_t a0, int32_t a1, int32_t a2) {
+  QueuedCommand c;
+  c.ticket = g_ticket.fetch_add(1, std::memory_order_relaxed);
+  c.exec   = exec;
+  c.arg[0] = a0;
+  c.arg[1] = a1;
+  c.arg[2] = a2;
+
+  bool ok = (src == CMD_SRC_REMOTE) ? g_remoteQueue.push(c) : g_serialQueue.push(c);
+  if (!ok) {
+    LOG(CMDQ_OVERFLOW, src);
+    return false;
+  }
+  g_pushed[src].fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+uint16_t cmdQueueFree(CommandSource src) {
+  return (src == CMD_SRC_REMOTE) ? g_remoteQueue.freeSpace() : g_serialQueue.freeSpace();
+}
+
+uint8_t cmdQueueDispatch() {
+  uint16_t depth = g_remoteQueue.size();
+  if (depth > g_highWater[CMD_SRC_REMOTE]) g_highWater[CMD_SRC_REMOTE] = depth;
+  depth = g_serialQueue.size();
+  if (depth > g_highWater[CMD_SRC_SERIAL]) g_highWater[CMD_SRC_SERIAL] = depth;
+
+  uint8_t done = 0;
+  while (done < CMDQ_MAX_PER_DISPATCH) {
+    const QueuedCommand *r = g_remoteQueue.peek();
+    const QueuedCommand *s = g_serialQueue.peek();
+    if (!r && !s) break;
+
+    // Старший по номеру ждёт (разность со знаком — переполнение номера не страшно)
+    bool takeRemote = r && (!s || (int32_t)(r->ticket - s->ticket) < 0);
+    QueuedCommand c = takeRemote ? *r : *s;
+    if (takeRemote) g_remoteQueue.drop();
+    else            g_serialQueue.drop();
+
+    if (c.exec) c.exec(c.arg);
+    done++;
+  }
+  return done;
+}
+
+uint32_t cmdQueueGetPushed(CommandSource src) {
+  return (src < CMD_SRC_COUNT) ? g_pushed[src].load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t cmdQueueGetOverflow(CommandSource src) {
+  return (src == CMD_SRC_REMOTE) ? g_remoteQueue.overflowCount() : g_serialQueue.overflowCount();
+}
+
+uint16_t cmdQueueGetHighWater(CommandSource src) {
+  return (src < CMD_SRC_COUNT) ? g_highWater[src] : 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+
+// Единый путь команд к автомату.
+// Источники только кладут команду в свою очередь SPSC (пульт — из задачи WiFi,
+// Serial — из задачи связи), выполняет их cmdQueueDispatch() в задаче движения в одной
+// точке, перед smTick(). Так автомат и мотор трогает только задача движения, а колбэк
+// ESP-NOW и приём Serial не ждут ни автомата, ни друг друга.
+//
+// Каждая команда получает сквозной номер при постановке; диспетчер сливает обе
+// очереди по этому номеру — команды выполняются в порядке поступления.
+
+enum CommandSource : uint8_t {
+  CMD_SRC_REMOTE = 0,
+  CMD_SRC_SERIAL,
+  CMD_SRC_COUNT
+};
+
+// Исполнитель команды (вызывается из задачи движения); arg — то, что положил источник
+typedef void (*CommandExec)(const int32_t *arg);
+
+struct QueuedCommand {
+  uint32_t    ticket;   // сквозной номер постановки
+  CommandExec exec;
+  int32_t     arg[3];
+};
+
+// Постановка. Для каждого источника — ровно один писатель (своя задача).
+// false — очередь полна, команда отброшена и посчитана.
+bool cmdQueuePush(CommandSource src, CommandExec exec, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0);
+
+// Свободных мест в очереди источника (писатель может придержать ввод)
+uint16_t cmdQueueFree(CommandSource src);
+
+// Из задачи движения: выполнить всё, что накопилось. Возвращает число выполненных команд.
+uint8_t cmdQueueDispatch();
+
+// Счётчики: поставлено / отброшено из-за переполнения / наибольшая глубина очереди
+uint32_t cmdQueueGetPushed(CommandSource src);
+uint32_t cmdQueueGetOverflow(CommandSource src);
+uint16_t cmdQueueGetHighWater(CommandSource src);
@@ -0,0 +1,99 @@
+#include "encoder.h"
+#include "logger.h"
+#include <driver/pulse_cnt.h>
+
+static const int PIN_ENC_A = 26;
+static const int PIN_ENC_B = 27;
+
+static const int      ENC_PCNT_LIMIT    = 30000;  // дальше — накопление по точкам наблюдения
+static const uint32_t ENC_GLITCH_NS     = 1000;   // импульсы короче — помеха
+
+static pcnt_unit_handle_t    g_unit   = nullptr;
+static pcnt_channel_handle_t g_chanA  = nullptr;
+static pcnt_channel_handle_t g_chanB  = nullptr;
+static long                  g_offset = 0;        // шагов: позиция при нулевом счёте
+
+static long countToSteps(long count) {
+  // Округление к ближайшему шагу: 2.5 отсчёта на шаг, дребезг на краю отсчёта не виден
+  int64_t num = (int64_t)count * MOTOR_STEPS_PER_REV;
+  int64_t half = ENC_COUNTS_PER_REV / 2;
+  return (long)((num >= 0 ? num + half : num - half) / ENC_COUNTS_PER_REV);
+}
+
+void encoderEnd() {
+  if (g_unit) {
+    pcnt_unit_stop(g_unit);
+    pcnt_unit_disable(g_unit);
+  }
+  if (g_chanA) pcnt_del_channel(g_chanA);
+  if (g_chanB) pcnt_del_channel(g_chanB);
+  if (g_unit) pcnt_del_unit(g_unit);
+  g_chanA = nullptr;
+  g_chanB = nullptr;
+  g_unit  = nullptr;
+}
+
+bool encoderBegin() {
+  if (g_unit) return true;
+  pinMode(PIN_ENC_A, INPUT_PULLUP);
+  pinMode(PIN_ENC_B, INPUT_PULLUP);
+
+  pcnt_unit_config_t unit = {};
+  unit.low_limit  = -ENC_PCNT_LIMIT;
+  unit.high_limit = ENC_PCNT_LIMIT;
+  unit.flags.accum_count = 1;
+
+  pcnt_chan_config_t a = {};
+  a.edge_gpio_num  = PIN_ENC_A;
+  a.level_gpio_num = PIN_ENC_B;
+  pcnt_chan_config_t b = {};
+  b.edge_gpio_num  = PIN_ENC_B;
+  b.level_gpio_num = PIN_ENC_A;
+
+  pcnt_glitch_filter_config_t filter = {};
+  filter.max_glitch_ns = ENC_GLITCH_NS;
+
+  bool ok = pcnt_new_unit(&unit, &g_unit) == ESP_OK &&
+            pcnt_unit_set_glitch_filter(g_unit, &filter) == ESP_OK &&
+            pcnt_new_channel(g_unit, &a, &g_chanA) == ESP_OK &&
+            pcnt_new_channel(g_unit, &b, &g_chanB) == ESP_OK;
+  if (ok) {
+    // x4: вверх A опережает B — каждый фронт A и B даёт +1
+    pcnt_channel_set_edge_action(g_chanA, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+    pcnt_channel_set_level_action(g_chanA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    pcnt_channel_set_edge_action(g_chanB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    pcnt_channel_set_level_action(g_chanB, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    pcnt_unit_add_watch_point(g_unit, ENC_PCNT_LIMIT);
+    pcnt_unit_add_watch_point(g_unit, -ENC_PCNT_LIMIT);
+    ok = pcnt_unit_enable(g_unit) == ESP_OK && pcnt_unit_clear_count(g_unit) == ESP_OK &&
+         pcnt_unit_start(g_unit) == ESP_OK;
+  }
+  if (!ok) {
+    LOG(ENC_PCNT_FAILED);
+    encoderEnd();
+    return false;
+  }
+  g_offset = 0;
+  LOG(ENC_PCNT_PINS, PIN_ENC_A, PIN_ENC_B);
+  LOG(ENC_PCNT_SCALE, ENC_COUNTS_PER_REV, MOTOR_STEPS_PER_REV);
+  return true;
+}
+
+bool encoderIsActive() {
+  return g_unit != nullptr;
+}
+
+long encoderGetCount() {
+  if (!g_unit) return 0;
+  int count = 0;
+  pcnt_unit_get_count(g_unit, &count);
+  return count;
+}
+
+long encoderGetSteps() {
+  return g_offset + countToSteps(encoderGetCount());
+}
+
+void encoderSetSteps(long steps) {
+  g_offset = steps - countToSteps(encoderGetCount());
+}
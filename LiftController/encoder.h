@@ -0,0 +1,24 @@
+#pragma once
+#include <Arduino.h>
+
+// Необязательный квадратурный энкодер на валу мотора.
+// Счёт x4 ведёт PCNT (два канала: A по фронтам с B как уровнем и наоборот) — без прерываний,
+// предел счётчика расширяет accum_count. Позиция отдаётся в шагах мотора, на той же шкале,
+// что motorGetCurrentPosition(): encoderSetSteps() совмещает шкалы.
+// Сверку с заданной позицией (срыв, поправка дрейфа) делает motor_controller.
+// Без энкодера на плате — ENCODER_ENABLED 0 (по умолчанию), команда Serial ENCODER 0|1.
+
+#ifndef ENCODER_ENABLED
+#define ENCODER_ENABLED 0
+#endif
+
+static const long ENC_COUNTS_PER_REV  = 4000;  // 1000 линий x4
+static const long MOTOR_STEPS_PER_REV = 1600;  // 200 шагов x 1/8
+
+bool encoderBegin();            // занять PCNT; false — нет блока (остаёмся без обратной связи)
+void encoderEnd();
+bool encoderIsActive();
+
+long encoderGetSteps();         // позиция по энкодеру, шагов
+void encoderSetSteps(long steps);
+long encoderGetCount();         // сырой счёт x4 (для STATUS)
@@ -1,19 +1,33 @@
 #include "floor_manager.h"
+#include "logger.h"
 
-// Пока всё хранится только в RAM.
-// Потом сюда добавим сохранение в NVS/EEPROM.
+// Таблица этажей в RAM; в NVS её сохраняет calibration_manager (через calib_store)
 
-static bool   hasCalib = false;
-static long   fullTravelSteps = 0;
-static long   floorPos[4]; // 1..3
+static const uint8_t FLOOR_COUNT_DEFAULT = 3;
+// Минимальное расстояние между соседними этажами (в шагах)
+static const long    FLOOR_MIN_GAP       = 50;
+
+static bool    hasCalib = false;
+static long    fullTravelSteps = 0;
+static uint8_t floorCount = FLOOR_COUNT_DEFAULT;
+static long    floorPos[FLOOR_MAX + 1]; // 1..floorCount, по возрастанию
+static bool    floorTaught = false;     // позиции выучены, а не разложены равномерно
+
+// Равномерная раскладка: этаж 1 внизу (0), последний — весь ход
+static void layoutEvenly() {
+  floorPos[0] = 0;
+  for (uint8_t f = 1; f <= floorCount; f++) {
+    floorPos[f] = (floorCount > 1) ? (fullTravelSteps * (f - 1)) / (floorCount - 1) : 0;
+  }
+  floorTaught = false;
+}
 
 void floorInit() {
-  // TODO: читать из NVS.
+  // Сохранённую калибровку потом подставит calibInit() через floorRestore()
   hasCalib = false;
   fullTravelSteps = 0;
-  floorPos[1] = 0;
-  floorPos[2] = 0;
-  floorPos[3] = 0;
+  floorCount = FLOOR_COUNT_DEFAULT;
+  layoutEvenly();
   Serial.println("[FLOOR] Init (no calib)");
 }
 
@@ -21,19 +35,108 @@ bool floorHasValidCalibration() {
   return hasCalib && fullTravelSteps > 0;
 }
 
+uint8_t floorGetCount() {
+  return floorCount;
+}
+
 long floorGetPositionForFloor(uint8_t floor) {
-  if (floor < 1 || floor > 3) return 0;
+  if (floor < 1 || floor > floorCount) return 0;
   return floorPos[floor];
 }
 
+// Бинарный поиск по отсортированным позициям: первый этаж не ниже position,
+// затем сравниваем с соседом снизу (при равенстве — нижний этаж)
 uint8_t floorGetNearestFloor(long position) {
   if (!floorHasValidCalibration()) return 0;
-  long d1 = labs(position - floorPos[1]);
-  long d2 = labs(position - floorPos[2]);
-  long d3 = labs(position - floorPos[3]);
-  if (d1 <= d2 && d1 <= d3) return 1;
-  if (d2 <= d1 && d2 <= d3) return 2;
-  return 3;
+
+  uint8_t lo = 1, hi = floorCount;
+  while (lo < hi) {
+    uint8_t mid = (uint8_t)((lo + hi) / 2);
+    if (floorPos[mid] < position) lo = mid + 1;
+    else                          hi = mid;
+  }
+  if (lo > 1 && position - floorPos[lo - 1] <= floorPos[lo] - position) {
+    return lo - 1;
+  }
+  return lo;
+}
+
+bool floorSetCount(uint8_t count) {
+  if (count < 2 || count > FLOOR_MAX) {
+    LOG(FLOOR_COUNT_INVALID, count);
+    return false;
+  }
+  floorCount = count;
+  layoutEvenly();
+  return true;
+}
+
+bool floorTeach(uint8_t floor, long position) {
+  if (floor < 1 || floor > floorCount) {
+    LOG(FLOOR_TEACH_INVALID);
+    return false;
+  }
+  if (position < 0 || position > fullTravelSteps) {
+    LOG(FLOOR_TEACH_OUTSIDE);
+    return false;
+  }
+  if ((floor > 1 && position - floorPos[floor - 1] < FLOOR_MIN_GAP) ||
+      (floor < floorCount && floorPos[floor + 1] - position < FLOOR_MIN_GAP)) {
+    LOG(FLOOR_TEACH_ORDER);
+    return false;
+  }
+
+  floorPos[floor] = position;
+  floorTaught = true;
+  LOG(FLOOR_TAUGHT, floor, position);
+  return true;
+}
+
+bool floorIsTaught() {
+  return floorTaught;
+}
+
+bool floorRestore(long fullTravel, uint8_t count, const long *positions, bool taught) {
+  if (fullTravel <= 0 || count < 2 || count > FLOOR_MAX) return false;
+  for (uint8_t f = 1; f <= count; f++) {
+    if (positions[f] < 0 || positions[f] > fullTravel) return false;
+    if (f > 1 && positions[f] - positions[f - 1] < FLOOR_MIN_GAP) return false;
+  }
+
+  fullTravelSteps = fullTravel;
+  floorCount      = count;
+  floorPos[0]     = 0;
+  for (uint8_t f = 1; f <= count; f++) floorPos[f] = positions[f];
+  floorTaught = taught;
+  hasCalib    = true;
+
+  // Из setup() (calibInit), задач ещё нет — печатаем сразу
+  FloorTable t;
+  floorGetTable(t);
+  Serial.println("[FLOOR] Restored");
+  floorPrint(t, Serial);
+  return true;
+}
+
+void floorGetTable(FloorTable &out) {
+  memset(&out, 0, sizeof(out));
+  out.full   = (int32_t)fullTravelSteps;
+  out.count  = floorCount;
+  out.taught = floorTaught ? 1 : 0;
+  for (uint8_t f = 1; f <= floorCount; f++) out.pos[f] = (int32_t)floorPos[f];
+}
+
+void floorPrint(const FloorTable &t, Print &out) {
+  out.print("[FLOOR] full=");
+  out.print((long)t.full);
+  out.print(t.taught ? " taught:" : " even:");
+  for (uint8_t f = 1; f <= t.count; f++) {
+    out.print(" ");
+    out.print(f);
+    out.print("=");
+    out.print((long)t.pos[f]);
+  }
+  out.println();
 }
 
 void floorSetFullTravelSteps(long steps) {
@@ -42,19 +145,14 @@ void floorSetFullTravelSteps(long steps) {
     hasCalib = false;
     return;
   }
-  floorPos[1] = 0;
-  floorPos[3] = fullTravelSteps;
-  floorPos[2] = fullTravelSteps / 2;
+
+  // Выученные позиции (низ = 0) переживают перекалибровку, если влезают в новый ход
+  if (!floorTaught || floorPos[floorCount] > fullTravelSteps) {
+    layoutEvenly();
+  }
   hasCalib = true;
 
-  Serial.print("[FLOOR] Calibrated: full=");
-  Serial.print(fullTravelSteps);
-  Serial.print(" floor1=");
-  Serial.print(floorPos[1]);
-  Serial.print(" floor2=");
-  Serial.print(floorPos[2]);
-  Serial.print(" floor3=");
-  Serial.println(floorPos[3]);
+  LOG(FLOOR_CALIBRATED, fullTravelSteps, floorCount);
 }
 
 long floorGetFullTravelSteps() {
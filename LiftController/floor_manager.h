@@ -1,11 +1,36 @@
 #pragma once
 #include <Arduino.h>
 
+// Этажи 1..floorGetCount(); позиции строго возрастают с номером этажа.
+// Не больше FLOOR_MAX: вызовы и статус пульта — битовые маски uint16 (бит n = этаж n).
+static const uint8_t FLOOR_MAX = 15;
+
 void floorInit();
 
 bool floorHasValidCalibration();
+uint8_t floorGetCount();
 long floorGetPositionForFloor(uint8_t floor);
 uint8_t floorGetNearestFloor(long position);
 
+// Число этажей: раскладывает их равномерно по ходу (выученные позиции сбрасываются)
+bool floorSetCount(uint8_t count);
+// Выучить позицию этажа (обычно — текущую позицию кабины).
+// false — позиция вне хода или нарушает порядок этажей.
+bool floorTeach(uint8_t floor, long position);
+bool floorIsTaught();
+
+// Таблица целиком: снимает задача движения (FLOORS), печатает задача связи
+struct FloorTable {
+  int32_t full;
+  int32_t pos[FLOOR_MAX + 1];
+  uint8_t count;
+  uint8_t taught;
+};
+void floorGetTable(FloorTable &out);
+void floorPrint(const FloorTable &t, Print &out);
+
+// Восстановить таблицу из сохранённой калибровки (calib_store)
+bool floorRestore(long fullTravel, uint8_t count, const long *positions, bool taught);
+
 void floorSetFullTravelSteps(long steps);
 long floorGetFullTravelSteps();
@@ -1,35 +1,263 @@
 #include "io_manager.h"
 
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_timer.h>
+#endif
+
 // Пины пока поставим заглушками, потом подправим под реальное железо
 static const int PIN_TOP_SWITCH   = 32;
 static const int PIN_CALIB_BUTTON = 33;
 static const int PIN_STOP_BUTTON  = 25;
 static const int PIN_POT_SPEED    = 34;
 
+static const uint8_t SWITCH_PIN[IO_SW_COUNT] = { PIN_TOP_SWITCH, PIN_CALIB_BUTTON, PIN_STOP_BUTTON };
+
+static const uint32_t IO_SAMPLE_US      = 1000;  // отсчёт кнопок и концевика
+static const uint8_t  IO_POT_EVERY      = 4;     // потенциометр — каждый 4-й отсчёт (250 Гц)
+static const uint8_t  IO_POT_OVERSAMPLE = 4;     // чтений АЦП на отсчёт
+static const uint8_t  IO_POT_FRAC       = 8;     // дробные биты фильтра
+static const uint8_t  IO_POT_IIR_SHIFT  = 4;     // y += (x - y) / 16: постоянная ~16 отсчётов (64 мс)
+static const uint16_t IO_POT_HYST       = 32;    // ~14 шаг/с из 1800 диапазона ручки: с запасом над шумом после IIR
+static const uint32_t IO_POT_FOLLOW_US  = 100000;  // после изменения — следом за ручкой без гистерезиса
+static const uint16_t IO_POT_MAX        = 4095;
+static const uint8_t  IO_SW_INTEGRATE   = 5;     // отсчётов подряд (с перевесом) для смены уровня, 5 мс
+static const uint8_t  IO_CATCHUP_MAX    = 20;    // симулятор: догон пропущенных отсчётов за проход
+
+// ---- Состояние выборки: пишет только ioSample() ----
+static int32_t  g_potAcc     = 0;   // фильтр, IO_POT_FRAC дробных бит
+static uint8_t  g_potPhase   = 0;
+static int8_t   g_potDir     = 0;   // куда менялось pot в последний раз
+static uint32_t g_potFollowUs = 0;  // до этого момента идём следом в ту же сторону
+static uint8_t  g_swCount[IO_SW_COUNT];     // интегратор 0..IO_SW_INTEGRATE
+static uint32_t g_swLeaveUs[IO_SW_COUNT];   // первый отсчёт, сдвинувший интегратор с края
+static long     g_swLeavePos[IO_SW_COUNT];  // позиция мотора на нём
+
+// ---- Снимок (ioSample() пишет, loop() читает) и то, что уже видели подписчики ----
+static IoSnapshot      g_snap;
+static IoSnapshot      g_seen;
+static IoPotHandler    g_onPot    = nullptr;
+static IoSwitchHandler g_onSwitch = nullptr;
+static IoPositionSource g_posSource = nullptr;
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+static esp_timer_handle_t g_ioTimer = nullptr;
+static portMUX_TYPE       g_ioMux   = portMUX_INITIALIZER_UNLOCKED;
+
+#define IO_LOCK()   portENTER_CRITICAL(&g_ioMux)
+#define IO_UNLOCK() portEXIT_CRITICAL(&g_ioMux)
+
+#else  // ---- Linux: отсчёты из ioUpdate() по виртуальным часам ----
+
+static uint32_t g_nextSampleUs = 0;
+
+#define IO_LOCK()
+#define IO_UNLOCK()
+
+#endif
+
+static long readPosition() {
+  IoPositionSource source = g_posSource;
+  return source ? source() : 0;
+}
+
+static uint16_t readPot() {
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < IO_POT_OVERSAMPLE; i++) sum += analogRead(PIN_POT_SPEED);
+  return (uint16_t)(sum / IO_POT_OVERSAMPLE);
+}
+
+// Один отсчёт всех входов. Пишет снимок только под замком и только готовыми значениями.
+static void ioSample(uint32_t nowUs) {
+  bool     potSampled = false;
+  uint16_t potRaw = 0, potFiltered = 0;
+  if (g_potPhase++ == 0) {
+    potRaw = readPot();
+    int32_t x = (int32_t)potRaw << IO_POT_FRAC;
+    int32_t step = (x - g_potAcc) >> IO_POT_IIR_SHIFT;
+    if (step == 0 && x != g_potAcc) step = (x > g_potAcc) ? 1 : -1;  // дойти до значения, а не застрять рядом
+    g_potAcc += step;
+    potFiltered = (uint16_t)((g_potAcc + (1 << (IO_POT_FRAC - 1))) >> IO_POT_FRAC);
+    potSampled = true;
+  }
+  if (g_potPhase >= IO_POT_EVERY) g_potPhase = 0;
+
+  // Интегратор: замкнут — к IO_SW_INTEGRATE, разомкнут — к 0; уровень меняется на краю.
+  // Одиночные отскоки двигают счётчик туда-обратно и до края не доходят.
+  bool changed[IO_SW_COUNT] = {};
+  for (uint8_t i = 0; i < IO_SW_COUNT; i++) {
+    bool raw = (digitalRead(SWITCH_PIN[i]) == LOW);
+    uint8_t &c = g_swCount[i];
+    if (raw && c < IO_SW_INTEGRATE) {
+      if (c == 0) {
+        g_swLeaveUs[i]  = nowUs;
+        g_swLeavePos[i] = readPosition();
+      }
+      c++;
+    } else if (!raw && c > 0) {
+      if (c == IO_SW_INTEGRATE) {
+        g_swLeaveUs[i]  = nowUs;
+        g_swLeavePos[i] = readPosition();
+      }
+      c--;
+    }
+    changed[i] = (c == IO_SW_INTEGRATE) != g_snap.sw[i].active && (c == 0 || c == IO_SW_INTEGRATE);
+  }
+
+  IO_LOCK();
+  g_snap.samples++;
+  g_snap.sampledUs = nowUs;
+  if (potSampled) {
+    g_snap.potRaw      = potRaw;
+    g_snap.potFiltered = potFiltered;
+    int8_t   dir = (potFiltered > g_snap.pot) ? 1 : -1;
+    uint16_t d   = (dir > 0) ? potFiltered - g_snap.pot : g_snap.pot - potFiltered;
+    // Ручку только что повернули — догоняем фильтр до конца, иначе pot застрянет на краю
+    // полосы гистерезиса и позже её пересечёт шум. Края шкалы — тоже без гистерезиса,
+    // иначе крайнее положение ручки недостижимо.
+    bool follow = dir == g_potDir && (int32_t)(nowUs - g_potFollowUs) < 0;
+    if (d >= IO_POT_HYST || (d && (follow || potFiltered == 0 || potFiltered == IO_POT_MAX))) {
+      g_snap.pot = potFiltered;
+      g_snap.potChanges++;
+      g_potDir      = dir;
+      g_potFollowUs = nowUs + IO_POT_FOLLOW_US;
+    }
+  }
+  for (uint8_t i = 0; i < IO_SW_COUNT; i++) {
+    if (!changed[i]) continue;
+    g_snap.sw[i].active    = !g_snap.sw[i].active;
+    g_snap.sw[i].changedUs  = g_swLeaveUs[i];
+    g_snap.sw[i].changedPos = g_swLeavePos[i];
+    g_snap.sw[i].edges++;
+  }
+  IO_UNLOCK();
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// Задача esp_timer, не ISR: analogRead() здесь можно
+static void onIoTimer(void *) {
+  ioSample((uint32_t)esp_timer_get_time());
+}
+#endif
+
 void ioInit() {
   pinMode(PIN_TOP_SWITCH,   INPUT_PULLUP);
   pinMode(PIN_CALIB_BUTTON, INPUT_PULLUP);
   pinMode(PIN_STOP_BUTTON,  INPUT_PULLUP);
-  // Потенциометр — просто analogRead
-  Serial.println("[IO] Init");
+
+  // Стартовый снимок — сразу по текущим уровням, без ложных фронтов и разгона фильтра
+  uint32_t now = micros();
+  memset(&g_snap, 0, sizeof(g_snap));
+  uint16_t pot = readPot();
+  g_potAcc   = (int32_t)pot << IO_POT_FRAC;
+  g_potPhase = 0;
+  g_potDir   = 0;
+  g_snap.potRaw = g_snap.potFiltered = g_snap.pot = pot;
+  for (uint8_t i = 0; i < IO_SW_COUNT; i++) {
+    bool active = (digitalRead(SWITCH_PIN[i]) == LOW);
+    g_swCount[i] = active ? IO_SW_INTEGRATE : 0;
+    g_snap.sw[i].active    = active;
+    g_snap.sw[i].changedUs = now;
+    g_snap.sw[i].changedPos = readPosition();
+  }
+  g_snap.sampledUs = now;
+  g_seen = g_snap;
+
+#if defined(ARDUINO_ARCH_ESP32)
+  if (!g_ioTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = onIoTimer;
+    args.name     = "io";
+    if (esp_timer_create(&args, &g_ioTimer) != ESP_OK) {
+      Serial.println("[IO] esp_timer alloc FAILED");
+      g_ioTimer = nullptr;
+    }
+  }
+  if (g_ioTimer) esp_timer_start_periodic(g_ioTimer, IO_SAMPLE_US);
+#else
+  g_nextSampleUs = now + IO_SAMPLE_US;
+#endif
+  Serial.printf("[IO] Init: sample %lu us, pot %u\r\n", (unsigned long)IO_SAMPLE_US, pot);
 }
 
 void ioUpdate() {
-  // сюда можно потом добавить дебаунс кнопок, обработку долгого нажатия и т.п.
+#if !defined(ARDUINO_ARCH_ESP32)
+  // Отсчёты в свои моменты; loop() задержался — догоняем, но не бесконечно
+  uint32_t now = micros();
+  uint8_t n = 0;
+  while ((int32_t)(now - g_nextSampleUs) >= 0) {
+    if (n++ == IO_CATCHUP_MAX) {
+      g_nextSampleUs = now + IO_SAMPLE_US;
+      break;
+    }
+    ioSample(g_nextSampleUs);
+    g_nextSampleUs += IO_SAMPLE_US;
+  }
+#endif
+
+  // Обработчики уже видят новый снимок через ioRead*()
+  IoSnapshot prev = g_seen;
+  ioGetSnapshot(g_seen);
+  const IoSnapshot &s = g_seen;
+  if (s.pot != prev.pot && g_onPot) g_onPot(s.pot);
+  for (uint8_t i = 0; i < IO_SW_COUNT; i++) {
+    // Между проходами loop() могло быть несколько фронтов — сообщаем итог
+    if (s.sw[i].active == prev.sw[i].active || !g_onSwitch) continue;
+    g_onSwitch((IoSwitch)i, s.sw[i].active, s.sw[i].changedUs);
+  }
 }
 
+void ioOnPotChange(IoPotHandler handler) {
+  g_onPot = handler;
+  if (handler) handler(g_seen.pot);
+}
+
+void ioOnSwitchChange(IoSwitchHandler handler) {
+  g_onSwitch = handler;
+}
+
+void ioSetPositionSource(IoPositionSource source) {
+  g_posSource = source;
+}
+
+void ioGetSnapshot(IoSnapshot &out) {
+  IO_LOCK();
+  out = g_snap;
+  IO_UNLOCK();
+}
+
+// Потребители в loop() видят то же, что ушло подписчикам (g_seen), — без замка
 bool ioReadTopSwitch() {
-  return digitalRead(PIN_TOP_SWITCH) == LOW; // активный LOW
+  return g_seen.sw[IO_SW_TOP].active;
 }
 
 bool ioReadCalibButton() {
-  return digitalRead(PIN_CALIB_BUTTON) == LOW;
+  return g_seen.sw[IO_SW_CALIB].active;
 }
 
 bool ioReadStopButton() {
-  return digitalRead(PIN_STOP_BUTTON) == LOW;
+  return g_seen.sw[IO_SW_STOP].active;
 }
 
 int ioReadPotSpeed() {
-  return analogRead(PIN_POT_SPEED); // 0..4095
+  return g_seen.pot; // 0..4095
+}
+
+uint32_t ioSwitchChangedUs(IoSwitch sw) {
+  return g_seen.sw[sw].changedUs;
+}
+
+long ioSwitchChangedPos(IoSwitch sw) {
+  return g_seen.sw[sw].changedPos;
+}
+
+void ioPrintStatus(Print &out) {
+  IoSnapshot s;
+  ioGetSnapshot(s);
+  out.printf("[IO] samples %lu, pot raw %u filtered %u used %u (%lu changes), "
+             "top %d (%lu edges), calib %d (%lu), stop %d (%lu)\r\n",
+             (unsigned long)s.samples, s.potRaw, s.potFiltered, s.pot, (unsigned long)s.potChanges,
+             s.sw[IO_SW_TOP].active, (unsigned long)s.sw[IO_SW_TOP].edges,
+             s.sw[IO_SW_CALIB].active, (unsigned long)s.sw[IO_SW_CALIB].edges,
+             s.sw[IO_SW_STOP].active, (unsigned long)s.sw[IO_SW_STOP].edges);
 }
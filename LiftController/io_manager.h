@@ -1,11 +1,62 @@
 #pragma once
 #include <Arduino.h>
 
+// Входы базы: концевик, кнопки, потенциометр скорости.
+// Отсчёты — по расписанию раз в IO_SAMPLE_US в фоне (esp_timer на ESP32, в симуляторе —
+// из ioUpdate() с догоном пропущенных), а не в момент чтения: потребители читают готовый
+// снимок, АЦП в пути управления нет.
+//  - Потенциометр: 4 чтения АЦП на отсчёт, IIR-фильтр и гистерезис — значение в снимке
+//    меняется только при заметном повороте ручки, шум АЦП не доходит до maxSpeed.
+//  - Кнопки и концевик: интегрирующий антидребезг (счётчик отсчётов), у фронта — метка
+//    времени первого отсчёта нового уровня и позиция мотора в этот момент.
+// Об изменениях ioUpdate() сообщает подписчикам из loop(); без изменений — тишина.
+
+enum IoSwitch : uint8_t {
+  IO_SW_TOP,     // верхний концевик
+  IO_SW_CALIB,   // кнопка калибровки (долгое нажатие — сброс калибровки)
+  IO_SW_STOP,
+  IO_SW_COUNT
+};
+
+struct IoSwitchState {
+  bool     active;      // после антидребезга; true — замкнут (активный LOW)
+  uint32_t changedUs;   // micros() первого отсчёта нового уровня
+  long     changedPos;  // позиция из ioSetPositionSource() на том же отсчёте
+  uint32_t edges;       // подтверждённых фронтов с ioInit()
+};
+
+struct IoSnapshot {
+  uint32_t      samples;       // отсчётов с ioInit()
+  uint32_t      sampledUs;     // micros() последнего отсчёта
+  uint16_t      potRaw;        // последний отсчёт АЦП (среднее из 4), 0..4095
+  uint16_t      potFiltered;   // после IIR
+  uint16_t      pot;           // после гистерезиса — это и читают потребители
+  uint32_t      potChanges;    // сколько раз менялось pot
+  IoSwitchState sw[IO_SW_COUNT];
+};
+
+typedef void (*IoPotHandler)(int potRaw);
+typedef void (*IoSwitchHandler)(IoSwitch sw, bool active, uint32_t atUs);
+typedef long (*IoPositionSource)();
+
 void ioInit();
+// Из loop(): уведомления подписчикам (в симуляторе — ещё и сами отсчёты)
 void ioUpdate();
 
-// Входы
+// Подписка; обработчик потенциометра сразу получает текущее значение
+void ioOnPotChange(IoPotHandler handler);
+void ioOnSwitchChange(IoSwitchHandler handler);
+// Чем метить фронты по позиции. Зовётся из фона (esp_timer) — только чтение, без замков loop()
+void ioSetPositionSource(IoPositionSource source);
+
+// Входы — из снимка (без обращения к железу)
 bool ioReadTopSwitch();
 bool ioReadCalibButton();
 bool ioReadStopButton();
 int  ioReadPotSpeed();
+// micros() фронта, который сейчас в снимке (первый отсчёт нового уровня)
+uint32_t ioSwitchChangedUs(IoSwitch sw);
+long     ioSwitchChangedPos(IoSwitch sw);
+
+void ioGetSnapshot(IoSnapshot &out);
+void ioPrintStatus(Print &out);
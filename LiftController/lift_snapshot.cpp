@@ -0,0 +1,36 @@
+#include "lift_snapshot.h"
+#include "seqlock.h"
+#include "state_machine.h"
+#include "motor_controller.h"
+#include "floor_manager.h"
+
+static Seqlock<LiftSnapshot> g_snapshot;
+
+void snapshotPublish() {
+  LiftSnapshot s;
+  s.publishedMs  = millis();
+  s.position     = (int32_t)motorGetCurrentPosition();
+  s.speed        = (int32_t)motorGetSpeed();
+  s.maxSpeed     = (int32_t)motorGetMaxSpeed();
+  s.etaMs        = motorGetEtaMs();
+  s.pendingCalls = smGetPendingCalls();
+  s.state        = (uint8_t)smGetState();
+  s.currentFloor = smGetCurrentFloor();
+  s.targetFloor  = smGetTargetFloor();
+  s.errorCode    = smGetErrorCode();
+  s.floorCount   = floorGetCount();
+  s.busy         = motorIsBusy() ? 1 : 0;
+  g_snapshot.write(s);
+}
+
+void snapshotRead(LiftSnapshot &out) {
+  g_snapshot.read(out);
+}
+
+uint32_t snapshotVersion() {
+  return g_snapshot.version();
+}
+
+uint32_t snapshotRetries() {
+  return g_snapshot.retryCount();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+// Снимок состояния лифта для задач с другого ядра (статус пульту, счётчики).
+// Публикует задача движения раз за проход (snapshotPublish()), читает кто угодно через
+// seqlock (seqlock.h): копия всегда согласованная, автомат и мотор с чужого ядра не трогаются.
+//
+// Только stdint — структура собирается и в хостовом стресс-тесте (sim/seqlock_stress.cpp).
+
+struct LiftSnapshot {
+  uint32_t publishedMs;   // millis() публикации
+  int32_t  position;      // шаги
+  int32_t  speed;         // шаг/с со знаком направления
+  int32_t  maxSpeed;      // крейсерская, шаг/с (для процента скорости)
+  uint32_t etaMs;         // до прибытия по плану мотора, мс (0 — не едем к цели)
+  uint16_t pendingCalls;  // бит n — этаж n
+  uint8_t  state;         // LiftState
+  uint8_t  currentFloor;
+  uint8_t  targetFloor;
+  uint8_t  errorCode;     // 0 — нет ошибки
+  uint8_t  floorCount;
+  uint8_t  busy;          // мотор едет или ещё тормозит
+};
+
+// Только задача движения (после smTick() / motorService())
+void snapshotPublish();
+// Любая задача
+void snapshotRead(LiftSnapshot &out);
+
+uint32_t snapshotVersion();   // публикаций с загрузки
+uint32_t snapshotRetries();   // повторов чтения (писатель был посреди записи)
@@ -0,0 +1,117 @@
+#include "logger.h"
+#include <atomic>
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+// Сколько записей logService() форматирует за один проход loop()
+static const uint8_t LOG_MAX_PER_SERVICE = 4;
+
+static const char *const LOG_FORMATS[LOG_ID_COUNT] = {
+#define LOG_X_FORMAT(id, level, fmt) fmt,
+  LOG_MESSAGES(LOG_X_FORMAT)
+#undef LOG_X_FORMAT
+};
+
+// Слот кольца. seq — состояние слота для круга lap = pos / LOG_RING_SIZE:
+//   2*lap     — свободен, писатель с позицией pos может его занять
+//   2*lap + 1 — заполнен, читатель с позицией pos может его забрать
+// Нулевая инициализация = всё свободно на нулевом круге, logInit() не нужен.
+struct LogRecord {
+  std::atomic<uint32_t> seq;
+  uint16_t id;
+  int32_t  arg[3];
+};
+
+static LogRecord             g_ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> g_head{0};     // следующая позиция записи (все писатели)
+static uint32_t              g_tail = 0;    // следующая позиция чтения (только logService)
+static std::atomic<uint32_t> g_dropped{0};
+static uint32_t              g_droppedShown = 0;
+
+// Отформатированная строка, ждущая места в TX FIFO
+static char   g_line[160];
+static size_t g_lineLen = 0;
+
+static inline uint32_t freeSeq(uint32_t pos) {
+  return (pos / LOG_RING_SIZE) * 2;
+}
+
+bool IRAM_ATTR logWrite(LogId id, int32_t a0, int32_t a1, int32_t a2) {
+  uint32_t pos = g_head.load(std::memory_order_relaxed);
+  for (;;) {
+    LogRecord &r = g_ring[pos & (LOG_RING_SIZE - 1)];
+    uint32_t seq  = r.seq.load(std::memory_order_acquire);
+    uint32_t want = freeSeq(pos);
+
+    if (seq == want) {
+      // Слот наш, если никто не занял позицию раньше (иначе CAS обновит pos)
+      if (g_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        r.id     = (uint16_t)id;
+        r.arg[0] = a0;
+        r.arg[1] = a1;
+        r.arg[2] = a2;
+        r.seq.store(want + 1, std::memory_order_release);
+        return true;
+      }
+    } else if ((int32_t)(seq - want) < 0) {
+      // Слот ещё не прочитан с прошлого круга — кольцо полно
+      g_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      // Позицию уже занял другой писатель
+      pos = g_head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Следующая запись в g_line; false — кольцо пусто (или ближайшая запись ещё пишется)
+static bool formatNext() {
+  uint32_t dropped = g_dropped.load(std::memory_order_relaxed);
+  if (dropped != g_droppedShown) {
+    int n = snprintf(g_line, sizeof(g_line), "[LOG] %lu records dropped\r\n",
+                     (unsigned long)(dropped - g_droppedShown));
+    g_droppedShown = dropped;
+    g_lineLen = (n > 0) ? (size_t)n : 0;
+    return true;
+  }
+
+  LogRecord &r = g_ring[g_tail & (LOG_RING_SIZE - 1)];
+  if (r.seq.load(std::memory_order_acquire) != freeSeq(g_tail) + 1) return false;
+
+  uint16_t id = r.id;
+  long a0 = r.arg[0], a1 = r.arg[1], a2 = r.arg[2];
+  r.seq.store(freeSeq(g_tail + LOG_RING_SIZE), std::memory_order_release);
+  g_tail++;
+
+  const char *fmt = (id < LOG_ID_COUNT) ? LOG_FORMATS[id] : "[LOG] bad id %ld";
+  if (id >= LOG_ID_COUNT) a0 = id;
+  int n = snprintf(g_line, sizeof(g_line) - 2, fmt, a0, a1, a2);
+  if (n < 0) n = 0;
+  if ((size_t)n > sizeof(g_line) - 3) n = sizeof(g_line) - 3;
+  g_line[n++] = '\r';
+  g_line[n++] = '\n';
+  g_lineLen = (size_t)n;
+  return true;
+}
+
+void logService() {
+  for (uint8_t i = 0; i < LOG_MAX_PER_SERVICE; i++) {
+    if (g_lineLen == 0 && !formatNext()) return;
+    // Строку целиком или никак: Serial.write() не должен ждать UART
+    if ((size_t)Serial.availableForWrite() < g_lineLen) return;
+    Serial.write((const uint8_t *)g_line, g_lineLen);
+    g_lineLen = 0;
+  }
+}
+
+void logFlush() {
+  for (;;) {
+    if (g_lineLen == 0 && !formatNext()) return;
+    Serial.write((const uint8_t *)g_line, g_lineLen);
+    g_lineLen = 0;
+  }
+}
+
+uint32_t logGetDropped() {
+  return g_dropped.load(std::memory_order_relaxed);
+}
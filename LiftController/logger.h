@@ -0,0 +1,202 @@
+#pragma once
+#include <Arduino.h>
+
+// Неблокирующий лог.
+// LOG(ID, args...) кладёт в кольцевой буфер запись фиксированного размера
+// (id сообщения + до трёх целых аргументов) и сразу возвращается — без форматирования
+// и без Serial. Текст собирает logService() в задаче связи (commLoop(), ядро 0), и только когда
+// в TX FIFO UART есть место под всю строку, так что ни задача движения, ни связь на логе не стоят.
+//
+// Запись — без блокировок (CAS на индексе головы), можно звать из ISR и из задачи WiFi.
+// Буфер полон → запись отбрасывается и считается; счётчик печатается при следующем сливе.
+//
+// Уровень отсекается при компиляции: сообщения выше LOG_LEVEL не оставляют кода
+// (аргументы тоже не вычисляются).
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Записей в кольце (степень двойки)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+
+// Таблица сообщений: X(ID, уровень, формат). Аргументы — long, формат — %ld / %lu / %lX.
+#define LOG_MESSAGES(X) \
+  /* ---- мотор ---- */ \
+  X(MOTOR_MOVE_TO,          INFO,  "[MOTOR] MoveTo %ld (%ld ms)") \
+  X(MOTOR_MOVE_TO_SCURVE,   INFO,  "[MOTOR] MoveTo %ld (S-curve, %ld ms)") \
+  X(MOTOR_STOP,             INFO,  "[MOTOR] Stop: braking to %ld (%ld ms)") \
+  X(MOTOR_EMERGENCY_STOP,   WARN,  "[MOTOR] Emergency stop at %ld") \
+  X(MOTOR_MANUAL_UP,        INFO,  "[MOTOR] Manual UP") \
+  X(MOTOR_MANUAL_DOWN,      INFO,  "[MOTOR] Manual DOWN") \
+  X(MOTOR_CALIB_DOWN_FAST,  INFO,  "[MOTOR] Calib DOWN FAST (x3)") \
+  X(MOTOR_SET_POSITION,     INFO,  "[MOTOR] Set position=%ld") \
+  X(MOTOR_STALL,            ERROR, "[MOTOR] Stall: %ld steps behind the encoder, position set to %ld") \
+  X(MOTOR_DRIFT_FIXED,      INFO,  "[MOTOR] Encoder drift %ld steps, position set to %ld") \
+  X(MOTOR_STEP_MODE_BUSY,   WARN,  "[MOTOR] Step mode change ignored: motor is moving") \
+  X(MOTOR_STEP_IO_BUSY,     WARN,  "[MOTOR] Step I/O change ignored: motor is moving") \
+  X(MOTOR_PROFILE_BUSY,     WARN,  "[MOTOR] Profile change ignored: motor is moving") \
+  X(MOTOR_PROFILE_TRAP,     INFO,  "[MOTOR] Profile: trapezoid") \
+  X(MOTOR_PROFILE_SCURVE,   INFO,  "[MOTOR] Profile: S-curve") \
+  X(MOTOR_ENCODER_ON,       INFO,  "[MOTOR] Encoder feedback ON") \
+  X(MOTOR_ENCODER_OFF,      INFO,  "[MOTOR] Encoder feedback OFF") \
+  X(STEPGEN_MODE_ISR,       INFO,  "[STEPGEN] Mode: TIMER_ISR") \
+  X(STEPGEN_MODE_POLL,      INFO,  "[STEPGEN] Mode: POLLING") \
+  X(STEPGEN_MODE_RMT,       INFO,  "[STEPGEN] Mode: RMT") \
+  X(STEPGEN_TIMER_FAILED,   ERROR, "[STEPGEN] GPTimer alloc FAILED, fallback to POLLING") \
+  X(STEPGEN_RMT_FAILED,     ERROR, "[STEPGEN] RMT/PCNT alloc FAILED, fallback to TIMER_ISR") \
+  X(STEPGEN_RMT_NO_IDF,     WARN,  "[STEPGEN] RMT needs ESP-IDF 5.3+, fallback to TIMER_ISR") \
+  X(STEPIO_MODE_REGISTERS,  INFO,  "[STEPIO] Mode: REGISTERS") \
+  X(STEPIO_MODE_ARDUINO,    INFO,  "[STEPIO] Mode: ARDUINO") \
+  X(ENC_PCNT_FAILED,        ERROR, "[ENC] PCNT alloc FAILED, running open-loop") \
+  X(ENC_PCNT_PINS,          INFO,  "[ENC] PCNT x4 on A=%ld B=%ld") \
+  X(ENC_PCNT_SCALE,         INFO,  "[ENC] %ld counts/rev, %ld steps/rev") \
+  X(RAMP_ACCEL,             INFO,  "[RAMP] accel=%lu c0=%luus top=%lu steps/s") \
+  /* ---- автомат ---- */ \
+  X(SM_MOVING_TO_FLOOR,     INFO,  "[SM] Moving to floor %ld (target pos %ld)") \
+  X(SM_INTERMEDIATE_STOP,   INFO,  "[SM] Intermediate stop at floor %ld") \
+  X(SM_REACHED_FLOOR,       INFO,  "[SM] Reached target floor: %ld") \
+  X(SM_CALL_FLOOR,          INFO,  "[SM] Call floor %ld") \
+  X(SM_CALL_FLOOR_UP,       INFO,  "[SM] Call floor %ld (up)") \
+  X(SM_CALL_FLOOR_DOWN,     INFO,  "[SM] Call floor %ld (down)") \
+  X(SM_ALREADY_AT_FLOOR,    INFO,  "[SM] Already at floor %ld") \
+  X(SM_MOTION_STALL,        ERROR, "[SM] No motion for %ld ms at %ld! ERROR") \
+  X(SM_MOTION_TIMEOUT,      ERROR, "[SM] Motion timeout: %ld ms, limit %ld ms! ERROR") \
+  X(SM_UNEXPECTED_TOP,      ERROR, "[SM] Unexpected top switch! ERROR") \
+  X(SM_MOTOR_STALL,         ERROR, "[SM] Motor stall (encoder)! ERROR") \
+  X(SM_MOVE_IGNORED_CALIB,  WARN,  "[SM] Move command ignored: NEED_CALIB/CALIB") \
+  X(SM_MOVE_IGNORED_ERROR,  WARN,  "[SM] Move command ignored: ERROR state") \
+  X(SM_MOVE_IGNORED_STATE,  WARN,  "[SM] Move command ignored: not in IDLE/MOVING") \
+  X(SM_INVALID_FLOOR,       WARN,  "[SM] Invalid floor") \
+  X(SM_STOP_VERIFY,         WARN,  "[SM] STOP: verify homing aborted") \
+  X(SM_STOP_MOVING,         INFO,  "[SM] STOP: braking to %ld") \
+  X(SM_EMERGENCY_STOP,      ERROR, "[SM] EMERGENCY STOP at %ld, position unverified! ERROR") \
+  X(SM_ESTOP_CALIB,         ERROR, "[SM] EMERGENCY STOP: calibration aborted! ERROR") \
+  X(SM_STOPPED,             INFO,  "[SM] Stopped at %ld, floor %ld") \
+  X(SM_STOP_IDLE,           INFO,  "[SM] STOP: no movement") \
+  X(SM_CALIB_WHILE_MOVING,  WARN,  "[SM] Cannot start calib while moving") \
+  X(SM_CALIB_START,         INFO,  "[SM] Start calibration: homing up") \
+  X(SM_CALIB_TOP,           INFO,  "[SM] CALIB: reached top switch") \
+  X(SM_CALIB_DOWN_IGNORED,  WARN,  "[SM] CALIB_DOWN_START ignored: not in CALIB_MOVING_DOWN") \
+  X(SM_CALIB_DOWN_START,    INFO,  "[SM] Start moving down for calibration") \
+  X(SM_CALIB_SAVE_IGNORED,  WARN,  "[SM] CALIB_DOWN_SAVE ignored: not in CALIB_MOVING_DOWN") \
+  X(SM_CALIB_SAVE,          INFO,  "[SM] Save bottom position") \
+  X(SM_FLOORS_IGNORED,      WARN,  "[SM] FLOORS ignored: not in IDLE") \
+  X(SM_TEACH_IGNORED,       WARN,  "[SM] TEACH ignored: not in IDLE") \
+  X(SM_MAN_UP_IGNORED,      WARN,  "[SM] MAN_UP ignored in current state") \
+  X(SM_MAN_DOWN_IGNORED,    WARN,  "[SM] MAN_DOWN ignored in current state") \
+  X(SM_MANUAL_UP,           INFO,  "[SM] Manual move UP") \
+  X(SM_MANUAL_DOWN,         INFO,  "[SM] Manual move DOWN") \
+  X(SM_MANUAL_STOP,         INFO,  "[SM] Manual move STOP") \
+  X(SM_POSITION_MOVE,       INFO,  "[SM] Move to position %ld") \
+  X(SM_POSITION_REACHED,    INFO,  "[SM] At position %ld") \
+  X(SM_POSITION_IGNORED,    WARN,  "[SM] GOTO/JOG ignored: not in IDLE") \
+  X(SM_POSITION_RANGE,      WARN,  "[SM] GOTO/JOG: position %ld outside travel 0..%ld") \
+  X(SM_CLEAR_IGNORED,       WARN,  "[SM] CLEAR: not in ERROR") \
+  X(SM_CLEAR,               INFO,  "[SM] CLEAR: error cleared") \
+  X(SM_FORCE_NEED_CALIB,    INFO,  "[SM] Force NEED_CALIB") \
+  X(SM_VERIFY_START,        INFO,  "[SM] Verify homing: checking position at top switch") \
+  X(SM_HOMING_START,        INFO,  "[SM] Homing: position unknown, seeking top switch") \
+  X(SM_VERIFY_TOP,          INFO,  "[SM] Top switch at %ld (expected %ld)") \
+  X(SM_VERIFY_DONE,         INFO,  "[SM] Verify homing done, at floor %ld") \
+  X(SM_VERIFY_TIMEOUT,      ERROR, "[SM] Verify homing failed: timeout") \
+  X(SM_VERIFY_DRIFT,        ERROR, "[SM] Verify homing failed: position drift %ld, recalibration needed") \
+  X(SM_VERIFY_NO_SWITCH,    ERROR, "[SM] Verify homing failed: top switch not found") \
+  /* ---- калибровка / NVS ---- */ \
+  X(CALIB_FORCE_RESET,      INFO,  "[CALIB] Force reset calibration") \
+  X(CALIB_HOMING_UP,        INFO,  "[CALIB] Homing UP: manual up") \
+  X(CALIB_TOP_REACHED,      INFO,  "[CALIB] Top reached, position set to 0 (TopSwitch)") \
+  X(CALIB_MOVING_DOWN,      INFO,  "[CALIB] Moving DOWN for calibration (manual down)") \
+  X(CALIB_BOTTOM_RAW,       INFO,  "[CALIB] Bottom raw position = %ld") \
+  X(CALIB_DISTANCE,         INFO,  "[CALIB] Distance Bottom -> TopSwitch = %ld") \
+  X(CALIB_TRAVEL_TOO_SMALL, WARN,  "[CALIB] WARNING: fullTravelSteps too small (%ld), forcing to MIN_TRAVEL_STEPS=%ld") \
+  X(CALIB_DONE,             INFO,  "[CALIB] Calibration done. fullTravelSteps=%ld (floor 1 = 0, top floor = full, below top switch)") \
+  X(CALIB_BUTTON_RESET,     INFO,  "[CALIB] Base button long press: FULL RECALIBRATION") \
+  X(NVS_WRITE_FAILED,       ERROR, "[NVS] Calibration write FAILED") \
+  X(NVS_ERASED,             INFO,  "[NVS] Calibration record erased") \
+  /* ---- этажи ---- */ \
+  X(FLOOR_COUNT_INVALID,    WARN,  "[FLOOR] Invalid floor count %ld") \
+  X(FLOOR_TEACH_INVALID,    WARN,  "[FLOOR] Teach: invalid floor") \
+  X(FLOOR_TEACH_OUTSIDE,    WARN,  "[FLOOR] Teach: position outside travel") \
+  X(FLOOR_TEACH_ORDER,      WARN,  "[FLOOR] Teach: position breaks floor order") \
+  X(FLOOR_TAUGHT,           INFO,  "[FLOOR] Taught floor %ld at %ld") \
+  X(FLOOR_CALIBRATED,       INFO,  "[FLOOR] Calibrated: full=%ld, %ld floors") \
+  /* ---- входы ---- */ \
+  X(IO_TOP_SWITCH,          INFO,  "[IO] Top switch %ld (edge %ld us ago)") \
+  /* ---- пульт / ESP-NOW ---- */ \
+  X(RCV_CMD,                INFO,  "[RCV CMD] type=%ld arg=%ld seq=%lu") \
+  X(ACT_FLOOR_IN_CALIB,     INFO,  "[ACT] Ignored: floor call during calibration") \
+  X(ACT_MOVE_TO_FLOOR,      INFO,  "[ACT] Move to floor %ld") \
+  X(ACT_INVALID_FLOOR,      WARN,  "[WARN] Invalid floor in CMD_CALL_FLOOR") \
+  X(ACT_CALIB_UP,           INFO,  "[ACT] NEED_CALIB: start calibration (UP)") \
+  X(ACT_UP_IN_CALIB,        INFO,  "[ACT] Ignored: UP during calibration") \
+  X(ACT_MANUAL_UP,          INFO,  "[ACT] Manual UP start") \
+  X(ACT_DOWN_NEED_CALIB,    INFO,  "[ACT] Ignored: DOWN in NEED_CALIB (press UP first)") \
+  X(ACT_DOWN_HOMING,        INFO,  "[ACT] Ignored: DOWN during CALIB_HOMING_UP") \
+  X(ACT_CALIB_DOWN,         INFO,  "[ACT] CALIB_MOVING_DOWN: start auto down") \
+  X(ACT_MANUAL_DOWN,        INFO,  "[ACT] Manual DOWN start") \
+  X(ACT_STOP_IN_CALIB,      INFO,  "[ACT] Ignored: Manual STOP during calibration") \
+  X(ACT_MANUAL_STOP,        INFO,  "[ACT] Manual move STOP") \
+  X(ACT_CALIB,              INFO,  "[ACT] Start calibration (explicit CMD_CALIB)") \
+  X(ACT_CALIB_DOWN_START,   INFO,  "[ACT] Calib: move down (explicit CMD_CALIB_DOWN_START)") \
+  X(ACT_CALIB_DOWN_SAVE,    INFO,  "[ACT] Calib: save bottom (explicit CMD_CALIB_DOWN_SAVE)") \
+  X(ACT_STOP,               INFO,  "[ACT] STOP (braking)") \
+  X(ACT_EMERGENCY_STOP,     INFO,  "[ACT] EMERGENCY STOP") \
+  X(ACT_UNKNOWN,            WARN,  "[ACT] CMD_NONE or unknown cmd") \
+  X(ACT_F1_SAVE,            INFO,  "[ACT] CALIB_MOVING_DOWN: F1 pressed, save bottom & finish") \
+  X(ACT_STATUS_REQUEST,     DEBUG, "[ACT] Remote asked for status") \
+  X(ESPNOW_SEND_STATUS,     DEBUG, "[ESP-NOW BASE] Send status: %ld") \
+  X(ESPNOW_RECV,            DEBUG, "[ESP-NOW BASE] Data received, len=%ld") \
+  X(ESPNOW_REMOTE_MAC,      INFO,  "[COMM] Remote MAC %06lX%06lX") \
+  X(ESPNOW_BAD_FRAME,       WARN,  "[ESP-NOW BASE] Bad frame (err %ld), len=%ld, ignoring") \
+  X(COMM_PEER_ADDED,        INFO,  "[COMM] Remote peer added for status TX") \
+  X(COMM_PEER_FAILED,       ERROR, "[COMM] Failed to add remote peer, err=%ld") \
+  X(COMM_STATUS_SEND_ERR,   WARN,  "[COMM] Frame send ERR=%ld, %ld ACK dropped") \
+  X(COMM_DUPLICATE,         INFO,  "[COMM] Duplicate cmd seq=%lu type=%ld, ACK only") \
+  /* ---- очередь команд ---- */ \
+  X(CMDQ_OVERFLOW,          WARN,  "[CMDQ] Queue %ld full, command dropped") \
+  /* ---- Serial / телеметрия / стенд ---- */ \
+  X(SERIAL_SET_ACCEL,       INFO,  "[SERIAL] ACCEL=%ld") \
+  X(SERIAL_SET_MAXSPEED,    INFO,  "[SERIAL] MAXSPEED=%ld") \
+  X(SERIAL_SET_JERK,        INFO,  "[SERIAL] JERK=%ld") \
+  X(TELEM_START,            INFO,  "[TELEM] Recording at %ld Hz, %ld-sample ring") \
+  X(TELEM_STOP,             INFO,  "[TELEM] Stopped: samples %lu, dropped %lu") \
+  X(BENCH_BUSY,             WARN,  "[BENCH] Already running") \
+  X(BENCH_NEED_IDLE,        WARN,  "[BENCH] Needs IDLE with valid calibration") \
+  X(BENCH_TRAVEL_SHORT,     WARN,  "[BENCH] Travel too short") \
+  X(BENCH_START,            INFO,  "[BENCH] Start")
+
+enum LogId : uint16_t {
+#define LOG_X_ENUM(id, level, fmt) LOG_##id,
+  LOG_MESSAGES(LOG_X_ENUM)
+#undef LOG_X_ENUM
+  LOG_ID_COUNT
+};
+
+// Уровень сообщения — константа времени компиляции (для отсечения в LOG())
+constexpr uint8_t logLevelOf(LogId id) {
+#define LOG_X_LEVEL(name, level, fmt) id == LOG_##name ? LOG_LEVEL_##level :
+  return LOG_MESSAGES(LOG_X_LEVEL) LOG_LEVEL_DEBUG;
+#undef LOG_X_LEVEL
+}
+
+#define LOG(id, ...)                                         \
+  do {                                                       \
+    if (logLevelOf(LOG_##id) <= LOG_LEVEL) {                 \
+      logWrite(LOG_##id, ##__VA_ARGS__);                     \
+    }                                                        \
+  } while (0)
+
+// Запись в кольцо (ISR / задача WiFi / loop). false — кольцо полно, запись отброшена.
+bool logWrite(LogId id, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0);
+
+void     logService();         // из задачи связи: форматирует и отдаёт в Serial, сколько влезет в TX FIFO
+void     logFlush();           // слить всё с ожиданием (перед перезагрузкой / в отчётах)
+uint32_t logGetDropped();      // сколько записей потеряно с момента старта
@@ -1,5 +1,9 @@
 #include "motor_controller.h"
-#include <math.h>
+#include "step_generator.h"
+#include "step_io.h"
+#include "step_ramp.h"
+#include "step_bench.h"
+#include "logger.h"
 
 // Пины (как мы договорились)
 static const int STEP_PIN = 18;
@@ -9,33 +13,49 @@ static const int EN_PIN   = 21;
 // Профиль движения
 static float maxSpeed   = 2500.0f;  // шагов/сек (максимальная крейсерская)
 static float accel      = 1800.0f;   // шагов/сек^2 (ускорение/торможение)
+static float jerk       = 12000.0f;  // шагов/сек^3 (рывок, только для S-кривой)
 static float manualSpeed = 400.0f;  // шагов/сек в ручном режиме
+static float speedLimit  = 0.0f;    // потолок для потенциометра, 0 — нет
+static int   lastPotRaw  = 4095;    // последнее значение ручки (потолок применяется к нему)
 
 // Текущее состояние движения
-static long  currentPos     = 0;      // текущая позиция в шагах
-static long  targetPos      = 0;      // целевая позиция в шагах
-static bool  moveActive     = false;  // едем к targetPos
+static volatile long currentPos = 0;  // текущая позиция в шагах (меняется из ISR шага)
+static volatile long targetPos = 0;   // целевая позиция в шагах
+static volatile bool moveActive = false; // едем к targetPos
 static bool  manualMode     = false;  // ручной режим (MAN_UP / MAN_DOWN)
 static int   manualDir      = 0;      // +1 вверх, -1 вниз
 static bool calibDownFastFlag = false; //быстрее при калибровке вниз
-static float currentSpeed   = 0.0f;   // текущая скорость (шагов/сек, знак = направление)
-static unsigned long lastStepMicros   = 0;  // момент последнего шага
-static unsigned long lastServiceMicros = 0; // момент последнего пересчёта скорости
+static volatile int8_t stepDir = 0;   // направление текущего профиля: +1 / -1
+static float jogSpeed = 0.0f;         // > 0 — ручной ход ждёт, пока мотор дотормозит (motorService)
+
+// План поездки к targetPos (считается в planToTarget) и отсчёт времени до прибытия
+static RampPlan      movePlan;          // участки профиля последнего плана
+static unsigned long planStartMs = 0;   // millis() в момент плана
+static uint32_t      planMs      = 0;   // от planStartMs до прибытия в targetPos
+
+// Энкодер (пороги — в motor_controller.h)
+static bool     encOn         = false;
+static bool     stallPending  = false;
+static long     encErrMax     = 0;    // наибольшее |расхождение| на ходу
+static uint32_t encFixes      = 0;
+static long     encFixedSteps = 0;
+static uint32_t encStalls     = 0;
+
+// Режим генерации шагов и форма профиля по умолчанию
+static const StepGenMode STEP_MODE_DEFAULT = STEPGEN_TIMER_ISR;
+static const RampProfile PROFILE_DEFAULT   = RAMP_TRAPEZOID;
 
 // Минимальная скорость, ниже которой не шагаем (чтобы избежать дёрганий)
 static const float MIN_SPEED = 50.0f;         // шагов/сек
-// Минимальная длительность импульса STEP
-static const int   STEP_PULSE_US = 2;
+
+static void stepCallback();
+static void syncPosition();
 
 // ----------------------------------------------------------
 
 void motorInit() {
-  pinMode(STEP_PIN, OUTPUT);
-  pinMode(DIR_PIN, OUTPUT);
+  stepIoInit(STEP_PIN, DIR_PIN);  // STEP и DIR в LOW
   pinMode(EN_PIN, OUTPUT);
-
-  digitalWrite(STEP_PIN, LOW);
-  digitalWrite(DIR_PIN, LOW);
   // EN активен по LOW → сразу включаем драйвер
   digitalWrite(EN_PIN, LOW);
 
@@ -44,53 +64,202 @@ void motorInit() {
   moveActive = false;
   manualMode = false;
   manualDir  = 0;
-  currentSpeed = 0.0f;
-  lastStepMicros = micros();
-  lastServiceMicros = micros();
+  stepDir = 0;
 
   Serial.println("[MOTOR] Init: STEP=18, DIR=19, EN=21");
+  rampInit();
+  rampSetAccel((uint32_t)accel);
+  rampSetJerk((uint32_t)jerk);
+  rampSetProfile(PROFILE_DEFAULT);
+  stepGenSetPulseOutput(STEP_PIN, rampNextInterval);  // для режима RMT: профиль напрямую в символы
+  stepGenInit(STEP_MODE_DEFAULT, stepCallback);
+  if (ENCODER_ENABLED) motorSetEncoder(true);
+}
+
+void motorSetStepMode(StepGenMode mode) {
+  // Переключаем только на стоящем моторе, иначе потеряем шаги
+  if (stepGenIsRunning()) {
+    LOG(MOTOR_STEP_MODE_BUSY);
+    return;
+  }
+  syncPosition();  // счётчик выданных шагов RMT сбрасывается при смене режима
+  stepGenSetMode(mode);
 }
-void motorCalibDownFast() {
-  manualMode = true;
-  moveActive = false;
-  manualDir  = -1;
-  calibDownFastFlag = true; 
-  // Удваиваем скорость
-  currentSpeed = 0;
-  Serial.println("[MOTOR] Calib DOWN FAST (x2)");
 
-  // временно увеличиваем manualSpeed
-  // но только внутри motorService
+void motorSetStepIo(StepIoMode mode) {
+  if (stepGenIsRunning()) {
+    LOG(MOTOR_STEP_IO_BUSY);
+    return;
+  }
+  stepIoSetMode(mode);
 }
 
-static void setDirFromSpeed(float speed) {
-  // Положительная скорость → DIR HIGH (допустим, вверх)
-  // Если хочешь инвертировать направление — просто поменяй HIGH/LOW местами
-  if (speed >= 0) {
-    digitalWrite(DIR_PIN, HIGH);
+void motorSetProfile(RampProfile profile) {
+  // Таблица S-кривой переписывается при планировании — только на стоящем моторе
+  if (stepGenIsRunning()) {
+    LOG(MOTOR_PROFILE_BUSY);
+    return;
+  }
+  rampSetProfile(profile);
+  if (profile == RAMP_SCURVE) {
+    LOG(MOTOR_PROFILE_SCURVE);
   } else {
-    digitalWrite(DIR_PIN, LOW);
+    LOG(MOTOR_PROFILE_TRAP);
+  }
+}
+
+void motorSetJerk(float jerk_steps_per_sec3) {
+  if (jerk_steps_per_sec3 < 100.0f) jerk_steps_per_sec3 = 100.0f;
+  jerk = jerk_steps_per_sec3;
+}
+
+// Остановить генератор сразу (без торможения) и забыть профиль
+static void haltSteps() {
+  stepGenSetInterval(0);
+  syncPosition();  // RMT: символы, не успевшие выйти, сброшены — в позицию только выданные
+  rampReset();
+}
+
+// Таблица разгона пересчитывается только на стоящем моторе —
+// ISR шага читает её без блокировки
+static void applyAccelIfStopped() {
+  if (!stepGenIsRunning()) {
+    rampSetAccel((uint32_t)accel);
+    rampSetJerk((uint32_t)jerk);
+  }
+}
+
+// Ручное движение с разгоном до speed в направлении dir (с места)
+static void startJogFromRest(int dir, float speed) {
+  jogSpeed = 0.0f;
+  haltSteps();
+  applyAccelIfStopped();
+  stepDir = (int8_t)dir;
+  stepIoSetDir(stepDir);  // в режиме RMT колбэка шага нет — DIR ставим до цепочки
+  rampPlanJog((uint32_t)speed, 0);
+  stepGenStart();
+}
+
+// Ручное движение. На ходу (MAN_UP посреди поездки) — как разворот в planToTarget():
+// торможение с ускорением профиля, разгон с места — из motorService(), когда мотор встанет
+static void startJog(int dir, float speed) {
+  stepGenLock();
+  bool running = stepGenIsRunning();
+  if (running) rampPlanStop();
+  stepGenUnlock();
+  if (running) {
+    jogSpeed = speed;
+    return;
   }
+  startJogFromRest(dir, speed);
+}
+
+void motorCalibDownFast() {
+  manualMode = true;
+  moveActive = false;
+  manualDir  = -1;
+  calibDownFastFlag = true;
+  // Ускоряем спуск (множитель к manualSpeed)
+  startJog(manualDir, manualSpeed * 3.0f);
+  LOG(MOTOR_CALIB_DOWN_FAST);
 }
 
 void motorSetMaxSpeed(float speed_steps_per_sec) {
   if (speed_steps_per_sec < MIN_SPEED) speed_steps_per_sec = MIN_SPEED;
   maxSpeed = speed_steps_per_sec;
-  // Serial.print("[MOTOR] maxSpeed="); Serial.println(maxSpeed);
 }
 
 void motorSetAccel(float accel_steps_per_sec2) {
   if (accel_steps_per_sec2 < 10.0f) accel_steps_per_sec2 = 10.0f;
   accel = accel_steps_per_sec2;
-  // Serial.print("[MOTOR] accel="); Serial.println(accel);
 }
 
+float motorGetAccel() {
+  return accel;
+}
+
+// Зовётся только при изменении ручки (io_manager) и при смене потолка
 void motorUpdateSpeedFromPot(int potRaw) {
+  lastPotRaw = potRaw;
   // Мапим 0..4095 → 200..2000 шаг/сек
   float s = 200.0f + (1800.0f * ((float)potRaw / 4095.0f));
+  if (speedLimit > 0.0f && s > speedLimit) s = speedLimit;
   motorSetMaxSpeed(s);
 }
 
+void motorSetSpeedLimit(float speed_steps_per_sec) {
+  if (speed_steps_per_sec > 0.0f && speed_steps_per_sec < MIN_SPEED) speed_steps_per_sec = MIN_SPEED;
+  speedLimit = speed_steps_per_sec;
+  motorUpdateSpeedFromPot(lastPotRaw);
+}
+
+// ----------------------------------------------------------
+// Планирование поездки к targetPos
+
+// Отсчёт до прибытия — от плана рампы, который только что построен (+ extraUs сверх него)
+static void startPlanClock(uint32_t extraUs) {
+  rampGetPlan(movePlan);
+  planStartMs = millis();
+  planMs      = (movePlan.totalUs + extraUs + 999) / 1000;
+}
+
+// Поездка к targetPos с места. Генератор стоит — ISR таблицу не читает, поэтому план
+// (для S-кривой — таблица до 2048 шагов на cbrtf) строится без замка, с прерываниями.
+static void planFromRest() {
+  syncPosition();
+  long distanceToGo = targetPos - currentPos;
+  rampReset();
+  if (distanceToGo != 0) {
+    stepDir = (int8_t)((distanceToGo > 0) ? +1 : -1);
+    stepIoSetDir(stepDir);
+    rampPlanMove((uint32_t)labs(distanceToGo), (uint32_t)maxSpeed, 0);
+  }
+  startPlanClock(0);
+  if (distanceToGo != 0) stepGenStart();
+}
+
+// Строит профиль к targetPos с учётом того, что мотор, возможно, уже едет.
+// Если на ходу цель позади или ближе тормозного пути — тормозим,
+// а новый профиль строит motorService() после остановки.
+// В режиме RMT профиль уже взят в символы на stepGenQueuedSteps() шагов вперёд —
+// путь считаем от той точки, где профиль сейчас, а не от выданной позиции.
+// Под замком — только чтение уровня и позиции и подмена плана на ходу (без таблиц).
+static void planToTarget() {
+  if (!stepGenIsRunning()) {
+    planFromRest();
+    return;
+  }
+
+  syncPosition();
+  stepGenLock();
+  if (!stepGenIsRunning()) {  // профиль успел закончиться
+    stepGenUnlock();
+    planFromRest();
+    return;
+  }
+  long planPos = currentPos + (long)stepDir * (long)stepGenQueuedSteps();
+  long distanceToGo = targetPos - planPos;
+  int  dir = (distanceToGo > 0) ? +1 : -1;
+  uint32_t dist = (uint32_t)labs(distanceToGo);
+  long stopPos = planPos;  // куда встанем при торможении
+
+  if (dir != stepDir || !rampPlanMove(dist, (uint32_t)maxSpeed, rampGetLevel())) {
+    rampPlanStop();
+    stopPos = planPos + (long)stepDir * (long)rampGetLevel();
+  }
+  stepGenUnlock();
+
+  // Торможение с разворотом — к нему поездка с места от точки остановки,
+  // её motorService() спланирует, когда мотор встанет
+  uint32_t restUs = 0;
+  if (stopPos != planPos && stopPos != targetPos) {
+    RampPlan rest;
+    rampEstimateMove((uint32_t)labs(targetPos - stopPos), (uint32_t)maxSpeed, rest);
+    restUs = rest.totalUs;
+  }
+  startPlanClock(restUs);
+}
+
 // ----------------------------------------------------------
 // Внешние команды движения
 
@@ -99,158 +268,292 @@ void motorMoveTo(long targetPosition) {
   moveActive = true;
   manualMode = false;
   manualDir  = 0;
-  // направление задаём по знаку distanceToGo в motorService()
-  Serial.print("[MOTOR] MoveTo "); Serial.println(targetPos);
+  jogSpeed   = 0.0f;
+  applyAccelIfStopped();
+  // Профиль (разгон / крейсер / торможение) считается один раз здесь
+  planToTarget();
+  if (rampGetProfile() == RAMP_SCURVE) {
+    LOG(MOTOR_MOVE_TO_SCURVE, targetPos, planMs);
+  } else {
+    LOG(MOTOR_MOVE_TO, targetPos, planMs);
+  }
 }
 
 void motorStop() {
+  manualMode = false;
+  manualDir  = 0;
+  jogSpeed   = 0.0f;
+  calibDownFastFlag = false;
+  if (!stepGenIsRunning()) {
+    moveActive = false;
+    haltSteps();
+    LOG(MOTOR_STOP, currentPos, 0L);
+    return;
+  }
+
+  // Торможение с текущей скорости с ускорением профиля. Цель — точка остановки: поездка
+  // к ней, так что motorIsBusy() держится до последнего шага, а ETA — время торможения.
+  // Уровень и позиция — под одним замком, иначе шаг ISR между ними сдвинул бы точку.
+  syncPosition();
+  stepGenLock();
+  long planPos = currentPos + (long)stepDir * (long)stepGenQueuedSteps();
+  rampPlanStop();
+  targetPos  = planPos + (long)stepDir * (long)rampGetLevel();
+  moveActive = true;
+  stepGenUnlock();
+  startPlanClock(0);
+  LOG(MOTOR_STOP, targetPos, planMs);
+}
+
+void motorEmergencyStop() {
   moveActive = false;
   manualMode = false;
   manualDir  = 0;
-  currentSpeed = 0.0f;
+  jogSpeed   = 0.0f;
+  haltSteps();
   calibDownFastFlag = false;  // <----------- СБРОС
-  Serial.println("[MOTOR] Stop");
+  LOG(MOTOR_EMERGENCY_STOP, currentPos);
 }
 
 void motorManualUp() {
   manualMode = true;
   moveActive = false;
   manualDir  = +1;
-  currentSpeed = 0.0f; // начнём разгоняться вверх
-  Serial.println("[MOTOR] Manual UP");
+  startJog(manualDir, manualSpeed); // начнём разгоняться вверх
+  LOG(MOTOR_MANUAL_UP);
 }
 
 void motorManualDown() {
   manualMode = true;
   moveActive = false;
   manualDir  = -1;
-  currentSpeed = 0.0f; // начнём разгоняться вниз
-  Serial.println("[MOTOR] Manual DOWN");
-}
-
-void motorManualStop() {
-  manualMode = false;
-  manualDir  = 0;
-  currentSpeed = 0.0f;
-  Serial.println("[MOTOR] Manual STOP");
+  startJog(manualDir, manualSpeed); // начнём разгоняться вниз
+  LOG(MOTOR_MANUAL_DOWN);
 }
 
 // ----------------------------------------------------------
 // Позиция
 
+bool motorIsBusy() {
+  return moveActive || manualMode || stepGenIsRunning();
+}
+
+long motorGetStoppingDistance() {
+  // Уровень рампы = ровно столько шагов торможения (и для трапеции, и для S-кривой);
+  // в режиме RMT к нему — шаги, уже взятые в символы, но ещё не выданные
+  return stepGenIsRunning() ? (long)(rampGetLevel() + stepGenQueuedSteps()) : 0;
+}
+
+long motorGetSpeed() {
+  if (!stepGenIsRunning()) return 0;
+  uint32_t interval = rampGetCurrentIntervalUs();
+  if (interval == 0) return 0;
+  long v = (long)(1000000UL / interval);
+  return (stepDir < 0) ? -v : v;
+}
+
+float motorGetMaxSpeed() {
+  return maxSpeed;
+}
+
 long motorGetCurrentPosition() {
+  syncPosition();
   return currentPos;
 }
 
+long motorPeekPosition() {
+  stepGenLock();
+  long n = (long)stepGenPeekEmittedSteps();
+  long pos = currentPos + ((stepDir < 0) ? -n : n);
+  stepGenUnlock();
+  return pos;
+}
+
+long motorGetTargetPosition() {
+  return targetPos;
+}
+
+uint32_t motorGetEtaMs() {
+  if (!moveActive) return 0;
+  unsigned long elapsed = millis() - planStartMs;
+  return (elapsed < planMs) ? (uint32_t)(planMs - elapsed) : 0;
+}
+
+bool motorEtaIsExact() {
+  return stepGenGetMode() != STEPGEN_POLLING;
+}
+
+void motorGetStatus(MotorStatus &out) {
+  out.plan          = movePlan;
+  out.planMs        = planMs;
+  out.etaMs         = motorGetEtaMs();
+  out.encOn         = encOn ? 1 : 0;
+  out.encSteps      = encOn ? (int32_t)encoderGetSteps() : 0;
+  out.encCount      = encOn ? (int32_t)encoderGetCount() : 0;
+  out.encErrMax     = (int32_t)encErrMax;
+  out.encFixedSteps = (int32_t)encFixedSteps;
+  out.encFixes      = encFixes;
+  out.encStalls     = encStalls;
+  out.position      = (int32_t)motorGetCurrentPosition();
+}
+
+void motorPrintPlan(const MotorStatus &s, Print &out) {
+  const RampPlan &p = s.plan;
+  out.printf("[PLAN] accel %lu steps %lu ms, cruise %lu steps %lu ms, decel %lu steps %lu ms, "
+             "to target %lu ms, ETA %lu ms\r\n",
+             (unsigned long)p.accelSteps, (unsigned long)(p.accelUs / 1000),
+             (unsigned long)p.cruiseSteps, (unsigned long)(p.cruiseUs / 1000),
+             (unsigned long)p.decelSteps, (unsigned long)(p.decelUs / 1000),
+             (unsigned long)s.planMs, (unsigned long)s.etaMs);
+}
+
 void motorSetCurrentPosition(long pos) {
+  syncPosition();  // выданные до этого шаги не должны лечь поверх новой позиции
   currentPos = pos;
+  if (encOn) encoderSetSteps(pos);
   // При установке позиции мы также ставим targetPos = currentPos,
   // чтобы не было "ложного" движения
   targetPos = pos;
-  Serial.print("[MOTOR] Set position="); Serial.println(currentPos);
+  LOG(MOTOR_SET_POSITION, currentPos);
 }
 
 // ----------------------------------------------------------
 // Внутренние вспомогательные функции
 
-// Один шаг в текущем направлении currentSpeed
-static void doStep() {
-  // Выбираем направление по знаку скорости
-  setDirFromSpeed(currentSpeed);
-
-  digitalWrite(STEP_PIN, HIGH);
-  delayMicroseconds(STEP_PULSE_US);
-  digitalWrite(STEP_PIN, LOW);
+// Один шаг в направлении stepDir: DIR (только на реверсе) и фронт STEP.
+// Спад STEP — в stepCallback(), когда посчитан следующий интервал.
+static void IRAM_ATTR doStep() {
+  int8_t dir = stepDir;
+  stepIoPulseBegin(dir);
 
   // Обновляем логическую позицию
-  if (currentSpeed > 0) {
-    currentPos += 1;
-  } else if (currentSpeed < 0) {
-    currentPos -= 1;
+  if (dir > 0) {
+    currentPos = currentPos + 1;
+  } else if (dir < 0) {
+    currentPos = currentPos - 1;
   }
 }
 
-// ----------------------------------------------------------
-// Главная функция сервиса, вызывается в loop() очень часто
-
-void motorService() {
-  unsigned long nowMicros = micros();
-  float dt = (nowMicros - lastServiceMicros) / 1000000.0f; // dt в секундах
-  if (dt <= 0) dt = 0.000001f;
-  lastServiceMicros = nowMicros;
-
-  // Определяем, чего мы хотим: режим MoveTo или Manual
-  float targetSpeed = 0.0f; // желаемая скорость (шаг/сек)
+// Режим RMT: шаги выдаёт железо, PCNT их считает — забираем в currentPos.
+// В остальных режимах позицию ведёт doStep(), здесь всегда 0.
+// Под замком генератора: motorPeekPosition() из фона не должен увидеть шаги дважды.
+static void syncPosition() {
+  stepGenLock();
+  uint32_t n = stepGenTakeEmittedSteps();
+  if (n) currentPos = currentPos + ((stepDir < 0) ? -(long)n : (long)n);
+  stepGenUnlock();
+}
 
-if (manualMode) {
-    float baseSpeed = manualSpeed;
+// Колбэк генератора шагов (в режиме ISR — из прерывания таймера):
+// шаг + следующая задержка из заранее посчитанного профиля.
+// Число шагов в профиле ровно равно пути, поэтому торможение начинается
+// на нужном шаге и остановка точно в targetPos.
+static void IRAM_ATTR stepCallback() {
+  benchOnStep(rampGetCurrentIntervalUs());  // задержка, которую профиль задал перед этим шагом
+  doStep();
+  stepGenSetInterval(rampNextInterval());  // считаем, пока STEP в HIGH
+  stepIoPulseEnd();
+  benchOnStepDone();
+}
 
-    // если включён быстрый режим калибровки — умножаем
-    if (calibDownFastFlag && manualDir < 0) {
-        baseSpeed *= 3.0f;   // ← множитель скорости
-    }
+// ----------------------------------------------------------
+// Энкодер
 
-    if (manualDir > 0) {
-        targetSpeed = baseSpeed;
-    } else if (manualDir < 0) {
-        targetSpeed = -baseSpeed;
-    } else {
-        targetSpeed = 0.0f;
-    }
+void motorSetEncoder(bool on) {
+  if (!on) {
+    encOn = false;
+    encoderEnd();
+    LOG(MOTOR_ENCODER_OFF);
+    return;
+  }
+  if (!encoderBegin()) return;
+  syncPosition();
+  encoderSetSteps(currentPos);
+  encErrMax     = 0;
+  encFixes      = 0;
+  encFixedSteps = 0;
+  encStalls     = 0;
+  stallPending  = false;
+  encOn         = true;
+  LOG(MOTOR_ENCODER_ON);
 }
- else if (moveActive) {
-    long distanceToGo = targetPos - currentPos; // сколько шагов осталось
-    if (distanceToGo == 0) {
-      // Уже на месте
-      moveActive = false;
-      currentSpeed = 0.0f;
-      return;
-    }
 
-    int dir = (distanceToGo > 0) ? +1 : -1;
-    float dist = fabs((float)distanceToGo);
-
-    // Тормозной путь при текущей скорости: v^2 / (2a)
-    float speedAbs = fabs(currentSpeed);
-    float brakeDist = (speedAbs * speedAbs) / (2.0f * accel);
+bool motorEncoderActive() {
+  return encOn;
+}
 
-    float maxAllowedSpeed = maxSpeed;
+bool motorTakeStall() {
+  bool s = stallPending;
+  stallPending = false;
+  return s;
+}
 
-    // Если пора тормозить, ограничиваем максимальную скорость
-    if (brakeDist > dist) {
-      maxAllowedSpeed = sqrtf(2.0f * accel * dist);
-      if (maxAllowedSpeed < MIN_SPEED) {
-        maxAllowedSpeed = MIN_SPEED;
-      }
-    }
+void motorPrintEncoderStatus(const MotorStatus &s, Print &out) {
+  if (!s.encOn) {
+    out.println("[ENC] off (open loop)");
+    return;
+  }
+  out.printf("[ENC] pos %ld (count %ld), error %ld, max on the move %ld, drift fixes %lu (%ld steps), stalls %lu\r\n",
+             (long)s.encSteps, (long)s.encCount, (long)(s.position - s.encSteps), (long)s.encErrMax,
+             (unsigned long)s.encFixes, (long)s.encFixedSteps, (unsigned long)s.encStalls);
+}
 
-    targetSpeed = dir * maxAllowedSpeed;
-  } else {
-    // Нет ни движения, ни ручного режима
-    targetSpeed = 0.0f;
+// Сверка позиции по шагам с энкодером (после syncPosition())
+static void encoderCheck() {
+  long measured = encoderGetSteps();
+  long err      = currentPos - measured;  // шагов выдано, а вал не прошёл (со знаком хода)
+  long errAbs   = labs(err);
+  bool running  = stepGenIsRunning();
+  if (running && errAbs > encErrMax) encErrMax = errAbs;
+
+  if (errAbs > ENC_STALL_STEPS) {
+    // Срыв: шаги уходят в пустоту — стоп сразу, без торможения (вал всё равно не идёт)
+    moveActive = false;
+    manualMode = false;
+    manualDir  = 0;
+    calibDownFastFlag = false;
+    haltSteps();
+    currentPos   = measured;
+    targetPos    = measured;
+    stallPending = true;
+    encStalls++;
+    LOG(MOTOR_STALL, err, measured);
+    return;
+  }
+  if (!running && errAbs > ENC_DEADBAND_STEPS) {
+    // Дрейф на месте: позиция — по энкодеру; недоехавшую поездку motorService() доведёт
+    currentPos = measured;
+    encFixes++;
+    encFixedSteps += errAbs;
+    LOG(MOTOR_DRIFT_FIXED, err, measured);
   }
+}
 
-  // Плавно изменяем currentSpeed → targetSpeed с учётом ускорения
-  float maxDeltaV = accel * dt; // максимальное изменение скорости за dt
+// ----------------------------------------------------------
+// Главная функция сервиса, вызывается в loop() очень часто
 
-  if (currentSpeed < targetSpeed) {
-    currentSpeed += maxDeltaV;
-    if (currentSpeed > targetSpeed) currentSpeed = targetSpeed;
-  } else if (currentSpeed > targetSpeed) {
-    currentSpeed -= maxDeltaV;
-    if (currentSpeed < targetSpeed) currentSpeed = targetSpeed;
-  }
+void motorService() {
+  // В режиме POLLING шаги делаются здесь; в режиме ISR — в прерывании
+  stepGenService();
+  syncPosition();
+  if (encOn) encoderCheck();
+
+  if (stepGenIsRunning()) return;
 
-  // Если скорость почти нулевая — не шагаем
-  if (fabs(currentSpeed) < MIN_SPEED) {
+  // Дотормозили перед ручным ходом — разгон с места
+  if (jogSpeed > 0.0f) {
+    startJogFromRest(manualDir, jogSpeed);
     return;
   }
 
-  // Частота шагов → интервал между шагами
-  float stepInterval = 1000000.0f / fabs(currentSpeed); // микросек на один шаг
-
-  if ((nowMicros - lastStepMicros) >= (unsigned long)stepInterval) {
-    lastStepMicros = nowMicros;
-    doStep();
+  // Профиль закончился
+  if (moveActive) {
+    if (currentPos == targetPos) {
+      // Уже на месте
+      moveActive = false;
+    } else {
+      // Тормозили с разворотом (цель сменилась на ходу) — теперь едем к новой цели
+      planToTarget();
+    }
   }
 }
@@ -1,22 +1,84 @@
 #pragma once
 #include <Arduino.h>
+#include "step_generator.h"
+#include "step_io.h"
+#include "step_ramp.h"
+#include "encoder.h"
 
 // Реальный контроллер шагового мотора с STEP/DIR/EN и профилем скорости
 
 void motorInit();
 void motorService();
 
+// Способ генерации STEP: опрос из loop() или ISR аппаратного таймера
+void motorSetStepMode(StepGenMode mode);
+// Выход STEP/DIR: регистры GPIO (по умолчанию) или digitalWrite, как раньше — для BENCH
+void motorSetStepIo(StepIoMode mode);
+
+// Новую цель можно дать в любой момент: профиль продолжается с текущей скорости; цель позади
+// или ближе тормозного пути — торможение, потом поездка с места (разворот).
 void motorMoveTo(long targetPosition);
+// Управляемый стоп: торможение с ускорением профиля (motorGetStoppingDistance() шагов),
+// мотор занят до последнего шага
 void motorStop();
+// Аварийный стоп: шаги прекращаются сразу, без торможения (концевик, ошибка, точка калибровки)
+void motorEmergencyStop();
 
 void motorSetMaxSpeed(float speed_steps_per_sec);
 void motorSetAccel(float accel_steps_per_sec2);
+float motorGetAccel();
+// Форма профиля (трапеция / S-кривая) и рывок для S-кривой — применяются со следующей поездки
+void motorSetProfile(RampProfile profile);
+void motorSetJerk(float jerk_steps_per_sec3);
 void motorUpdateSpeedFromPot(int potRaw);
+// Потолок скорости поверх потенциометра (Serial: SET MAXSPEED), 0 — без потолка
+void motorSetSpeedLimit(float speed_steps_per_sec);
+
+bool motorIsBusy();  // едем к цели, ручной режим или ещё идут шаги торможения
+long motorGetStoppingDistance();  // шагов до остановки с текущей скорости (0 — стоим)
+long motorGetSpeed();             // текущая скорость, шагов/сек со знаком направления (0 — стоим)
+float motorGetMaxSpeed();         // крейсерская скорость (потенциометр с потолком)
 
 long motorGetCurrentPosition();
+long motorPeekPosition();  // то же без побочных эффектов — можно звать из фона (esp_timer)
 void motorSetCurrentPosition(long pos);
+long motorGetTargetPosition();  // цель поездки (после motorSetCurrentPosition — та же позиция)
+
+// План поездки считается по формулам при motorMoveTo() и при каждом перепланировании
+// (step_ramp.h: RampPlan); с разворотом на ходу — торможение плюс поездка с места обратно.
+uint32_t motorGetEtaMs();          // до прибытия в цель по плану, мс (0 — не едем к цели / план вышел)
+// ETA выдерживается, только когда шаги идут по аппаратному таймеру (ISR / RMT);
+// в STEP_POLL шаг не чаще прохода loop(), и поездка отстаёт от плана
+bool motorEtaIsExact();
+
+// Обратная связь по энкодеру (encoder.h). Позиция по-прежнему считается по шагам; энкодер
+// сверяется с ней каждый motorService(): на месте расхождение больше зоны нечувствительности
+// (дрейф) — позиция берётся с энкодера и недошедшая поездка доезжает сама; расхождение
+// больше порога срыва (на ходу или на месте) — мотор встаёт сразу, позиция с энкодера.
+static const long ENC_DEADBAND_STEPS = 4;   // на месте: угол нагрузки (полшага при 1/8), не дрейф
+static const long ENC_STALL_STEPS    = 48;  // шесть полных шагов — срыв
+void motorSetEncoder(bool on);   // включение совмещает шкалу энкодера с текущей позицией
+bool motorEncoderActive();
+bool motorTakeStall();           // был срыв с прошлого вызова (мотор уже стоит) — для автомата
+
+// STATUS: план и энкодер снимает задача движения, печатает задача связи
+struct MotorStatus {
+  RampPlan plan;           // участки последнего плана
+  uint32_t planMs;         // от старта плана до прибытия
+  uint32_t etaMs;
+  int32_t  encSteps;
+  int32_t  encCount;
+  int32_t  encErrMax;      // наибольшее |расхождение| на ходу
+  int32_t  encFixedSteps;
+  uint32_t encFixes;
+  uint32_t encStalls;
+  int32_t  position;
+  uint8_t  encOn;
+};
+void motorGetStatus(MotorStatus &out);
+void motorPrintPlan(const MotorStatus &s, Print &out);
+void motorPrintEncoderStatus(const MotorStatus &s, Print &out);
 
 // Ручное движение (для MANUAL_MOVE / калибровки)
 void motorManualUp();
 void motorManualDown();
-void motorManualStop();
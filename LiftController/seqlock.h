@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Seqlock: один писатель публикует значение целиком, читателей сколько угодно, никто не ждёт
+// замка. Писатель делает счётчик нечётным, пишет данные и делает его снова чётным; читатель
+// копирует данные и повторяет, если счётчик был нечётным или изменился за время копии.
+// Так читатель на другом ядре никогда не получит половину старого снимка и половину нового,
+// а писатель (задача движения) не ждёт ни одного читателя.
+//
+// Данные хранятся атомарными словами — копия без гонок и для модели памяти C++, и для
+// ThreadSanitizer. Порядок — без отдельных барьеров: слова пишутся с release, читаются с
+// acquire. Увидел читатель хоть одно новое слово — увидит и изменившийся счётчик.
+//
+// Заголовок без Arduino — собирается и в хостовом стресс-тесте (sim/seqlock_stress.cpp).
+
+template <typename T>
+struct Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+  static constexpr size_t WORDS = (sizeof(T) + 3) / 4;
+
+  // Только писатель
+  void write(const T &v) {
+    uint32_t w[WORDS] = {};
+    memcpy(w, &v, sizeof(T));
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);  // нечётный — идёт запись
+    for (size_t i = 0; i < WORDS; i++) data[i].store(w[i], std::memory_order_release);
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  // Любой читатель: согласованная копия. Повторы (писатель был посреди записи) — в retries.
+  void read(T &out) const {
+    uint32_t w[WORDS];
+    for (;;) {
+      uint32_t s1 = seq.load(std::memory_order_acquire);
+      if (s1 & 1) {
+        retries.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      // acquire: повторное чтение счётчика не уедет раньше копии
+      for (size_t i = 0; i < WORDS; i++) w[i] = data[i].load(std::memory_order_acquire);
+      if (seq.load(std::memory_order_relaxed) == s1) break;
+      retries.fetch_add(1, std::memory_order_relaxed);
+    }
+    memcpy(&out, w, sizeof(T));
+  }
+
+  // Сколько раз публиковали (чётный счётчик / 2)
+  uint32_t version() const { return seq.load(std::memory_order_acquire) >> 1; }
+  uint32_t retryCount() const { return retries.load(std::memory_order_relaxed); }
+
+  // ---- состояние ----
+  std::atomic<uint32_t>         seq{0};
+  std::atomic<uint32_t>         data[WORDS] = {};
+  mutable std::atomic<uint32_t> retries{0};
+};
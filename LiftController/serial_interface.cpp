@@ -1,59 +1,524 @@
 #include "serial_interface.h"
 #include "state_machine.h"
+#include "motor_controller.h"
+#include "step_bench.h"
+#include "floor_manager.h"
+#include "command_queue.h"
+#include "comm_interface.h"
+#include "io_manager.h"
+#include "lift_snapshot.h"
+#include "telemetry.h"
+#include "seqlock.h"
+#include "logger.h"
+#include <limits.h>
 
-static String inputLine;
+// Разбор команд без String и кучи: строка копится в фиксированном буфере, режется
+// на токены на месте, команда ищется по хешу имени (хеши таблицы считаются при компиляции).
+// Разобранная и проверенная команда не выполняется сразу, а встаёт в общую очередь
+// команд (command_queue) вместе с командами пульта; выполнит её cmdQueueDispatch() в задаче
+// движения. Сама она в Serial не пишет: короткий ответ — через LOG(), STATUS / FLOORS — снимок
+// в seqlock, текст из него собирает serialService() в задаче связи. LINK и HELP отвечают данными
+// задачи связи — выполняются сразу при разборе, мимо очереди.
+//
+// Ошибки — одной строкой: "[SERIAL] ERR <код> <ИМЯ>: <подробности>".
 
-void serialInit() {
-  inputLine.reserve(64);
-  Serial.println("[SERIAL] Ready. Commands: F1/F2/F3, STOP, CALIB, CALIB_DOWN_START, CALIB_DOWN_SAVE, STATUS, CLEAR, MAN_UP, MAN_DOWN, MAN_STOP");
-}
-
-static void handleCommand(const String &cmd) {
-  if (cmd == "F1") {
-    smCommandMoveToFloor(1);
-  } else if (cmd == "F2") {
-    smCommandMoveToFloor(2);
-  } else if (cmd == "F3") {
-    smCommandMoveToFloor(3);
-  } else if (cmd == "STOP") {
-    smCommandStop();
-  } else if (cmd == "CALIB") {
-    smCommandStartCalib();
-  } else if (cmd == "CALIB_DOWN_START") {
-    smCommandCalibDownStart();
-  } else if (cmd == "CALIB_DOWN_SAVE") {
-    smCommandCalibDownSave();
-  } else if (cmd == "STATUS") {
-    smPrintStatus(Serial);
-  } else if (cmd == "CLEAR") {
-    smCommandClearError();
-  } else if (cmd == "MAN_UP") {
-    smCommandManualUpStart();
-  } else if (cmd == "MAN_DOWN") {
-    smCommandManualDownStart();
-  } else if (cmd == "MAN_STOP") {
-    smCommandManualStop();
+static const uint8_t SERIAL_LINE_MAX  = 96;   // с завершающим нулём
+static const uint8_t SERIAL_MAX_ARGS  = 3;    // аргументов после имени команды
+
+enum SerialError : uint8_t {
+  SERR_NONE = 0,
+  SERR_UNKNOWN_COMMAND,
+  SERR_ARG_COUNT,
+  SERR_BAD_NUMBER,
+  SERR_OUT_OF_RANGE,
+  SERR_LINE_TOO_LONG,
+  SERR_UNKNOWN_KEY,
+  SERR_QUEUE_FULL
+};
+
+static const char *const SERIAL_ERROR_NAMES[] = {
+  "OK", "UNKNOWN_COMMAND", "ARG_COUNT", "BAD_NUMBER", "OUT_OF_RANGE", "LINE_TOO_LONG", "UNKNOWN_KEY",
+  "QUEUE_FULL"
+};
+
+static char     g_line[SERIAL_LINE_MAX];
+static uint8_t  g_lineLen      = 0;
+static bool     g_lineOverflow = false;
+static uint32_t g_commandCount = 0;
+static uint32_t g_errorCount   = 0;
+
+// ---------------- ответы ----------------
+
+// Снимки для STATUS / FLOORS: пишет обработчик в задаче движения (в порядке очереди команд),
+// печатает serialService(). Запросы, пришедшие до печати прошлого ответа, дают один ответ —
+// по последнему снимку.
+struct StatusReport {
+  SmStatus        sm;
+  MotorStatus     motor;
+  TelemetryStatus telem;
+};
+
+static Seqlock<StatusReport> g_statusReport;
+static Seqlock<FloorTable>   g_floorReport;
+static uint32_t g_statusShown = 0;  // версии снимков, уже отданные в текст (задача связи)
+static uint32_t g_floorShown  = 0;
+
+// Текст ответа, ждущий места в TX FIFO: строки уходят целиком, как строки лога
+static const size_t SERIAL_TX_FIFO = 128;  // аппаратный TX FIFO UART ESP32
+static char   g_reply[1024];
+static size_t g_replyLen  = 0;
+static size_t g_replySent = 0;
+
+struct ReplyPrint : public Print {
+  size_t write(uint8_t c) override {
+    if (g_replyLen >= sizeof(g_reply)) return 0;  // не влезло — хвост ответа теряется
+    g_reply[g_replyLen++] = (char)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+// ---------------- хеш имён ----------------
+
+// FNV-1a; constexpr — таблица команд хешируется при компиляции
+static constexpr uint32_t nameHash(const char *s, uint32_t h = 2166136261u) {
+  return *s ? nameHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// ---------------- аргументы ----------------
+
+struct SerialArgs {
+  uint8_t     count;
+  const char *str[SERIAL_MAX_ARGS];  // токены как есть (для ключей вроде SET ACCEL)
+  long        num[SERIAL_MAX_ARGS];  // числовые значения (для аргументов из numMask)
+};
+
+// Ключевые команды (SET) выбирают исполнителя по аргументам ещё при разборе:
+// в очередь уходят только числа, строка к тому времени уже перезаписана.
+// nullptr — аргументы отвергнуты (ошибка уже напечатана).
+typedef CommandExec (*CommandResolve)(const SerialArgs &a, int32_t *arg);
+
+struct CommandDef {
+  uint32_t       hash;
+  const char    *name;
+  const char    *usage;
+  uint8_t        minArgs;
+  uint8_t        maxArgs;
+  uint8_t        numMask;   // бит i — аргумент i число в [minVal, maxVal]
+  long           minVal;
+  long           maxVal;
+  CommandExec    handler;   // исполнитель (из очереди), аргументы — num[]
+  CommandResolve resolve;   // или выбор исполнителя при разборе (nullptr — не нужен)
+  bool           local;     // выполнить сразу в задаче связи, мимо очереди
+};
+
+static void reportError(SerialError err, const char *fmt = nullptr, const char *a = nullptr,
+                        const char *b = nullptr) {
+  g_errorCount++;
+  Serial.print("[SERIAL] ERR ");
+  Serial.print((int)err);
+  Serial.print(' ');
+  Serial.print(SERIAL_ERROR_NAMES[err]);
+  if (fmt) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), fmt, a ? a : "", b ? b : "");
+    Serial.print(": ");
+    Serial.print(buf);
+  }
+  Serial.println();
+}
+
+// Целое со знаком, только цифры; false — не число или не влезает в long
+static bool parseLong(const char *s, long *out) {
+  bool neg = false;
+  if (*s == '-' || *s == '+') neg = (*s++ == '-');
+  if (!*s) return false;
+  long v = 0;
+  for (; *s; s++) {
+    if (!isDigit(*s)) return false;
+    if (v > (LONG_MAX - (*s - '0')) / 10) return false;
+    v = v * 10 + (*s - '0');
+  }
+  *out = neg ? -v : v;
+  return true;
+}
+
+static void toUpper(char *s) {
+  for (; *s; s++) {
+    if (*s >= 'a' && *s <= 'z') *s -= 'a' - 'A';
+  }
+}
+
+// ---------------- обработчики ----------------
+
+static void cmdHelp(const int32_t *);
+
+static void cmdCarCall(const int32_t *a)     { smCommandMoveToFloor((uint8_t)a[0]); }
+static void cmdUpCall(const int32_t *a)      { smCommandCall((uint8_t)a[0], CALL_UP); }
+static void cmdDownCall(const int32_t *a)    { smCommandCall((uint8_t)a[0], CALL_DOWN); }
+static void cmdGoto(const int32_t *a)        { smCommandMoveToPosition(a[0]); }
+static void cmdJog(const int32_t *a)         { smCommandJog(a[0]); }
+// Таблица этажей — ответом (печатает serialService())
+static void reportFloors() {
+  FloorTable t;
+  floorGetTable(t);
+  g_floorReport.write(t);
+}
+
+static void cmdTeach(const int32_t *a) {
+  smCommandTeachFloor((uint8_t)a[0]);
+  reportFloors();
+}
+static void cmdStop(const int32_t *)         { smCommandStop(); }
+static void cmdEstop(const int32_t *)        { smCommandEmergencyStop(); }
+static void cmdCalib(const int32_t *)        { smCommandStartCalib(); }
+static void cmdCalibDown(const int32_t *)    { smCommandCalibDownStart(); }
+static void cmdCalibSave(const int32_t *) {
+  smCommandCalibDownSave();
+  reportFloors();
+}
+// Снимок — здесь, в порядке очереди; входы, очереди и счётчики снимка — при печати
+static void cmdStatus(const int32_t *) {
+  StatusReport r;
+  smGetStatus(r.sm);
+  motorGetStatus(r.motor);
+  telemetryGetStatus(r.telem);
+  g_statusReport.write(r);
+}
+static void cmdClear(const int32_t *)        { smCommandClearError(); }
+static void cmdManUp(const int32_t *)        { smCommandManualUpStart(); }
+static void cmdManDown(const int32_t *)      { smCommandManualDownStart(); }
+static void cmdManStop(const int32_t *)      { smCommandManualStop(); }
+static void cmdStepIsr(const int32_t *)      { motorSetStepMode(STEPGEN_TIMER_ISR); }
+static void cmdStepPoll(const int32_t *)     { motorSetStepMode(STEPGEN_POLLING); }
+static void cmdStepRmt(const int32_t *)      { motorSetStepMode(STEPGEN_RMT); }
+static void cmdStepIoReg(const int32_t *)    { motorSetStepIo(STEPIO_REGISTERS); }
+static void cmdStepIoArduino(const int32_t *) { motorSetStepIo(STEPIO_ARDUINO); }
+static void cmdProfileTrap(const int32_t *)  { motorSetProfile(RAMP_TRAPEZOID); }
+static void cmdProfileS(const int32_t *)     { motorSetProfile(RAMP_SCURVE); }
+static void cmdBench(const int32_t *)        { benchStart(); }
+static void cmdLink(const int32_t *)         { commPrintStats(Serial); }
+static void cmdEncoder(const int32_t *a)     { motorSetEncoder(a[0] != 0); }
+
+// TELEMETRY <hz> — запись и поток кадров; без аргумента (приходит 0) — стоп и итог
+static void cmdTelemetry(const int32_t *a) {
+  if (a[0] == 0) {
+    telemetryStop();
+  } else {
+    telemetryStart((uint16_t)a[0]);
+  }
+}
+
+// FLOORS без аргумента приходит с 0 (допустимые значения начинаются с 2)
+static void cmdFloors(const int32_t *a) {
+  if (a[0] != 0) smCommandSetFloorCount((uint8_t)a[0]);
+  reportFloors();
+}
+
+static void cmdSetAccel(const int32_t *a) {
+  motorSetAccel((float)a[0]);
+  LOG(SERIAL_SET_ACCEL, a[0]);
+}
+
+static void cmdSetMaxSpeed(const int32_t *a) {
+  motorSetSpeedLimit((float)a[0]);
+  LOG(SERIAL_SET_MAXSPEED, a[0]);
+}
+
+static void cmdSetJerk(const int32_t *a) {
+  motorSetJerk((float)a[0]);
+  LOG(SERIAL_SET_JERK, a[0]);
+}
+
+// SET <ключ> <значение>: ключ — по хешу, как и команды; проверка — при разборе
+static CommandExec resolveSet(const SerialArgs &a, int32_t *arg) {
+  char key[16];
+  strncpy(key, a.str[0], sizeof(key) - 1);
+  key[sizeof(key) - 1] = '\0';
+  toUpper(key);
+
+  long v = 0;
+  if (!parseLong(a.str[1], &v)) {
+    reportError(SERR_BAD_NUMBER, "'%s' (usage: SET ACCEL|MAXSPEED|JERK <v>)", a.str[1]);
+    return nullptr;
+  }
+  arg[0] = (int32_t)v;
+
+  switch (nameHash(key)) {
+    case nameHash("ACCEL"):
+      if (v < 10 || v > 100000) break;
+      return cmdSetAccel;
+    case nameHash("MAXSPEED"):
+      if (v < 0 || v > 20000) break;
+      return cmdSetMaxSpeed;
+    case nameHash("JERK"):
+      if (v < 100 || v > 10000000) break;
+      return cmdSetJerk;
+    default:
+      reportError(SERR_UNKNOWN_KEY, "SET %s (keys: ACCEL, MAXSPEED, JERK)", key);
+      return nullptr;
+  }
+  reportError(SERR_OUT_OF_RANGE, "SET %s %s (ACCEL 10..100000, MAXSPEED 0..20000, JERK 100..10000000)",
+              key, a.str[1]);
+  return nullptr;
+}
+
+// ---------------- таблица команд ----------------
+
+#define SERIAL_CMD(name, usage, minA, maxA, mask, lo, hi, fn) \
+  { nameHash(name), name, usage, minA, maxA, mask, lo, hi, fn, nullptr, false }
+#define SERIAL_CMD_KEYED(name, usage, minA, maxA, resolveFn) \
+  { nameHash(name), name, usage, minA, maxA, 0x0, 0, 0, nullptr, resolveFn, false }
+#define SERIAL_CMD_LOCAL(name, fn) \
+  { nameHash(name), name, name, 0, 0, 0x0, 0, 0, fn, nullptr, true }
+
+static constexpr CommandDef COMMANDS[] = {
+  // F<n> / U<n> / D<n> приходят сюда как "F n" (см. splitFloorShorthand)
+  SERIAL_CMD("F",                "F<n>",             1, 1, 0x1, 1, FLOOR_MAX, cmdCarCall),
+  SERIAL_CMD("U",                "U<n>",             1, 1, 0x1, 1, FLOOR_MAX, cmdUpCall),
+  SERIAL_CMD("D",                "D<n>",             1, 1, 0x1, 1, FLOOR_MAX, cmdDownCall),
+  SERIAL_CMD("FLOOR",            "FLOOR <n>",        1, 1, 0x1, 1, FLOOR_MAX, cmdCarCall),
+  SERIAL_CMD("FLOORS",           "FLOORS [n]",       0, 1, 0x1, 2, FLOOR_MAX, cmdFloors),
+  SERIAL_CMD("TEACH",            "TEACH <n>",        1, 1, 0x1, 1, FLOOR_MAX, cmdTeach),
+  SERIAL_CMD("GOTO",             "GOTO <steps>",     1, 1, 0x1, -1000000000L, 1000000000L, cmdGoto),
+  SERIAL_CMD("JOG",              "JOG <steps>",      1, 1, 0x1, -1000000000L, 1000000000L, cmdJog),
+  SERIAL_CMD_KEYED("SET",        "SET <key> <v>",    2, 2, resolveSet),
+  SERIAL_CMD("STOP",             "STOP",             0, 0, 0x0, 0, 0, cmdStop),
+  SERIAL_CMD("ESTOP",            "ESTOP",            0, 0, 0x0, 0, 0, cmdEstop),
+  SERIAL_CMD("CALIB",            "CALIB",            0, 0, 0x0, 0, 0, cmdCalib),
+  SERIAL_CMD("CALIB_DOWN_START", "CALIB_DOWN_START", 0, 0, 0x0, 0, 0, cmdCalibDown),
+  SERIAL_CMD("CALIB_DOWN_SAVE",  "CALIB_DOWN_SAVE",  0, 0, 0x0, 0, 0, cmdCalibSave),
+  SERIAL_CMD("STATUS",           "STATUS",           0, 0, 0x0, 0, 0, cmdStatus),
+  SERIAL_CMD("CLEAR",            "CLEAR",            0, 0, 0x0, 0, 0, cmdClear),
+  SERIAL_CMD("MAN_UP",           "MAN_UP",           0, 0, 0x0, 0, 0, cmdManUp),
+  SERIAL_CMD("MAN_DOWN",         "MAN_DOWN",         0, 0, 0x0, 0, 0, cmdManDown),
+  SERIAL_CMD("MAN_STOP",         "MAN_STOP",         0, 0, 0x0, 0, 0, cmdManStop),
+  SERIAL_CMD("STEP_ISR",         "STEP_ISR",         0, 0, 0x0, 0, 0, cmdStepIsr),
+  SERIAL_CMD("STEP_POLL",        "STEP_POLL",        0, 0, 0x0, 0, 0, cmdStepPoll),
+  SERIAL_CMD("STEP_RMT",         "STEP_RMT",         0, 0, 0x0, 0, 0, cmdStepRmt),
+  SERIAL_CMD("STEP_IO_REG",      "STEP_IO_REG",      0, 0, 0x0, 0, 0, cmdStepIoReg),
+  SERIAL_CMD("STEP_IO_ARDUINO",  "STEP_IO_ARDUINO",  0, 0, 0x0, 0, 0, cmdStepIoArduino),
+  SERIAL_CMD("PROFILE_TRAP",     "PROFILE_TRAP",     0, 0, 0x0, 0, 0, cmdProfileTrap),
+  SERIAL_CMD("PROFILE_S",        "PROFILE_S",        0, 0, 0x0, 0, 0, cmdProfileS),
+  SERIAL_CMD("BENCH",            "BENCH",            0, 0, 0x0, 0, 0, cmdBench),
+  SERIAL_CMD_LOCAL("LINK",       cmdLink),
+  SERIAL_CMD("TELEMETRY",        "TELEMETRY [hz]",   0, 1, 0x1, 1, TELEM_RATE_MAX, cmdTelemetry),
+  SERIAL_CMD("ENCODER",          "ENCODER 0|1",      1, 1, 0x1, 0, 1, cmdEncoder),
+  SERIAL_CMD_LOCAL("HELP",       cmdHelp),
+};
+static constexpr uint8_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+static constexpr bool hashesUnique() {
+  for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+    for (uint8_t j = i + 1; j < COMMAND_COUNT; j++) {
+      if (COMMANDS[i].hash == COMMANDS[j].hash) return false;
+    }
+  }
+  return true;
+}
+static_assert(hashesUnique(), "serial command name hash collision");
+
+static void printCommandList() {
+  for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+    if (i) Serial.print(", ");
+    Serial.print(COMMANDS[i].usage);
+  }
+  Serial.println();
+}
+
+static void cmdHelp(const int32_t *) {
+  Serial.print("[SERIAL] Commands: ");
+  printCommandList();
+}
+
+static const CommandDef *findCommand(const char *name) {
+  uint32_t h = nameHash(name);
+  for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+    if (COMMANDS[i].hash == h && strcmp(COMMANDS[i].name, name) == 0) return &COMMANDS[i];
+  }
+  return nullptr;
+}
+
+// ---------------- разбор строки ----------------
+
+// Режет строку на токены по пробелам (на месте). Возвращает число токенов.
+static uint8_t tokenize(char *line, char **tok, uint8_t maxTok) {
+  uint8_t n = 0;
+  char *p = line;
+  while (*p) {
+    while (*p == ' ' || *p == '\t') *p++ = '\0';
+    if (!*p) break;
+    if (n == maxTok) return maxTok + 1;  // лишние токены
+    tok[n++] = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+  }
+  return n;
+}
+
+// "F12" → команда "F", аргумент "12": короткий вид вызова этажа
+static bool splitFloorShorthand(char *first, char **numOut) {
+  if ((first[0] != 'F' && first[0] != 'U' && first[0] != 'D') || !isDigit(first[1])) return false;
+  for (const char *p = first + 1; *p; p++) {
+    if (!isDigit(*p)) return false;
+  }
+  *numOut = first + 1;
+  return true;
+}
+
+static void handleLine(char *line) {
+  char *tok[SERIAL_MAX_ARGS + 1];
+  uint8_t n = tokenize(line, tok, SERIAL_MAX_ARGS + 1);
+  if (n == 0) return;
+
+  const CommandDef *cmd = nullptr;
+  char *argTok[SERIAL_MAX_ARGS + 1];
+  uint8_t argc = 0;
+
+  toUpper(tok[0]);
+  char *floorNum = nullptr;
+  if (n <= 1 && splitFloorShorthand(tok[0], &floorNum)) {
+    const char shortName[2] = { tok[0][0], '\0' };
+    cmd = findCommand(shortName);
+    argTok[argc++] = floorNum;
   } else {
-    Serial.print("[SERIAL] Unknown command: ");
-    Serial.println(cmd);
+    cmd = findCommand(tok[0]);
+    for (uint8_t i = 1; i < n && i <= SERIAL_MAX_ARGS; i++) argTok[argc++] = tok[i];
+  }
+
+  if (!cmd) {
+    reportError(SERR_UNKNOWN_COMMAND, "'%s' (try HELP)", tok[0]);
+    return;
+  }
+  if (n > SERIAL_MAX_ARGS + 1 || argc < cmd->minArgs || argc > cmd->maxArgs) {
+    reportError(SERR_ARG_COUNT, "usage: %s", cmd->usage);
+    return;
   }
+
+  SerialArgs a;
+  a.count = argc;
+  for (uint8_t i = 0; i < argc; i++) {
+    a.str[i] = argTok[i];
+    a.num[i] = 0;
+    if (!(cmd->numMask & (1u << i))) continue;
+    if (!parseLong(argTok[i], &a.num[i])) {
+      reportError(SERR_BAD_NUMBER, "'%s' (usage: %s)", argTok[i], cmd->usage);
+      return;
+    }
+    if (a.num[i] < cmd->minVal || a.num[i] > cmd->maxVal) {
+      reportError(SERR_OUT_OF_RANGE, "'%s' (usage: %s)", argTok[i], cmd->usage);
+      return;
+    }
+  }
+
+  int32_t arg[SERIAL_MAX_ARGS] = {0};
+  for (uint8_t i = 0; i < argc; i++) arg[i] = (int32_t)a.num[i];
+
+  CommandExec exec = cmd->resolve ? cmd->resolve(a, arg) : cmd->handler;
+  if (!exec) return;
+  if (cmd->local) {
+    exec(arg);
+    g_commandCount++;
+    return;
+  }
+
+  if (!cmdQueuePush(CMD_SRC_SERIAL, exec, arg[0], arg[1], arg[2])) {
+    reportError(SERR_QUEUE_FULL, "%s dropped", cmd->name);
+    return;
+  }
+  g_commandCount++;
+}
+
+// ---------------- печать ответов (задача связи) ----------------
+
+// Отдаёт в UART столько целых строк ответа, сколько влезает в TX FIFO без ожидания
+static void replyDrain() {
+  while (g_replySent < g_replyLen) {
+    size_t end = g_replySent;
+    while (end < g_replyLen && g_reply[end] != '\n') end++;
+    if (end < g_replyLen) end++;  // с переводом строки
+    size_t line = end - g_replySent;
+    size_t need = line < SERIAL_TX_FIFO ? line : SERIAL_TX_FIFO;
+    if ((size_t)Serial.availableForWrite() < need) return;
+    Serial.write((const uint8_t *)g_reply + g_replySent, line);
+    g_replySent = end;
+  }
+  g_replyLen  = 0;
+  g_replySent = 0;
+}
+
+static void formatStatus() {
+  g_statusShown = g_statusReport.version();
+  StatusReport r;
+  g_statusReport.read(r);
+  ReplyPrint out;
+  smPrintStatus(r.sm, out);
+  ioPrintStatus(out);
+  out.printf("[CMDQ] remote %lu (lost %lu, max depth %u), serial %lu (lost %lu, max depth %u)\r\n",
+             (unsigned long)cmdQueueGetPushed(CMD_SRC_REMOTE), (unsigned long)cmdQueueGetOverflow(CMD_SRC_REMOTE),
+             cmdQueueGetHighWater(CMD_SRC_REMOTE),
+             (unsigned long)cmdQueueGetPushed(CMD_SRC_SERIAL), (unsigned long)cmdQueueGetOverflow(CMD_SRC_SERIAL),
+             cmdQueueGetHighWater(CMD_SRC_SERIAL));
+  out.printf("[SNAP] published %lu, reader retries %lu\r\n",
+             (unsigned long)snapshotVersion(), (unsigned long)snapshotRetries());
+  telemetryPrintStatus(r.telem, out);
+  motorPrintEncoderStatus(r.motor, out);
+  motorPrintPlan(r.motor, out);
+}
+
+static void formatFloors() {
+  g_floorShown = g_floorReport.version();
+  FloorTable t;
+  g_floorReport.read(t);
+  ReplyPrint out;
+  floorPrint(t, out);
+}
+
+// ---------------- API ----------------
+
+void serialInit() {
+  g_lineLen      = 0;
+  g_lineOverflow = false;
+  Serial.print("[SERIAL] Ready. Commands: ");
+  printCommandList();
 }
 
 void serialUpdate() {
-  while (Serial.available()) {
+  // Очередь полна — строку не дочитываем: байты подождут в буфере UART
+  while (Serial.available() && cmdQueueFree(CMD_SRC_SERIAL) > 0) {
     char c = (char)Serial.read();
     if (c == '\r') continue;
     if (c == '\n') {
-      if (inputLine.length() > 0) {
-        inputLine.trim();
-        handleCommand(inputLine);
-        inputLine = "";
+      if (g_lineOverflow) {
+        reportError(SERR_LINE_TOO_LONG, "max 95 chars");
+      } else {
+        g_line[g_lineLen] = '\0';
+        handleLine(g_line);
       }
+      g_lineLen      = 0;
+      g_lineOverflow = false;
+    } else if (g_lineLen < SERIAL_LINE_MAX - 1) {
+      g_line[g_lineLen++] = c;
     } else {
-      inputLine += c;
-      if (inputLine.length() > 63) {
-        inputLine = "";
-      }
+      g_lineOverflow = true;  // хвост выбрасываем до конца строки, потом — ошибка
     }
   }
 }
+
+void serialService() {
+  if (g_replyLen == 0) {
+    if (g_statusReport.version() != g_statusShown) {
+      formatStatus();
+    } else if (g_floorReport.version() != g_floorShown) {
+      formatFloors();
+    }
+  }
+  replyDrain();
+}
+
+uint32_t serialGetCommandCount() {
+  return g_commandCount;
+}
+
+uint32_t serialGetErrorCount() {
+  return g_errorCount;
+}
@@ -3,3 +3,10 @@
 
 void serialInit();
 void serialUpdate();
+
+// Задача связи: печать ответов STATUS / FLOORS из снимков, по строке, пока есть место в TX FIFO
+void serialService();
+
+// Счётчики для стенда: принятые команды и строки с ошибкой
+uint32_t serialGetCommandCount();
+uint32_t serialGetErrorCount();
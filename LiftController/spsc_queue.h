@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Кольцевая очередь без блокировок: ровно один писатель и ровно один читатель
+// (например, задача WiFi → loop()). Писатель двигает только head, читатель — только tail,
+// поэтому хватает release/acquire на индексах, CAS не нужен.
+//
+// Полна → push() возвращает false и считает потерю (счётчик переполнений).
+// Индексы 32-битные и идут без сброса; переполнение uint32 безопасно, пока N — степень двойки.
+//
+// Заголовок без Arduino — собирается и в хостовом стресс-тесте (sim/spsc_stress.cpp).
+// ФАЙЛ ОДИНАКОВЫЙ в LiftController/ и remote/ (make -C sim check-shared).
+
+template <typename T, uint16_t N>
+struct SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+  // Только писатель
+  bool push(const T &v) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) {
+      overflow.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buf[h & (N - 1)] = v;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Только читатель: голова очереди без извлечения (nullptr — пусто)
+  const T *peek() const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return nullptr;
+    return &buf[t & (N - 1)];
+  }
+
+  // Только читатель: выбросить голову (после peek() != nullptr)
+  void drop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Только читатель
+  bool pop(T &out) {
+    const T *p = peek();
+    if (!p) return false;
+    out = *p;
+    drop();
+    return true;
+  }
+
+  // Оценки с любой стороны (точны для той стороны, что вызывает)
+  uint16_t size() const {
+    return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+  uint16_t freeSpace() const { return (uint16_t)(N - size()); }
+  uint32_t overflowCount() const { return overflow.load(std::memory_order_relaxed); }
+
+  static constexpr uint16_t capacity() { return N; }
+
+  // ---- состояние ----
+  T                     buf[N];
+  std::atomic<uint32_t> head{0};      // следующая запись (писатель)
+  std::atomic<uint32_t> tail{0};      // следующее чтение (читатель)
+  std::atomic<uint32_t> overflow{0};  // отвергнутые push()
+};
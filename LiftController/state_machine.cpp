@@ -3,26 +3,377 @@
 #include "io_manager.h"
 #include "floor_manager.h"
 #include "calibration_manager.h"
+#include "logger.h"
 
 // Текущее состояние автомата
 static LiftState state = STATE_BOOT;
 static uint8_t currentFloor = 0;
 static uint8_t targetFloor  = 0;
 static long    targetPosition = 0;
-static int     errorCode = 0;
+static int     errorCode = 0;  // 1 — таймаут, 2 — концевик на ходу, 3 — позиция не сошлась, 4 — хоминг прерван,
+                               // 5 — срыв мотора (энкодер), 6 — аварийный стоп на ходу
 
 // Простые константы для логики движения
 static const long POSITION_TOLERANCE          = 10;     // в шагах
-static const unsigned long MOTION_TIMEOUT_MS  = 20000;  // таймаут движения
+// Сторож хода: позиция не менялась MOTION_STALL_MS — поездка встала, ERROR 1 сразу, на любой
+// длине поездки. Самый долгий шаг профиля — первый (c0 при малом ускорении, ~0.3 с), он короче.
+static const unsigned long MOTION_STALL_MS = 500;
+// Срок по плану — страховка (ход есть, а цели нет): ETA + 1/8 плана, но не больше
+// MOTION_TIMEOUT_SLACK_MAX_MS, + запас на усечение формулы, доводку по энкодеру и дрожание тика.
+// В STEP_POLL план не выдерживается (motorEtaIsExact) — там только сторож хода.
+static const unsigned long MOTION_TIMEOUT_SLACK_MAX_MS = 500;
+static const unsigned long MOTION_TIMEOUT_MARGIN_MS    = 300;
 
 static unsigned long motionStartTime = 0;
+static unsigned long motionTimeoutMs = 0;      // от motionStartTime; 0 — без срока
+static long          progressPos     = 0;      // позиция при последнем шаге, замеченном тиком
+static unsigned long progressMs      = 0;
+static bool          positionMove    = false;  // MANUAL_MOVE по GOTO / JOG (сам остановится в цели)
+static bool          stopping        = false;  // STOP на ходу: мотор тормозит, IDLE — когда встанет
+
+// Очередь вызовов (бит n = этаж n) и направление обхода LOOK
+static uint16_t callsCar  = 0;
+static uint16_t callsUp   = 0;
+static uint16_t callsDown = 0;
+static int8_t   travelDir = 0;
+
+// Стоянка на этаже после прибытия, прежде чем ехать к следующему вызову
+static const unsigned long DOOR_DWELL_MS = 2000;
+static bool          dwelling    = false;
+static unsigned long arrivalTime = 0;
+
+// Проверочный хоминг после загрузки калибровки из NVS: быстро подъезжаем под концевик,
+// последние шаги — медленно, сверяем позицию, возвращаемся на этаж
+enum VerifyPhase : uint8_t {
+  VERIFY_APPROACH,
+  VERIFY_SEEK,
+  VERIFY_RETURN
+};
+static const long VERIFY_APPROACH_STEPS       = 300;    // медленный участок до концевика
+static const long VERIFY_TOLERANCE            = 50;     // допустимое расхождение, шагов
+static const unsigned long VERIFY_TIMEOUT_MS  = 90000;
+static bool        verifyPending     = false;
+static bool        verifyTrusted     = false;  // позиция до хоминга известна (чистая остановка)
+static VerifyPhase verifyPhase       = VERIFY_APPROACH;
+static long        verifySeekStart   = 0;
+static uint8_t     verifyReturnFloor = 0;
+
+// ---------------- очередь вызовов (LOOK) ----------------
+
+static inline uint16_t floorBit(uint8_t floor) {
+  return (uint16_t)(1u << floor);
+}
+
+static uint16_t allCalls() {
+  return callsCar | callsUp | callsDown;
+}
+
+static void clearCalls() {
+  callsCar  = 0;
+  callsUp   = 0;
+  callsDown = 0;
+  travelDir = 0;
+  dwelling  = false;
+}
+
+// Ближайшая остановка впереди по направлению dir: вызов из кабины или попутный
+// с площадки; если таких нет — самый дальний встречный (там развернёмся).
+// Этажи ближе minAhead шагов не рассматриваются (уже проехали / не успеть затормозить).
+// 0 — впереди вызовов нет.
+static uint8_t lookNextStop(long pos, int8_t dir, long minAhead) {
+  uint8_t count = floorGetCount();
+  uint16_t along   = callsCar | (dir > 0 ? callsUp : callsDown);
+  uint16_t against = (dir > 0) ? callsDown : callsUp;
+  uint8_t farthest = 0;
+
+  for (uint8_t i = 1; i <= count; i++) {
+    uint8_t f = (dir > 0) ? i : (uint8_t)(count + 1 - i);  // от ближних к дальним
+    long ahead = (floorGetPositionForFloor(f) - pos) * dir;
+    if (ahead < minAhead) continue;
+    if (along & floorBit(f)) return f;
+    if (against & floorBit(f)) farthest = f;
+  }
+  return farthest;
+}
+
+// Снять вызовы, которые обслужены остановкой на этаже floor
+static void serveFloor(uint8_t floor, long pos) {
+  uint16_t b = floorBit(floor);
+  callsCar &= ~b;
+  if (travelDir >= 0) callsUp   &= ~b;
+  if (travelDir <= 0) callsDown &= ~b;
+
+  // Дальше в эту сторону ехать некуда — здесь же разворачиваемся
+  if (travelDir != 0 && lookNextStop(pos, travelDir, POSITION_TOLERANCE + 1) == 0) {
+    callsUp   &= ~b;
+    callsDown &= ~b;
+  }
+}
+
+// Выбор следующей остановки из позиции pos (стоим на этаже)
+static uint8_t dispatchNext(long pos) {
+  if (!allCalls()) {
+    travelDir = 0;
+    return 0;
+  }
+
+  if (travelDir == 0) {
+    // Без направления — к ближайшему вызову
+    long best = -1;
+    for (uint8_t f = 1; f <= floorGetCount(); f++) {
+      if (!(allCalls() & floorBit(f))) continue;
+      long d = floorGetPositionForFloor(f) - pos;
+      if (best < 0 || labs(d) < best) {
+        best = labs(d);
+        travelDir = (d >= 0) ? +1 : -1;
+      }
+    }
+  }
+
+  uint8_t f = lookNextStop(pos, travelDir, POSITION_TOLERANCE + 1);
+  if (f == 0) {
+    travelDir = (int8_t)-travelDir;
+    f = lookNextStop(pos, travelDir, POSITION_TOLERANCE + 1);
+  }
+  if (f == 0) travelDir = 0;
+  return f;
+}
+
+// Пересчитать таймаут после motorMoveTo(): новый план — новый срок
+static void armMotionTimeout() {
+  unsigned long eta   = motorGetEtaMs();
+  unsigned long slack = eta / 8;
+  if (slack > MOTION_TIMEOUT_SLACK_MAX_MS) slack = MOTION_TIMEOUT_SLACK_MAX_MS;
+  motionTimeoutMs = motorEtaIsExact() ? (millis() - motionStartTime) + eta + slack + MOTION_TIMEOUT_MARGIN_MS : 0;
+  progressPos = motorGetCurrentPosition();
+  progressMs  = millis();
+}
+
+// Поездка встала: позиция не менялась MOTION_STALL_MS или вышел срок по плану
+static bool motionTimedOut() {
+  long pos = motorGetCurrentPosition();
+  if (pos != progressPos) {
+    progressPos = pos;
+    progressMs  = millis();
+  } else if (millis() - progressMs > MOTION_STALL_MS) {
+    LOG(SM_MOTION_STALL, millis() - progressMs, pos);
+    return true;
+  }
+  if (motionTimeoutMs && millis() - motionStartTime > motionTimeoutMs) {
+    LOG(SM_MOTION_TIMEOUT, millis() - motionStartTime, motionTimeoutMs);
+    return true;
+  }
+  return false;
+}
+
+static void startMoveToFloor(uint8_t floor) {
+  targetFloor     = floor;
+  targetPosition  = floorGetPositionForFloor(floor);
+  state           = STATE_MOVING;
+  motionStartTime = millis();
+  calibPersist(false);  // до первого шага: запись во flash не должна мешать шагам
+  motorMoveTo(targetPosition);
+  armMotionTimeout();
+
+  LOG(SM_MOVING_TO_FLOOR, floor, targetPosition);
+}
+
+// STOP на ходу: торможение с ускорением профиля, а не обрыв шагов. Состояние остаётся
+// MOVING / MANUAL_MOVE, пока мотор не встанет (stopTick); вызов во время торможения
+// сразу даёт новую поездку — мотор переходит в неё с текущей скорости.
+static void startControlledStop() {
+  motorStop();
+  positionMove    = false;
+  stopping        = true;
+  targetFloor     = 0;
+  targetPosition  = motorGetTargetPosition();
+  motionStartTime = millis();
+  armMotionTimeout();
+}
+
+static void stopTick(bool topSwitch) {
+  if (topSwitch && motorGetSpeed() > 0) {
+    LOG(SM_UNEXPECTED_TOP);
+    motorEmergencyStop();
+    stopping  = false;
+    clearCalls();
+    state     = STATE_ERROR;
+    errorCode = 2;
+    return;
+  }
+  if (motionTimedOut()) {
+    motorEmergencyStop();
+    stopping  = false;
+    clearCalls();
+    state     = STATE_ERROR;
+    errorCode = 1;
+    return;
+  }
+  if (motorIsBusy()) return;
+
+  long pos = motorGetCurrentPosition();
+  stopping     = false;
+  state        = STATE_IDLE;
+  currentFloor = floorGetNearestFloor(pos);
+  calibPersist(true);
+  LOG(SM_STOPPED, pos, currentFloor);
+}
+
+// На ходу: новый попутный вызов ближе текущей цели и дальше тормозного пути —
+// останавливаемся на нём
+static void retargetIfCloserStop() {
+  long pos = motorGetCurrentPosition();
+  long minAhead = motorGetStoppingDistance() + POSITION_TOLERANCE + 1;
+  uint8_t f = lookNextStop(pos, travelDir, minAhead);
+  if (f == 0 || f == targetFloor) return;
+
+  long newAhead = (floorGetPositionForFloor(f) - pos) * travelDir;
+  long curAhead = (targetPosition - pos) * travelDir;
+  if (newAhead >= curAhead) return;
+
+  LOG(SM_INTERMEDIATE_STOP, f);
+  targetFloor    = f;
+  targetPosition = floorGetPositionForFloor(f);
+  motorMoveTo(targetPosition);
+  armMotionTimeout();
+}
+
+// Позиция в момент фронта верхнего концевика. smTick() видит его позже — на антидребезг
+// и фазу тика, — а кабина за это время проезжает ещё несколько шагов. io_manager метит
+// фронт позицией на первом отсчёте нового уровня: он не позже 1 мс после прохода, так что
+// до ~1000 шаг/с лишнего шага в метке нет, и точка концевика от прохода к проходу одна.
+static long positionAtTopEdge() {
+  uint32_t ageUs    = micros() - ioSwitchChangedUs(IO_SW_TOP);
+  uint32_t movingUs = (millis() - motionStartTime) * 1000UL;
+  if (ageUs <= movingUs) return ioSwitchChangedPos(IO_SW_TOP);
+
+  // Концевик был нажат ещё до старта — фронт там, откуда поехали
+  int64_t passed = (int64_t)motorGetSpeed() * movingUs;  // шаги * 1e6
+  passed += (passed < 0) ? -500000 : 500000;          // до ближайшего шага
+  return motorGetCurrentPosition() - (long)(passed / 1000000);
+}
+
+// ---------------- проверочный хоминг ----------------
+
+static void startVerify() {
+  long sw  = calibGetTopSwitchPosition();
+  long pos = motorGetCurrentPosition();
+
+  state           = STATE_VERIFY_HOMING;
+  motionStartTime = millis();
+  calibPersist(false);
+  verifyReturnFloor = verifyTrusted ? floorGetNearestFloor(pos) : floorGetCount();
+
+  if (verifyTrusted && pos < sw - VERIFY_APPROACH_STEPS) {
+    verifyPhase = VERIFY_APPROACH;
+    motorMoveTo(sw - VERIFY_APPROACH_STEPS);
+  } else {
+    verifyPhase     = VERIFY_SEEK;
+    verifySeekStart = pos;
+    motorManualUp();
+  }
+  if (verifyTrusted) {
+    LOG(SM_VERIFY_START);
+  } else {
+    LOG(SM_HOMING_START);
+  }
+}
+
+static void verifyFail(int code) {
+  motorEmergencyStop();
+  clearCalls();
+  state     = STATE_ERROR;  // verifyPending остаётся: после CLEAR хоминг повторится
+  errorCode = code;
+}
+
+static void verifyTick(bool topSwitch) {
+  long sw  = calibGetTopSwitchPosition();
+  long pos = motorGetCurrentPosition();
+
+  if (millis() - motionStartTime > VERIFY_TIMEOUT_MS) {
+    LOG(SM_VERIFY_TIMEOUT);
+    verifyFail(1);
+    return;
+  }
+
+  if (verifyPhase == VERIFY_RETURN) {
+    if (!motorIsBusy() && labs(targetPosition - pos) <= POSITION_TOLERANCE) {
+      currentFloor  = verifyReturnFloor;
+      targetFloor   = 0;
+      verifyPending = false;
+      state         = STATE_IDLE;
+      calibPersist(true);
+      LOG(SM_VERIFY_DONE, currentFloor);
+    }
+    return;
+  }
+
+  if (topSwitch) {
+    long edge = positionAtTopEdge();
+    motorEmergencyStop();
+    long drift = edge - sw;
+    LOG(SM_VERIFY_TOP, edge, sw);
+
+    if (verifyTrusted && labs(drift) > VERIFY_TOLERANCE) {
+      // Ход или этажи уже не те — старой калибровке верить нельзя
+      LOG(SM_VERIFY_DRIFT, drift);
+      calibForceReset();
+      verifyFail(3);
+      return;
+    }
+
+    // Доверенную позицию не трогаем: счёт шагов точнее, чем момент срабатывания
+    // концевика (он зависит от скорости подхода). Неизвестную — берём от концевика.
+    if (!verifyTrusted) motorSetCurrentPosition(sw + (pos - edge));
+    verifyPhase    = VERIFY_RETURN;
+    targetPosition = floorGetPositionForFloor(verifyReturnFloor);
+    motorMoveTo(targetPosition);
+    return;
+  }
+
+  if (verifyPhase == VERIFY_APPROACH) {
+    if (!motorIsBusy()) {
+      verifyPhase     = VERIFY_SEEK;
+      verifySeekStart = pos;
+      motorManualUp();
+    }
+    return;
+  }
+
+  // VERIFY_SEEK: концевик должен найтись не дальше ожидаемого места (+ допуск),
+  // а при неизвестной позиции — не дальше всего хода от старта поиска
+  long limit = verifyTrusted ? (sw + VERIFY_TOLERANCE - verifySeekStart)
+                             : (sw + VERIFY_TOLERANCE);
+  if (pos - verifySeekStart > limit) {
+    LOG(SM_VERIFY_NO_SWITCH);
+    verifyFail(3);
+  }
+}
 
 void smInit() {
+  state         = STATE_BOOT;
+  currentFloor  = 0;
+  targetFloor   = 0;
+  errorCode     = 0;
+  verifyPending = false;
+  clearCalls();
+
+  // Скорость по потенциометру — только когда ручку повернули (io_manager: фильтр + гистерезис)
+  ioOnPotChange(motorUpdateSpeedFromPot);
+  ioSetPositionSource(motorPeekPosition);
+
   // Выбираем начальное состояние в зависимости от калибровки
   if (calibHasValidData()) {
-    state = STATE_IDLE;
-    currentFloor = floorGetNearestFloor(motorGetCurrentPosition());
-    Serial.println("[SM] Calibration OK, starting in IDLE");
+    // Калибровка из NVS: сразу в работу, позицию сверим хомингом, как только нет вызовов
+    verifyPending = true;
+    verifyTrusted = calibBootPositionTrusted();
+    if (verifyTrusted) {
+      state = STATE_IDLE;
+      currentFloor = floorGetNearestFloor(motorGetCurrentPosition());
+      Serial.println("[SM] Calibration OK, starting in IDLE");
+    } else {
+      startVerify();
+    }
   } else {
     state = STATE_NEED_CALIB;
     Serial.println("[SM] No calibration, NEED_CALIB");
@@ -30,13 +381,29 @@ void smInit() {
 }
 
 void smTick() {
-  // Обновляем скорость по потенциометру
-  int potRaw = ioReadPotSpeed();
-  motorUpdateSpeedFromPot(potRaw);
+  // Срыв по энкодеру: мотор уже стоит, позиция взята с энкодера. Что было с кабиной,
+  // неизвестно — после CLEAR сверим позицию проверочным хомингом.
+  if (motorTakeStall()) {
+    LOG(SM_MOTOR_STALL);
+    clearCalls();
+    positionMove  = false;
+    stopping      = false;
+    targetFloor   = 0;
+    verifyPending = calibHasValidData();
+    verifyTrusted = true;
+    state         = STATE_ERROR;
+    errorCode     = 5;
+    return;
+  }
 
-  // Верхний концевик — базовая реакция
+  // Верхний концевик (снимок io_manager, после антидребезга) — базовая реакция
   bool topSwitch = ioReadTopSwitch();
 
+  if (stopping) {
+    stopTick(topSwitch);
+    return;
+  }
+
   switch (state) {
     case STATE_BOOT:
       // сюда не должны попадать после smInit, но на всякий случай
@@ -48,8 +415,8 @@ void smTick() {
 
     case STATE_CALIB_HOMING_UP:
       if (topSwitch) {
-        Serial.println("[SM] CALIB: reached top switch");
-        calibOnTopReached();  // сообщаем модулю калибровки
+        LOG(SM_CALIB_TOP);
+        calibOnTopReached(motorGetCurrentPosition() - positionAtTopEdge());  // сообщаем модулю калибровки
         state = STATE_CALIB_MOVING_DOWN;
       }
       break;
@@ -59,7 +426,23 @@ void smTick() {
       break;
 
     case STATE_IDLE:
-      // Можно следить за кнопками STOP/Calib и т.п. через io_manager
+      if (dwelling && millis() - arrivalTime >= DOOR_DWELL_MS) {
+        dwelling = false;
+      }
+      if (!dwelling && verifyPending && !allCalls()) {
+        startVerify();
+        break;
+      }
+      if (!dwelling && allCalls()) {
+        long pos = motorGetCurrentPosition();
+        uint8_t next = dispatchNext(pos);
+        if (next) {
+          startMoveToFloor(next);
+        } else {
+          // Остались только вызовы на текущем этаже
+          serveFloor(currentFloor, pos);
+        }
+      }
       break;
 
     case STATE_MOVING: {
@@ -67,28 +450,32 @@ void smTick() {
       long diff       = targetPosition - currentPos;
       long distAbs    = labs(diff);
 
-      // Проверка окончания движения (упрощённо)
-      if (distAbs <= POSITION_TOLERANCE) {
-        motorStop();
+      // Профиль сам приводит в цель и останавливается — ждём последний шаг
+      if (distAbs <= POSITION_TOLERANCE && !motorIsBusy()) {
         currentFloor = targetFloor;
         targetFloor  = 0;
-        state = STATE_IDLE;
-        Serial.print("[SM] Reached target floor: ");
-        Serial.println(currentFloor);
+        serveFloor(currentFloor, currentPos);
+        state       = STATE_IDLE;
+        dwelling    = true;
+        arrivalTime = millis();
+        calibPersist(true);
+        LOG(SM_REACHED_FLOOR, currentFloor);
+        break;
       }
 
-      // Таймаут
-      if (millis() - motionStartTime > MOTION_TIMEOUT_MS) {
-        Serial.println("[SM] Motion timeout! ERROR");
-        motorStop();
+      // Ход встал или вышел срок по плану поездки (armMotionTimeout)
+      if (motionTimedOut()) {
+        motorEmergencyStop();
+        clearCalls();
         state = STATE_ERROR;
         errorCode = 1;
       }
 
       // Неожиданный верхний концевик при движении вверх
       if (topSwitch && diff > 0) {  // ехали вверх
-        Serial.println("[SM] Unexpected top switch! ERROR");
-        motorStop();
+        LOG(SM_UNEXPECTED_TOP);
+        motorEmergencyStop();
+        clearCalls();
         state = STATE_ERROR;
         errorCode = 2;
       }
@@ -96,136 +483,268 @@ void smTick() {
     }
 
     case STATE_MANUAL_MOVE:
-      // Логика ручного движения реализуется через команды MANUAL_* и мотор
+      // Логика ручного движения реализуется через команды MANUAL_* и мотор;
+      // GOTO / JOG заканчиваются сами, когда мотор встал
+      if (positionMove && !motorIsBusy()) {
+        positionMove = false;
+        state        = STATE_IDLE;
+        currentFloor = floorGetNearestFloor(motorGetCurrentPosition());
+        calibPersist(true);
+        LOG(SM_POSITION_REACHED, motorGetCurrentPosition());
+      }
       break;
 
     case STATE_ERROR:
       // Ждём smCommandClearError() или smForceNeedCalib()
       break;
+
+    case STATE_VERIFY_HOMING:
+      verifyTick(topSwitch);
+      break;
   }
 }
 
 // ---------------- команды извне ----------------
 
 void smCommandMoveToFloor(uint8_t floor) {
+  smCommandCall(floor, CALL_CAR);
+}
+
+void smCommandCall(uint8_t floor, CallType type) {
   if (state == STATE_NEED_CALIB || state == STATE_CALIB_HOMING_UP || state == STATE_CALIB_MOVING_DOWN) {
-    Serial.println("[SM] Move command ignored: NEED_CALIB/CALIB");
+    LOG(SM_MOVE_IGNORED_CALIB);
     return;
   }
   if (state == STATE_ERROR) {
-    Serial.println("[SM] Move command ignored: ERROR state");
+    LOG(SM_MOVE_IGNORED_ERROR);
     return;
   }
-  if (floor < 1 || floor > 3) {
-    Serial.println("[SM] Invalid floor");
+  if (floor < 1 || floor > floorGetCount()) {
+    LOG(SM_INVALID_FLOOR);
     return;
   }
-  if (state != STATE_IDLE && state != STATE_MOVING) {
-    Serial.println("[SM] Move command ignored: not in IDLE/MOVING");
+  if (state != STATE_IDLE && state != STATE_MOVING && state != STATE_VERIFY_HOMING && !stopping) {
+    LOG(SM_MOVE_IGNORED_STATE);
     return;
   }
 
   long currentPos = motorGetCurrentPosition();
   long dest       = floorGetPositionForFloor(floor);
 
-  if (labs(dest - currentPos) <= POSITION_TOLERANCE) {
-    Serial.print("[SM] Already at floor ");
-    Serial.println(floor);
+  if (state == STATE_IDLE && labs(dest - currentPos) <= POSITION_TOLERANCE) {
+    LOG(SM_ALREADY_AT_FLOOR, floor);
     currentFloor = floor;
-    targetFloor  = 0;
-    state = STATE_IDLE;
     return;
   }
 
-  targetFloor     = floor;
-  targetPosition  = dest;
-  state           = STATE_MOVING;
-  motionStartTime = millis();
-  motorMoveTo(targetPosition);
+  uint16_t b = floorBit(floor);
+  switch (type) {
+    case CALL_UP:   callsUp   |= b; break;
+    case CALL_DOWN: callsDown |= b; break;
+    default:        callsCar  |= b; break;
+  }
 
-  Serial.print("[SM] Moving to floor ");
-  Serial.print(floor);
-  Serial.print(" (target pos ");
-  Serial.print(targetPosition);
-  Serial.println(")");
+  if (type == CALL_UP) {
+    LOG(SM_CALL_FLOOR_UP, floor);
+  } else if (type == CALL_DOWN) {
+    LOG(SM_CALL_FLOOR_DOWN, floor);
+  } else {
+    LOG(SM_CALL_FLOOR, floor);
+  }
+
+  // В IDLE поездку начнёт smTick() (после стоянки), во время хоминга — после него;
+  // при торможении по STOP — сразу, без остановки; на ходу — может, остановимся по пути
+  if (stopping) {
+    uint8_t next = dispatchNext(currentPos);
+    if (next) {
+      stopping = false;
+      startMoveToFloor(next);
+    }
+  } else if (state == STATE_MOVING) {
+    retargetIfCloserStop();
+  }
 }
 
 void smCommandStop() {
-  motorStop();
-  if (state == STATE_MOVING || state == STATE_MANUAL_MOVE) {
-    Serial.println("[SM] STOP: motor stopped, go to IDLE");
-    state = STATE_IDLE;
-    targetFloor = 0;
+  clearCalls();
+  if (state == STATE_VERIFY_HOMING) {
+    // Позиция не сверена — в работу не пускаем; CLEAR повторит хоминг
+    motorEmergencyStop();
+    LOG(SM_STOP_VERIFY);
+    state     = STATE_ERROR;
+    errorCode = 4;
+  } else if (state == STATE_MOVING || state == STATE_MANUAL_MOVE) {
+    startControlledStop();
+    LOG(SM_STOP_MOVING, targetPosition);
+  } else {
+    motorStop();
+    LOG(SM_STOP_IDLE);
+  }
+}
+
+// ESTOP: шаги обрываются на любой скорости — на ходу вал мог проскочить, счёт шагов больше
+// не верен. Как при срыве: ERROR, после CLEAR — проверочный хоминг. Калибровка прервана —
+// её точки не записаны, после CLEAR NEED_CALIB (или хоминг по прежней калибровке).
+void smCommandEmergencyStop() {
+  motorEmergencyStop();
+  clearCalls();
+  stopping = false;
+  if (state == STATE_VERIFY_HOMING) {
+    LOG(SM_STOP_VERIFY);
+    state     = STATE_ERROR;
+    errorCode = 4;
+  } else if (state == STATE_MOVING || state == STATE_MANUAL_MOVE) {
+    LOG(SM_EMERGENCY_STOP, motorGetCurrentPosition());
+    positionMove  = false;
+    targetFloor   = 0;
+    verifyPending = calibHasValidData();
+    verifyTrusted = true;
+    calibPersist(false);  // позиция не сверена — после перезагрузки тоже хоминг
+    state         = STATE_ERROR;
+    errorCode     = 6;
+  } else if (state == STATE_CALIB_HOMING_UP || state == STATE_CALIB_MOVING_DOWN) {
+    LOG(SM_ESTOP_CALIB);
+    verifyPending = calibHasValidData();
+    verifyTrusted = false;  // после верхнего концевика счёт уже от него, а не от этажей
+    state         = STATE_ERROR;
+    errorCode     = 4;
   } else {
-    Serial.println("[SM] STOP: no movement");
+    LOG(SM_STOP_IDLE);
   }
 }
 
 void smCommandStartCalib() {
-  if (state == STATE_MOVING || state == STATE_MANUAL_MOVE) {
-    Serial.println("[SM] Cannot start calib while moving");
+  if (state == STATE_MOVING || state == STATE_MANUAL_MOVE || state == STATE_VERIFY_HOMING) {
+    LOG(SM_CALIB_WHILE_MOVING);
     return;
   }
-  Serial.println("[SM] Start calibration: homing up");
-  state = STATE_CALIB_HOMING_UP;
+  LOG(SM_CALIB_START);
+  clearCalls();
+  verifyPending = false;
+  calibPersist(false);
+  state           = STATE_CALIB_HOMING_UP;
+  motionStartTime = millis();
   calibStartHomingUp();
 }
 
 void smCommandCalibDownStart() {
   if (state != STATE_CALIB_MOVING_DOWN) {
-    Serial.println("[SM] CALIB_DOWN_START ignored: not in CALIB_MOVING_DOWN");
+    LOG(SM_CALIB_DOWN_IGNORED);
     return;
   }
-  Serial.println("[SM] Start moving down for calibration");
+  LOG(SM_CALIB_DOWN_START);
   calibStartMovingDown();
 }
 
 void smCommandCalibDownSave() {
   if (state != STATE_CALIB_MOVING_DOWN) {
-    Serial.println("[SM] CALIB_DOWN_SAVE ignored: not in CALIB_MOVING_DOWN");
+    LOG(SM_CALIB_SAVE_IGNORED);
     return;
   }
-  Serial.println("[SM] Save bottom position");
-  calibSaveBottom();
-  currentFloor = 1;
-  targetFloor  = 0;
-  state        = STATE_IDLE;
+  LOG(SM_CALIB_SAVE);
+  calibSaveBottom();  // пишет и NVS
+  currentFloor  = 1;
+  targetFloor   = 0;
+  verifyPending = false;
+  state         = STATE_IDLE;
+}
+
+// Настройка этажей меняет позиции, по которым идёт очередь, — только на стоящей кабине
+static bool floorSetupAllowed() {
+  return state == STATE_IDLE && !motorIsBusy();
+}
+
+void smCommandSetFloorCount(uint8_t count) {
+  if (!floorSetupAllowed()) {
+    LOG(SM_FLOORS_IGNORED);
+    return;
+  }
+  if (floorSetCount(count)) {
+    clearCalls();
+    currentFloor = floorGetNearestFloor(motorGetCurrentPosition());
+    calibPersist(true);
+  }
+}
+
+void smCommandTeachFloor(uint8_t floor) {
+  if (!floorSetupAllowed()) {
+    LOG(SM_TEACH_IGNORED);
+    return;
+  }
+  long pos = motorGetCurrentPosition();
+  if (floorTeach(floor, pos)) {
+    clearCalls();
+    currentFloor = floor;
+    calibPersist(true);
+  }
+}
+
+void smCommandMoveToPosition(long position) {
+  if (state != STATE_IDLE || motorIsBusy()) {
+    LOG(SM_POSITION_IGNORED);
+    return;
+  }
+  long full = floorGetFullTravelSteps();
+  if (position < 0 || position > full) {
+    LOG(SM_POSITION_RANGE, position, full);
+    return;
+  }
+  LOG(SM_POSITION_MOVE, position);
+  clearCalls();
+  dwelling     = false;
+  positionMove = true;
+  state        = STATE_MANUAL_MOVE;
+  calibPersist(false);
+  motorMoveTo(position);
+}
+
+void smCommandJog(long steps) {
+  smCommandMoveToPosition(motorGetCurrentPosition() + steps);
 }
 
 void smCommandManualUpStart() {
-  if (state == STATE_ERROR || state == STATE_CALIB_HOMING_UP || state == STATE_CALIB_MOVING_DOWN) {
-    Serial.println("[SM] MAN_UP ignored in current state");
+  if (state == STATE_ERROR || state == STATE_CALIB_HOMING_UP || state == STATE_CALIB_MOVING_DOWN ||
+      state == STATE_VERIFY_HOMING) {
+    LOG(SM_MAN_UP_IGNORED);
     return;
   }
-  Serial.println("[SM] Manual move UP");
+  LOG(SM_MANUAL_UP);
+  clearCalls();
+  positionMove = false;
+  stopping     = false;
   state = STATE_MANUAL_MOVE;
+  calibPersist(false);
   motorManualUp();
 }
 
 void smCommandManualDownStart() {
-  if (state == STATE_ERROR || state == STATE_CALIB_HOMING_UP || state == STATE_CALIB_MOVING_DOWN) {
-    Serial.println("[SM] MAN_DOWN ignored in current state");
+  if (state == STATE_ERROR || state == STATE_CALIB_HOMING_UP || state == STATE_CALIB_MOVING_DOWN ||
+      state == STATE_VERIFY_HOMING) {
+    LOG(SM_MAN_DOWN_IGNORED);
     return;
   }
-  Serial.println("[SM] Manual move DOWN");
+  LOG(SM_MANUAL_DOWN);
+  clearCalls();
+  positionMove = false;
+  stopping     = false;
   state = STATE_MANUAL_MOVE;
+  calibPersist(false);
   motorManualDown();
 }
 
 void smCommandManualStop() {
   if (state == STATE_MANUAL_MOVE) {
-    Serial.println("[SM] Manual move STOP");
-    motorStop();
-    state = STATE_IDLE;
+    LOG(SM_MANUAL_STOP);
+    startControlledStop();
   }
 }
 
 void smCommandClearError() {
   if (state != STATE_ERROR) {
-    Serial.println("[SM] CLEAR: not in ERROR");
+    LOG(SM_CLEAR_IGNORED);
     return;
   }
-  Serial.println("[SM] CLEAR: error cleared");
+  LOG(SM_CLEAR);
   errorCode = 0;
 
   if (calibHasValidData()) {
@@ -238,30 +757,64 @@ void smCommandClearError() {
 // ---------------- getters / статус ----------------
 
 LiftState smGetState() { return state; }
+uint8_t smGetErrorCode() { return (uint8_t)errorCode; }
 
 uint8_t smGetCurrentFloor() { return currentFloor; }
 uint8_t smGetTargetFloor()  { return targetFloor; }
 
+uint16_t smGetPendingCalls() { return allCalls(); }
+int8_t   smGetTravelDir()    { return travelDir; }
+bool     smIsDwelling()      { return dwelling; }
+bool     smIsVerifyPending() { return verifyPending; }
+
 long smGetCurrentPosition() { return motorGetCurrentPosition(); }
 
-void smPrintStatus(Stream &out) {
+void smGetStatus(SmStatus &out) {
+  out.position     = (int32_t)motorGetCurrentPosition();
+  out.calls        = allCalls();
+  out.callsUp      = callsUp;
+  out.callsDown    = callsDown;
+  out.state        = (uint8_t)state;
+  out.currentFloor = currentFloor;
+  out.targetFloor  = targetFloor;
+  out.errorCode    = (uint8_t)errorCode;
+  out.floorCount   = floorGetCount();
+}
+
+void smPrintStatus(const SmStatus &s, Print &out) {
   out.print("STATE=");
-  out.print((int)state);
+  out.print((int)s.state);
   out.print(" FLOOR=");
-  out.print(currentFloor);
+  out.print(s.currentFloor);
   out.print(" TARGET_FLOOR=");
-  out.print(targetFloor);
+  out.print(s.targetFloor);
+  out.print(" CALLS=");
+  bool any = false;
+  for (uint8_t f = 1; f <= s.floorCount; f++) {
+    if (!(s.calls & floorBit(f))) continue;
+    if (any) out.print(',');
+    out.print(f);
+    if (s.callsUp & floorBit(f))   out.print('^');
+    if (s.callsDown & floorBit(f)) out.print('v');
+    any = true;
+  }
+  if (!any) out.print('-');
   out.print(" POS=");
-  out.print(motorGetCurrentPosition());
+  out.print((long)s.position);
   out.print(" ERROR=");
-  out.print(errorCode);
+  out.print(s.errorCode);
   out.println();
 }
 
 // Принудительный переход в режим NEED_CALIB (для кнопки на базе)
 void smForceNeedCalib() {
-  Serial.println("[SM] Force NEED_CALIB");
+  LOG(SM_FORCE_NEED_CALIB);
+  if (state == STATE_VERIFY_HOMING) motorEmergencyStop();
+  verifyPending = false;
+  positionMove  = false;
+  stopping      = false;
   state     = STATE_NEED_CALIB;
   errorCode = 0;
   targetFloor = 0;
+  clearCalls();
 }
@@ -1,31 +1,40 @@
 #pragma once
 #include <Arduino.h>
+#include "lift_protocol.h"
 
-// Состояния лифта
-enum LiftState : uint8_t {
-    STATE_BOOT,
-    STATE_NEED_CALIB,
-    STATE_CALIB_HOMING_UP,
-    STATE_CALIB_MOVING_DOWN,
-    STATE_IDLE,
-    STATE_MOVING,
-    STATE_MANUAL_MOVE,
-    STATE_ERROR
-};
+// Состояния лифта (LiftState) — в lift_protocol.h: они же уходят пульту в статусе
 
 // Инициализация и тик автомата
 void smInit();
 void smTick();
 
+// Вызовы этажей. Очередь обслуживается по LOOK: едем в одну сторону, останавливаясь
+// на вызванных этажах, и разворачиваемся, только когда впереди вызовов нет.
+enum CallType : uint8_t {
+    CALL_CAR,   // из кабины / с пульта: «на этаж N»
+    CALL_UP,    // с площадки: «вверх»
+    CALL_DOWN   // с площадки: «вниз»
+};
+
 // Команды управления лифтом
-void smCommandMoveToFloor(uint8_t floor);  // перейти на этаж 1–3
-void smCommandStop();                      // экстренный стоп
+void smCommandMoveToFloor(uint8_t floor);  // вызов на этаж 1..floorGetCount() (CALL_CAR)
+void smCommandCall(uint8_t floor, CallType type);
+void smCommandStop();                      // стоп с торможением (сбрасывает все вызовы)
+void smCommandEmergencyStop();             // аварийный стоп: шаги сразу, без торможения
 
 // Калибровка
 void smCommandStartCalib();        // начать калибровку (поездка вверх к концевику)
 void smCommandCalibDownStart();    // в калибровке: начать движение вниз вручную
 void smCommandCalibDownSave();     // в калибровке: сохранить нижнюю точку
 
+// Настройка этажей (только в IDLE)
+void smCommandSetFloorCount(uint8_t count);  // равномерная раскладка по ходу
+void smCommandTeachFloor(uint8_t floor);     // текущая позиция кабины = этаж floor
+
+// Сервисное перемещение (только в IDLE, в пределах хода): состояние MANUAL_MOVE до остановки
+void smCommandMoveToPosition(long position);  // абсолютная позиция, шаги
+void smCommandJog(long steps);                // относительно текущей позиции
+
 // Ручной режим
 void smCommandManualUpStart();
 void smCommandManualDownStart();
@@ -34,11 +43,29 @@ void smCommandManualStop();
 // Работа с ошибками / статусом
 void smCommandClearError();
 LiftState smGetState();
-void smPrintStatus(Stream &out);
+uint8_t smGetErrorCode();  // 0 — нет; коды — у errorCode в state_machine.cpp
+// STATUS: снимает задача движения (в порядке очереди команд), печатает задача связи
+struct SmStatus {
+  int32_t  position;
+  uint16_t calls;      // бит n — этаж n (все вызовы)
+  uint16_t callsUp;
+  uint16_t callsDown;
+  uint8_t  state;
+  uint8_t  currentFloor;
+  uint8_t  targetFloor;
+  uint8_t  errorCode;
+  uint8_t  floorCount;
+};
+void smGetStatus(SmStatus &out);
+void smPrintStatus(const SmStatus &s, Print &out);
 
 // Дополнительно: доступ к текущему положению/этажам (если нужно)
 uint8_t smGetCurrentFloor();
 uint8_t smGetTargetFloor();
+uint16_t smGetPendingCalls();  // все ожидающие вызовы, бит n = этаж n
+int8_t  smGetTravelDir();      // направление обхода: +1 вверх, -1 вниз, 0 — вызовов нет
+bool    smIsDwelling();        // стоим на этаже после прибытия (посадка)
+bool    smIsVerifyPending();   // позиция из NVS ещё не сверена с концевиком
 long    smGetCurrentPosition();
 
 // Специально для кнопки на базе: принудительно перевести лифт в режим NEED_CALIB
@@ -0,0 +1,263 @@
+#include "step_bench.h"
+#include "motor_controller.h"
+#include "state_machine.h"
+#include "floor_manager.h"
+#include "step_io.h"
+#include "logger.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_cpu.h>
+#endif
+
+struct BenchCase {
+  float maxSpeed;  // шагов/сек
+  float accel;     // шагов/сек^2
+};
+
+// Прогоны: от спокойного до заведомо выше штатного профиля
+static const BenchCase BENCH_CASES[] = {
+  {  800.0f, 1000.0f },
+  { 1500.0f, 1800.0f },
+  { 2000.0f, 1800.0f },
+  { 2500.0f, 3000.0f },
+  { 3000.0f, 5000.0f },
+};
+static const int BENCH_CASE_COUNT = sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]);
+
+// Сколько импульсов пишем за прогон (столько же шагов длина поездки, не больше)
+static const uint32_t BENCH_MAX_PULSES = 3000;
+// Окно усреднения скорости для кривой «заданная / реальная»
+static const uint32_t BENCH_WINDOW_US  = 100000;
+// В симуляторе «такты» = мкс виртуального времени * эту частоту
+static const uint32_t BENCH_HOST_MHZ   = 240;
+
+enum BenchPhase : uint8_t {
+  BENCH_OFF,
+  BENCH_RUN,
+  BENCH_HOME
+};
+
+static uint32_t g_stamp[BENCH_MAX_PULSES];    // такты CPU в момент шага
+static uint32_t g_cmdUs[BENCH_MAX_PULSES];    // заданная профилем задержка перед шагом
+static volatile uint32_t g_count     = 0;
+static volatile bool     g_capturing = false;
+// Такты на колбэк шага (от benchOnStep() до benchOnStepDone())
+static uint32_t          g_cbStart   = 0;
+static uint64_t          g_cbSum     = 0;
+static uint32_t          g_cbMax     = 0;
+static uint32_t          g_cbCount   = 0;
+
+static BenchPhase    g_phase      = BENCH_OFF;
+static int           g_case       = 0;
+static long          g_homePos    = 0;
+static float         g_savedAccel = 0.0f;
+static float         g_savedSpeed = 0.0f;
+static uint32_t      g_loops      = 0;
+static unsigned long g_caseStartMs = 0;
+
+// ----------------------------------------------------------
+
+static inline uint32_t IRAM_ATTR benchNow() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return (uint32_t)esp_cpu_get_cycle_count();
+#else
+  return (uint32_t)micros() * BENCH_HOST_MHZ;
+#endif
+}
+
+static uint32_t benchCpuMhz() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return getCpuFrequencyMhz();
+#else
+  return BENCH_HOST_MHZ;
+#endif
+}
+
+void IRAM_ATTR benchOnStep(uint32_t commandedUs) {
+  if (!g_capturing) return;
+  uint32_t now = benchNow();
+  g_cbStart = now;
+  uint32_t i = g_count;
+  if (i >= BENCH_MAX_PULSES) return;
+  g_stamp[i] = now;
+  g_cmdUs[i] = commandedUs;
+  g_count = i + 1;
+}
+
+void IRAM_ATTR benchOnStepDone() {
+  if (!g_capturing) return;
+  uint32_t c = benchNow() - g_cbStart;
+  g_cbSum += c;
+  if (c > g_cbMax) g_cbMax = c;
+  g_cbCount++;
+}
+
+void benchLoopTick() {
+  if (g_capturing) g_loops++;
+}
+
+bool benchIsRunning() {
+  return g_phase != BENCH_OFF;
+}
+
+// ----------------------------------------------------------
+
+static int cmpU32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void printPercentile(const char *name, const uint32_t *sorted, uint32_t n, uint32_t permille) {
+  uint32_t idx = (uint32_t)(((uint64_t)(n - 1) * permille) / 1000);
+  Serial.print(name);
+  Serial.print(sorted[idx]);
+}
+
+static void benchReport() {
+  const BenchCase &c = BENCH_CASES[g_case];
+  uint32_t n   = g_count;
+  uint32_t mhz = benchCpuMhz();
+  unsigned long durMs = millis() - g_caseStartMs;
+
+  Serial.print("[BENCH] case "); Serial.print(g_case + 1);
+  Serial.print(" maxSpeed="); Serial.print((long)c.maxSpeed);
+  Serial.print(" accel="); Serial.print((long)c.accel);
+  StepGenMode mode = stepGenGetMode();
+  Serial.print(" mode=");
+  Serial.print(mode == STEPGEN_TIMER_ISR ? "ISR" : mode == STEPGEN_RMT ? "RMT" : "POLL");
+  Serial.print(" pulses="); Serial.println(n);
+  if (n < 3) return;
+
+  // --- Кривая скорости по окнам и самый длинный разрыв ---
+  uint64_t windowCycles = (uint64_t)BENCH_WINDOW_US * mhz;
+  uint32_t winSteps = 0;
+  float    winCmdSum = 0.0f;
+  uint32_t winIndex = 0;
+  uint32_t gapNs = 0, gapCmdUs = 0, gapStep = 0;
+
+  for (uint32_t i = 1; i < n; i++) {
+    uint32_t dtNs = (uint32_t)(((uint64_t)(g_stamp[i] - g_stamp[i - 1]) * 1000) / mhz);
+    if (dtNs > gapNs) {
+      gapNs = dtNs;
+      gapCmdUs = g_cmdUs[i];
+      gapStep = i;
+    }
+
+    uint32_t w = (uint32_t)((uint64_t)(g_stamp[i] - g_stamp[0]) / windowCycles);
+    if (w != winIndex) {
+      Serial.print("[BENCH]   v t="); Serial.print((winIndex + 1) * (BENCH_WINDOW_US / 1000));
+      Serial.print("ms cmd="); Serial.print((long)(winCmdSum / winSteps));
+      Serial.print(" act="); Serial.println((long)(winSteps * (1000000UL / BENCH_WINDOW_US)));
+      winIndex = w;
+      winSteps = 0;
+      winCmdSum = 0.0f;
+    }
+    winSteps++;
+    if (g_cmdUs[i]) winCmdSum += 1000000.0f / (float)g_cmdUs[i];
+
+    // Ошибку интервала складываем на место заданной задержки (она больше не нужна)
+    uint32_t cmdNs = g_cmdUs[i] * 1000;
+    g_cmdUs[i] = (dtNs > cmdNs) ? dtNs - cmdNs : cmdNs - dtNs;
+  }
+
+  // --- Перцентили |фактический − заданный| интервал, нс ---
+  qsort(&g_cmdUs[1], n - 1, sizeof(uint32_t), cmpU32);
+  Serial.print("[BENCH]   interval err ns:");
+  printPercentile(" p50=", &g_cmdUs[1], n - 1, 500);
+  printPercentile(" p90=", &g_cmdUs[1], n - 1, 900);
+  printPercentile(" p99=", &g_cmdUs[1], n - 1, 990);
+  printPercentile(" p99.9=", &g_cmdUs[1], n - 1, 999);
+  Serial.print(" max="); Serial.println(g_cmdUs[n - 1]);
+
+  Serial.print("[BENCH]   longest gap: "); Serial.print(gapNs / 1000);
+  Serial.print("us (commanded "); Serial.print(gapCmdUs);
+  Serial.print("us) at step "); Serial.println(gapStep);
+
+  Serial.print("[BENCH]   step callback: avg ");
+  Serial.print(g_cbCount ? (uint32_t)(g_cbSum / g_cbCount) : 0);
+  Serial.print(" cycles, max "); Serial.print(g_cbMax);
+  Serial.print(" (io="); Serial.print(stepIoGetMode() == STEPIO_REGISTERS ? "REG" : "ARDUINO");
+  Serial.println(")");
+
+  Serial.print("[BENCH]   loop(): ");
+  Serial.print(durMs ? (uint32_t)((uint64_t)g_loops * 1000 / durMs) : 0);
+  Serial.println(" iter/s");
+}
+
+static void benchStartCase() {
+  const BenchCase &c = BENCH_CASES[g_case];
+
+  // Едем к дальнему концу хода, но не дальше, чем влезает в буфер
+  long pos  = motorGetCurrentPosition();
+  long full = floorGetFullTravelSteps();
+  long target;
+  if (pos < full / 2) {
+    target = pos + (long)BENCH_MAX_PULSES;
+    if (target > full) target = full;
+  } else {
+    target = pos - (long)BENCH_MAX_PULSES;
+    if (target < 0) target = 0;
+  }
+
+  g_count       = 0;
+  g_loops       = 0;
+  g_cbSum       = 0;
+  g_cbMax       = 0;
+  g_cbCount     = 0;
+  g_caseStartMs = millis();
+  g_capturing   = true;
+
+  // Потенциометр maxSpeed не перезапишет, пока ручку не повернут; в конце вернём как было
+  motorSetAccel(c.accel);
+  motorSetMaxSpeed(c.maxSpeed);
+  motorMoveTo(target);
+}
+
+void benchStart() {
+  if (g_phase != BENCH_OFF) {
+    LOG(BENCH_BUSY);
+    return;
+  }
+  if (smGetState() != STATE_IDLE || !floorHasValidCalibration()) {
+    LOG(BENCH_NEED_IDLE);
+    return;
+  }
+  if (floorGetFullTravelSteps() < 200) {
+    LOG(BENCH_TRAVEL_SHORT);
+    return;
+  }
+
+  LOG(BENCH_START);
+  g_homePos    = motorGetCurrentPosition();
+  g_savedAccel = motorGetAccel();
+  g_savedSpeed = motorGetMaxSpeed();
+  g_case       = 0;
+  g_phase      = BENCH_RUN;
+  benchStartCase();
+}
+
+void benchService() {
+  if (g_phase == BENCH_OFF || motorIsBusy()) return;
+
+  if (g_phase == BENCH_RUN) {
+    g_capturing = false;
+    benchReport();
+
+    g_case++;
+    if (g_case < BENCH_CASE_COUNT) {
+      benchStartCase();
+      return;
+    }
+
+    // Возвращаем кабину и профиль как было
+    motorSetAccel(g_savedAccel);
+    motorSetMaxSpeed(g_savedSpeed);
+    motorMoveTo(g_homePos);
+    g_phase = BENCH_HOME;
+    return;
+  }
+
+  Serial.println("[BENCH] Done");
+  g_phase = BENCH_OFF;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+
+// Бенчмарк равномерности шагов.
+// Гоняет motorMoveTo() с несколькими maxSpeed/accel, пишет метку времени каждого
+// импульса STEP (счётчик тактов CPU на ESP32, виртуальное время в симуляторе)
+// вместе с заданной профилем задержкой и печатает:
+//   перцентили ошибки интервала, самый длинный разрыв, кривую заданной/реальной
+//   скорости по окнам 100 мс, такты CPU на колбэк шага и число итераций loop() в секунду.
+
+void benchStart();           // команда BENCH: только в IDLE с валидной калибровкой
+bool benchIsRunning();
+void benchService();         // из loop(): переход между прогонами и отчёт
+
+// Хуки (дёшевы, пока бенчмарк не запущен)
+void benchOnStep(uint32_t commandedUs);  // из колбэка шага (ISR) до импульса
+void benchOnStepDone();                  // в конце колбэка шага: его длительность в тактах
+void benchLoopTick();                    // каждая итерация loop()
@@ -0,0 +1,611 @@
+#include "step_generator.h"
+#include "logger.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <driver/gptimer.h>
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+// Простой энкодер RMT (колбэк дописывает символы по мере освобождения памяти) — с IDF 5.3
+#define STEPGEN_HAS_RMT 1
+#include <driver/rmt_tx.h>
+#include <driver/rmt_encoder.h>
+#include <driver/pulse_cnt.h>
+#endif
+#else
+#define STEPGEN_HAS_RMT 1  // Linux: модель памяти RMT и PCNT
+#endif
+
+// Первый шаг после простоя делаем почти сразу (как и опрос в loop())
+static const uint32_t STEPGEN_MIN_LEAD_US = 2;
+
+static StepGenMode       g_mode    = STEPGEN_POLLING;
+static StepGenCallback   g_onStep  = nullptr;
+static volatile uint32_t g_intervalUs = 0;     // 0 = стоим
+static volatile bool     g_armed      = false; // таймер взведён (режим ISR) / идёт цепочка RMT
+static uint32_t          g_lastStepUs = 0;     // только для режима POLLING
+
+// ---- Цепочка импульсов RMT: источник интервалов и счёт шагов ----
+static const uint32_t RMT_PULSE_US    = 2;       // ширина STEP, как в step_io
+static const uint32_t RMT_MAX_DUR     = 32767;   // 15 бит на длительность в символе (1 тик = 1 мкс)
+static const uint16_t RMT_MEM_SYMBOLS = 64;      // память канала: две половины по 32 (ping-pong)
+
+static uint8_t               g_stepPin      = 0;
+static StepGenIntervalSource g_nextInterval = nullptr;
+static volatile uint32_t     g_rmtPulled    = 0;      // шагов цепочки уже в символах
+static uint32_t              g_rmtGapUs     = 0;      // недописанный остаток паузы после шага
+static bool                  g_rmtLast      = false;  // последний шаг цепочки уже в символах
+static uint32_t              g_emittedBase  = 0;      // выдано в прошлых цепочках
+static uint32_t              g_emittedTaken = 0;      // сколько уже забрал stepGenTakeEmittedSteps()
+
+// ----------------------------------------------------------
+// Аппаратная часть: ESP32 GPTimer 1 МГц или симуляция под Linux
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+static gptimer_handle_t g_timer = nullptr;
+static portMUX_TYPE     g_mux   = portMUX_INITIALIZER_UNLOCKED;
+
+#define STEPGEN_LOCK()   portENTER_CRITICAL_SAFE(&g_mux)
+#define STEPGEN_UNLOCK() portEXIT_CRITICAL_SAFE(&g_mux)
+
+static void IRAM_ATTR timerSetAlarm(uint64_t atCount) {
+  gptimer_alarm_config_t cfg = {};
+  cfg.alarm_count = atCount;
+  gptimer_set_alarm_action(g_timer, &cfg);
+}
+
+static void IRAM_ATTR timerDisarm() {
+  gptimer_set_alarm_action(g_timer, nullptr);
+}
+
+static void timerArmFromNow(uint32_t delayUs) {
+  uint64_t now = 0;
+  gptimer_get_raw_count(g_timer, &now);
+  timerSetAlarm(now + delayUs);
+}
+
+static bool IRAM_ATTR onStepAlarm(gptimer_handle_t timer,
+                                  const gptimer_alarm_event_data_t *edata,
+                                  void *userCtx) {
+  if (!g_armed) return false;
+
+  g_onStep();  // может сам вызвать stepGenSetInterval()
+
+  STEPGEN_LOCK();
+  if (g_armed) {
+    uint64_t next = edata->alarm_value + g_intervalUs;
+    // Если ISR опоздал больше чем на интервал — не ждём переполнения счётчика
+    if (next <= edata->count_value) next = edata->count_value + STEPGEN_MIN_LEAD_US;
+    timerSetAlarm(next);
+  }
+  STEPGEN_UNLOCK();
+  return false;
+}
+
+static void timerInit() {
+  if (g_timer) return;
+
+  gptimer_config_t cfg = {};
+  cfg.clk_src       = GPTIMER_CLK_SRC_DEFAULT;
+  cfg.direction     = GPTIMER_COUNT_UP;
+  cfg.resolution_hz = 1000000;  // 1 тик = 1 мкс
+  if (gptimer_new_timer(&cfg, &g_timer) != ESP_OK) {
+    LOG(STEPGEN_TIMER_FAILED);
+    g_timer = nullptr;
+    g_mode  = STEPGEN_POLLING;
+    return;
+  }
+
+  gptimer_event_callbacks_t cbs = {};
+  cbs.on_alarm = onStepAlarm;
+  gptimer_register_event_callbacks(g_timer, &cbs, nullptr);
+  gptimer_enable(g_timer);
+  gptimer_start(g_timer);  // считает непрерывно, 64 бита — переполнения не ждём
+}
+
+#if STEPGEN_HAS_RMT
+typedef rmt_symbol_word_t StepSymbol;
+#endif
+
+#else  // ---- Linux: симулированный таймер ----
+
+static uint32_t  g_simAlarmUs   = 0;
+static uint32_t *g_simCapture   = nullptr;
+static size_t    g_simCaptureCap = 0;
+static size_t    g_simCaptured   = 0;
+
+#define STEPGEN_LOCK()
+#define STEPGEN_UNLOCK()
+
+static void timerSetAlarm(uint32_t atUs) { g_simAlarmUs = atUs; }
+static void timerDisarm() {}
+static void timerArmFromNow(uint32_t delayUs) { timerSetAlarm(micros() + delayUs); }
+static void timerInit() {}
+
+// Те же поля, что у rmt_symbol_word_t
+struct StepSymbol {
+  uint16_t duration0;
+  uint8_t  level0;
+  uint16_t duration1;
+  uint8_t  level1;
+};
+
+static void simPlanPush(uint32_t intervalUs);
+
+#endif
+
+// ----------------------------------------------------------
+// Энкодер цепочки: интервалы профиля → символы RMT. Общий для ESP32 и модели под Linux.
+// Шаг — символ «STEP HIGH RMT_PULSE_US, LOW остаток интервала»; длинная пауза (медленный
+// старт) добивается символами без импульса. Длительности в символе 15-битные и не нулевые
+// (ноль — конец передачи), поэтому остаток паузы не бывает короче 2 мкс.
+
+#if STEPGEN_HAS_RMT
+
+static size_t IRAM_ATTR rmtFill(StepSymbol *out, size_t room, bool *done) {
+  size_t n = 0;
+  STEPGEN_LOCK();
+  while (n < room) {
+    if (g_rmtGapUs) {
+      uint32_t chunk = g_rmtGapUs;
+      if (chunk > 2 * RMT_MAX_DUR) {
+        chunk = 2 * RMT_MAX_DUR;
+        if (g_rmtGapUs - chunk < 2) chunk -= 2;
+      }
+      out[n].level0    = 0;
+      out[n].duration0 = chunk / 2;
+      out[n].level1    = 0;
+      out[n].duration1 = chunk - chunk / 2;
+      g_rmtGapUs -= chunk;
+      n++;
+      continue;
+    }
+    if (g_rmtLast) {
+      *done = true;
+      break;
+    }
+
+    uint32_t next = g_nextInterval();  // пауза после этого шага; 0 — шаг последний
+    g_rmtPulled = g_rmtPulled + 1;
+#if !defined(ARDUINO_ARCH_ESP32)
+    simPlanPush(next);
+#endif
+    uint32_t low   = (next > RMT_PULSE_US + 1) ? next - RMT_PULSE_US : RMT_PULSE_US;
+    uint32_t first = (low > RMT_MAX_DUR) ? RMT_MAX_DUR : low;
+    if (low - first == 1) first--;
+    out[n].level0    = 1;
+    out[n].duration0 = RMT_PULSE_US;
+    out[n].level1    = 0;
+    out[n].duration1 = first;
+    g_rmtGapUs = low - first;
+    if (next == 0) g_rmtLast = true;
+    n++;
+  }
+  STEPGEN_UNLOCK();
+  return n;
+}
+
+static void rmtResetChain() {
+  g_rmtPulled = 0;
+  g_rmtGapUs  = 0;
+  g_rmtLast   = false;
+}
+
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) && STEPGEN_HAS_RMT
+
+static rmt_channel_handle_t  g_rmtChan  = nullptr;
+static rmt_encoder_handle_t  g_rmtEnc   = nullptr;
+static pcnt_unit_handle_t    g_pcnt     = nullptr;
+static pcnt_channel_handle_t g_pcntChan = nullptr;
+static const int             PCNT_HIGH_LIMIT = 30000;  // дальше — накопление по точке наблюдения
+
+static size_t IRAM_ATTR onRmtEncode(const void *, size_t, size_t, size_t symbolsFree,
+                                    rmt_symbol_word_t *symbols, bool *done, void *) {
+  return rmtFill(symbols, symbolsFree, done);
+}
+
+static bool IRAM_ATTR onRmtDone(rmt_channel_handle_t, const rmt_tx_done_event_data_t *, void *) {
+  g_armed = false;
+  return false;
+}
+
+static uint32_t rmtCount() {
+  int count = 0;
+  pcnt_unit_get_count(g_pcnt, &count);
+  return (uint32_t)count;
+}
+
+static void rmtDeinit() {
+  if (g_rmtChan) {
+    rmt_disable(g_rmtChan);
+    rmt_del_channel(g_rmtChan);
+  }
+  if (g_rmtEnc) rmt_del_encoder(g_rmtEnc);
+  if (g_pcnt) {
+    pcnt_unit_stop(g_pcnt);
+    pcnt_unit_disable(g_pcnt);
+  }
+  if (g_pcntChan) pcnt_del_channel(g_pcntChan);
+  if (g_pcnt) pcnt_del_unit(g_pcnt);
+  g_rmtChan = nullptr;
+  g_rmtEnc = nullptr;
+  g_pcntChan = nullptr;
+  g_pcnt = nullptr;
+  // Пин снова обычный выход (step_io пишет в регистры GPIO)
+  pinMode(g_stepPin, OUTPUT);
+  digitalWrite(g_stepPin, LOW);
+}
+
+static bool rmtInit() {
+  if (g_rmtChan) return true;
+  if (!g_nextInterval) return false;
+
+  rmt_tx_channel_config_t tx = {};
+  tx.gpio_num          = (gpio_num_t)g_stepPin;
+  tx.clk_src           = RMT_CLK_SRC_DEFAULT;
+  tx.resolution_hz     = 1000000;  // 1 тик = 1 мкс
+  tx.mem_block_symbols = RMT_MEM_SYMBOLS;
+  tx.trans_queue_depth = 1;
+  tx.flags.io_loop_back = 1;       // PCNT считает импульсы с того же пина
+
+  rmt_simple_encoder_config_t enc = {};
+  enc.callback       = onRmtEncode;
+  enc.min_chunk_size = 1;
+
+  pcnt_unit_config_t unit = {};
+  unit.low_limit  = -1;
+  unit.high_limit = PCNT_HIGH_LIMIT;
+  unit.flags.accum_count = 1;
+
+  pcnt_chan_config_t chan = {};
+  chan.edge_gpio_num  = g_stepPin;
+  chan.level_gpio_num = -1;
+
+  bool ok = rmt_new_tx_channel(&tx, &g_rmtChan) == ESP_OK &&
+            rmt_new_simple_encoder(&enc, &g_rmtEnc) == ESP_OK &&
+            pcnt_new_unit(&unit, &g_pcnt) == ESP_OK &&
+            pcnt_new_channel(g_pcnt, &chan, &g_pcntChan) == ESP_OK;
+  if (ok) {
+    rmt_tx_event_callbacks_t cbs = {};
+    cbs.on_trans_done = onRmtDone;
+    rmt_tx_register_event_callbacks(g_rmtChan, &cbs, nullptr);
+    pcnt_channel_set_edge_action(g_pcntChan, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD);
+    pcnt_unit_add_watch_point(g_pcnt, PCNT_HIGH_LIMIT);
+    ok = rmt_enable(g_rmtChan) == ESP_OK && pcnt_unit_enable(g_pcnt) == ESP_OK &&
+         pcnt_unit_clear_count(g_pcnt) == ESP_OK && pcnt_unit_start(g_pcnt) == ESP_OK;
+  }
+  if (!ok) {
+    LOG(STEPGEN_RMT_FAILED);
+    rmtDeinit();
+  }
+  return ok;
+}
+
+static void rmtStart() {
+  g_emittedBase += rmtCount();
+  pcnt_unit_clear_count(g_pcnt);
+  rmtResetChain();
+  g_armed = true;
+
+  static const uint8_t payload = 0;  // данные энкодеру не нужны: символы берёт из профиля
+  rmt_transmit_config_t cfg = {};
+  cfg.loop_count     = 0;
+  cfg.flags.eot_level = 0;
+  if (rmt_transmit(g_rmtChan, g_rmtEnc, &payload, sizeof(payload), &cfg) != ESP_OK) g_armed = false;
+}
+
+static void rmtStop() {
+  // Снять передачу на полуслове: не выданные символы пропадают, PCNT знает, сколько ушло
+  rmt_disable(g_rmtChan);
+  g_armed = false;
+  rmt_enable(g_rmtChan);
+}
+
+#elif !defined(ARDUINO_ARCH_ESP32)
+
+// ---- Модель RMT под Linux ----
+// Память канала — кольцо из RMT_MEM_SYMBOLS символов. Передатчик выдаёт символ за символом
+// в виртуальном времени; как только выдана половина, «прерывание» дописывает в неё новые
+// символы энкодером (ping-pong, как на ESP32). Фронты STEP идут на стенд через digitalWrite,
+// PCNT — счётчик фронтов. Каждый интервал между фронтами сверяется с тем, что энкодер взял
+// из профиля для этого шага.
+
+static StepSymbol g_simMem[RMT_MEM_SYMBOLS];
+static uint32_t   g_simWritten = 0;    // символов записано в кольцо за цепочку
+static uint32_t   g_simSent    = 0;    // выдано
+static uint8_t    g_simHalf    = 0;    // 0 — идёт duration0 символа, 1 — duration1
+static bool       g_simDone    = false;
+static uint32_t   g_simEdges   = 0;    // «PCNT»: фронты STEP цепочки
+static uint32_t   g_simLastEdgeUs = 0;
+
+// Интервалы, взятые энкодером, по порядку шагов — ещё не сверенные с выдачей
+static const uint16_t SIM_PLAN_CAP = 256;
+static uint32_t g_simPlan[SIM_PLAN_CAP];
+static uint32_t g_simPlanHead = 0, g_simPlanTail = 0;
+static StepGenSimRmtStats g_simStats = {};
+
+static void simPlanPush(uint32_t intervalUs) {
+  if (g_simPlanHead - g_simPlanTail >= SIM_PLAN_CAP) {
+    g_simStats.mismatches++;  // не должно случаться: вперёд не больше RMT_MEM_SYMBOLS шагов
+    return;
+  }
+  g_simPlan[g_simPlanHead++ % SIM_PLAN_CAP] = intervalUs;
+}
+
+static void simRefill() {
+  uint32_t room = RMT_MEM_SYMBOLS - (g_simWritten - g_simSent);
+  if (room == 0 || g_simDone) return;
+  StepSymbol tmp[RMT_MEM_SYMBOLS];
+  bool done = false;
+  size_t n = rmtFill(tmp, room, &done);
+  for (size_t i = 0; i < n; i++) g_simMem[(g_simWritten + i) % RMT_MEM_SYMBOLS] = tmp[i];
+  g_simWritten += n;
+  g_simDone = done;
+  g_simStats.refills++;
+  uint32_t ahead = g_rmtPulled - g_simEdges;
+  if (ahead > g_simStats.maxAhead) g_simStats.maxAhead = ahead;
+}
+
+static void simOnRisingEdge(uint32_t at) {
+  if (g_simCapture && g_simCaptured < g_simCaptureCap) g_simCapture[g_simCaptured] = at;
+  g_simCaptured++;
+
+  // Пауза перед этим шагом должна быть ровно той, что профиль дал после предыдущего
+  if (g_simEdges > 0) {
+    uint32_t planned = (g_simPlanTail < g_simPlanHead) ? g_simPlan[g_simPlanTail++ % SIM_PLAN_CAP] : 0;
+    g_simStats.checked++;
+    if (planned != at - g_simLastEdgeUs) g_simStats.mismatches++;
+  }
+  g_simEdges++;
+  g_simLastEdgeUs = at;
+}
+
+static uint32_t rmtCount() {
+  return g_simEdges;
+}
+
+static bool rmtInit() {
+  return g_nextInterval != nullptr;
+}
+
+static void rmtDeinit() {}
+
+static void rmtStart() {
+  g_emittedBase += g_simEdges;
+  g_simEdges     = 0;
+  rmtResetChain();
+  g_simWritten   = 0;
+  g_simSent      = 0;
+  g_simHalf      = 0;
+  g_simDone      = false;
+  g_simPlanHead  = g_simPlanTail = 0;
+  g_armed        = true;
+  simRefill();
+  timerArmFromNow(STEPGEN_MIN_LEAD_US);
+}
+
+static void rmtStop() {
+  if (g_simHalf == 1 && g_simSent < g_simWritten && g_simMem[g_simSent % RMT_MEM_SYMBOLS].level0) {
+    digitalWrite(g_stepPin, LOW);  // сняли посреди импульса
+  }
+  g_armed = false;
+}
+
+// Выдать всё, что передатчик успел к nowUs
+static void simRmtAdvanceTo(uint32_t nowUs) {
+  while (g_armed && (int32_t)(nowUs - g_simAlarmUs) >= 0) {
+    uint32_t at = g_simAlarmUs;
+    if (g_simSent == g_simWritten) {
+      g_armed = false;  // память пуста и энкодер закончил: on_trans_done
+      if (!g_simDone) g_simStats.underruns++;
+      break;
+    }
+    const StepSymbol &s = g_simMem[g_simSent % RMT_MEM_SYMBOLS];
+    if (g_simHalf == 0) {
+      digitalWrite(g_stepPin, s.level0 ? HIGH : LOW);
+      if (s.level0) simOnRisingEdge(at);
+      g_simHalf = 1;
+      timerSetAlarm(at + s.duration0);
+    } else {
+      digitalWrite(g_stepPin, s.level1 ? HIGH : LOW);
+      g_simHalf = 0;
+      g_simSent++;
+      timerSetAlarm(at + s.duration1);
+      if (g_simWritten - g_simSent <= RMT_MEM_SYMBOLS / 2) simRefill();
+    }
+  }
+}
+
+void stepGenSimRmtGetStats(StepGenSimRmtStats *out) {
+  *out = g_simStats;
+}
+
+#endif
+
+// ----------------------------------------------------------
+
+#if !defined(ARDUINO_ARCH_ESP32)
+
+void stepGenSimAdvanceTo(uint32_t nowUs) {
+  if (g_mode == STEPGEN_RMT) {
+    simRmtAdvanceTo(nowUs);
+    return;
+  }
+  while (g_mode == STEPGEN_TIMER_ISR && g_armed &&
+         (int32_t)(nowUs - g_simAlarmUs) >= 0) {
+    uint32_t at = g_simAlarmUs;
+    if (g_simCapture && g_simCaptured < g_simCaptureCap) {
+      g_simCapture[g_simCaptured] = at;
+    }
+    g_simCaptured++;
+
+    g_onStep();
+
+    if (g_armed) timerSetAlarm(at + g_intervalUs);
+  }
+}
+
+bool stepGenSimNextAlarm(uint32_t *atUs) {
+  if ((g_mode != STEPGEN_TIMER_ISR && g_mode != STEPGEN_RMT) || !g_armed) return false;
+  *atUs = g_simAlarmUs;
+  return true;
+}
+
+void stepGenSimCapture(uint32_t *buf, size_t capacity) {
+  g_simCapture    = buf;
+  g_simCaptureCap = capacity;
+  g_simCaptured   = 0;
+}
+
+size_t stepGenSimCapturedCount() {
+  return g_simCaptured;
+}
+
+#endif
+
+// ----------------------------------------------------------
+
+void stepGenInit(StepGenMode mode, StepGenCallback onStep) {
+  g_onStep     = onStep;
+  g_intervalUs = 0;
+  g_armed      = false;
+  g_lastStepUs = micros();
+  stepGenSetMode(mode);
+}
+
+void stepGenSetPulseOutput(uint8_t stepPin, StepGenIntervalSource next) {
+  g_stepPin      = stepPin;
+  g_nextInterval = next;
+}
+
+static void logMode(StepGenMode mode) {
+  switch (mode) {
+    case STEPGEN_TIMER_ISR: LOG(STEPGEN_MODE_ISR);  break;
+    case STEPGEN_RMT:       LOG(STEPGEN_MODE_RMT);  break;
+    default:                LOG(STEPGEN_MODE_POLL); break;
+  }
+}
+
+void stepGenSetMode(StepGenMode mode) {
+  stepGenSetInterval(0);
+#if STEPGEN_HAS_RMT
+  if (g_mode == STEPGEN_RMT && mode != STEPGEN_RMT) rmtDeinit();
+#endif
+  g_emittedBase  = 0;
+  g_emittedTaken = 0;
+
+  g_mode = mode;
+#if STEPGEN_HAS_RMT
+  if (g_mode == STEPGEN_RMT && !rmtInit()) g_mode = STEPGEN_TIMER_ISR;
+  // Импульсы прошлых цепочек (канал мог остаться от прежнего включения RMT) — уже не наши
+  if (g_mode == STEPGEN_RMT) g_emittedTaken = rmtCount();
+#else
+  if (g_mode == STEPGEN_RMT) {
+    LOG(STEPGEN_RMT_NO_IDF);
+    g_mode = STEPGEN_TIMER_ISR;
+  }
+#endif
+  if (g_mode == STEPGEN_TIMER_ISR) timerInit();  // при ошибке сам вернёт POLLING
+
+  logMode(g_mode);
+}
+
+StepGenMode stepGenGetMode() {
+  return g_mode;
+}
+
+void stepGenStart() {
+  stepGenSetInterval(STEPGEN_MIN_LEAD_US);
+}
+
+void IRAM_ATTR stepGenSetInterval(uint32_t intervalUs) {
+  if (g_mode == STEPGEN_POLLING) {
+    g_intervalUs = intervalUs;
+    return;
+  }
+
+#if STEPGEN_HAS_RMT
+  if (g_mode == STEPGEN_RMT) {
+    // Интервалы цепочка берёт из источника сама; здесь только старт и срыв
+    g_intervalUs = intervalUs;
+    if (intervalUs == 0) {
+      if (g_armed) rmtStop();
+    } else if (!g_armed) {
+      rmtStart();
+    }
+    return;
+  }
+#endif
+
+  STEPGEN_LOCK();
+  g_intervalUs = intervalUs;
+  if (intervalUs == 0) {
+    if (g_armed) {
+      g_armed = false;
+      timerDisarm();
+    }
+  } else if (!g_armed) {
+    // Из простоя: первый шаг сразу, дальше — по интервалам из колбэка
+    g_armed = true;
+    timerArmFromNow(STEPGEN_MIN_LEAD_US);
+  }
+  STEPGEN_UNLOCK();
+}
+
+void stepGenLock() {
+  STEPGEN_LOCK();
+}
+
+void stepGenUnlock() {
+  STEPGEN_UNLOCK();
+}
+
+bool stepGenIsRunning() {
+  if (g_mode == STEPGEN_TIMER_ISR || g_mode == STEPGEN_RMT) return g_armed;
+  return g_intervalUs != 0;
+}
+
+uint32_t stepGenTakeEmittedSteps() {
+#if STEPGEN_HAS_RMT
+  if (g_mode != STEPGEN_RMT) return 0;
+  uint32_t total = g_emittedBase + rmtCount();
+  uint32_t n = total - g_emittedTaken;
+  g_emittedTaken = total;
+  return n;
+#else
+  return 0;
+#endif
+}
+
+uint32_t stepGenPeekEmittedSteps() {
+#if STEPGEN_HAS_RMT
+  if (g_mode != STEPGEN_RMT) return 0;
+  return g_emittedBase + rmtCount() - g_emittedTaken;
+#else
+  return 0;
+#endif
+}
+
+uint32_t stepGenQueuedSteps() {
+#if STEPGEN_HAS_RMT
+  if (g_mode != STEPGEN_RMT || !g_armed) return 0;
+  return g_rmtPulled - rmtCount();
+#else
+  return 0;
+#endif
+}
+
+void stepGenService() {
+  if (g_mode != STEPGEN_POLLING) return;
+
+  uint32_t interval = g_intervalUs;
+  if (interval == 0) return;
+
+  uint32_t now = micros();
+  if ((now - g_lastStepUs) >= interval) {
+    g_lastStepUs = now;
+    g_onStep();
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+
+// Генератор импульсов STEP.
+// Планировщик скорости (motorService) сообщает только интервал до следующего шага,
+// а сам шаг делается либо опросом из loop(), либо из прерывания аппаратного таймера.
+// В режиме RMT прерывания на шаг нет: интервалы профиля кодируются в символы RMT и
+// выдаются железом целыми кусками разгона / крейсера / торможения, программа лишь
+// дописывает освободившуюся половину памяти канала. Шаги считает PCNT на том же пине.
+
+enum StepGenMode : uint8_t {
+  STEPGEN_POLLING,    // шаги из loop() по micros() (старый режим)
+  STEPGEN_TIMER_ISR,  // шаги из ISR аппаратного таймера ESP32
+  STEPGEN_RMT         // цепочка импульсов RMT, счёт шагов — PCNT (ESP-IDF 5.3+)
+};
+
+// Колбэк шага: делает один шаг. Может вызываться из ISR.
+// Внутри можно вызвать stepGenSetInterval() — новый интервал подхватится сразу.
+typedef void (*StepGenCallback)();
+// Источник интервалов для режима RMT: то же, что колбэк шага отдал бы в stepGenSetInterval()
+// после шага, но без самого шага. 0 — этот шаг последний. Вызывается из прерывания RMT.
+typedef uint32_t (*StepGenIntervalSource)();
+
+void stepGenInit(StepGenMode mode, StepGenCallback onStep);
+// Пин STEP и источник интервалов для режима RMT (до stepGenInit)
+void stepGenSetPulseOutput(uint8_t stepPin, StepGenIntervalSource next);
+void stepGenSetMode(StepGenMode mode);   // переключать только на стоящем моторе
+StepGenMode stepGenGetMode();
+
+// Первый шаг из простоя — сразу; дальнейшие интервалы задаёт колбэк шага
+void stepGenStart();
+// Интервал до следующего шага в мкс; 0 = не шагать. Можно звать из ISR.
+void stepGenSetInterval(uint32_t intervalUs);
+bool stepGenIsRunning();
+
+// Режим RMT: шаги, выданные (по PCNT) с прошлого вызова, — позицию ведёт вызывающий.
+// В остальных режимах 0: позицию считает колбэк шага.
+uint32_t stepGenTakeEmittedSteps();
+// То же без «забирания» — сколько выдано и ещё не забрано
+uint32_t stepGenPeekEmittedSteps();
+// Режим RMT: шаги, уже взятые из профиля в символы, но ещё не выданные (иначе 0).
+// Профиль впереди реальной позиции ровно на столько.
+uint32_t stepGenQueuedSteps();
+
+// Критическая секция относительно ISR шага (перепланирование профиля на ходу)
+void stepGenLock();
+void stepGenUnlock();
+
+// Вызывать из motorService(): в режиме POLLING делает шаги, в режиме ISR ничего не делает
+void stepGenService();
+
+#if !defined(ARDUINO_ARCH_ESP32)
+// ---- Только для сборки под Linux: симулированный аппаратный таймер ----
+// Продвигает виртуальное время таймера до nowUs и вызывает «ISR» на каждом сработавшем
+// аларме (метка импульса = момент аларма, а не nowUs).
+void     stepGenSimAdvanceTo(uint32_t nowUs);
+// Момент ближайшего аларма; false, если таймер не взведён.
+// Симулятор часов по нему продвигает время точно до срабатывания.
+bool     stepGenSimNextAlarm(uint32_t *atUs);
+// Буфер, куда пишутся метки времени всех импульсов, выданных «ISR»
+void     stepGenSimCapture(uint32_t *buf, size_t capacity);
+size_t   stepGenSimCapturedCount();
+
+// Модель RMT: сверка каждого выданного интервала с запланированным
+struct StepGenSimRmtStats {
+  uint32_t checked;     // интервалов между фронтами сверено
+  uint32_t mismatches;  // не совпало с профилем
+  uint32_t underruns;   // память опустела раньше конца цепочки
+  uint32_t refills;     // дописываний памяти канала
+  uint32_t maxAhead;    // шагов в символах впереди выданных (максимум)
+};
+void     stepGenSimRmtGetStats(StepGenSimRmtStats *out);
+#endif
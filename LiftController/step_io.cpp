@@ -0,0 +1,164 @@
+#include "step_io.h"
+#include "logger.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_cpu.h>
+#include <soc/gpio_reg.h>
+#endif
+
+// Тайминги драйвера (DRV8825: импульс STEP ≥ 1.9 мкс, установка DIR ≥ 650 нс; A4988 — меньше)
+static const uint32_t STEP_PULSE_NS = 2000;
+static const uint32_t DIR_SETUP_NS  = 1000;
+static const uint32_t STEP_PULSE_US = 2;     // для прежнего пути через delayMicroseconds()
+
+// Выход: номер пина и (на ESP32) регистры set/clear с маской
+struct StepIoPin {
+  uint8_t  pin;
+#if defined(ARDUINO_ARCH_ESP32)
+  uint32_t setReg;
+  uint32_t clrReg;
+  uint32_t mask;
+#endif
+};
+
+static StepIoMode        g_mode = STEPIO_REGISTERS;
+static StepIoPin         g_step = {};
+static StepIoPin         g_dir  = {};
+static int8_t            g_dirLevel    = 0;      // что сейчас на DIR: +1 HIGH, -1 LOW, 0 — неизвестно
+static bool              g_stepHigh    = false;
+static uint32_t          g_riseCycles  = 0;
+static uint32_t          g_pulseCycles = 0;
+static uint32_t          g_setupCycles = 0;
+static volatile uint32_t g_dirChanges  = 0;
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+static StepIoPin makePin(uint8_t pin) {
+  StepIoPin p = {};
+  p.pin = pin;
+#if defined(GPIO_OUT1_W1TS_REG)
+  if (pin >= 32) {
+    p.setReg = GPIO_OUT1_W1TS_REG;
+    p.clrReg = GPIO_OUT1_W1TC_REG;
+    p.mask   = 1UL << (pin - 32);
+    return p;
+  }
+#endif
+  p.setReg = GPIO_OUT_W1TS_REG;
+  p.clrReg = GPIO_OUT_W1TC_REG;
+  p.mask   = 1UL << pin;
+  return p;
+}
+
+static inline void IRAM_ATTR pinWrite(const StepIoPin &p, bool high) {
+  REG_WRITE(high ? p.setReg : p.clrReg, p.mask);
+}
+
+static inline uint32_t IRAM_ATTR cycles() {
+  return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+static inline void IRAM_ATTR waitCycles(uint32_t since, uint32_t n) {
+  while ((uint32_t)(cycles() - since) < n) {
+  }
+}
+
+static uint32_t cpuMhz() {
+  return getCpuFrequencyMhz();
+}
+
+#else  // ---- Linux: через заглушку digitalWrite (её видит стенд) ----
+
+static StepIoPin makePin(uint8_t pin) {
+  StepIoPin p = {};
+  p.pin = pin;
+  return p;
+}
+
+static inline void pinWrite(const StepIoPin &p, bool high) {
+  digitalWrite(p.pin, high ? HIGH : LOW);
+}
+
+// Виртуальное время внутри колбэка шага стоит — ждать по тактам нечего
+static inline uint32_t cycles() { return 0; }
+static inline void waitCycles(uint32_t, uint32_t) {}
+static uint32_t cpuMhz() { return 240; }
+
+#endif
+
+// ----------------------------------------------------------
+
+void stepIoInit(uint8_t stepPin, uint8_t dirPin) {
+  g_step = makePin(stepPin);
+  g_dir  = makePin(dirPin);
+  pinMode(stepPin, OUTPUT);
+  pinMode(dirPin, OUTPUT);
+  digitalWrite(stepPin, LOW);
+  digitalWrite(dirPin, LOW);
+  g_dirLevel   = -1;
+  g_stepHigh   = false;
+  g_dirChanges = 0;
+
+  uint32_t mhz  = cpuMhz();
+  g_pulseCycles = (STEP_PULSE_NS * mhz + 999) / 1000;
+  g_setupCycles = (DIR_SETUP_NS * mhz + 999) / 1000;
+  stepIoSetMode(g_mode);
+}
+
+void stepIoSetMode(StepIoMode mode) {
+  stepIoPulseEnd();
+  g_mode = mode;
+  if (g_mode == STEPIO_REGISTERS) {
+    LOG(STEPIO_MODE_REGISTERS);
+  } else {
+    LOG(STEPIO_MODE_ARDUINO);
+  }
+}
+
+StepIoMode stepIoGetMode() {
+  return g_mode;
+}
+
+void IRAM_ATTR stepIoPulseBegin(int8_t dir) {
+  int8_t level = (dir >= 0) ? 1 : -1;  // DIR HIGH = вверх, как и раньше
+  if (level != g_dirLevel) g_dirChanges = g_dirChanges + 1;
+
+  if (g_mode == STEPIO_ARDUINO) {
+    // Прежний путь: DIR перед каждым шагом, импульс с ожиданием в цикле
+    g_dirLevel = level;
+    digitalWrite(g_dir.pin, level > 0 ? HIGH : LOW);
+    digitalWrite(g_step.pin, HIGH);
+    delayMicroseconds(STEP_PULSE_US);
+    digitalWrite(g_step.pin, LOW);
+    return;
+  }
+
+  if (level != g_dirLevel) {
+    g_dirLevel = level;
+    pinWrite(g_dir, level > 0);
+    waitCycles(cycles(), g_setupCycles);  // установка DIR→STEP — только на реверсе
+  }
+  pinWrite(g_step, true);
+  g_riseCycles = cycles();
+  g_stepHigh   = true;
+}
+
+void IRAM_ATTR stepIoPulseEnd() {
+  if (!g_stepHigh) return;
+  waitCycles(g_riseCycles, g_pulseCycles);  // остаток ширины импульса
+  pinWrite(g_step, false);
+  g_stepHigh = false;
+}
+
+void stepIoSetDir(int8_t dir) {
+  int8_t level = (dir >= 0) ? 1 : -1;
+  if (level == g_dirLevel) return;
+  g_dirChanges = g_dirChanges + 1;
+  g_dirLevel   = level;
+  pinWrite(g_dir, level > 0);
+  waitCycles(cycles(), g_setupCycles);
+}
+
+uint32_t stepIoDirChanges() {
+  return g_dirChanges;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+// Выходы STEP/DIR на драйвер шаговика.
+// STEPIO_REGISTERS: запись в регистры GPIO set/clear (одна команда store, без поиска пина),
+// DIR пишется только при смене направления, и лишь тогда выдерживается время установки
+// DIR→STEP. Спад STEP не ждёт в цикле сразу после фронта: между stepIoPulseBegin() и
+// stepIoPulseEnd() колбэк шага считает следующий интервал, а End() дожидается только
+// остатка минимальной ширины импульса (обычно он уже истёк).
+// STEPIO_ARDUINO — прежний путь (digitalWrite + delayMicroseconds), для сравнения в BENCH.
+
+enum StepIoMode : uint8_t {
+  STEPIO_ARDUINO,
+  STEPIO_REGISTERS
+};
+
+void stepIoInit(uint8_t stepPin, uint8_t dirPin);
+void stepIoSetMode(StepIoMode mode);   // переключать только на стоящем моторе
+StepIoMode stepIoGetMode();
+
+// Из колбэка шага (ISR): направление (+1 / -1), фронт STEP, ..., спад STEP
+void stepIoPulseBegin(int8_t dir);
+void stepIoPulseEnd();
+// Только DIR, без импульса (режим RMT: импульсы выдаёт железо). Пишется лишь при смене;
+// установку DIR→STEP выдерживает вызывающий — до первого фронта всё равно проходят микросекунды.
+void stepIoSetDir(int8_t dir);
+
+// Сколько раз переключали DIR (реверсы) с stepIoInit()
+uint32_t stepIoDirChanges();
@@ -0,0 +1,430 @@
+#include "step_ramp.h"
+#include "logger.h"
+#include <math.h>
+#include <string.h>
+
+// Длина таблицы разгона = максимальный уровень скорости.
+// При 1800 шаг/с² этого хватает до ~2700 шаг/с; выше скорость упрётся в конец таблицы.
+static const uint32_t RAMP_TABLE_LEN = 2048;
+
+static uint32_t g_table[RAMP_TABLE_LEN];  // c_n в мкс, строго не возрастает
+static uint32_t g_accel = 0;
+
+// S-кривая: таблица разгона текущей поездки (строится в rampPlanMove)
+static uint32_t    g_sTable[RAMP_TABLE_LEN];
+static RampProfile g_profile   = RAMP_TRAPEZOID;
+static uint32_t    g_jerk      = 12000;  // шагов/сек^3
+
+// Участки и время текущего профиля (rampGetPlan)
+static RampPlan g_plan;
+
+// Таблица, по которой идёт текущий профиль (g_table или g_sTable)
+static const uint32_t *volatile g_active = g_table;
+
+// Текущий профиль (меняется из ISR шага)
+static volatile uint32_t g_level       = 0;  // уровень скорости
+static volatile uint32_t g_accelLeft   = 0;  // шагов разгона осталось
+static volatile uint32_t g_cruiseLeft  = 0;  // шагов крейсера осталось
+static volatile uint32_t g_cruiseDelay = 0;  // задержка на крейсере, мкс
+static volatile bool     g_jog         = false; // крейсер без конца (ручной режим)
+static volatile uint32_t g_lastDelay   = 0;
+
+// ----------------------------------------------------------
+
+void rampInit() {
+  rampReset();
+  rampSetAccel(1800);
+}
+
+void rampSetAccel(uint32_t accelStepsPerSec2) {
+  if (accelStepsPerSec2 == 0) accelStepsPerSec2 = 1;
+  if (accelStepsPerSec2 == g_accel) return;
+  g_accel = accelStepsPerSec2;
+
+  // Float здесь не страшен: считается один раз, не на шаге
+  float c = 0.676f * sqrtf(2.0f / (float)g_accel) * 1000000.0f;
+  g_table[0] = (uint32_t)c;
+  for (uint32_t n = 1; n < RAMP_TABLE_LEN; n++) {
+    c = c - (2.0f * c) / (4.0f * n + 1.0f);
+    g_table[n] = (uint32_t)c;
+    if (g_table[n] == 0) g_table[n] = 1;
+  }
+
+  LOG(RAMP_ACCEL, g_accel, g_table[0], 1000000UL / g_table[RAMP_TABLE_LEN - 1]);
+}
+
+uint32_t rampGetAccel() {
+  return g_accel;
+}
+
+void rampSetProfile(RampProfile profile) {
+  g_profile = profile;
+}
+
+RampProfile rampGetProfile() {
+  return g_profile;
+}
+
+void rampSetJerk(uint32_t jerkStepsPerSec3) {
+  if (jerkStepsPerSec3 == 0) jerkStepsPerSec3 = 1;
+  g_jerk = jerkStepsPerSec3;
+}
+
+uint32_t rampGetJerk() {
+  return g_jerk;
+}
+
+void rampGetPlan(RampPlan &out) {
+  out = g_plan;
+}
+
+uint32_t rampGetPlannedMoveUs() {
+  return g_plan.totalUs;
+}
+
+static inline uint32_t usFromSec(float s) {
+  return (s > 0.0f) ? (uint32_t)(s * 1000000.0f + 0.5f) : 0;
+}
+
+static inline void planSetTotal(RampPlan &p) {
+  p.totalUs = p.accelUs + p.cruiseUs + p.decelUs;
+}
+
+// Уровень, на котором достигается скорость speed, и задержка крейсера на нём.
+// Бинарный поиск первого c_n <= 1e6/speed.
+static uint32_t levelForSpeed(uint32_t speed, uint32_t *cruiseDelay) {
+  if (speed == 0) speed = 1;
+  uint32_t cMin = 1000000UL / speed;
+  if (cMin == 0) cMin = 1;
+
+  uint32_t lo = 0, hi = RAMP_TABLE_LEN;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (g_table[mid] <= cMin) hi = mid;
+    else                      lo = mid + 1;
+  }
+
+  if (lo == RAMP_TABLE_LEN) {
+    // Таблицы не хватило: крейсер на самой быстрой задержке из таблицы
+    *cruiseDelay = g_table[RAMP_TABLE_LEN - 1];
+  } else {
+    *cruiseDelay = cMin;
+  }
+  return lo;
+}
+
+// Время n шагов разгона трапеции с места (сумма c_0..c_{n-1}), мкс.
+// Непрерывно t = sqrt(2n / a); поправка 0.676 в c0 сдвигает всю сумму на 0.324 * sqrt(2 / a),
+// а усечение таблицы до целых мкс теряет в среднем полмикросекунды на шаг.
+static uint32_t trapezoidLevelUs(uint32_t n) {
+  if (n == 0) return 0;
+  float us = sqrtf(2.0f / (float)g_accel) * (sqrtf((float)n) - 0.324f) * 1000000.0f - 0.5f * (float)n;
+  return (us > 0.0f) ? (uint32_t)(us + 0.5f) : 0;
+}
+
+// Участки на intervals промежутков с уровня startLevel по таблице table:
+// разгон до peak, но не выше top (там крейсер на topDelay), крейсер, торможение peak шагов.
+// levelUs(n) — время первых n шагов таблицы. false — с этого уровня не затормозить.
+static bool planFromLevel(uint32_t intervals, uint32_t startLevel, uint32_t top, uint32_t topDelay,
+                          const uint32_t *table, uint32_t (*levelUs)(uint32_t),
+                          RampPlan &p, uint32_t *cruiseDelay) {
+  if (intervals < startLevel) return false;
+
+  // Симметричный профиль: разгон (peak - L) + крейсер + торможение peak = intervals
+  uint32_t peak = (intervals + startLevel) / 2;
+  bool limited = false;
+  if (peak >= top) {
+    peak = top;
+    limited = true;
+  }
+  if (peak < startLevel) peak = startLevel;  // maxSpeed уменьшили на ходу — не разгоняемся
+
+  if (limited && peak == top) {
+    *cruiseDelay = topDelay;
+  } else {
+    *cruiseDelay = table[peak ? peak - 1 : 0];
+  }
+  p.accelSteps  = peak - startLevel;
+  p.cruiseSteps = intervals - p.accelSteps - peak;
+  p.decelSteps  = peak;
+  p.accelUs     = levelUs(peak) - levelUs(startLevel);
+  p.cruiseUs    = p.cruiseSteps * *cruiseDelay;
+  p.decelUs     = levelUs(peak);
+  planSetTotal(p);
+  return true;
+}
+
+// Трапеция: потолок — уровень крейсерской maxSpeed в таблице AVR446
+static bool trapezoidPlan(uint32_t intervals, uint32_t maxSpeed, uint32_t startLevel,
+                          RampPlan &p, uint32_t *cruiseDelay) {
+  uint32_t limitDelay;
+  uint32_t limitLevel = levelForSpeed(maxSpeed, &limitDelay);
+  return planFromLevel(intervals, startLevel, limitLevel, limitDelay, g_table, trapezoidLevelUs, p, cruiseDelay);
+}
+
+// ----------------------------------------------------------
+// S-кривая (7 участков: рывок +J, ускорение A, рывок -J, крейсер, и зеркально).
+// Половина разгона до скорости V при ускорении A и рывке J:
+//   V*J >= A^2:  Tj = A/J,        Ta = Tj + V/A   (есть участок постоянного A)
+//   V*J <  A^2:  Tj = sqrt(V/J),  Ta = 2*Tj       (A не достигается)
+// Путь разгона sa = V*Ta/2, время поездки T = 2*Ta + (D - 2*sa)/V.
+
+struct SCurve {
+  float v;   // пиковая скорость, шаг/с
+  float ap;  // пиковое ускорение, шаг/с^2
+  float tj;  // длительность участка рывка, с
+  float ta;  // длительность разгона, с
+  float sa;  // путь разгона, шагов
+};
+
+static void sCurveForSpeed(float v, float a, float j, SCurve *c) {
+  c->v = v;
+  if (v * j >= a * a) {
+    c->tj = a / j;
+    c->ta = c->tj + v / a;
+  } else {
+    c->tj = sqrtf(v / j);
+    c->ta = 2.0f * c->tj;
+  }
+  c->ap = j * c->tj;
+  c->sa = v * c->ta * 0.5f;
+}
+
+// Пиковая скорость, при которой разгон + торможение занимают ровно d шагов
+static float sCurvePeakForDistance(float d, float a, float j) {
+  // С участком постоянного A: V^2/A + V*A/J - d = 0
+  float v = 0.5f * a * (sqrtf(a * a / (j * j) + 4.0f * d / a) - a / j);
+  if (v * j < a * a) {
+    // A не достигается: d = 2 * V^1.5 / sqrt(J)
+    v = powf(d * sqrtf(j) * 0.5f, 2.0f / 3.0f);
+  }
+  return v;
+}
+
+// Момент (с от начала разгона), когда пройден путь x шагов
+static float sCurveTimeAt(const SCurve &c, float x) {
+  float s1 = c.ap * c.tj * c.tj / 6.0f;  // конец участка +J
+  float v1 = c.ap * c.tj * 0.5f;
+  float tc = c.ta - 2.0f * c.tj;          // участок постоянного ускорения
+  float s2 = s1 + v1 * tc + c.ap * tc * tc * 0.5f;
+
+  if (x <= s1) {
+    return cbrtf(6.0f * x * c.tj / c.ap);  // s = J*t^3/6
+  }
+  if (x <= s2) {
+    float dx = x - s1;
+    return c.tj + (sqrtf(v1 * v1 + 2.0f * c.ap * dx) - v1) / c.ap;
+  }
+  if (x < c.sa) {
+    // Участок -J от конца разгона: sa - x = V*u - J*u^3/6, u = Ta - t.
+    // Функция вогнутая и растущая — Ньютон из u0 = (sa-x)/V сходится снизу.
+    float j = c.ap / c.tj;
+    float r = c.sa - x;
+    float u = r / c.v;
+    for (int i = 0; i < 4; i++) {
+      float f  = c.v * u - j * u * u * u / 6.0f - r;
+      float df = c.v - j * u * u * 0.5f;
+      u -= f / df;
+    }
+    if (u > c.tj) u = c.tj;
+    return c.ta - u;
+  }
+  return c.ta + (x - c.sa) / c.v;
+}
+
+// Участки S-кривой с места на intervals (> 0) промежутков; c — профиль для таблицы
+static void sCurvePlan(uint32_t intervals, uint32_t maxSpeed, SCurve &c, RampPlan &p,
+                       uint32_t *cruiseDelay) {
+  float a = (float)g_accel;
+  float j = (float)g_jerk;
+  float d = (float)intervals;
+
+  // Скорость ограничена maxSpeed, длиной поездки и длиной таблицы
+  float v = (float)maxSpeed;
+  float vDist = sCurvePeakForDistance(d, a, j);
+  if (vDist < v) v = vDist;
+  float vTable = sCurvePeakForDistance(2.0f * RAMP_TABLE_LEN, a, j);
+  if (vTable < v) v = vTable;
+
+  sCurveForSpeed(v, a, j, &c);
+
+  uint32_t steps = (uint32_t)(c.sa + 0.5f);
+  if (steps > intervals / 2) steps = intervals / 2;
+  if (steps > RAMP_TABLE_LEN) steps = RAMP_TABLE_LEN;
+
+  *cruiseDelay  = (uint32_t)(1000000.0f / v + 0.5f);
+  p.accelSteps  = steps;
+  p.cruiseSteps = intervals - 2 * steps;
+  p.decelSteps  = steps;
+  if (steps) {
+    p.accelUs  = usFromSec(c.ta);
+    p.cruiseUs = usFromSec((d - 2.0f * c.sa) / v);
+    p.decelUs  = p.accelUs;
+  } else {
+    p.accelUs  = 0;
+    p.cruiseUs = *cruiseDelay * p.cruiseSteps;  // 1-2 шага: одна задержка, разгона нет
+    p.decelUs  = 0;
+  }
+  planSetTotal(p);
+}
+
+// Профиль S-кривой текущей поездки: время торможения и перепланирование на ходу.
+// g_sTable построена до g_sPeak — выше этого уровня профиль поездки не разгоняется.
+static SCurve   g_sCurve;
+static uint32_t g_sPeak      = 0;
+static uint32_t g_sPeakDelay = 0;
+
+// Время n шагов по таблице S-кривой с места (сумма g_sTable[0..n-1]), мкс
+static uint32_t sCurveLevelUs(uint32_t n) {
+  return n ? usFromSec(sCurveTimeAt(g_sCurve, (float)n)) : 0;
+}
+
+// Поездка S-кривой с места на intervals промежутков между шагами
+static void planSCurve(uint32_t intervals, uint32_t maxSpeed) {
+  g_active     = g_sTable;
+  g_level      = 0;
+  g_jog        = false;
+  if (intervals == 0) {
+    g_accelLeft  = 0;
+    g_cruiseLeft = 0;
+    memset(&g_plan, 0, sizeof(g_plan));
+    return;
+  }
+
+  SCurve &c = g_sCurve;
+  uint32_t cruiseDelay;
+  sCurvePlan(intervals, maxSpeed, c, g_plan, &cruiseDelay);
+  uint32_t steps = g_plan.accelSteps;
+
+  // Задержки — разности округлённых моментов шагов: сумма таблицы не копит ошибку
+  uint32_t prevUs = 0;
+  for (uint32_t n = 0; n < steps; n++) {
+    uint32_t tUs = (uint32_t)(sCurveTimeAt(c, (float)(n + 1)) * 1000000.0f + 0.5f);
+    uint32_t dUs = tUs - prevUs;
+    g_sTable[n] = dUs ? dUs : 1;
+    prevUs = tUs;
+  }
+
+  g_accelLeft   = steps;
+  g_cruiseLeft  = g_plan.cruiseSteps;
+  g_cruiseDelay = cruiseDelay;
+  g_sPeak       = steps;
+  g_sPeakDelay  = cruiseDelay;
+}
+
+// ----------------------------------------------------------
+
+bool rampPlanMove(uint32_t distance, uint32_t maxSpeed, uint32_t startLevel) {
+  if (distance == 0) return startLevel == 0;
+
+  if (g_profile == RAMP_SCURVE && startLevel == 0) {
+    planSCurve(distance - 1, maxSpeed);
+    return true;
+  }
+
+  uint32_t intervals = distance - 1;  // первый шаг — сразу / уже запланирован
+  RampPlan p;
+  uint32_t cruiseDelay;
+  if (startLevel != 0 && g_active == g_sTable) {
+    // На ходу по S-кривой — по её же таблице: новый путь, тот же пик, без остановки
+    if (!planFromLevel(intervals, startLevel, g_sPeak, g_sPeakDelay, g_sTable, sCurveLevelUs, p, &cruiseDelay)) {
+      return false;
+    }
+    g_plan        = p;
+    g_accelLeft   = p.accelSteps;
+    g_cruiseLeft  = p.cruiseSteps;
+    g_cruiseDelay = cruiseDelay;
+    g_jog         = false;
+    return true;
+  }
+  // С места или на ходу по таблице AVR446 (трапеция, ручной разгон)
+  if (!trapezoidPlan(intervals, maxSpeed, startLevel, p, &cruiseDelay)) return false;
+
+  g_active      = g_table;
+  g_plan        = p;
+  g_level       = startLevel;
+  g_accelLeft   = p.accelSteps;
+  g_cruiseLeft  = p.cruiseSteps;
+  g_cruiseDelay = cruiseDelay;
+  g_jog         = false;
+  return true;
+}
+
+void rampEstimateMove(uint32_t distance, uint32_t maxSpeed, RampPlan &out) {
+  memset(&out, 0, sizeof(out));
+  if (distance <= 1) return;
+  uint32_t cruiseDelay;
+  if (g_profile == RAMP_SCURVE) {
+    SCurve c;
+    sCurvePlan(distance - 1, maxSpeed, c, out, &cruiseDelay);
+  } else {
+    trapezoidPlan(distance - 1, maxSpeed, 0, out, &cruiseDelay);
+  }
+}
+
+void rampPlanJog(uint32_t speed, uint32_t startLevel) {
+  uint32_t limitDelay;
+  uint32_t peak = levelForSpeed(speed, &limitDelay);
+  if (peak < startLevel) {
+    peak = startLevel;
+    limitDelay = g_table[peak - 1];
+  }
+
+  g_active      = g_table;
+  memset(&g_plan, 0, sizeof(g_plan));
+  g_level       = startLevel;
+  g_accelLeft   = peak - startLevel;
+  g_cruiseLeft  = 1;  // в режиме jog не уменьшается
+  g_cruiseDelay = limitDelay;
+  g_jog         = true;
+}
+
+void rampPlanStop() {
+  g_accelLeft  = 0;
+  g_cruiseLeft = 0;
+  g_jog        = false;
+
+  // Торможение — те же задержки c_{L-1}..c_0: по трапеции или по моментам шагов S-кривой
+  uint32_t level = g_level;
+  memset(&g_plan, 0, sizeof(g_plan));
+  g_plan.decelSteps = level;
+  g_plan.decelUs = (g_active == g_table) ? trapezoidLevelUs(level) : sCurveLevelUs(level);
+  planSetTotal(g_plan);
+}
+
+void rampReset() {
+  g_accelLeft  = 0;
+  g_cruiseLeft = 0;
+  g_jog        = false;
+  g_level      = 0;
+  g_lastDelay  = 0;
+  memset(&g_plan, 0, sizeof(g_plan));
+}
+
+uint32_t IRAM_ATTR rampNextInterval() {
+  uint32_t d;
+  if (g_accelLeft) {
+    g_accelLeft = g_accelLeft - 1;
+    d = g_active[g_level];
+    g_level = g_level + 1;
+  } else if (g_cruiseLeft) {
+    if (!g_jog) g_cruiseLeft = g_cruiseLeft - 1;
+    d = g_cruiseDelay;
+  } else if (g_level) {
+    // Торможение: c_{L-1}, ..., c_0 — ровно L шагов с текущей скорости
+    g_level = g_level - 1;
+    d = g_active[g_level];
+  } else {
+    d = 0;
+  }
+  g_lastDelay = d;
+  return d;
+}
+
+uint32_t rampGetLevel() {
+  return g_level;
+}
+
+uint32_t rampGetCurrentIntervalUs() {
+  return g_lastDelay;
+}
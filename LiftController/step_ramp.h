@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+
+// Разгонная кривая шагового мотора по рекурренте D. Austin (AVR446):
+//   c0 = 0.676 * sqrt(2 / a),   c_n = c_{n-1} - 2 * c_{n-1} / (4n + 1)
+// Таблица задержек c_n считается один раз на значение ускорения, число шагов
+// разгона / крейсера / торможения — один раз на поездку (rampPlan*).
+// На каждом шаге (rampNextInterval) — только декременты, сравнения и чтение таблицы.
+//
+// «Уровень» скорости L = число пройденных шагов разгона: текущая задержка c_{L-1},
+// и с этой скорости до остановки ровно L шагов.
+//
+// Режим S-кривой: ускорение нарастает и спадает с ограниченным рывком (jerk).
+// Таблица задержек строится на каждую поездку под её пиковую скорость,
+// торможение — та же таблица в обратном порядке, так что шаговый путь прежний.
+
+enum RampProfile : uint8_t {
+  RAMP_TRAPEZOID,  // постоянное ускорение (AVR446)
+  RAMP_SCURVE      // ограниченный рывок
+};
+
+void     rampInit();
+void     rampSetAccel(uint32_t accelStepsPerSec2);  // только на стоящем моторе
+uint32_t rampGetAccel();
+
+void        rampSetProfile(RampProfile profile);     // только на стоящем моторе
+RampProfile rampGetProfile();
+void        rampSetJerk(uint32_t jerkStepsPerSec3);
+uint32_t    rampGetJerk();
+
+// План поездки на distance шагов (первый шаг тоже считается) с крейсерской maxSpeed,
+// начиная с уровня startLevel (0 = с места).
+// false — с этой скорости не затормозить за distance шагов (план не меняется).
+// На ходу профиль продолжается по той таблице, по которой едем: S-кривая — по таблице своей
+// поездки (выше её пика не разгоняется), трапеция и ручной разгон — по AVR446.
+bool rampPlanMove(uint32_t distance, uint32_t maxSpeed, uint32_t startLevel);
+// Участки поездки и их длительность — по формулам, без прохода по таблице задержек.
+// Шаги — промежутки между шагами: первый шаг поездки выдаётся сразу.
+struct RampPlan {
+  uint32_t accelSteps;
+  uint32_t cruiseSteps;
+  uint32_t decelSteps;
+  uint32_t accelUs;
+  uint32_t cruiseUs;
+  uint32_t decelUs;
+  uint32_t totalUs;
+};
+// План последней rampPlanMove() / rampPlanStop(); после rampPlanJog() и rampReset() — нули
+void rampGetPlan(RampPlan &out);
+uint32_t rampGetPlannedMoveUs();  // rampGetPlan().totalUs
+// План поездки с места на distance шагов, не трогая текущий профиль (для оценки времени)
+void rampEstimateMove(uint32_t distance, uint32_t maxSpeed, RampPlan &out);
+// Ручной режим: разгон до speed и движение без конца, пока не вызовут rampPlanStop().
+// Всегда трапеция — ручные скорости малы.
+void rampPlanJog(uint32_t speed, uint32_t startLevel);
+// Торможение с текущей скорости (rampGetLevel() шагов)
+void rampPlanStop();
+// Мгновенно забыть профиль (уровень 0)
+void rampReset();
+
+// Шаговый путь, можно из ISR: задержка в мкс до следующего шага, 0 = профиль закончен
+uint32_t rampNextInterval();
+
+uint32_t rampGetLevel();
+uint32_t rampGetCurrentIntervalUs();  // последняя выданная задержка, 0 = стоим
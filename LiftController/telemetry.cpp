@@ -0,0 +1,157 @@
+#include "telemetry.h"
+#include "telemetry_frame.h"
+#include "spsc_queue.h"
+#include "motor_controller.h"
+#include "state_machine.h"
+#include "logger.h"
+#include <atomic>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_cpu.h>
+#endif
+
+// Выборок в кольце (степень двойки): ~0.5 с при 1 кГц сверх того, что успевает UART
+static const uint16_t TELEM_RING_SIZE = 512;
+
+// Выборка с номером: по номерам задача связи режет кадры (в кадре — только подряд идущие)
+struct TelemEntry {
+  uint32_t    seq;
+  TelemSample s;
+};
+
+static SpscQueue<TelemEntry, TELEM_RING_SIZE> g_ring;
+
+// ---- сторона движения (пишет) ----
+static std::atomic<uint16_t> g_rateHz{0};
+static uint16_t g_lastRateHz = 0;
+static uint32_t g_periodUs   = 0;
+static uint32_t g_nextDueUs  = 0;
+static uint32_t g_nextSeq    = 0;
+static bool     g_havePrev   = false;
+static uint32_t g_prevUs     = 0;
+static long     g_prevPos    = 0;
+static uint32_t g_costMax    = 0;   // такты CPU на выборку
+static uint64_t g_costSum    = 0;
+static uint32_t g_dropBase   = 0;   // overflowCount() на старте записи
+
+// ---- сторона связи (читает) ----
+static std::atomic<uint32_t> g_framesSent{0};
+static uint8_t  g_frame[TELEM_FRAME_MAX];
+static uint16_t g_frameLen = 0;     // собранный кадр, ждущий места в TX FIFO
+
+static inline uint32_t telemCycles() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return (uint32_t)esp_cpu_get_cycle_count();
+#else
+  return 0;  // в симуляторе время виртуальное — цену выборки не измерить
+#endif
+}
+
+static inline int16_t clampI16(long v) {
+  return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+void telemetryStart(uint16_t rateHz) {
+  if (rateHz == 0 || rateHz > TELEM_RATE_MAX) return;
+  g_periodUs  = 1000000UL / rateHz;
+  g_nextDueUs = micros();
+  g_nextSeq   = 0;
+  g_havePrev  = false;
+  g_costMax   = 0;
+  g_costSum   = 0;
+  g_dropBase  = g_ring.overflowCount();
+  g_lastRateHz = rateHz;
+  g_framesSent.store(0, std::memory_order_relaxed);
+  g_rateHz.store(rateHz, std::memory_order_relaxed);
+  LOG(TELEM_START, rateHz, TELEM_RING_SIZE);
+}
+
+void telemetryStop() {
+  // Остаток кольца задача связи дошлёт сама
+  g_rateHz.store(0, std::memory_order_relaxed);
+  LOG(TELEM_STOP, g_nextSeq, g_ring.overflowCount() - g_dropBase);
+}
+
+bool telemetryIsRunning() {
+  return g_rateHz.load(std::memory_order_relaxed) != 0;
+}
+
+void telemetrySample(uint32_t passUs) {
+  if (g_rateHz.load(std::memory_order_relaxed) == 0) return;
+  uint32_t now = micros();
+  if ((int32_t)(now - g_nextDueUs) < 0) return;
+  // Опоздали больше чем на период (задачу задержали) — без навёрстывания пачкой
+  g_nextDueUs = ((now - g_nextDueUs) >= g_periodUs) ? now + g_periodUs : g_nextDueUs + g_periodUs;
+
+  uint32_t c0 = telemCycles();
+  TelemEntry e;
+  e.seq = g_nextSeq++;
+  long pos = motorGetCurrentPosition();
+  e.s.tUs      = now;
+  e.s.position = (int32_t)pos;
+  e.s.target   = (int32_t)motorGetTargetPosition();
+  e.s.cmdSpeed = clampI16(motorGetSpeed());
+  e.s.actSpeed = 0;
+  if (g_havePrev && now != g_prevUs) {
+    e.s.actSpeed = clampI16((long)(((int64_t)(pos - g_prevPos) * 1000000) / (int32_t)(now - g_prevUs)));
+  }
+  e.s.loopUs = (uint16_t)(passUs > 65535 ? 65535 : passUs);
+  e.s.state  = (uint8_t)smGetState();
+  e.s.flags  = motorIsBusy() ? TELEM_FLAG_BUSY : 0;
+  g_havePrev = true;
+  g_prevUs   = now;
+  g_prevPos  = pos;
+  g_ring.push(e);  // полно — выборка считается в overflowCount(), номер уже занят
+
+  uint32_t cost = telemCycles() - c0;
+  g_costSum += cost;
+  if (cost > g_costMax) g_costMax = cost;
+}
+
+// Следующий кадр из кольца: до TELEM_FRAME_SAMPLES выборок с номерами подряд
+static bool buildFrame() {
+  TelemSample samples[TELEM_FRAME_SAMPLES];
+  const TelemEntry *e = g_ring.peek();
+  if (!e) return false;
+  uint32_t first = e->seq;
+  uint8_t n = 0;
+  while (e && n < TELEM_FRAME_SAMPLES && e->seq == first + n) {
+    samples[n++] = e->s;
+    g_ring.drop();
+    e = g_ring.peek();
+  }
+  g_frameLen = telemFrameBuild(g_frame, first, samples, n);
+  return true;
+}
+
+void telemetryService() {
+  // Кадр — только полный: идёт запись, а выборок на кадр ещё нет — ждём следующего прохода
+  for (;;) {
+    if (g_frameLen == 0) {
+      if (telemetryIsRunning() && g_ring.size() < TELEM_FRAME_SAMPLES) return;
+      if (!buildFrame()) return;
+    }
+    // Кадр целиком или никак: Serial.write() не должен ждать UART, текст лога не рвёт кадр
+    if ((size_t)Serial.availableForWrite() < g_frameLen) return;
+    Serial.write(g_frame, g_frameLen);
+    g_frameLen = 0;
+    g_framesSent.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void telemetryGetStatus(TelemetryStatus &out) {
+  uint32_t taken = g_nextSeq;
+  out.samples = taken;
+  out.frames  = g_framesSent.load(std::memory_order_relaxed);
+  out.dropped = g_ring.overflowCount() - g_dropBase;
+  out.costAvg = taken ? (uint32_t)(g_costSum / taken) : 0;
+  out.costMax = g_costMax;
+  out.rateHz  = g_lastRateHz;
+  out.running = telemetryIsRunning() ? 1 : 0;
+}
+
+void telemetryPrintStatus(const TelemetryStatus &s, Print &out) {
+  out.printf("[TELEM] %s %u Hz, samples %lu, frames %lu, dropped %lu, sample cost avg %lu max %lu cycles\r\n",
+             s.running ? "on" : "off", s.rateHz, (unsigned long)s.samples, (unsigned long)s.frames,
+             (unsigned long)s.dropped, (unsigned long)s.costAvg, (unsigned long)s.costMax);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+
+// Телеметрия движения для разбора на ПК (команда TELEMETRY <hz>).
+// Задача движения в конце прохода кладёт выборку (позиция, цель, заданная и реальная
+// скорость, состояние, длительность прохода) в заранее выделенное кольцо — без Serial,
+// без форматирования и без кучи. Задача связи собирает из кольца двоичные кадры
+// (telemetry_frame.h) и пишет их в Serial, только когда кадр целиком влезает в TX FIFO.
+// Кольцо полно (UART 115200 не успевает за частотой) → выборка отбрасывается и считается,
+// номер выборки всё равно растёт — на ПК пропуск виден.
+
+static const uint16_t TELEM_RATE_MAX = 1000;  // Гц: задача движения проходит раз в тик 1 мс
+
+void telemetryStart(uint16_t rateHz);   // 1..TELEM_RATE_MAX; заново — с нулевого номера
+void telemetryStop();
+bool telemetryIsRunning();
+
+void telemetrySample(uint32_t passUs);  // из задачи движения, в конце прохода (passUs — его длительность)
+void telemetryService();                // из задачи связи: кадры в свободное место TX FIFO
+
+// STATUS: снимает задача движения (её счётчики), печатает задача связи
+struct TelemetryStatus {
+  uint32_t samples;
+  uint32_t frames;
+  uint32_t dropped;
+  uint32_t costAvg;   // такты CPU на выборку
+  uint32_t costMax;
+  uint16_t rateHz;    // последняя заданная частота
+  uint8_t  running;
+};
+void telemetryGetStatus(TelemetryStatus &out);
+void telemetryPrintStatus(const TelemetryStatus &s, Print &out);
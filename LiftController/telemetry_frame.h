@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "lift_protocol.h"
+
+// Двоичные кадры телеметрии движения (команда TELEMETRY) в том же UART, что и текстовый лог.
+//
+// Кадр: [A5][5A][версия][N][seq, 4 байта][N выборок TelemSample][CRC-16 CCITT, little-endian]
+//   seq — номер первой выборки кадра; номера идут подряд с TELEMETRY <hz>, в том числе
+//   через выборки, выброшенные при полном кольце, — пропуск виден как скачок seq.
+//   CRC — от байта версии до последней выборки (liftCrc16, как в кадрах пульта).
+//
+// Байт A5 в тексте не встречается (лог — ASCII), так что разборщик на ПК ищет A5 5A,
+// проверяет длину и CRC и всё, что не кадр, считает текстом. Битый кадр — поиск со
+// следующего байта. Кадр целиком влезает в TX FIFO UART (128 байт) и пишется одним write().
+//
+// Заголовок без Arduino — его же берёт разборщик (sim/telemetry_decode.cpp).
+// Поля little-endian, структуры без выравнивания; изменение формата — с TELEM_VERSION.
+
+static const uint8_t TELEM_SYNC0   = 0xA5;
+static const uint8_t TELEM_SYNC1   = 0x5A;
+static const uint8_t TELEM_VERSION = 1;
+
+// Бит TelemSample::flags
+static const uint8_t TELEM_FLAG_BUSY = 0x01;  // motorIsBusy(): едем, ручной режим или тормозим
+
+struct LIFT_PACKED TelemSample {
+  uint32_t tUs;        // micros() в момент выборки
+  int32_t  position;   // шагов, выданные на мотор к этому моменту
+  int32_t  target;     // цель мотора, шагов
+  int16_t  cmdSpeed;   // заданная профилем скорость, шагов/сек со знаком
+  int16_t  actSpeed;   // по позиции с прошлой выборки, шагов/сек со знаком
+  uint16_t loopUs;     // длительность прохода задачи движения, мкс (насыщается на 65535)
+  uint8_t  state;      // LiftState
+  uint8_t  flags;      // TELEM_FLAG_*
+};
+
+struct LIFT_PACKED TelemFrameHeader {
+  uint8_t  sync[2];
+  uint8_t  version;
+  uint8_t  count;      // выборок в кадре
+  uint32_t seq;        // номер первой выборки
+};
+
+// Выборок в кадре: заголовок + выборки + CRC не больше TX FIFO
+static const uint8_t TELEM_FRAME_SAMPLES = 5;
+static const uint8_t TELEM_FRAME_MAX =
+  sizeof(TelemFrameHeader) + TELEM_FRAME_SAMPLES * sizeof(TelemSample) + 2;
+
+static_assert(sizeof(TelemSample) == 20, "TelemSample layout changed: bump TELEM_VERSION");
+static_assert(TELEM_FRAME_MAX <= 128, "telemetry frame must fit the UART TX FIFO");
+
+static inline uint16_t telemFrameLength(uint8_t count) {
+  return (uint16_t)(sizeof(TelemFrameHeader) + count * sizeof(TelemSample) + 2);
+}
+
+// Собрать кадр в buf (не меньше TELEM_FRAME_MAX). Возвращает длину.
+static inline uint16_t telemFrameBuild(uint8_t *buf, uint32_t seq, const TelemSample *samples, uint8_t count) {
+  TelemFrameHeader h;
+  h.sync[0] = TELEM_SYNC0;
+  h.sync[1] = TELEM_SYNC1;
+  h.version = TELEM_VERSION;
+  h.count   = count;
+  h.seq     = seq;
+  memcpy(buf, &h, sizeof(h));
+  memcpy(buf + sizeof(h), samples, count * sizeof(TelemSample));
+  uint16_t body = (uint16_t)(sizeof(h) + count * sizeof(TelemSample));
+  uint16_t crc  = liftCrc16(buf + 2, (uint16_t)(body - 2));
+  buf[body]     = (uint8_t)(crc & 0xFF);
+  buf[body + 1] = (uint8_t)(crc >> 8);
+  return (uint16_t)(body + 2);
+}
+
+// Проверить кадр в начале buf (len — сколько байт есть). Возвращает длину кадра,
+// 0 — здесь не кадр (нет синхро, чужая версия, неверный N или CRC), -1 — кадр ещё не дочитан.
+static inline int telemFrameCheck(const uint8_t *buf, size_t len) {
+  if (len < 1 || buf[0] != TELEM_SYNC0) return 0;
+  if (len < 2) return -1;
+  if (buf[1] != TELEM_SYNC1) return 0;
+  if (len < 4) return -1;
+  if (buf[2] != TELEM_VERSION || buf[3] == 0 || buf[3] > TELEM_FRAME_SAMPLES) return 0;
+  uint16_t total = telemFrameLength(buf[3]);
+  if (len < total) return -1;
+  uint16_t crc = (uint16_t)(buf[total - 2] | (buf[total - 1] << 8));
+  if (liftCrc16(buf + 2, (uint16_t)(total - 4)) != crc) return 0;
+  return total;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// Кнопки пульта: фронты из прерываний GPIO -> события нажатия.
+//
+// Прерывание только кладёт фронт (кнопка, уровень, время) в очередь. Здесь, в loop(),
+// каждый фронт проходит автомат подавления дребезга по меткам времени:
+//  - первый фронт, меняющий состояние, принимается сразу (нажатие уходит без задержки);
+//  - следующие BTN_DEBOUNCE_US фронты этой кнопки — дребезг, не считаются;
+//  - в конце окна уровень перечитывается: если кнопку уже отпустили (короткое касание),
+//    отпускание выдаётся тогда — оно не теряется и не дублируется;
+//  - вне окна tick() сверяет уровень с состоянием: фронт, потерянный при переполнении
+//    очереди или пришедший между разбором очереди и tick(), не оставит кнопку «залипшей».
+// Удержание: BTN_LONG после BTN_LONG_US, дальше BTN_REPEAT каждые BTN_REPEAT_US.
+//
+// Логика не знает про GPIO и часы: время и уровень передаются параметрами, поэтому
+// гоняется на Linux (sim/button_test.cpp).
+
+static const uint32_t BTN_DEBOUNCE_US = 30000;    // окно дребезга после смены состояния
+static const uint32_t BTN_LONG_US     = 800000;   // удержание до BTN_LONG
+static const uint32_t BTN_REPEAT_US   = 200000;   // период BTN_REPEAT после BTN_LONG
+
+// Фронт из прерывания
+struct ButtonEdge {
+  uint8_t  button;   // индекс кнопки
+  uint8_t  pressed;  // уровень после фронта: 1 — нажата
+  uint32_t atUs;
+};
+
+enum ButtonEventType : uint8_t {
+  BTN_PRESS,
+  BTN_RELEASE,
+  BTN_LONG,
+  BTN_REPEAT
+};
+
+typedef void (*ButtonEventFn)(uint8_t button, ButtonEventType type, uint32_t atUs, void *ctx);
+
+struct ButtonDebouncer {
+  bool     pressed;       // подтверждённое состояние
+  bool     lockout;       // идёт окно дребезга
+  bool     longSent;
+  uint32_t changedUs;     // когда сменилось подтверждённое состояние
+  uint32_t nextRepeatUs;
+  uint32_t bounces;       // отброшено фронтов
+
+  void reset(bool pressedNow) {
+    memset(this, 0, sizeof(*this));
+    pressed = pressedNow;
+  }
+
+  // Фронт из очереди прерываний
+  void onEdge(uint8_t button, bool level, uint32_t atUs, ButtonEventFn fn, void *ctx) {
+    // Со знаком: фронт старше смены состояния (tick() успел раньше очереди) — тоже дребезг
+    if (lockout && (int32_t)(atUs - changedUs) < (int32_t)BTN_DEBOUNCE_US) {
+      bounces++;
+      return;
+    }
+    lockout = false;
+    if (level == pressed) {
+      bounces++;   // пропущенный парный фронт — уровень не изменился
+      return;
+    }
+    change(button, level, atUs, fn, ctx);
+  }
+
+  // Из loop(): конец окна дребезга, удержание и повтор. levelNow — уровень пина сейчас.
+  void tick(uint8_t button, bool levelNow, uint32_t nowUs, ButtonEventFn fn, void *ctx) {
+    if (lockout && (uint32_t)(nowUs - changedUs) >= BTN_DEBOUNCE_US) lockout = false;
+    // Фронт в окне был проглочен (или потерян) — итог по уровню
+    if (!lockout && levelNow != pressed) change(button, levelNow, nowUs, fn, ctx);
+    if (!pressed) return;
+    if (!longSent && (uint32_t)(nowUs - changedUs) >= BTN_LONG_US) {
+      longSent     = true;
+      nextRepeatUs = nowUs + BTN_REPEAT_US;
+      fn(button, BTN_LONG, nowUs, ctx);
+    } else if (longSent && (int32_t)(nowUs - nextRepeatUs) >= 0) {
+      nextRepeatUs += BTN_REPEAT_US;
+      fn(button, BTN_REPEAT, nowUs, ctx);
+    }
+  }
+
+  // Через сколько мкс tick() что-то сделает; UINT32_MAX — ничего не ждём
+  uint32_t usUntilDeadline(uint32_t nowUs) const {
+    uint32_t best = UINT32_MAX;
+    if (lockout) best = remaining(changedUs + BTN_DEBOUNCE_US, nowUs);
+    if (pressed) {
+      uint32_t d = longSent ? remaining(nextRepeatUs, nowUs) : remaining(changedUs + BTN_LONG_US, nowUs);
+      if (d < best) best = d;
+    }
+    return best;
+  }
+
+  static uint32_t remaining(uint32_t atUs, uint32_t nowUs) {
+    int32_t d = (int32_t)(atUs - nowUs);
+    return d > 0 ? (uint32_t)d : 0;
+  }
+
+  void change(uint8_t button, bool level, uint32_t atUs, ButtonEventFn fn, void *ctx) {
+    pressed   = level;
+    lockout   = true;
+    changedUs = atUs;
+    longSent  = false;
+    fn(button, level ? BTN_PRESS : BTN_RELEASE, atUs, ctx);
+  }
+};
@@ -0,0 +1,300 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// Протокол база <-> пульт поверх ESP-NOW.
+// ФАЙЛ ОДИНАКОВЫЙ в LiftController/ и remote/ (make -C sim check-shared).
+//
+// Кадр:   [LIFT_PROTO_MAGIC][версия][N][записи, N байт][CRC-16 CCITT, little-endian]
+// Запись: [тип MsgType][длина L][L байт]
+//
+// В одном кадре — сколько угодно записей (статус + ACK + текст, несколько команд).
+// Кадр проверяется целиком (магия, версия, длина, CRC, границы всех записей) до того,
+// как отдать хоть одну запись. Записи читаются на месте: указатель на упакованную
+// структуру прямо в буфере приёма, без копирования.
+// Неизвестный тип записи пропускается — новое сообщение не ломает старую сторону;
+// изменение существующей структуры — только вместе с LIFT_PROTO_VERSION.
+// Все поля little-endian (ESP32 и хост симулятора), структуры без выравнивания.
+
+static const uint8_t LIFT_PROTO_MAGIC   = 0x4C;  // 'L'
+static const uint8_t LIFT_PROTO_VERSION = 3;     // 1 — голые структуры без заголовка (до кадров), 2 — статус без etaMs
+static const uint8_t LIFT_FRAME_MAX     = 250;   // ESP_NOW_MAX_DATA_LEN
+static const uint8_t LIFT_TEXT_MAX      = 64;    // MSG_TEXT, байт без нуля
+
+#define LIFT_PACKED __attribute__((packed))
+
+// ---------------- общие перечисления ----------------
+
+// Команды пульт -> база
+enum CommandType : uint8_t {
+  CMD_NONE             = 0,
+  CMD_CALL_FLOOR       = 1, // arg = номер этажа 1..floorCount
+  CMD_STOP             = 2,
+  CMD_CALIB            = 3,
+  CMD_CALIB_DOWN_START = 4,
+  CMD_CALIB_DOWN_SAVE  = 5,
+  CMD_MANUAL_UP        = 6,
+  CMD_MANUAL_DOWN      = 7,
+  CMD_MANUAL_STOP      = 8,
+  CMD_STATUS_REQUEST   = 9, // пульт проснулся: полный статус, не ждать heartbeat
+  CMD_ESTOP            = 10 // аварийный стоп: шаги сразу, без торможения (CMD_STOP — с торможением)
+};
+
+// Состояния лифта (автомат базы, в статусе — как есть)
+enum LiftState : uint8_t {
+  STATE_BOOT,
+  STATE_NEED_CALIB,
+  STATE_CALIB_HOMING_UP,
+  STATE_CALIB_MOVING_DOWN,
+  STATE_IDLE,
+  STATE_MOVING,
+  STATE_MANUAL_MOVE,
+  STATE_ERROR,
+  STATE_VERIFY_HOMING   // после загрузки калибровки из NVS: сверка позиции по верхнему концевику
+};
+
+// Ответ базы на команду
+enum AckStatus : uint8_t {
+  LINK_ACK_OK        = 0,   // принята и поставлена в очередь
+  LINK_ACK_DUPLICATE = 1    // уже была, не выполняется повторно
+};
+
+// Типы записей
+enum MsgType : uint8_t {
+  MSG_COMMAND = 1,   // RemoteCommand, пульт -> база
+  MSG_ACK     = 2,   // CommandAck,    база -> пульт
+  MSG_STATUS  = 3,   // LiftStatus,    база -> пульт
+  MSG_MOTION  = 4,   // LiftMotion,    база -> пульт (на ходу между статусами)
+  MSG_TEXT    = 5    // строка до LIFT_TEXT_MAX байт (без нуля), любая сторона
+};
+
+// ---------------- сообщения ----------------
+
+struct LIFT_PACKED WireHeader {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t length;    // байт записей
+};
+
+struct LIFT_PACKED TlvHeader {
+  uint8_t type;      // MsgType
+  uint8_t length;
+};
+
+struct LIFT_PACKED RemoteCommand {
+  uint8_t  type;     // CommandType
+  uint8_t  arg;      // этаж (1..floorCount) или 0
+  uint16_t seq;      // номер для ACK и отсева повторов
+};
+
+struct LIFT_PACKED CommandAck {
+  uint16_t seq;
+  uint8_t  type;     // CommandType подтверждаемой команды
+  uint8_t  status;   // AckStatus
+};
+
+struct LIFT_PACKED LiftStatus {
+  uint8_t  state;         // LiftState
+  uint8_t  currentFloor;
+  uint8_t  targetFloor;
+  int8_t   direction;     // 1=вверх, -1=вниз, 0=стоит
+  uint8_t  error;
+  uint8_t  speedPercent;  // от крейсерской скорости, 0..100
+  uint8_t  needCalib;
+  uint32_t uptimeMs;
+  uint16_t pendingCalls;  // бит n = есть вызов на этаж n
+  uint8_t  floorCount;    // этажей всего (1..floorCount)
+  uint32_t etaMs;         // до прибытия по плану поездки, мс (0 — стоит), отсчёт — от отправки статуса
+};
+
+struct LIFT_PACKED LiftMotion {
+  int32_t  position;      // шаги от нижней точки
+  uint16_t speed;         // шагов/сек (модуль)
+  uint8_t  speedPercent;  // от крейсерской скорости, 0..100
+  int8_t   direction;     // 1=вверх, -1=вниз, 0=стоит
+};
+
+// Размеры на проводе фиксированы: поменялось — поднимай LIFT_PROTO_VERSION
+static_assert(sizeof(WireHeader)    == 3,  "wire header size");
+static_assert(sizeof(TlvHeader)     == 2,  "TLV header size");
+static_assert(sizeof(RemoteCommand) == 4,  "RemoteCommand wire size");
+static_assert(sizeof(CommandAck)    == 4,  "CommandAck wire size");
+static_assert(sizeof(LiftStatus)    == 18, "LiftStatus wire size");
+static_assert(sizeof(LiftMotion)    == 8,  "LiftMotion wire size");
+
+static const uint8_t LIFT_FRAME_OVERHEAD = sizeof(WireHeader) + 2;  // заголовок + CRC
+
+// Самый толстый кадр базы: статус + движение + текст + пачка ACK
+static const uint8_t LIFT_MAX_ACKS_PER_FRAME = 16;
+static_assert(LIFT_FRAME_OVERHEAD + sizeof(TlvHeader) * 3 + sizeof(LiftStatus) + sizeof(LiftMotion) +
+              LIFT_TEXT_MAX + LIFT_MAX_ACKS_PER_FRAME * (sizeof(TlvHeader) + sizeof(CommandAck))
+              <= LIFT_FRAME_MAX, "base frame does not fit into one ESP-NOW packet");
+
+// Тип записи для структуры (чтобы FrameWriter::add<T>() не перепутал тип и размер)
+template <typename T> struct MsgTypeOf;
+template <> struct MsgTypeOf<RemoteCommand> { static constexpr MsgType value = MSG_COMMAND; };
+template <> struct MsgTypeOf<CommandAck>    { static constexpr MsgType value = MSG_ACK; };
+template <> struct MsgTypeOf<LiftStatus>    { static constexpr MsgType value = MSG_STATUS; };
+template <> struct MsgTypeOf<LiftMotion>    { static constexpr MsgType value = MSG_MOTION; };
+
+// Длина записи известного типа (0 — переменная: MSG_TEXT; 0xFF — тип неизвестен)
+constexpr uint8_t msgFixedLength(uint8_t type) {
+  return type == MSG_COMMAND ? sizeof(RemoteCommand) :
+         type == MSG_ACK     ? sizeof(CommandAck) :
+         type == MSG_STATUS  ? sizeof(LiftStatus) :
+         type == MSG_MOTION  ? sizeof(LiftMotion) :
+         type == MSG_TEXT    ? 0 : 0xFF;
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF); кадры короткие — без таблицы
+static inline uint16_t liftCrc16(const uint8_t *data, uint16_t len) {
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+// ---------------- сборка ----------------
+
+// Пишет кадр прямо в буфер вызывающего: add<T>() возвращает место под запись,
+// поля заполняются на месте. finish() — длина и CRC.
+struct FrameWriter {
+  uint8_t *buf;
+  uint8_t  cap;
+  uint8_t  pos;
+  uint8_t  records;
+
+  void begin(uint8_t *out, uint8_t capacity) {
+    buf     = out;
+    cap     = capacity;
+    pos     = sizeof(WireHeader);
+    records = 0;
+  }
+
+  // Место под значение длины len; nullptr — не влезает (кадр не меняется)
+  uint8_t *reserve(MsgType type, uint8_t len) {
+    if ((uint16_t)pos + sizeof(TlvHeader) + len + 2 > cap) return nullptr;
+    buf[pos]     = type;
+    buf[pos + 1] = len;
+    uint8_t *value = buf + pos + sizeof(TlvHeader);
+    pos += sizeof(TlvHeader) + len;
+    records++;
+    return value;
+  }
+
+  template <typename T>
+  T *add() {
+    static_assert(sizeof(T) == msgFixedLength(MsgTypeOf<T>::value), "message size mismatch");
+    return reinterpret_cast<T *>(reserve(MsgTypeOf<T>::value, sizeof(T)));
+  }
+
+  bool addText(const char *text) {
+    size_t n = strlen(text);
+    if (n > LIFT_TEXT_MAX) n = LIFT_TEXT_MAX;
+    uint8_t *v = reserve(MSG_TEXT, (uint8_t)n);
+    if (!v) return false;
+    memcpy(v, text, n);
+    return true;
+  }
+
+  bool empty() const {
+    return records == 0;
+  }
+
+  // Готовый кадр: заголовок и CRC. Возвращает полную длину.
+  uint8_t finish() {
+    WireHeader *h = reinterpret_cast<WireHeader *>(buf);
+    h->magic   = LIFT_PROTO_MAGIC;
+    h->version = LIFT_PROTO_VERSION;
+    h->length  = (uint8_t)(pos - sizeof(WireHeader));
+    uint16_t crc = liftCrc16(buf, pos);
+    buf[pos]     = (uint8_t)(crc & 0xFF);
+    buf[pos + 1] = (uint8_t)(crc >> 8);
+    return (uint8_t)(pos + 2);
+  }
+};
+
+// ---------------- разбор ----------------
+
+enum FrameError : uint8_t {
+  FRAME_OK = 0,
+  FRAME_TOO_SHORT,
+  FRAME_BAD_MAGIC,
+  FRAME_BAD_VERSION,
+  FRAME_BAD_LENGTH,    // длина в заголовке не сходится с длиной пакета
+  FRAME_BAD_CRC,
+  FRAME_BAD_RECORD     // запись вылезает за кадр или длина не та для своего типа
+};
+
+static inline const char *frameErrorName(FrameError e) {
+  switch (e) {
+    case FRAME_OK:          return "OK";
+    case FRAME_TOO_SHORT:   return "TOO_SHORT";
+    case FRAME_BAD_MAGIC:   return "BAD_MAGIC";
+    case FRAME_BAD_VERSION: return "BAD_VERSION";
+    case FRAME_BAD_LENGTH:  return "BAD_LENGTH";
+    case FRAME_BAD_CRC:     return "BAD_CRC";
+    case FRAME_BAD_RECORD:  return "BAD_RECORD";
+  }
+  return "?";
+}
+
+// Запись внутри принятого кадра (указатели — в буфер приёма)
+struct FrameRecord {
+  uint8_t        type;
+  uint8_t        length;
+  const uint8_t *value;
+
+  // Указатель на сообщение на месте; nullptr — запись другого типа
+  template <typename T>
+  const T *as() const {
+    return (type == MsgTypeOf<T>::value && length == sizeof(T)) ? reinterpret_cast<const T *>(value) : nullptr;
+  }
+};
+
+struct FrameReader {
+  const uint8_t *pos;
+  const uint8_t *end;
+
+  // Проверить кадр целиком; FRAME_OK — можно читать next()
+  FrameError open(const uint8_t *data, int len) {
+    pos = end = data;
+    if (!data || len < (int)LIFT_FRAME_OVERHEAD) return FRAME_TOO_SHORT;
+    const WireHeader *h = reinterpret_cast<const WireHeader *>(data);
+    if (h->magic != LIFT_PROTO_MAGIC) return FRAME_BAD_MAGIC;
+    if (h->version != LIFT_PROTO_VERSION) return FRAME_BAD_VERSION;
+    if ((int)h->length + LIFT_FRAME_OVERHEAD != len) return FRAME_BAD_LENGTH;
+
+    uint16_t bodyLen = (uint16_t)(sizeof(WireHeader) + h->length);
+    uint16_t crc = (uint16_t)(data[bodyLen] | (data[bodyLen + 1] << 8));
+    if (liftCrc16(data, bodyLen) != crc) return FRAME_BAD_CRC;
+
+    // Границы всех записей — заранее, чтобы next() не мог вылезти за буфер
+    const uint8_t *p = data + sizeof(WireHeader);
+    const uint8_t *e = data + bodyLen;
+    while (p < e) {
+      if (e - p < (int)sizeof(TlvHeader)) return FRAME_BAD_RECORD;
+      uint8_t type = p[0], rlen = p[1];
+      if (e - p - (int)sizeof(TlvHeader) < rlen) return FRAME_BAD_RECORD;
+      uint8_t fixed = msgFixedLength(type);
+      if (fixed != 0xFF && fixed != 0 && rlen != fixed) return FRAME_BAD_RECORD;
+      if (type == MSG_TEXT && rlen > LIFT_TEXT_MAX) return FRAME_BAD_RECORD;
+      p += sizeof(TlvHeader) + rlen;
+    }
+    pos = data + sizeof(WireHeader);
+    end = e;
+    return FRAME_OK;
+  }
+
+  // Следующая запись; false — кадр кончился. Неизвестные типы тоже отдаются — пропусти их.
+  bool next(FrameRecord &r) {
+    if (pos >= end) return false;
+    r.type   = pos[0];
+    r.length = pos[1];
+    r.value  = pos + sizeof(TlvHeader);
+    pos += sizeof(TlvHeader) + r.length;
+    return true;
+  }
+};
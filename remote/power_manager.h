@@ -0,0 +1,111 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// Питание пульта: ступени простоя и учёт времени/заряда по ним.
+//
+// Без нажатий пульт проходит ступени по таймаутам от последней активности:
+//   ACTIVE -> DIM (экран приглушён) -> BLANK (экран и светодиоды погашены, CPU 80 МГц)
+//   -> SLEEP (light sleep, радио выключено, будят пять кнопок).
+// Активность — нажатие кнопки или лифт в движении (на экране анимация). Пока команда ждёт
+// ACK или кнопка держится, глубже BLANK не уходим. Любое нажатие — сразу в ACTIVE.
+//
+// Здесь только решения и учёт; экран, радио и сон — в remote.ino. Время — параметром,
+// поэтому логика гоняется на Linux (sim/power_test.cpp).
+
+enum PowerState : uint8_t {
+  PWR_ACTIVE,
+  PWR_DIM,
+  PWR_BLANK,
+  PWR_SLEEP,
+  PWR_STATE_COUNT
+};
+
+static const char *const POWER_STATE_NAME[PWR_STATE_COUNT] = { "ACTIVE", "DIM", "BLANK", "SLEEP" };
+
+// Таймауты от последней активности, мс; 0 — ступень выключена
+struct PowerConfig {
+  uint32_t dimMs;
+  uint32_t blankMs;
+  uint32_t sleepMs;
+};
+
+static const PowerConfig POWER_DEFAULTS = { 15000, 30000, 120000 };
+
+// Оценка тока пульта в каждой ступени, мА: ESP32 + SSD1306 + светодиоды кнопок.
+// Цифры из даташитов, не измерение — для сравнения режимов, а не точного прогноза.
+//   ACTIVE: CPU 240 МГц, приёмник включён (~95), экран (~8), два светодиода (~10)
+//   DIM:    то же, экран на минимальной яркости (~2)
+//   BLANK:  CPU 80 МГц, приёмник включён, экран выключен, светодиоды погашены
+//   SLEEP:  light sleep (~0.8) + экран в режиме off (~0.01) + LDO
+static const float POWER_STATE_MA[PWR_STATE_COUNT] = { 113.0f, 107.0f, 80.0f, 1.0f };
+
+struct PowerManager {
+  PowerConfig cfg;
+  PowerState  state;
+  uint32_t    lastActivityMs;
+  uint32_t    enteredMs;                     // начало учёта текущей ступени
+  uint64_t    timeMs[PWR_STATE_COUNT];       // накоплено по ступеням
+  uint32_t    entries[PWR_STATE_COUNT];      // сколько раз входили
+
+  void begin(const PowerConfig &c, uint32_t nowMs) {
+    memset(this, 0, sizeof(*this));
+    cfg            = c;
+    state          = PWR_ACTIVE;
+    lastActivityMs = nowMs;
+    enteredMs      = nowMs;
+    entries[PWR_ACTIVE] = 1;
+  }
+
+  void activity(uint32_t nowMs) { lastActivityMs = nowMs; }
+
+  // Ступень по простою; canSleep = false — не глубже BLANK
+  PowerState due(uint32_t nowMs, bool canSleep) const {
+    uint32_t idle = nowMs - lastActivityMs;
+    if (canSleep && cfg.sleepMs && idle >= cfg.sleepMs) return PWR_SLEEP;
+    if (cfg.blankMs && idle >= cfg.blankMs) return PWR_BLANK;
+    if (cfg.dimMs && idle >= cfg.dimMs) return PWR_DIM;
+    return PWR_ACTIVE;
+  }
+
+  // Через сколько мс due() сменит ступень без новой активности; UINT32_MAX — никогда
+  uint32_t msUntilNext(uint32_t nowMs, bool canSleep) const {
+    uint32_t idle = nowMs - lastActivityMs;
+    uint32_t best = UINT32_MAX;
+    const uint32_t steps[3] = { cfg.dimMs, cfg.blankMs, canSleep ? cfg.sleepMs : 0 };
+    for (uint8_t i = 0; i < 3; i++) {
+      if (steps[i] && steps[i] > idle && steps[i] - idle < best) best = steps[i] - idle;
+    }
+    return best;
+  }
+
+  void enter(PowerState s, uint32_t nowMs) {
+    account(nowMs);
+    state = s;
+    entries[s]++;
+  }
+
+  // Дописать время текущей ступени (перед печатью и сменой ступени)
+  void account(uint32_t nowMs) {
+    timeMs[state] += (uint32_t)(nowMs - enteredMs);
+    enteredMs = nowMs;
+  }
+
+  uint64_t totalMs() const {
+    uint64_t t = 0;
+    for (uint8_t i = 0; i < PWR_STATE_COUNT; i++) t += timeMs[i];
+    return t;
+  }
+
+  // Израсходовано по оценке POWER_STATE_MA, мА·ч
+  float chargeMah() const {
+    float mah = 0;
+    for (uint8_t i = 0; i < PWR_STATE_COUNT; i++) mah += POWER_STATE_MA[i] * (float)timeMs[i] / 3600000.0f;
+    return mah;
+  }
+
+  float averageMa() const {
+    uint64_t t = totalMs();
+    return t ? chargeMah() * 3600000.0f / (float)t : POWER_STATE_MA[state];
+  }
+};
@@ -0,0 +1,288 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "lift_protocol.h"
+
+// Надёжная доставка команд пульт -> база поверх ESP-NOW.
+//
+// Пульт (CommandSender): команды стоят в очереди; всё, что накопилось (до LINK_BATCH_MAX),
+// уходит одним кадром в порядке очереди, следующая пачка — после ACK текущей.
+// Кадр доходит целиком или никак, поэтому команда без предшественницы исполниться не может
+// (порядок MANUAL_UP / MANUAL_STOP не перепутается).
+// Нет ACK — пачка (без уже подтверждённых) уходит снова с удвоением таймаута до потолка,
+// после LINK_MAX_ATTEMPTS — потеря.
+// База (CommandReceiver): окно последних номеров на каждого пульта отсекает повторы;
+// ACK уходит и на повтор (значит, потерялся прошлый ACK), но команда не выполняется дважды.
+//
+// Логика не знает про ESP-NOW и часы: время передаётся параметром, отправка — через
+// LinkSendFn. Поэтому тот же код гоняется на Linux через модель канала (sim/link_test.cpp).
+//
+// ФАЙЛ ОДИНАКОВЫЙ в LiftController/ и remote/ (make -C sim check-shared).
+
+static const uint8_t  LINK_MAX_ATTEMPTS   = 6;       // первая отправка + 5 повторов
+static const uint32_t LINK_RETX_FIRST_US  = 25000;   // таймаут первой попытки
+static const uint32_t LINK_RETX_MAX_US    = 200000;  // потолок таймаута
+static const uint8_t  LINK_SEND_QUEUE     = 8;       // команд в очереди пульта
+static const uint8_t  LINK_BATCH_MAX      = 4;       // команд в одном кадре
+static const uint8_t  LINK_WINDOW_BITS    = 32;      // глубина окна повторов на базе
+static const uint8_t  LINK_MAX_PEERS      = 4;       // пультов, которых помнит база
+
+// ---------------- гистограмма RTT ----------------
+
+// Корзины: < 0.5, 1, 2, 4, 8, 16, 32, 64, 128 мс и всё, что дольше
+static const uint8_t RTT_BUCKETS = 10;
+
+struct RttHistogram {
+  uint32_t bucket[RTT_BUCKETS];
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+
+  void reset() {
+    memset(this, 0, sizeof(*this));
+  }
+
+  // Верхняя граница корзины i, мкс (последняя — без границы)
+  static uint32_t limitUs(uint8_t i) {
+    return (i + 1 < RTT_BUCKETS) ? (500u << i) : 0xFFFFFFFFu;
+  }
+
+  void add(uint32_t us) {
+    uint8_t i = 0;
+    while (i + 1 < RTT_BUCKETS && us >= limitUs(i)) i++;
+    bucket[i]++;
+    if (count == 0 || us < minUs) minUs = us;
+    if (us > maxUs) maxUs = us;
+    sumUs += us;
+    count++;
+  }
+
+  uint32_t avgUs() const {
+    return count ? (uint32_t)(sumUs / count) : 0;
+  }
+
+  // Две строки в out (Serial или что угодно с printf): сводка и корзины
+  template <typename Out>
+  void printTo(Out &out, const char *tag) const {
+    out.printf("%s rtt n=%lu avg %.2f ms, min %.2f, max %.2f\r\n", tag, (unsigned long)count,
+               avgUs() / 1000.0, minUs / 1000.0, maxUs / 1000.0);
+    out.printf("%s rtt", tag);
+    for (uint8_t i = 0; i < RTT_BUCKETS; i++) {
+      if (i + 1 < RTT_BUCKETS) out.printf(" <%g:%lu", limitUs(i) / 1000.0, (unsigned long)bucket[i]);
+      else                     out.printf(" more:%lu", (unsigned long)bucket[i]);
+    }
+    out.printf(" (ms)\r\n");
+  }
+};
+
+// ---------------- база: окно номеров ----------------
+
+enum SeqVerdict : uint8_t {
+  SEQ_NEW = 0,
+  SEQ_DUPLICATE
+};
+
+// Окно одного пульта: highest — старший принятый номер, бит i в mask — принят highest - i.
+// Номер далеко позади окна считается новым: пульт перезагрузился и начал с другого seq.
+struct SeqWindow {
+  bool     valid;
+  uint16_t highest;
+  uint32_t mask;
+
+  SeqVerdict check(uint16_t seq) const {
+    if (!valid) return SEQ_NEW;
+    int16_t back = (int16_t)(highest - seq);
+    if (back < 0 || back >= LINK_WINDOW_BITS) return SEQ_NEW;
+    return (mask & (1u << back)) ? SEQ_DUPLICATE : SEQ_NEW;
+  }
+
+  void accept(uint16_t seq) {
+    int16_t ahead = (int16_t)(seq - highest);
+    if (!valid || ahead <= -(int16_t)LINK_WINDOW_BITS) {
+      valid   = true;
+      highest = seq;
+      mask    = 1;
+    } else if (ahead > 0) {
+      mask    = (ahead >= LINK_WINDOW_BITS) ? 1 : ((mask << ahead) | 1);
+      highest = seq;
+    } else {
+      mask |= 1u << (-ahead);
+    }
+  }
+};
+
+struct CommandReceiver {
+  struct Peer {
+    uint8_t   mac[6];
+    uint32_t  lastUse;
+    SeqWindow win;
+  };
+  Peer     peers[LINK_MAX_PEERS];
+  uint32_t useCounter;
+
+  void reset() {
+    memset(this, 0, sizeof(*this));
+  }
+
+  SeqVerdict check(const uint8_t mac[6], uint16_t seq) {
+    Peer *p = find(mac, false);
+    return p ? p->win.check(seq) : SEQ_NEW;
+  }
+
+  // Отметить номер принятым (только после успешной постановки команды в очередь)
+  void accept(const uint8_t mac[6], uint16_t seq) {
+    find(mac, true)->win.accept(seq);
+  }
+
+  // Пульт по MAC; create — занять свободный слот или самый давний
+  Peer *find(const uint8_t mac[6], bool create) {
+    Peer *oldest = &peers[0];
+    for (uint8_t i = 0; i < LINK_MAX_PEERS; i++) {
+      Peer &p = peers[i];
+      if (p.lastUse && memcmp(p.mac, mac, 6) == 0) {
+        p.lastUse = ++useCounter;
+        return &p;
+      }
+      if (p.lastUse < oldest->lastUse) oldest = &p;
+    }
+    if (!create) return nullptr;
+    memset(oldest, 0, sizeof(*oldest));
+    memcpy(oldest->mac, mac, 6);
+    oldest->lastUse = ++useCounter;
+    return oldest;
+  }
+};
+
+// ---------------- пульт: отправка с повтором ----------------
+
+// Отправка кадра транспортом (ESP-NOW / модель канала); false — не ушёл, повторим по таймауту
+typedef bool (*LinkSendFn)(const uint8_t *data, uint8_t len, void *ctx);
+
+struct LinkSenderStats {
+  uint32_t submitted;     // команд поставлено
+  uint32_t transmissions; // кадров отправлено (с повторами)
+  uint32_t retransmits;
+  uint32_t acked;
+  uint32_t lost;          // без ACK после всех попыток
+  uint32_t queueFull;     // не влезли в очередь
+  uint32_t staleAcks;     // ACK не на текущую команду
+};
+
+struct CommandSender {
+  struct Item {
+    uint8_t  type;
+    uint8_t  arg;
+    uint16_t seq;
+    bool     acked;
+  };
+
+  Item            queue[LINK_SEND_QUEUE];
+  uint8_t         head;          // старшая неподтверждённая
+  uint8_t         count;
+  uint8_t         inFlight;      // команд с головы, ушедших в последнем кадре
+  uint16_t        nextSeq;
+  uint8_t         attempts;      // попыток для текущей пачки, 0 — ещё не отправлена
+  uint32_t        firstSentUs;
+  uint32_t        lastSentUs;
+  uint32_t        timeoutUs;
+  LinkSendFn      send;
+  void           *ctx;
+  LinkSenderStats stats;
+  RttHistogram    rtt;
+
+  // firstSeq — случайный при старте, чтобы база не приняла новые команды за повторы
+  void begin(uint16_t firstSeq, LinkSendFn fn, void *fnCtx) {
+    memset(this, 0, sizeof(*this));
+    nextSeq = firstSeq;
+    send    = fn;
+    ctx     = fnCtx;
+  }
+
+  // В очередь; уйдёт из service(). false — очередь полна.
+  bool submit(uint8_t type, uint8_t arg) {
+    if (count >= LINK_SEND_QUEUE) {
+      stats.queueFull++;
+      return false;
+    }
+    Item &it = queue[(head + count) % LINK_SEND_QUEUE];
+    it.type  = type;
+    it.arg   = arg;
+    it.seq   = nextSeq++;
+    it.acked = false;
+    count++;
+    stats.submitted++;
+    return true;
+  }
+
+  bool busy() const {
+    return count > 0;
+  }
+
+  // ACK с базы; atUs — когда он пришёл
+  void onAck(uint16_t seq, uint32_t atUs) {
+    Item *it = nullptr;
+    for (uint8_t i = 0; i < inFlight; i++) {
+      Item &q = queue[(head + i) % LINK_SEND_QUEUE];
+      if (q.seq == seq && !q.acked) it = &q;
+    }
+    if (!it || attempts == 0) {
+      stats.staleAcks++;
+      return;
+    }
+    it->acked = true;
+    // RTT только по пачке без повторов: иначе неясно, на какую попытку ответ (Карн)
+    if (attempts == 1) rtt.add(atUs - firstSentUs);
+    stats.acked++;
+    while (count && queue[head].acked) popHead();
+    if (!inFlight) attempts = 0;   // пачка подтверждена целиком — следующая сразу
+  }
+
+  // Из loop(): отправить пачку или повторить по таймауту
+  void service(uint32_t nowUs) {
+    if (!count) return;
+    if (attempts > 0 && (uint32_t)(nowUs - lastSentUs) < timeoutUs) return;
+
+    if (attempts >= LINK_MAX_ATTEMPTS) {
+      while (inFlight) {
+        if (!queue[head].acked) stats.lost++;
+        popHead();
+      }
+      attempts = 0;
+      if (!count) return;
+    }
+
+    // Все неподтверждённые с головы (при повторе — и добавленные за это время)
+    uint8_t frame[LIFT_FRAME_MAX];
+    FrameWriter w;
+    w.begin(frame, sizeof(frame));
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count && n < LINK_BATCH_MAX; i++) {
+      const Item &it = queue[(head + i) % LINK_SEND_QUEUE];
+      if (it.acked) continue;
+      RemoteCommand *c = w.add<RemoteCommand>();
+      c->type = it.type;
+      c->arg  = it.arg;
+      c->seq  = it.seq;
+      n++;
+      inFlight = i + 1;
+    }
+    if (attempts == 0) {
+      firstSentUs = nowUs;
+      timeoutUs   = LINK_RETX_FIRST_US;
+    } else {
+      stats.retransmits++;
+      timeoutUs = (timeoutUs * 2 > LINK_RETX_MAX_US) ? LINK_RETX_MAX_US : timeoutUs * 2;
+    }
+    attempts++;
+    lastSentUs = nowUs;
+    stats.transmissions++;
+    send(frame, w.finish(), ctx);
+  }
+
+  void popHead() {
+    head = (head + 1) % LINK_SEND_QUEUE;
+    count--;
+    if (inFlight) inFlight--;
+  }
+};
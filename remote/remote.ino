@@ -6,6 +6,16 @@
 
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <atomic>
+
+#include "lift_protocol.h"   // копии из LiftController/, должны совпадать
+#include "reliable_link.h"
+#include "spsc_queue.h"
+#include "button_events.h"
+#include "power_manager.h"
+#include <soc/gpio_reg.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
 
 // ------------------- OLED -------------------
 #define SCREEN_WIDTH 128
@@ -29,67 +39,72 @@ const uint8_t LED_F1   = 5;
 const uint8_t LED_F2   = 4;
 const uint8_t LED_F3   = 33;
 
-// ------------------- Протокол (должен совпадать с базой) -------------------
-
-enum CommandType : uint8_t {
-  CMD_NONE             = 0,
-  CMD_CALL_FLOOR       = 1, // arg = 1,2,3
-  CMD_STOP             = 2,
-  CMD_CALIB            = 3,
-  CMD_CALIB_DOWN_START = 4,
-  CMD_CALIB_DOWN_SAVE  = 5,
-  CMD_MANUAL_UP        = 6,
-  CMD_MANUAL_DOWN      = 7,
-  CMD_MANUAL_STOP      = 8
-};
-
-enum LiftState : uint8_t {
-  STATE_BOOT = 0,
-  STATE_NEED_CALIB,
-  STATE_CALIB_HOMING_UP,
-  STATE_CALIB_MOVING_DOWN,
-  STATE_IDLE,
-  STATE_MOVING,
-  STATE_MANUAL_MOVE,
-  STATE_ERROR
-};
+// Кнопки этажей пульта: i-я кнопка вызывает этаж i+1 (если он есть у базы)
+const uint8_t FLOOR_KEYS = 3;
+const uint8_t FLOOR_LED[FLOOR_KEYS] = { LED_F1, LED_F2, LED_F3 };
 
-struct RemoteCommand {
-  uint8_t  type;  // CommandType
-  uint8_t  arg;   // этаж (1..3) или 0
-  uint16_t seq;   // счётчик
-};
+// Все кнопки по индексу (ButtonEdge::button); этажные — подряд с KEY_F1
+enum ButtonKey : uint8_t { KEY_DOWN, KEY_UP, KEY_F1, KEY_F2, KEY_F3, KEY_COUNT };
+static const uint8_t DRAM_ATTR BUTTON_PIN[KEY_COUNT] = { BTN_DOWN, BTN_UP, BTN_F1, BTN_F2, BTN_F3 };
+static const char *const BUTTON_NAME[KEY_COUNT] = { "DOWN", "UP", "F1", "F2", "F3" };
 
-struct LiftStatus {
-  uint8_t state;
-  uint8_t currentFloor;
-  uint8_t targetFloor;
-  int8_t  direction;    // 1=вверх, -1=вниз, 0=стоит
-  uint8_t error;
-  uint8_t speedPercent;
-  uint8_t needCalib;
-  uint32_t uptimeMs;
-};
+// ------------------- Протокол -------------------
+// Команды, статус, формат кадров — lift_protocol.h (копия из LiftController/)
 
 // ------------------- ESP-NOW -------------------
 
 // MAC базы (Лифт ESP32). ПОСТАВЬ СВОЙ, если отличается!
 uint8_t BASE_MAC[6] = { 0x30, 0xAE, 0xA4, 0x21, 0x33, 0x28 };
 
-// Глобальные данные
-static uint16_t g_cmdSeq = 0;
+// Команды уходят с подтверждением: очередь, повтор без ACK, RTT (reliable_link.h)
+static CommandSender g_sender;
+
+// ACK из колбэка приёма (задача WiFi) для loop(); в кадре базы их может быть несколько
+struct RxAck {
+  uint16_t seq;
+  uint8_t  status;
+  uint32_t atUs;   // время приёма — RTT без задержки loop()
+};
+static SpscQueue<RxAck, LIFT_MAX_ACKS_PER_FRAME> g_rxAcks;
+static uint32_t g_macSendFail = 0;   // кадр не ушёл на уровне MAC (колбэк отправки)
+static std::atomic<uint32_t> g_badFrames{0};   // не прошли проверку (версия, CRC, длина)
+static std::atomic<uint8_t>  g_lastFrameError{FRAME_OK};
+
+// Строка с Serial (LINK, OLED, BTN, PWR)
+static char    g_serialLine[24];
+static uint8_t g_serialLen = 0;
 
 // Последний статус от лифта
 static LiftStatus g_status;
 static bool       g_hasStatus = false;
-static unsigned long g_lastStatusMs = 0;
-
-// Дебаунс / состояние кнопок
-bool prevDown = false;
-bool prevUp   = false;
-bool prevF1   = false;
-bool prevF2   = false;
-bool prevF3   = false;
+static unsigned long g_lastStatusMs = 0;   // последний кадр от базы (статус или движение)
+static LiftMotion    g_motion;
+static unsigned long g_lastMotionMs = 0;
+
+// Кнопки: прерывание GPIO кладёт фронт в очередь и будит loop(); дребезг, удержание
+// и повтор — в loop() (button_events.h). Писатель очереди один: ISR GPIO идут по очереди
+// на ядре, где вызван attachInterrupt().
+static SpscQueue<ButtonEdge, 32> g_buttonEdges;
+static ButtonDebouncer           g_buttons[KEY_COUNT];
+static TaskHandle_t              g_loopTask = nullptr;
+
+// Без событий loop() спит до дедлайна (окно дребезга, удержание), но не дольше:
+static const uint32_t LOOP_IDLE_MS = 20;   // анимация экрана, светодиоды, таймаут статуса
+static const uint32_t LOOP_LINK_MS = 5;    // пока команда ждёт ACK (повторы)
+
+// Нажатие → esp_now_send (только если кадр ушёл сразу, а не ждал ACK предыдущих)
+static RttHistogram g_pressToSend;
+static uint32_t     g_pressQueued = 0;
+static uint32_t     g_buttonRepeats = 0;
+
+// Питание: ступени простоя (power_manager.h), light sleep до нажатия кнопки
+static PowerManager  g_power;
+static const uint32_t LOOP_BLANK_MS = 250;       // экран погашен — будить loop() реже
+static const float    BATTERY_MAH   = 1000.0f;   // элемент 1S — только для оценки в PWR
+static uint32_t      g_wakeUs = 0;               // выход из light sleep
+static bool          g_wakeSendPending = false;  // первая команда после сна ещё не ушла
+static RttHistogram  g_wakeToRadio;              // выход из сна -> ESP-NOW снова поднят
+static RttHistogram  g_wakeToSend;               // выход из сна -> первая команда в эфире
 
 // ------------------- Вспомогательные функции -------------------
 
@@ -103,6 +118,7 @@ const char* stateToText(uint8_t st) {
     case STATE_MOVING:           return "MOVING";
     case STATE_MANUAL_MOVE:      return "MANUAL";
     case STATE_ERROR:            return "ERROR";
+    case STATE_VERIFY_HOMING:    return "VERIFY";
     default:                     return "?";
   }
 }
@@ -113,28 +129,112 @@ char directionToChar(int8_t dir) {
   return '-';
 }
 
-void sendCommand(uint8_t type, uint8_t arg) {
-  RemoteCommand cmd;
-  cmd.type = type;
-  cmd.arg  = arg;
-  cmd.seq  = ++g_cmdSeq;
-
-  esp_err_t res = esp_now_send(BASE_MAC, (uint8_t*)&cmd, sizeof(cmd));
-  Serial.print(F("[REMOTE] Send cmd type="));
-  Serial.print(type);
-  Serial.print(F(" arg="));
-  Serial.print(arg);
-  Serial.print(F(" seq="));
-  Serial.print(cmd.seq);
+// Транспорт для CommandSender: кадр с командами в ESP-NOW (первая отправка и повторы)
+bool linkSendEspNow(const uint8_t *data, uint8_t len, void *ctx) {
+  esp_err_t res = esp_now_send(BASE_MAC, data, len);
+  FrameReader rd;
+  FrameRecord rec;
+  rd.open(data, len);
+  while (rd.next(rec)) {
+    const RemoteCommand *cmd = rec.as<RemoteCommand>();
+    if (!cmd) continue;
+    Serial.print(F("[REMOTE] Send cmd type="));
+    Serial.print(cmd->type);
+    Serial.print(F(" arg="));
+    Serial.print(cmd->arg);
+    Serial.print(F(" seq="));
+    Serial.print(cmd->seq);
+    Serial.print(' ');
+  }
+  if (g_sender.attempts > 1) {
+    Serial.print(F(" retry "));
+    Serial.print(g_sender.attempts - 1);
+  }
   Serial.print(F(" => "));
   Serial.println(res == ESP_OK ? F("OK") : F("ERR"));
+  return res == ESP_OK;
+}
+
+// pressUs — метка фронта кнопки из прерывания
+void sendCommand(uint8_t type, uint8_t arg, uint32_t pressUs) {
+  if (!g_sender.submit(type, arg)) {
+    Serial.println(F("[REMOTE] Command queue full, dropped"));
+    return;
+  }
+  uint32_t sentBefore = g_sender.stats.transmissions;
+  g_sender.service(micros());  // первая попытка — сразу
+  if (g_sender.stats.transmissions == sentBefore) {
+    g_pressQueued++;
+    return;
+  }
+  g_pressToSend.add(micros() - pressUs);
+  if (g_wakeSendPending) {
+    g_wakeToSend.add(micros() - g_wakeUs);
+    g_wakeSendPending = false;
+  }
+}
+
+void printLinkStats() {
+  const LinkSenderStats &st = g_sender.stats;
+  Serial.printf("[LINK] cmds %lu, sent %lu, retransmits %lu, acked %lu, lost %lu, queue full %lu, stale acks %lu\r\n",
+                (unsigned long)st.submitted, (unsigned long)st.transmissions, (unsigned long)st.retransmits,
+                (unsigned long)st.acked, (unsigned long)st.lost, (unsigned long)st.queueFull,
+                (unsigned long)st.staleAcks);
+  Serial.printf("[LINK] MAC send fail %lu, bad frames %lu (last %s), protocol v%u\r\n",
+                (unsigned long)g_macSendFail, (unsigned long)g_badFrames.load(),
+                frameErrorName((FrameError)g_lastFrameError.load()), LIFT_PROTO_VERSION);
+  g_sender.rtt.printTo(Serial, "[LINK] cmd");
+}
+
+void printOledStats();
+void printButtonStats();
+void printPowerStats();
+void drainButtonEdges();
+void powerCommand(const char *args);
+void powerWake();
+
+// ACK от базы → отправитель; повтор/потеря — в service()
+void serviceLink() {
+  RxAck a;
+  while (g_rxAcks.pop(a)) {
+    g_sender.onAck(a.seq, a.atUs);
+    if (a.status == LINK_ACK_DUPLICATE) {
+      Serial.print(F("[REMOTE] ACK seq="));
+      Serial.print(a.seq);
+      Serial.println(F(" (duplicate, base already had it)"));
+    }
+  }
+
+  uint32_t lostBefore = g_sender.stats.lost;
+  g_sender.service(micros());
+  if (g_sender.stats.lost != lostBefore) {
+    Serial.println(F("[REMOTE] Command lost: no ACK after all retries"));
+  }
+
+  // Serial: LINK — статистика канала, OLED — кадры и байты I2C экрана, BTN — кнопки,
+  // PWR [dim blank sleep] — ступени питания (таймауты в секундах)
+  while (Serial.available()) {
+    char c = (char)Serial.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (g_serialLen < sizeof(g_serialLine) - 1) g_serialLine[g_serialLen++] = c;
+      continue;
+    }
+    g_serialLine[g_serialLen] = '\0';
+    g_serialLen = 0;
+    if (strcasecmp(g_serialLine, "LINK") == 0) printLinkStats();
+    else if (strcasecmp(g_serialLine, "OLED") == 0) printOledStats();
+    else if (strcasecmp(g_serialLine, "BTN") == 0) printButtonStats();
+    else if (strncasecmp(g_serialLine, "PWR", 3) == 0) powerCommand(g_serialLine + 3);
+  }
 }
 
 void updateLeds() {
+  // Экран погашен — светодиоды тоже (погасил powerApply())
+  if (g_power.state >= PWR_BLANK) return;
+
   // Сначала выключим всё
-  digitalWrite(LED_F1, LOW);
-  digitalWrite(LED_F2, LOW);
-  digitalWrite(LED_F3, LOW);
+  for (uint8_t i = 0; i < FLOOR_KEYS; i++) digitalWrite(FLOOR_LED[i], LOW);
   digitalWrite(LED_UP, LOW);
   digitalWrite(LED_DOWN, LOW);
 
@@ -195,49 +295,135 @@ void updateLeds() {
 
   bool isMoving =
     (st == STATE_MOVING) ||
-    (st == STATE_MANUAL_MOVE);
+    (st == STATE_MANUAL_MOVE) ||
+    (st == STATE_VERIFY_HOMING);
 
   // 1) Стоим (IDLE) на этаже: кнопка этого этажа мигает
-  if (!isMoving && curFloor >= 1 && curFloor <= 3) {
+  if (!isMoving && curFloor >= 1 && curFloor <= FLOOR_KEYS) {
     if (blink) {
-      switch (curFloor) {
-        case 1: digitalWrite(LED_F1, HIGH); break;
-        case 2: digitalWrite(LED_F2, HIGH); break;
-        case 3: digitalWrite(LED_F3, HIGH); break;
-      }
+      digitalWrite(FLOOR_LED[curFloor - 1], HIGH);
     }
   }
 
   // 2) Едем к целевому этажу: кнопка целевого этажа горит постоянно
-  if (isMoving && tgtFloor >= 1 && tgtFloor <= 3) {
-    switch (tgtFloor) {
-      case 1: digitalWrite(LED_F1, HIGH); break;
-      case 2: digitalWrite(LED_F2, HIGH); break;
-      case 3: digitalWrite(LED_F3, HIGH); break;
-    }
+  if (isMoving && tgtFloor >= 1 && tgtFloor <= FLOOR_KEYS) {
+    digitalWrite(FLOOR_LED[tgtFloor - 1], HIGH);
+  }
+
+  // 3) Все ожидающие вызовы из очереди тоже горят постоянно
+  uint16_t calls = g_status.pendingCalls;
+  for (uint8_t i = 0; i < FLOOR_KEYS; i++) {
+    if (calls & (1u << (i + 1))) digitalWrite(FLOOR_LED[i], HIGH);
   }
 }
 
-void updateDisplay() {
+// ------------------- OLED: перерисовка по изменениям -------------------
+// Кадр собирается заново, только когда поменялось видимое (OledView), и не чаще
+// OLED_MIN_FRAME_MS. По I2C уходят не все 512 байт, а в каждой странице SSD1306
+// (8 строк) — только изменившиеся столбцы внутри грязных областей экрана.
+// Область = диапазон столбцов; текст слева может заходить на середину — диапазоны с запасом.
+
+enum OledArea : uint8_t {
+  AREA_LEFT,     // мини-статус: этажи, состояние, CAL/ERR/%
+  AREA_CENTER,   // крупный номер этажа
+  AREA_RIGHT,    // стрелка / черта
+  AREA_COUNT
+};
+static const uint8_t OLED_ALL_AREAS = (1 << AREA_COUNT) - 1;
+static const int16_t OLED_AREA_X0[AREA_COUNT] = { 0,  52,  84 };
+static const int16_t OLED_AREA_X1[AREA_COUNT] = { 78, 100, SCREEN_WIDTH };  // не включая
+
+static const uint8_t       OLED_PAGES        = SCREEN_HEIGHT / 8;
+static const unsigned long OLED_MIN_FRAME_MS = 50;    // не чаще 20 кадров/с
+static const unsigned long OLED_ANIM_MS      = 150;   // шаг анимации стрелки
+static const uint8_t       OLED_I2C_CHUNK    = 32;    // байт данных за транзакцию (буфер Wire)
+static const uint32_t      OLED_I2C_CLOCK    = 400000;
+// Полный display(): 7 байт команд + 512 данных + байт 0x40 на каждые 31 байт данных
+static const uint32_t      OLED_FULL_FRAME_BYTES = 7 + SCREEN_WIDTH * OLED_PAGES + 17;
+
+// Всё, от чего зависит картинка
+struct OledView {
+  bool    hasStatus;
+  uint8_t state;
+  uint8_t curFloor;
+  uint8_t tgtFloor;
+  int8_t  dir;
+  bool    needCal;
+  bool    hasError;
+  uint8_t pct;         // 0 — не показывается
+  uint8_t animFrame;   // 0..2, только на ходу
+};
+
+struct OledStats {
+  uint32_t frames;     // собрано и отправлено кадров
+  uint32_t i2cBytes;   // байт по I2C (команды + данные)
+  uint32_t deferred;   // проходов, когда кадр ждал ограничения частоты
+  uint32_t loops;      // проходов loop()
+};
+
+static OledView      g_shownView;
+static bool          g_shownValid = false;    // false — перерисовать всё
+static uint8_t       g_oledShadow[SCREEN_WIDTH * OLED_PAGES];   // что сейчас на панели
+static unsigned long g_lastFrameMs = 0;
+static OledStats     g_oledTotal;
+static OledStats     g_oledWindow;       // текущая секунда
+static OledStats     g_oledLastSecond;   // прошлая полная секунда
+static unsigned long g_oledWindowStartMs = 0;
+
+static OledView oledBuildView() {
+  OledView v;
+  memset(&v, 0, sizeof(v));
+  v.hasStatus = g_hasStatus;
+  if (!v.hasStatus) return v;
+  v.state    = g_status.state;
+  v.curFloor = g_status.currentFloor;
+  v.tgtFloor = g_status.targetFloor;
+  v.dir      = g_status.direction;
+  v.needCal  = g_status.needCalib != 0;
+  v.hasError = g_status.error != 0;
+  if (!v.needCal && !v.hasError) {
+    // На ходу — скорость из свежего кадра движения, иначе из статуса
+    bool motionFresh = (millis() - g_lastMotionMs) < 300;
+    v.pct = motionFresh ? g_motion.speedPercent : g_status.speedPercent;
+  }
+  if (v.dir != 0) v.animFrame = (millis() / OLED_ANIM_MS) % 3;
+  return v;
+}
+
+static uint8_t oledDirtyAreas(const OledView &v) {
+  const OledView &o = g_shownView;
+  if (!g_shownValid || v.hasStatus != o.hasStatus) return OLED_ALL_AREAS;
+  if (!v.hasStatus) return 0;
+  uint8_t areas = 0;
+  if (v.state != o.state || v.curFloor != o.curFloor || v.tgtFloor != o.tgtFloor ||
+      v.needCal != o.needCal || v.hasError != o.hasError || v.pct != o.pct) {
+    areas |= 1 << AREA_LEFT;
+  }
+  if (v.curFloor != o.curFloor) areas |= 1 << AREA_CENTER;
+  if (v.dir != o.dir || v.animFrame != o.animFrame) areas |= 1 << AREA_RIGHT;
+  return areas;
+}
+
+// Кадр целиком в буфер библиотеки (только RAM, без I2C)
+static void oledCompose(const OledView &v) {
   display.clearDisplay();
 
-  if (!g_hasStatus) {
+  if (!v.hasStatus) {
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
     display.setCursor(0, 0);
     display.println(F("NO STATUS"));
     display.setCursor(0, 10);
     display.println(F("Check power/ESP"));
-    display.display();
     return;
   }
 
-  uint8_t  st        = g_status.state;
-  uint8_t  curFloor  = g_status.currentFloor;
-  uint8_t  tgtFloor  = g_status.targetFloor;
-  int8_t   dir       = g_status.direction;
-  bool     needCal   = g_status.needCalib != 0;
-  bool     hasError  = g_status.error != 0;
+  uint8_t  st        = v.state;
+  uint8_t  curFloor  = v.curFloor;
+  uint8_t  tgtFloor  = v.tgtFloor;
+  int8_t   dir       = v.dir;
+  bool     needCal   = v.needCal;
+  bool     hasError  = v.hasError;
 
   // Разбиваем экран на трети по X
   const int16_t W = 128;
@@ -268,7 +454,7 @@ void updateDisplay() {
   display.print(F("St: "));
   display.print(stateToText(st)); // если будет длинно — можно позже сократить
 
-  // Строка 3: CAL/ERR
+  // Строка 3: CAL/ERR, на ходу — скорость в % (из свежего кадра движения, иначе из статуса)
   display.setCursor(leftX, 20);
   if (needCal) {
     display.print(F("CAL "));
@@ -277,6 +463,10 @@ void updateDisplay() {
   }
   if (hasError) {
     display.print(F("ERR"));
+  } else if (v.pct > 0) {
+    display.setCursor(leftX, 20);
+    display.print(v.pct);
+    display.print('%');
   }
 
   // ---------- СЕРЕДИНА: крупный номер этажа ----------
@@ -287,6 +477,7 @@ void updateDisplay() {
 
   // Оценка ширины цифры при size=3: примерно 6*3 = 18 px
   int16_t digitX = midCenterX - 9;     // сместим на пол-ширины цифры
+  if (curFloor >= 10) digitX -= 9;     // двузначный номер — ещё на пол-цифры
   int16_t digitY = midCenterY - 12;    // на пол-высоты (8*3/2 ≈12)
 
   display.setCursor(digitX, digitY);
@@ -306,7 +497,7 @@ void updateDisplay() {
   int16_t arrowHalfW   = (rightW / 2) - 4; // чуть отступим от краёв
 
   // Анимационный кадр (0..2)
-  uint8_t frame = (millis() / 150) % 3;
+  uint8_t frame = v.animFrame;
 
   if (dir > 0) {
     // ДВИЖЕНИЕ ВВЕРХ
@@ -375,38 +566,407 @@ void updateDisplay() {
     );
   }
 
-  display.display();
 }
 
+// Окно [x0..x1] страницы page: адресация страниц/столбцов SSD1306 + данные
+static void oledSendWindow(uint8_t page, uint8_t x0, uint8_t x1, const uint8_t *row) {
+  display.ssd1306_command(SSD1306_PAGEADDR);
+  display.ssd1306_command(page);
+  display.ssd1306_command(page);
+  display.ssd1306_command(SSD1306_COLUMNADDR);
+  display.ssd1306_command(x0);
+  display.ssd1306_command(x1);
+  g_oledWindow.i2cBytes += 6 * 2;   // каждая команда — байт управления + байт команды
+
+  for (uint16_t x = x0; x <= x1;) {
+    uint8_t n = (x1 - x + 1 < OLED_I2C_CHUNK) ? (uint8_t)(x1 - x + 1) : OLED_I2C_CHUNK;
+    Wire.beginTransmission(OLED_ADDR);
+    Wire.write((uint8_t)0x40);   // дальше — данные
+    Wire.write(row + x, n);
+    Wire.endTransmission();
+    g_oledWindow.i2cBytes += n + 1;
+    x += n;
+  }
+}
+
+// Отправить отличия буфера от панели в столбцах грязных областей
+static void oledFlush(uint8_t areas) {
+  int16_t x0 = SCREEN_WIDTH, x1 = 0;
+  for (uint8_t a = 0; a < AREA_COUNT; a++) {
+    if (!(areas & (1 << a))) continue;
+    if (OLED_AREA_X0[a] < x0) x0 = OLED_AREA_X0[a];
+    if (OLED_AREA_X1[a] > x1) x1 = OLED_AREA_X1[a];
+  }
+  const uint8_t *buf = display.getBuffer();
+  Wire.setClock(OLED_I2C_CLOCK);
+  for (uint8_t page = 0; page < OLED_PAGES; page++) {
+    const uint8_t *row    = buf + page * SCREEN_WIDTH;
+    uint8_t       *shadow = g_oledShadow + page * SCREEN_WIDTH;
+    int16_t first = -1, last = -1;
+    for (int16_t x = x0; x < x1; x++) {
+      if (row[x] == shadow[x]) continue;
+      if (first < 0) first = x;
+      last = x;
+    }
+    if (first < 0) continue;   // страница не изменилась
+    oledSendWindow(page, (uint8_t)first, (uint8_t)last, row);
+    memcpy(shadow + first, row + first, last - first + 1);
+    // Нажатие во время вывода не ждёт конца кадра
+    if (g_buttonEdges.size()) drainButtonEdges();
+  }
+}
+
+// Экран уже выведен целиком (display.display() в setup): запомнить, что на панели
+void oledSyncShadow() {
+  memcpy(g_oledShadow, display.getBuffer(), sizeof(g_oledShadow));
+  g_shownValid = false;
+}
+
+static void oledCountSecond(unsigned long now) {
+  g_oledWindow.loops++;
+  if (now - g_oledWindowStartMs < 1000) return;
+  g_oledLastSecond = g_oledWindow;
+  g_oledTotal.frames   += g_oledWindow.frames;
+  g_oledTotal.i2cBytes += g_oledWindow.i2cBytes;
+  g_oledTotal.deferred += g_oledWindow.deferred;
+  g_oledTotal.loops    += g_oledWindow.loops;
+  memset(&g_oledWindow, 0, sizeof(g_oledWindow));
+  g_oledWindowStartMs = now;
+}
+
+void printOledStats() {
+  const OledStats &s = g_oledLastSecond;
+  Serial.printf("[OLED] last second: %lu frames, %lu I2C bytes, %lu deferred, %lu loops\r\n",
+                (unsigned long)s.frames, (unsigned long)s.i2cBytes, (unsigned long)s.deferred,
+                (unsigned long)s.loops);
+  Serial.printf("[OLED] total: %lu frames, %lu I2C bytes (full redraw would be %lu)\r\n",
+                (unsigned long)g_oledTotal.frames, (unsigned long)g_oledTotal.i2cBytes,
+                (unsigned long)(g_oledTotal.frames * OLED_FULL_FRAME_BYTES));
+}
 
+void updateDisplay() {
+  unsigned long now = millis();
+  oledCountSecond(now);
+  // Панель выключена, но помнит картинку; теневая копия верна — после пробуждения уйдут отличия
+  if (g_power.state >= PWR_BLANK) return;
+
+  OledView v = oledBuildView();
+  uint8_t areas = oledDirtyAreas(v);
+  if (!areas) return;
+  if (g_shownValid && now - g_lastFrameMs < OLED_MIN_FRAME_MS) {
+    g_oledWindow.deferred++;
+    return;
+  }
 
+  oledCompose(v);
+  oledFlush(areas);
+  g_shownView   = v;
+  g_shownValid  = true;
+  g_lastFrameMs = now;
+  g_oledWindow.frames++;
+}
+
+
+
+
+// ------------------- Кнопки -------------------
+
+// Уровень пина из прерывания: регистр входов напрямую (digitalRead не в IRAM). LOW = нажата.
+static inline bool IRAM_ATTR buttonPressed(uint8_t pin) {
+  uint32_t in = (pin < 32) ? REG_READ(GPIO_IN_REG) : REG_READ(GPIO_IN1_REG);
+  return ((in >> (pin & 31)) & 1) == 0;
+}
+
+void IRAM_ATTR onButtonEdge(void *arg) {
+  uint8_t key = (uint8_t)(uintptr_t)arg;
+  ButtonEdge e = { key, (uint8_t)buttonPressed(BUTTON_PIN[key]), (uint32_t)esp_timer_get_time() };
+  g_buttonEdges.push(e);   // полна — потерю фронта исправит tick() по уровню
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(g_loopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+void onButtonEvent(uint8_t key, ButtonEventType type, uint32_t atUs, void *ctx) {
+  if (type == BTN_LONG) {
+    Serial.print(F("[BTN] Long press "));
+    Serial.println(BUTTON_NAME[key]);
+    return;
+  }
+  if (type == BTN_REPEAT) {
+    g_buttonRepeats++;   // команд на удержание пока нет
+    return;
+  }
+  bool press = (type == BTN_PRESS);
+  if (press) powerWake();   // нажатие и будит экран, и исполняется
+
+  // DOWN / UP: нажали -> MANUAL_DOWN / MANUAL_UP, отпустили -> MANUAL_STOP
+  if (key == KEY_DOWN || key == KEY_UP) {
+    if (press) sendCommand(key == KEY_DOWN ? CMD_MANUAL_DOWN : CMD_MANUAL_UP, 0, atUs);
+    else       sendCommand(CMD_MANUAL_STOP, 0, atUs);
+    return;
+  }
+
+  // Кнопки этажей: по нажатию — CMD_CALL_FLOOR (этажей у базы может быть меньше, чем кнопок).
+  // F1 шлём всегда: в калибровке вниз им сохраняют нижнюю точку.
+  uint8_t i = key - KEY_F1;
+  uint8_t floors = g_hasStatus ? g_status.floorCount : FLOOR_KEYS;
+  if (press && (i == 0 || i < floors)) sendCommand(CMD_CALL_FLOOR, i + 1, atUs);
+}
+
+// Фронты из очереди прерываний -> автоматы (нажатие уходит отсюда же)
+void drainButtonEdges() {
+  ButtonEdge e;
+  while (g_buttonEdges.pop(e)) {
+    g_buttons[e.button].onEdge(e.button, e.pressed != 0, e.atUs, onButtonEvent, nullptr);
+  }
+}
+
+// Фронты, потом дедлайны автоматов (конец дребезга, удержание)
+void processButtons() {
+  drainButtonEdges();
+  uint32_t now = micros();
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    g_buttons[k].tick(k, buttonPressed(BUTTON_PIN[k]), now, onButtonEvent, nullptr);
+  }
+}
+
+bool anyButtonHeld() {
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    if (g_buttons[k].pressed) return true;
+  }
+  return false;
+}
+
+// Сон до события (фронт кнопки, пакет ESP-NOW) или ближайшего дедлайна
+void waitForEvents() {
+  uint32_t waitMs = g_sender.busy() ? LOOP_LINK_MS : (g_power.state >= PWR_BLANK ? LOOP_BLANK_MS : LOOP_IDLE_MS);
+  uint32_t powerMs = g_power.msUntilNext(millis(), !g_sender.busy() && !anyButtonHeld());
+  if (powerMs < waitMs) waitMs = powerMs;
+  uint32_t waitUs = waitMs * 1000;
+  uint32_t now = micros();
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    uint32_t d = g_buttons[k].usUntilDeadline(now);
+    if (d < waitUs) waitUs = d;
+  }
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((waitUs + 999) / 1000));
+}
+
+void printButtonStats() {
+  g_pressToSend.printTo(Serial, "[BTN] press->send");
+  Serial.printf("[BTN] %lu presses waited for ACK of earlier commands, %lu repeats, %lu edges lost\r\n",
+                (unsigned long)g_pressQueued, (unsigned long)g_buttonRepeats,
+                (unsigned long)g_buttonEdges.overflowCount());
+  Serial.print(F("[BTN] bounces:"));
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    Serial.printf(" %s=%lu", BUTTON_NAME[k], (unsigned long)g_buttons[k].bounces);
+  }
+  Serial.println();
+}
 
 // ------------------- ESP-NOW колбэки -------------------
 
 void onDataSentRemote(const wifi_tx_info_t *info, esp_now_send_status_t status) {
   // Можно залогировать, если надо
-  Serial.print(F("[REMOTE] Send cb: "));
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? F("OK") : F("FAIL"));
+  // Только счётчик: ответ на команду — ACK от базы, а не MAC-подтверждение
+  if (status != ESP_NOW_SEND_SUCCESS) g_macSendFail++;
 }
 
 void onDataRecvRemote(const esp_now_recv_info *recv_info, const uint8_t *incomingData, int len) {
-  Serial.print(F("[REMOTE] Data received, len="));
-  Serial.println(len);
-
-  if (len == sizeof(LiftStatus)) {
-    memcpy(&g_status, incomingData, sizeof(LiftStatus));
-    g_hasStatus = true;
-    g_lastStatusMs = millis();
-
-    Serial.print(F("[REMOTE] status: state="));
-    Serial.print(g_status.state);
-    Serial.print(F(" floor="));
-    Serial.print(g_status.currentFloor);
-    Serial.print(F(" target="));
-    Serial.println(g_status.targetFloor);
-  } else {
-    Serial.println(F("[REMOTE] Unknown packet size"));
+  uint32_t nowUs = micros();
+  FrameReader rd;
+  FrameError err = rd.open(incomingData, len);
+  if (err != FRAME_OK) {
+    // Печать — из loop() (LINK); здесь задача WiFi
+    g_badFrames.fetch_add(1, std::memory_order_relaxed);
+    g_lastFrameError.store(err, std::memory_order_relaxed);
+    return;
+  }
+
+  // Записи читаются прямо из буфера кадра
+  FrameRecord rec;
+  while (rd.next(rec)) {
+    if (const CommandAck *ack = rec.as<CommandAck>()) {
+      RxAck a = { ack->seq, ack->status, nowUs };
+      g_rxAcks.push(a);   // переполнение — пропавший ACK, команда уйдёт повтором
+    } else if (const LiftStatus *st = rec.as<LiftStatus>()) {
+      g_status = *st;
+      g_hasStatus = true;
+      g_lastStatusMs = millis();
+
+      Serial.print(F("[REMOTE] status state="));
+      Serial.print(g_status.state);
+      Serial.print(F(" floor="));
+      Serial.print(g_status.currentFloor);
+      Serial.print(F(" target="));
+      Serial.print(g_status.targetFloor);
+      Serial.print(F(" eta="));
+      Serial.println(g_status.etaMs);
+    } else if (const LiftMotion *m = rec.as<LiftMotion>()) {
+      // Кадр движения: только позиция/скорость, без печати (идут ~10 раз в секунду)
+      g_motion = *m;
+      g_lastMotionMs = millis();
+      g_lastStatusMs = g_lastMotionMs;
+    } else if (rec.type == MSG_TEXT) {
+      Serial.print(F("[BASE] "));
+      Serial.write(rec.value, rec.length);
+      Serial.println();
+    }
+    // Неизвестные записи (новее этой прошивки) пропускаются
   }
+  // Разбудить loop(): ACK и статус — без ожидания конца сна
+  if (g_loopTask) xTaskNotifyGive(g_loopTask);
+}
+
+// ESP-NOW поверх запущенного WiFi (setup() и выход из light sleep); nullptr — всё поднялось
+const char *espNowStart() {
+  if (esp_now_init() != ESP_OK) {
+    Serial.println(F("[ESP-NOW] init FAIL"));
+    return "ESP-NOW FAIL";
+  }
+
+  esp_now_register_send_cb(onDataSentRemote);
+  esp_now_register_recv_cb(onDataRecvRemote);
+
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, BASE_MAC, 6);
+  peerInfo.channel = 0;
+  peerInfo.encrypt = false;
+
+  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+    Serial.println(F("[ESP-NOW] add_peer FAIL"));
+    return "Peer FAIL";
+  }
+  return nullptr;
+}
+
+// ------------------- Питание -------------------
+// Ступени по простою — power_manager.h. Здесь: экран, светодиоды, частота CPU и light sleep.
+
+static bool liftBusy(uint8_t st) {
+  return st == STATE_MOVING || st == STATE_MANUAL_MOVE || st == STATE_VERIFY_HOMING ||
+         st == STATE_CALIB_HOMING_UP || st == STATE_CALIB_MOVING_DOWN;
+}
+
+static void powerApply(PowerState s) {
+  PowerState from = g_power.state;
+  if (s == from) return;
+  g_power.enter(s, millis());
+
+  bool screenOn = (s <= PWR_DIM);
+  if (screenOn != (from <= PWR_DIM)) {
+    display.ssd1306_command(screenOn ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF);
+  }
+  if (screenOn) display.dim(s == PWR_DIM);
+  if (!screenOn) {
+    for (uint8_t i = 0; i < FLOOR_KEYS; i++) digitalWrite(FLOOR_LED[i], LOW);
+    digitalWrite(LED_UP, LOW);
+    digitalWrite(LED_DOWN, LOW);
+  }
+  // Приёмник ESP-NOW работает и на 80 МГц; полная частота — когда на экране что-то происходит
+  if ((s >= PWR_BLANK) != (from >= PWR_BLANK)) setCpuFrequencyMhz(s >= PWR_BLANK ? 80 : 240);
+
+  Serial.print(F("[PWR] "));
+  Serial.print(POWER_STATE_NAME[from]);
+  Serial.print(F(" -> "));
+  Serial.println(POWER_STATE_NAME[s]);
+}
+
+// Нажатие: сразу в ACTIVE (из light sleep сюда попадаем уже проснувшись)
+void powerWake() {
+  g_power.activity(millis());
+  powerApply(PWR_ACTIVE);
+}
+
+// Light sleep до нажатия любой из пяти кнопок. Радио на время сна выключено, ESP-NOW
+// поднимается заново; Serial во сне не слышно.
+static void powerSleep() {
+  powerApply(PWR_SLEEP);
+  Serial.println(F("[PWR] Light sleep, wake on any button"));
+  Serial.flush();
+
+  esp_now_deinit();
+  esp_wifi_stop();
+  // Будит низкий уровень; прерывания по фронтам на время сна выключены, иначе после
+  // пробуждения уровневое прерывание шло бы, пока кнопку держат
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    gpio_intr_disable((gpio_num_t)BUTTON_PIN[k]);
+    gpio_wakeup_enable((gpio_num_t)BUTTON_PIN[k], GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+
+  esp_light_sleep_start();
+
+  g_wakeUs = micros();
+  // Какая кнопка разбудила — по уровню сразу, пока её не отпустили (короткое касание)
+  bool heldAtWake[KEY_COUNT];
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    heldAtWake[k] = buttonPressed(BUTTON_PIN[k]);
+    gpio_wakeup_disable((gpio_num_t)BUTTON_PIN[k]);
+    gpio_set_intr_type((gpio_num_t)BUTTON_PIN[k], GPIO_INTR_ANYEDGE);
+    gpio_intr_enable((gpio_num_t)BUTTON_PIN[k]);
+  }
+  powerWake();   // CPU снова 240 МГц — до подъёма радио
+
+  const char *err = (esp_wifi_start() == ESP_OK) ? espNowStart() : "WiFi start FAIL";
+  g_wakeToRadio.add(micros() - g_wakeUs);
+  if (err) {
+    Serial.print(F("[PWR] Wake: "));
+    Serial.println(err);
+  }
+
+  // Статус за время сна устарел: полный — запросом, а не через heartbeat. Запрос встаёт
+  // в очередь первым и уходит одним кадром с командой разбудившей кнопки.
+  g_hasStatus = false;
+  g_sender.submit(CMD_STATUS_REQUEST, 0);
+  g_wakeSendPending = true;
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    if (heldAtWake[k]) g_buttons[k].onEdge(k, true, g_wakeUs, onButtonEvent, nullptr);
+  }
+  g_sender.service(micros());   // кнопку отпустили до проверки — уйдёт хотя бы запрос
+}
+
+// Из loop(): ступень по простою. Лифт в движении — тоже активность (на экране анимация).
+// Пока команда ждёт ACK или кнопку держат — не спать.
+void powerUpdate() {
+  unsigned long now = millis();
+  if (g_hasStatus && liftBusy(g_status.state)) g_power.activity(now);
+  PowerState s = g_power.due(now, !g_sender.busy() && !anyButtonHeld());
+  if (s == PWR_SLEEP) powerSleep();
+  else                powerApply(s);
+}
+
+void printPowerStats() {
+  unsigned long now = millis();
+  g_power.account(now);
+  const PowerConfig &c = g_power.cfg;
+  Serial.printf("[PWR] state %s, idle %lu s; timeouts dim %lu s, blank %lu s, sleep %lu s (0 = off)\r\n",
+                POWER_STATE_NAME[g_power.state], (unsigned long)((now - g_power.lastActivityMs) / 1000),
+                (unsigned long)(c.dimMs / 1000), (unsigned long)(c.blankMs / 1000),
+                (unsigned long)(c.sleepMs / 1000));
+  Serial.print(F("[PWR] time:"));
+  for (uint8_t i = 0; i < PWR_STATE_COUNT; i++) {
+    Serial.printf(" %s %.1f s (%lu)", POWER_STATE_NAME[i], g_power.timeMs[i] / 1000.0,
+                  (unsigned long)g_power.entries[i]);
+  }
+  Serial.println();
+  float avg = g_power.averageMa();
+  Serial.printf("[PWR] estimate: %.2f mAh used, avg %.1f mA -> %.0f h on %.0f mAh (always ACTIVE: %.0f h)\r\n",
+                g_power.chargeMah(), avg, BATTERY_MAH / avg, BATTERY_MAH,
+                BATTERY_MAH / POWER_STATE_MA[PWR_ACTIVE]);
+  g_wakeToRadio.printTo(Serial, "[PWR] wake->radio");
+  g_wakeToSend.printTo(Serial, "[PWR] wake->send");
+}
+
+// PWR — статистика; PWR <dim> <blank> <sleep> — таймауты в секундах (до перезагрузки)
+void powerCommand(const char *args) {
+  unsigned long d, b, sl;
+  if (sscanf(args, "%lu %lu %lu", &d, &b, &sl) == 3) {
+    g_power.cfg.dimMs   = d * 1000;
+    g_power.cfg.blankMs = b * 1000;
+    g_power.cfg.sleepMs = sl * 1000;
+    g_power.activity(millis());
+  }
+  printPowerStats();
 }
 
 // ------------------- SETUP / LOOP -------------------
@@ -417,25 +977,26 @@ void setup() {
   Serial.println();
   Serial.println(F("=== LIFT REMOTE ==="));
 
+  // Номера команд — со случайного: после перезагрузки пульта база не примет их за повторы
+  g_sender.begin((uint16_t)esp_random(), linkSendEspNow, nullptr);
+
   // Кнопки
-  pinMode(BTN_DOWN, INPUT_PULLUP);
-  pinMode(BTN_UP,   INPUT_PULLUP);
-  pinMode(BTN_F1,   INPUT_PULLUP);
-  pinMode(BTN_F2,   INPUT_PULLUP);
-  pinMode(BTN_F3,   INPUT_PULLUP);
+  // Кнопки: фронты по прерыванию (оба направления), loop() ждёт их в waitForEvents()
+  g_loopTask = xTaskGetCurrentTaskHandle();
+  for (uint8_t k = 0; k < KEY_COUNT; k++) {
+    pinMode(BUTTON_PIN[k], INPUT_PULLUP);
+    g_buttons[k].reset(buttonPressed(BUTTON_PIN[k]));
+    attachInterruptArg(digitalPinToInterrupt(BUTTON_PIN[k]), onButtonEdge, (void *)(uintptr_t)k, CHANGE);
+  }
 
   // Светодиоды
   pinMode(LED_DOWN, OUTPUT);
   pinMode(LED_UP,   OUTPUT);
-  pinMode(LED_F1,   OUTPUT);
-  pinMode(LED_F2,   OUTPUT);
-  pinMode(LED_F3,   OUTPUT);
+  for (uint8_t i = 0; i < FLOOR_KEYS; i++) pinMode(FLOOR_LED[i], OUTPUT);
 
   digitalWrite(LED_DOWN, LOW);
   digitalWrite(LED_UP,   LOW);
-  digitalWrite(LED_F1,   LOW);
-  digitalWrite(LED_F2,   LOW);
-  digitalWrite(LED_F3,   LOW);
+  for (uint8_t i = 0; i < FLOOR_KEYS; i++) digitalWrite(FLOOR_LED[i], LOW);
 
   // OLED
   if (!display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDR)) {
@@ -455,28 +1016,10 @@ void setup() {
   WiFi.mode(WIFI_STA);
   WiFi.disconnect();
 
-  if (esp_now_init() != ESP_OK) {
-    Serial.println(F("[ESP-NOW] init FAIL"));
-    display.clearDisplay();
-    display.setCursor(0, 0);
-    display.println(F("ESP-NOW FAIL"));
-    display.display();
-    return;
-  }
-
-  esp_now_register_send_cb(onDataSentRemote);
-  esp_now_register_recv_cb(onDataRecvRemote);
-
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, BASE_MAC, 6);
-  peerInfo.channel = 0;
-  peerInfo.encrypt = false;
-
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    Serial.println(F("[ESP-NOW] add_peer FAIL"));
+  if (const char *err = espNowStart()) {
     display.clearDisplay();
     display.setCursor(0, 0);
-    display.println(F("Peer FAIL"));
+    display.println(err);
     display.display();
     return;
   }
@@ -487,46 +1030,17 @@ void setup() {
   display.setCursor(0, 10);
   display.println(F("Ready"));
   display.display();
+  oledSyncShadow();
+
+  g_power.begin(POWER_DEFAULTS, millis());
 }
 
 void loop() {
-  // Чтение кнопок
-  bool nowDown = (digitalRead(BTN_DOWN) == LOW);
-  bool nowUp   = (digitalRead(BTN_UP)   == LOW);
-  bool nowF1   = (digitalRead(BTN_F1)   == LOW);
-  bool nowF2   = (digitalRead(BTN_F2)   == LOW);
-  bool nowF3   = (digitalRead(BTN_F3)   == LOW);
-
-  // DOWN: нажали -> MANUAL_DOWN, отпустили -> MANUAL_STOP
-  if (nowDown && !prevDown) {
-    sendCommand(CMD_MANUAL_DOWN, 0);
-  } else if (!nowDown && prevDown) {
-    sendCommand(CMD_MANUAL_STOP, 0);
-  }
+  // Кнопки — первыми: команда уходит в том же проходе, в котором проснулись
+  processButtons();
 
-  // UP: нажали -> MANUAL_UP, отпустили -> MANUAL_STOP
-  if (nowUp && !prevUp) {
-    sendCommand(CMD_MANUAL_UP, 0);
-  } else if (!nowUp && prevUp) {
-    sendCommand(CMD_MANUAL_STOP, 0);
-  }
-
-  // F1/F2/F3: по нажатию — CMD_CALL_FLOOR
-  if (nowF1 && !prevF1) {
-    sendCommand(CMD_CALL_FLOOR, 1);
-  }
-  if (nowF2 && !prevF2) {
-    sendCommand(CMD_CALL_FLOOR, 2);
-  }
-  if (nowF3 && !prevF3) {
-    sendCommand(CMD_CALL_FLOOR, 3);
-  }
-
-  prevDown = nowDown;
-  prevUp   = nowUp;
-  prevF1   = nowF1;
-  prevF2   = nowF2;
-  prevF3   = nowF3;
+  // ACK / повторы команд, Serial LINK
+  serviceLink();
 
   // Если давно не было статуса — считаем, что связь потеряна
   if (g_hasStatus && (millis() - g_lastStatusMs > 3000)) {
@@ -536,5 +1050,9 @@ void loop() {
   updateLeds();
   updateDisplay();
 
-  delay(20);
+  // Простой -> приглушить / погасить экран / light sleep (возврат отсюда — уже проснувшись)
+  powerUpdate();
+
+  // Вместо delay(20): сон до фронта кнопки, пакета от базы или дедлайна
+  waitForEvents();
 }
@@ -0,0 +1,314 @@
+// Тест кнопок пульта (remote/button_events.h): дребезг, удержание, задержка нажатия.
+//
+//   button_test [--presses N] [--bounce ms] [--busy ms] [--slice ms] [--seed N]
+//
+// Модель в виртуальном времени (шаг 10 мкс): контакт дребезжит --bounce мс на нажатии и
+// отпускании, прерывание кладёт фронт в очередь (как на пульте, 32 места) и будит loop();
+// loop() после кнопок занят экраном и связью до --busy мс, но между кусками по --slice мс
+// (страница OLED) разбирает очередь фронтов; потом спит до события или дедлайна
+// (тики FreeRTOS по 1 мс). Для сравнения тот же контакт опрашивается по-старому:
+// digitalRead раз в 20 мс + полная перерисовка экрана.
+// Проверяется: на каждое физическое нажатие ровно одно PRESS и одно RELEASE, по порядку;
+// BTN_LONG/BTN_REPEAT — только при удержании; задержка нажатие -> событие < 2 мс.
+// Код возврата 0 — всё сошлось.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "button_events.h"
+#include "reliable_link.h"   // RttHistogram
+#include "spsc_queue.h"
+
+struct Options {
+  uint32_t presses = 400;
+  double   bounceMs = 8;
+  double   busyMs   = 3;
+  double   sliceMs  = 0.5;
+  uint32_t seed     = 1;
+};
+
+static Options g_opt;
+
+static const uint8_t  KEYS           = 2;
+static const uint32_t STEP_US        = 10;
+static const uint32_t TICK_US        = 1000;   // тик FreeRTOS
+static const uint32_t LOOP_IDLE_US   = 20000;
+static const uint32_t POLL_PERIOD_US = 20000;  // старый loop(): delay(20)
+static const uint32_t POLL_DRAW_US   = 12000;  // + полный display() по I2C 400 кГц
+
+static double rnd() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+// ---------------- контакт ----------------
+
+// Уровень кнопки во времени: список переключений (время, уровень после)
+struct Contact {
+  std::vector<std::pair<uint32_t, bool>> edges;
+  size_t next  = 0;
+  bool   level = false;
+};
+
+static Contact g_contact[KEYS];
+
+// Нажатие с дребезгом на обоих фронтах
+static void addPress(uint8_t key, uint32_t atUs, uint32_t holdUs) {
+  auto bouncy = [&](uint32_t t0, bool to) {
+    uint32_t t = t0;
+    uint32_t end = t0 + (uint32_t)(rnd() * g_opt.bounceMs * 1000.0);
+    bool lv = to;
+    g_contact[key].edges.push_back({ t, lv });
+    while (true) {
+      t += 50 + (uint32_t)(rnd() * 1500);
+      if (t >= end) break;
+      lv = !lv;
+      g_contact[key].edges.push_back({ t, lv });
+    }
+    if (lv != to) g_contact[key].edges.push_back({ end > t0 ? end : t0 + 1, to });
+  };
+  bouncy(atUs, true);
+  bouncy(atUs + holdUs, false);
+}
+
+// ---------------- пульт: прерывание + loop() ----------------
+
+struct Recorded {
+  uint8_t         key;
+  ButtonEventType type;
+  uint32_t        edgeUs;   // метка события (фронт из прерывания или tick)
+  uint32_t        seenUs;   // когда loop() его обработал
+};
+
+static SpscQueue<ButtonEdge, 32> g_queue;
+static ButtonDebouncer           g_btn[KEYS];
+static std::vector<Recorded>     g_events;
+static uint32_t                  g_nowUs = 0;
+
+static void onEvent(uint8_t key, ButtonEventType type, uint32_t atUs, void *) {
+  g_events.push_back({ key, type, atUs, g_nowUs });
+}
+
+// ---------------- старый опрос ----------------
+
+struct PollResult {
+  uint32_t presses = 0;
+  std::vector<uint32_t> pressSeenUs;
+};
+
+// ---------------- прогон ----------------
+
+struct StdoutOut {
+  void printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    std::string f(fmt);
+    if (f.size() >= 2 && f.compare(f.size() - 2, 2, "\r\n") == 0) f.replace(f.size() - 2, 2, "\n");
+    vprintf(f.c_str(), ap);
+    va_end(ap);
+  }
+};
+
+static bool parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "missing value for %s\n", a.c_str());
+      return false;
+    }
+    double v = atof(argv[++i]);
+    if      (a == "--presses") g_opt.presses = (uint32_t)v;
+    else if (a == "--bounce")  g_opt.bounceMs = v;
+    else if (a == "--busy")    g_opt.busyMs = v;
+    else if (a == "--slice")   g_opt.sliceMs = v;
+    else if (a == "--seed")    g_opt.seed = (uint32_t)v;
+    else {
+      fprintf(stderr, "unknown option %s\n", a.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (!parseArgs(argc, argv)) return 2;
+  srand(g_opt.seed);
+
+  // Сценарий: нажатия по очереди на случайную кнопку. Короткие касания (короче окна
+  // дребезга), обычные и удержания с повтором.
+  std::vector<uint32_t> pressAt[KEYS];
+  std::vector<uint32_t> holdOf[KEYS];
+  uint32_t t = 100000;
+  for (uint32_t i = 0; i < g_opt.presses; i++) {
+    uint8_t key = (uint8_t)(rand() % KEYS);
+    double r = rnd();
+    uint32_t hold = r < 0.2 ? 15000 + (uint32_t)(rnd() * 20000) :      // касание
+                    r < 0.85 ? 60000 + (uint32_t)(rnd() * 400000) :    // нажатие
+                               900000 + (uint32_t)(rnd() * 1500000);   // удержание
+    addPress(key, t, hold);
+    pressAt[key].push_back(t);
+    holdOf[key].push_back(hold);
+    t += hold + (uint32_t)(g_opt.bounceMs * 1000) + 60000 + (uint32_t)(rnd() * 300000);
+  }
+  const uint32_t endUs = t + 100000;
+
+  for (uint8_t k = 0; k < KEYS; k++) g_btn[k].reset(false);
+
+  // Опрос по-старому
+  PollResult poll[KEYS];
+  bool pollPrev[KEYS] = { false };
+  uint32_t nextPollUs = 0;
+
+  bool     notified  = false;
+  uint32_t wakeAtUs  = 0;       // проснуться по таймауту
+  uint32_t busyUntil = 0;       // loop() занят (экран, связь)
+  uint32_t busyStart = 0;
+  const uint32_t sliceUs = (uint32_t)(g_opt.sliceMs * 1000.0) / STEP_US * STEP_US;
+  uint32_t loops = 0, wakes = 0;
+
+  for (g_nowUs = 0; g_nowUs < endUs; g_nowUs += STEP_US) {
+    // Контакты: фронты этого шага -> прерывание
+    for (uint8_t k = 0; k < KEYS; k++) {
+      Contact &c = g_contact[k];
+      while (c.next < c.edges.size() && c.edges[c.next].first <= g_nowUs) {
+        c.level = c.edges[c.next].second;
+        c.next++;
+        g_queue.push({ k, (uint8_t)c.level, g_nowUs });
+        notified = true;
+      }
+    }
+
+    // Старый loop(): опрос раз в 20 мс + перерисовка
+    if (g_nowUs >= nextPollUs) {
+      for (uint8_t k = 0; k < KEYS; k++) {
+        bool now = g_contact[k].level;
+        if (now && !pollPrev[k]) {
+          poll[k].presses++;
+          poll[k].pressSeenUs.push_back(g_nowUs);
+        }
+        pollPrev[k] = now;
+      }
+      nextPollUs = g_nowUs + POLL_PERIOD_US + POLL_DRAW_US;
+    }
+
+    // Новый loop(): просыпается по уведомлению или таймауту, если не занят.
+    // Занят — фронты разбираются на границах кусков (между страницами OLED).
+    if (g_nowUs < busyUntil) {
+      if (notified && (g_nowUs - busyStart) % sliceUs < STEP_US) {
+        ButtonEdge e;
+        while (g_queue.pop(e)) g_btn[e.button].onEdge(e.button, e.pressed != 0, e.atUs, onEvent, nullptr);
+        notified = false;
+      }
+      continue;
+    }
+    if (!notified && g_nowUs < wakeAtUs) continue;
+    if (notified) wakes++;
+    notified = false;
+    loops++;
+
+    ButtonEdge e;
+    while (g_queue.pop(e)) g_btn[e.button].onEdge(e.button, e.pressed != 0, e.atUs, onEvent, nullptr);
+    for (uint8_t k = 0; k < KEYS; k++) g_btn[k].tick(k, g_contact[k].level, g_nowUs, onEvent, nullptr);
+
+    busyStart = g_nowUs;
+    busyUntil = g_nowUs + (uint32_t)(rnd() * g_opt.busyMs * 1000.0);
+    uint32_t waitUs = LOOP_IDLE_US;
+    for (uint8_t k = 0; k < KEYS; k++) {
+      uint32_t d = g_btn[k].usUntilDeadline(g_nowUs);
+      if (d < waitUs) waitUs = d;
+    }
+    // ulTaskNotifyTake: целые тики, считая от конца занятости
+    wakeAtUs = busyUntil + (waitUs + TICK_US - 1) / TICK_US * TICK_US;
+  }
+
+  // Проверки: события каждой кнопки против сценария
+  bool ok = true;
+  RttHistogram latency, pollLatency;
+  latency.reset();
+  pollLatency.reset();
+  uint32_t longs = 0, repeats = 0, expectLongs = 0;
+  uint32_t pollMissed = 0, pollSpurious = 0;
+  for (uint8_t k = 0; k < KEYS; k++) {
+    size_t press = 0;
+    bool down = false;
+    for (const Recorded &r : g_events) {
+      if (r.key != k) continue;
+      if (r.type == BTN_PRESS) {
+        if (down || press >= pressAt[k].size()) {
+          fprintf(stderr, "[BTN] FAIL: key %u spurious PRESS at %.3f ms\n", k, r.seenUs / 1000.0);
+          ok = false;
+          continue;
+        }
+        latency.add(r.seenUs - pressAt[k][press]);
+        down = true;
+      } else if (r.type == BTN_RELEASE) {
+        if (!down) {
+          fprintf(stderr, "[BTN] FAIL: key %u RELEASE without PRESS at %.3f ms\n", k, r.seenUs / 1000.0);
+          ok = false;
+          continue;
+        }
+        uint32_t releasedAt = pressAt[k][press] + holdOf[k][press];
+        if (r.seenUs < releasedAt) {
+          fprintf(stderr, "[BTN] FAIL: key %u RELEASE %.3f ms before the finger left\n", k,
+                  (releasedAt - r.seenUs) / 1000.0);
+          ok = false;
+        }
+        down = false;
+        press++;
+      } else {
+        if (!down || holdOf[k][press] < BTN_LONG_US) {
+          fprintf(stderr, "[BTN] FAIL: key %u LONG/REPEAT on a short press\n", k);
+          ok = false;
+        }
+        if (r.type == BTN_LONG) longs++;
+        else                    repeats++;
+      }
+    }
+    if (press != pressAt[k].size() || down) {
+      fprintf(stderr, "[BTN] FAIL: key %u: %zu of %zu presses seen\n", k, press, pressAt[k].size());
+      ok = false;
+    }
+    for (uint32_t h : holdOf[k]) expectLongs += h >= BTN_LONG_US + BTN_DEBOUNCE_US ? 1 : 0;
+    // Опрос: нажатие, увиденное внутри физического, — первое в зачёт, остальные лишние
+    size_t j = 0;
+    for (size_t i = 0; i < pressAt[k].size(); i++) {
+      uint32_t from = pressAt[k][i];
+      uint32_t to   = from + holdOf[k][i] + (uint32_t)(g_opt.bounceMs * 1000);
+      while (j < poll[k].pressSeenUs.size() && poll[k].pressSeenUs[j] < from) j++;
+      uint32_t seen = 0;
+      for (; j < poll[k].pressSeenUs.size() && poll[k].pressSeenUs[j] <= to; j++) {
+        if (seen++ == 0) pollLatency.add(poll[k].pressSeenUs[j] - from);
+      }
+      if (seen == 0) pollMissed++;
+      else           pollSpurious += seen - 1;
+    }
+  }
+  if (longs < expectLongs) {
+    fprintf(stderr, "[BTN] FAIL: %u long presses detected, expected at least %u\n", longs, expectLongs);
+    ok = false;
+  }
+  if (latency.maxUs >= 2000) {
+    fprintf(stderr, "[BTN] FAIL: press latency up to %.2f ms\n", latency.maxUs / 1000.0);
+    ok = false;
+  }
+
+  uint32_t pollPresses = 0, bounces = 0;
+  for (uint8_t k = 0; k < KEYS; k++) {
+    pollPresses += poll[k].presses;
+    bounces += g_btn[k].bounces;
+  }
+  printf("[BTN] scenario: %u presses, bounce up to %.1f ms, loop busy up to %.1f ms (slices %.1f ms)\n",
+         g_opt.presses, g_opt.bounceMs, g_opt.busyMs, g_opt.sliceMs);
+  printf("[BTN] irq    : %zu events, %u bounce edges dropped, %u long, %u repeat, %u edges lost; "
+         "%u loop passes (%u woken by edges)\n",
+         g_events.size(), bounces, longs, repeats, g_queue.overflowCount(), loops, wakes);
+  printf("[BTN] polling: %u presses seen for %u real: %u missed, %u spurious (bounce)\n", pollPresses,
+         g_opt.presses, pollMissed, pollSpurious);
+  StdoutOut out;
+  latency.printTo(out, "[BTN] irq     press");
+  pollLatency.printTo(out, "[BTN] polling press");
+  printf("[BTN] result: %s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
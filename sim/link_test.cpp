@@ -0,0 +1,273 @@
+// Тест надёжной доставки команд (LiftController/reliable_link.h) через модель канала
+// с потерями, задержкой и дублями — в виртуальном времени, без прошивки.
+//
+//   link_test [--drop %] [--dup %] [--delay ms] [--jitter ms] [--count N]
+//             [--interval ms] [--remote-loop ms] [--seed N]
+//
+// Пульт: CommandSender, service() раз в --remote-loop мс (как delay(20) в loop() пульта).
+// Кадры — lift_protocol.h: пульт шлёт пачку команд одним кадром, база отвечает
+// на все команды кадра одним кадром ACK.
+// База: CommandReceiver, ACK уходит через 1 мс (следующий проход loop() базы).
+// Проверяется: ни одна команда не выполнена дважды, порядок выполнения = порядок отправки,
+// всё, что пульт не списал в потери, выполнено.
+// Код возврата 0 — всё сошлось.
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "reliable_link.h"
+
+struct Options {
+  double   dropPct      = 0;
+  double   dupPct       = 0;
+  double   delayMs      = 2;
+  double   jitterMs     = 0;
+  uint32_t count        = 2000;
+  double   intervalMs   = 150;   // среднее между нажатиями
+  uint32_t remoteLoopMs = 20;
+  uint32_t seed         = 1;
+};
+
+static Options g_opt;
+static uint64_t g_nowUs = 0;
+
+static const uint8_t REMOTE_MAC[6] = { 0x24, 0x6F, 0x28, 0x0A, 0x0B, 0x0C };
+
+// ---------------- канал ----------------
+
+struct Frame {
+  uint64_t             at;
+  uint64_t             order;   // при равном времени — в порядке отправки
+  bool                 toBase;
+  std::vector<uint8_t> data;
+  bool operator>(const Frame &o) const { return at != o.at ? at > o.at : order > o.order; }
+};
+
+static std::priority_queue<Frame, std::vector<Frame>, std::greater<Frame>> g_air;
+static uint64_t g_airOrder = 0;
+static uint32_t g_airSent = 0, g_airDropped = 0, g_airDuplicated = 0;
+
+static double rnd() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+static void airSend(bool toBase, const uint8_t *data, uint8_t len) {
+  g_airSent++;
+  int copies = 1;
+  if (rnd() * 100 < g_opt.dupPct) {
+    copies = 2;
+    g_airDuplicated++;
+  }
+  for (int i = 0; i < copies; i++) {
+    if (rnd() * 100 < g_opt.dropPct) {
+      g_airDropped++;
+      continue;
+    }
+    double ms = g_opt.delayMs + rnd() * g_opt.jitterMs;
+    Frame f;
+    f.at     = g_nowUs + (uint64_t)(ms * 1000.0);
+    f.order  = g_airOrder++;
+    f.toBase = toBase;
+    f.data.assign(data, data + len);
+    g_air.push(f);
+  }
+}
+
+// ---------------- пульт ----------------
+
+static CommandSender g_sender;
+
+static bool remoteSend(const uint8_t *data, uint8_t len, void *) {
+  airSend(true, data, len);
+  return true;
+}
+
+// ---------------- база ----------------
+
+static CommandReceiver g_receiver;
+static std::vector<uint16_t> g_executed;          // seq в порядке выполнения
+static std::vector<std::pair<uint64_t, std::vector<uint8_t>>> g_baseAcks;  // ACK к отправке
+
+static uint32_t g_badFrames = 0;
+
+static void baseReceive(const std::vector<uint8_t> &d) {
+  FrameReader rd;
+  if (rd.open(d.data(), (int)d.size()) != FRAME_OK) {
+    g_badFrames++;
+    return;
+  }
+  std::vector<uint8_t> ack(LIFT_FRAME_MAX);
+  FrameWriter w;
+  w.begin(ack.data(), (uint8_t)ack.size());
+  FrameRecord rec;
+  while (rd.next(rec)) {
+    const RemoteCommand *cmd = rec.as<RemoteCommand>();
+    if (!cmd) continue;
+    CommandAck *a = w.add<CommandAck>();
+    a->seq  = cmd->seq;
+    a->type = cmd->type;
+    if (g_receiver.check(REMOTE_MAC, cmd->seq) == SEQ_DUPLICATE) {
+      a->status = LINK_ACK_DUPLICATE;
+    } else {
+      g_receiver.accept(REMOTE_MAC, cmd->seq);
+      g_executed.push_back(cmd->seq);
+      a->status = LINK_ACK_OK;
+    }
+  }
+  if (w.empty()) return;
+  ack.resize(w.finish());
+  g_baseAcks.push_back({ g_nowUs + 1000, ack });
+}
+
+static void remoteReceive(const std::vector<uint8_t> &d) {
+  FrameReader rd;
+  if (rd.open(d.data(), (int)d.size()) != FRAME_OK) {
+    g_badFrames++;
+    return;
+  }
+  FrameRecord rec;
+  while (rd.next(rec)) {
+    if (const CommandAck *a = rec.as<CommandAck>()) {
+      g_sender.onAck(a->seq, (uint32_t)g_nowUs);  // как метка времени из колбэка приёма
+    }
+  }
+}
+
+// ---------------- прогон ----------------
+
+struct StdoutOut {
+  void printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    std::string f(fmt);
+    if (f.size() >= 2 && f.compare(f.size() - 2, 2, "\r\n") == 0) f.replace(f.size() - 2, 2, "\n");
+    vprintf(f.c_str(), ap);
+    va_end(ap);
+  }
+};
+
+static bool parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "missing value for %s\n", a.c_str());
+      return false;
+    }
+    double v = atof(argv[++i]);
+    if      (a == "--drop")        g_opt.dropPct = v;
+    else if (a == "--dup")         g_opt.dupPct = v;
+    else if (a == "--delay")       g_opt.delayMs = v;
+    else if (a == "--jitter")      g_opt.jitterMs = v;
+    else if (a == "--count")       g_opt.count = (uint32_t)v;
+    else if (a == "--interval")    g_opt.intervalMs = v;
+    else if (a == "--remote-loop") g_opt.remoteLoopMs = (uint32_t)v;
+    else if (a == "--seed")        g_opt.seed = (uint32_t)v;
+    else {
+      fprintf(stderr, "unknown option %s\n", a.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (!parseArgs(argc, argv)) return 2;
+  srand(g_opt.seed);
+
+  const uint16_t firstSeq = (uint16_t)rand();
+  g_sender.begin(firstSeq, remoteSend, nullptr);
+  g_receiver.reset();
+
+  std::map<uint16_t, uint32_t> seqToIndex;   // seq -> номер нажатия
+  uint32_t submitted = 0;
+  uint64_t nextPressUs = 0;
+  uint64_t nextRemoteLoopUs = 0;
+  const uint64_t stepUs = 100;
+
+  // Крутим, пока не нажато всё и не отработала очередь пульта и эфир
+  while (submitted < g_opt.count || g_sender.busy() || !g_air.empty() || !g_baseAcks.empty()) {
+    // Эфир
+    while (!g_air.empty() && g_air.top().at <= g_nowUs) {
+      Frame f = g_air.top();
+      g_air.pop();
+      if (f.toBase) baseReceive(f.data);
+      else          remoteReceive(f.data);
+    }
+    // База: ACK уходят со следующим проходом loop()
+    for (size_t i = 0; i < g_baseAcks.size();) {
+      if (g_baseAcks[i].first <= g_nowUs) {
+        airSend(false, g_baseAcks[i].second.data(), (uint8_t)g_baseAcks[i].second.size());
+        g_baseAcks.erase(g_baseAcks.begin() + i);
+      } else {
+        i++;
+      }
+    }
+    // Пульт
+    if (g_nowUs >= nextRemoteLoopUs) {
+      nextRemoteLoopUs += g_opt.remoteLoopMs * 1000ULL;
+      while (submitted < g_opt.count && g_nowUs >= nextPressUs) {
+        uint16_t seq = g_sender.nextSeq;
+        if (g_sender.submit((uint8_t)(1 + submitted % 8), (uint8_t)(submitted % 15))) {
+          seqToIndex[seq] = submitted;
+        }
+        submitted++;
+        nextPressUs += (uint64_t)(-log(1.0 - rnd()) * g_opt.intervalMs * 1000.0);
+      }
+      g_sender.service((uint32_t)g_nowUs);
+    }
+    g_nowUs += stepUs;
+  }
+
+  // Проверки
+  bool ok = true;
+  std::map<uint16_t, int> seen;
+  int64_t lastIndex = -1;
+  for (uint16_t seq : g_executed) {
+    if (++seen[seq] > 1) {
+      fprintf(stderr, "[LINK] FAIL: seq %u executed twice\n", seq);
+      ok = false;
+    }
+    auto it = seqToIndex.find(seq);
+    if (it == seqToIndex.end()) {
+      fprintf(stderr, "[LINK] FAIL: executed unknown seq %u\n", seq);
+      ok = false;
+      continue;
+    }
+    if ((int64_t)it->second <= lastIndex) {
+      fprintf(stderr, "[LINK] FAIL: seq %u executed out of order\n", seq);
+      ok = false;
+    }
+    lastIndex = it->second;
+  }
+  if (g_badFrames) {
+    fprintf(stderr, "[LINK] FAIL: %u frames failed to decode\n", g_badFrames);
+    ok = false;
+  }
+  const LinkSenderStats &st = g_sender.stats;
+  uint32_t queued = st.submitted;
+  uint32_t executed = (uint32_t)g_executed.size();
+  // Потерянные пультом могли всё же дойти (потерялись только ACK) — но не наоборот
+  if (executed + st.lost < queued || executed > queued) {
+    fprintf(stderr, "[LINK] FAIL: %u queued, %u executed, %u lost\n", queued, executed, st.lost);
+    ok = false;
+  }
+
+  printf("[LINK] channel: drop %.1f%%, dup %.1f%%, delay %.1f+%.1f ms; %u frames, %u dropped, %u duplicated\n",
+         g_opt.dropPct, g_opt.dupPct, g_opt.delayMs, g_opt.jitterMs, g_airSent, g_airDropped, g_airDuplicated);
+  printf("[LINK] remote: %u pressed, %u queued (%u queue full), %u sent, %u retransmits, %u acked, "
+         "%u lost, %u stale acks\n",
+         submitted, queued, st.queueFull, st.transmissions, st.retransmits, st.acked, st.lost, st.staleAcks);
+  printf("[LINK] base  : %u executed (%u of them counted lost by the remote)\n", executed,
+         executed + st.lost > queued ? executed + st.lost - queued : 0);
+  StdoutOut out;
+  g_sender.rtt.printTo(out, "[LINK] remote");
+  printf("[LINK] result: %s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
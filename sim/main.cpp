@@ -0,0 +1,920 @@
+// liftsim — прошивка LiftController на Linux с виртуальными часами и стендом.
+//
+//   liftsim [опции] [сценарий.txt]
+//
+// Без сценария: полная калибровка + 200 случайных поездок по этажам.
+// Код возврата 0 — всё доехало без ошибок и без потерянных шагов.
+
+#include <Arduino.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+#include "plant.h"
+#include "state_machine.h"
+#include "motor_controller.h"
+#include "io_manager.h"
+#include "step_bench.h"
+#include "floor_manager.h"
+#include "calibration_manager.h"
+#include "logger.h"
+#include "serial_interface.h"
+#include "command_queue.h"
+#include "lift_protocol.h"
+#include <Preferences.h>
+
+void setup();
+
+// ================== Параметры ==================
+
+struct SimOptions {
+  PlantConfig plant;
+  uint32_t    loopCostUs = 20;
+  uint32_t    seed       = 1;
+  bool        verbose    = false;
+  bool        pollSteps  = false;
+  bool        rmtSteps   = false;
+  bool        sCurve     = false;
+  long        accel      = 0;     // 0 — как в прошивке
+  long        jerk       = 0;
+  long        floors     = 0;     // 0 — как в прошивке
+  std::string nvsFile;            // образ NVS: калибровка переживает перезапуск liftsim
+  bool        encoder    = false; // обратная связь по энкодеру (ENCODER 1 после каждой загрузки)
+  std::string serialOut;          // весь вывод UART (текст + кадры телеметрии) как есть
+  std::string script;
+};
+
+static SimOptions g_opt;
+
+// ================== Статистика ==================
+
+struct SimStats {
+  uint32_t trips        = 0;
+  uint64_t tripTimeUs   = 0;
+  uint64_t tripTimeMax  = 0;
+  long     maxPosError  = 0;
+  int64_t  etaErrMaxUs  = 0;   // |время поездки − ETA в начале| (motorGetEtaMs), наибольшее
+  uint64_t calibTimeUs  = 0;
+  uint64_t loops        = 0;
+  // Нагрузка вызовами (calls)
+  uint32_t calls        = 0;
+  uint64_t waitUs       = 0;   // от вызова до прибытия на этаж
+  uint64_t waitMax      = 0;
+  uint32_t stops        = 0;
+  uint64_t loadTimeUs   = 0;
+  // Перезагрузки (reboot)
+  uint32_t reboots      = 0;
+  uint64_t bootToIdleUs = 0;   // от включения до IDLE (можно ехать)
+  // Входы (pot-noise, switch-bounce)
+  uint32_t speedChanges = 0;   // смен maxSpeed на ходу при неподвижной ручке
+  uint32_t topEdgesPrev = 0;   // фронтов концевика в прошлых загрузках (ioInit() обнуляет)
+};
+
+static SimStats g_stats;
+
+// Статус базы → пульт (ESP-NOW): кадры, задержка изменений, эфир в простое
+struct LinkStats {
+  uint32_t full        = 0;   // полные LiftStatus
+  uint32_t motion      = 0;   // кадры движения
+  uint32_t acks        = 0;   // ACK на команды пульта (записей)
+  uint32_t frames      = 0;   // кадров ESP-NOW всего
+  uint32_t bytes       = 0;
+  uint32_t idleFrames  = 0;   // кадры, пока стоим в IDLE
+  uint64_t idleUs      = 0;
+  // Что пульт знает по последнему полному статусу
+  bool     known       = false;
+  uint8_t  state = 0, floor = 0, target = 0;
+  // Изменение, которое ещё не ушло
+  bool     pending     = false;
+  uint64_t changeUs    = 0;
+  uint32_t changes     = 0;
+  uint64_t latencySum  = 0;
+  uint64_t latencyMax  = 0;
+  // CMD_STATUS_REQUEST (пульт проснулся) -> первый полный статус после него
+  bool     syncPending = false;
+  uint64_t syncReqUs   = 0;
+  uint32_t syncs       = 0;
+  uint64_t syncMaxUs   = 0;
+};
+
+// Ответ на CMD_STATUS_REQUEST должен прийти заметно раньше heartbeat (1 с)
+static const uint64_t SYNC_MAX_US = 100000;
+
+// Поездка без доводки по энкодеру должна уложиться в ETA начала поездки с этой точностью
+static const int64_t ETA_TOLERANCE_US = 100000;
+
+static LinkStats g_link;
+static long     g_plantOffset = 0;   // положение стенда, соответствующее позиции прошивки 0
+static bool     g_calibrated  = false;
+static bool     g_failed      = false;
+
+static const char *STATE_NAMES[] = {
+  "BOOT", "NEED_CALIB", "CALIB_HOMING_UP", "CALIB_MOVING_DOWN",
+  "IDLE", "MOVING", "MANUAL_MOVE", "ERROR", "VERIFY_HOMING"
+};
+static const int STATE_COUNT = sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]);
+
+static const char *stateName(LiftState s) {
+  return ((int)s < STATE_COUNT) ? STATE_NAMES[s] : "?";
+}
+
+static int stateFromName(const std::string &name) {
+  for (int i = 0; i < STATE_COUNT; i++) {
+    if (name == STATE_NAMES[i]) return i;
+  }
+  return -1;
+}
+
+static void fail(const std::string &msg) {
+  logFlush();  // хвост лога прошивки — до сообщения об ошибке
+  fprintf(stderr, "[SIM] FAIL at t=%.3fs: %s (state=%s pos=%ld cabin=%ld)\n",
+          simNowUs() / 1e6, msg.c_str(), stateName(smGetState()),
+          motorGetCurrentPosition(), plantCabinPos());
+  g_failed = true;
+}
+
+// ================== Прогон ==================
+
+static bool baseIsIdle() {
+  return smGetState() == STATE_IDLE && !motorIsBusy();
+}
+
+// Кадр базы в эфир (вызывается изнутри loop(), из esp_now_send)
+static void onBaseTx(const uint8_t *mac, const uint8_t *data, size_t len) {
+  (void)mac;
+  if (baseIsIdle()) g_link.idleFrames++;
+  g_link.frames++;
+  g_link.bytes += (uint32_t)len;
+
+  FrameReader rd;
+  FrameError err = rd.open(data, (int)len);
+  if (err != FRAME_OK) {
+    fail(std::string("base sent a bad frame: ") + frameErrorName(err));
+    return;
+  }
+  FrameRecord rec;
+  while (rd.next(rec)) {
+    if (rec.as<CommandAck>()) {
+      g_link.acks++;
+    } else if (rec.as<LiftMotion>()) {
+      g_link.motion++;
+    } else if (const LiftStatus *st = rec.as<LiftStatus>()) {
+      g_link.full++;
+      if (g_link.syncPending) {
+        uint64_t lat = simNowUs() - g_link.syncReqUs;
+        g_link.syncs++;
+        if (lat > g_link.syncMaxUs) g_link.syncMaxUs = lat;
+        g_link.syncPending = false;
+      }
+      bool differs = !g_link.known || st->state != g_link.state || st->currentFloor != g_link.floor ||
+                     st->targetFloor != g_link.target;
+      if (differs && g_link.known) {
+        // Изменение замечено стендом после прошлого loop() — иначе ушло в том же проходе
+        uint64_t lat = g_link.pending ? simNowUs() - g_link.changeUs : 0;
+        g_link.changes++;
+        g_link.latencySum += lat;
+        if (lat > g_link.latencyMax) g_link.latencyMax = lat;
+      }
+      g_link.known   = true;
+      g_link.state   = st->state;
+      g_link.floor   = st->currentFloor;
+      g_link.target  = st->targetFloor;
+      g_link.pending = false;
+    }
+  }
+}
+
+// После каждого loop(): есть ли у базы то, чего пульт ещё не знает
+static void observeLink(uint64_t dtUs) {
+  if (!g_link.known) return;
+  if (baseIsIdle()) g_link.idleUs += dtUs;
+  bool differs = (uint8_t)smGetState() != g_link.state || smGetCurrentFloor() != g_link.floor ||
+                 smGetTargetFloor() != g_link.target;
+  if (differs && !g_link.pending) {
+    g_link.pending  = true;
+    g_link.changeUs = simNowUs();
+  } else if (!differs) {
+    g_link.pending = false;  // вернулось к тому, что пульт уже видел
+  }
+}
+
+// Предел скорости на ходу: пока ручку не трогали с начала поездки, он меняться не должен
+static void observeSpeedLimit() {
+  static bool     moving = false;
+  static uint16_t tripPot = 0;
+  static float    limit   = 0;
+  bool now = smGetState() == STATE_MOVING;
+  if (now && !moving) tripPot = plantConfig().pot;
+  else if (now && plantConfig().pot == tripPot && motorGetMaxSpeed() != limit) g_stats.speedChanges++;
+  moving = now;
+  limit  = motorGetMaxSpeed();
+}
+
+static void stepOnce() {
+  uint64_t t0 = simNowUs();
+  simLoopOnce();
+  g_stats.loops++;
+  observeLink(simNowUs() - t0);
+  observeSpeedLimit();
+}
+
+static uint32_t topSwitchEdges() {
+  IoSnapshot s;
+  ioGetSnapshot(s);
+  return g_stats.topEdgesPrev + s.sw[IO_SW_TOP].edges;
+}
+
+static void runLoops(uint64_t us) {
+  uint64_t end = simNowUs() + us;
+  while (simNowUs() < end) stepOnce();
+}
+
+// Крутит loop(), пока cond() не станет true; false — таймаут
+template <typename Cond>
+static bool runUntil(Cond cond, uint64_t timeoutUs) {
+  uint64_t end = simNowUs() + timeoutUs;
+  while (!cond()) {
+    if (simNowUs() >= end) return false;
+    stepOnce();
+  }
+  return true;
+}
+
+static bool waitState(LiftState s, uint64_t timeoutUs) {
+  return runUntil([&] { return smGetState() == s; }, timeoutUs);
+}
+
+// Ошибка позиции: насколько стенд разошёлся с тем, что думает прошивка
+static long positionError() {
+  return (plantCabinPos() - g_plantOffset) - motorGetCurrentPosition();
+}
+
+static bool doCalibrate() {
+  uint64_t t0 = simNowUs();
+
+  simSerialInput("CALIB");
+  if (!waitState(STATE_CALIB_MOVING_DOWN, 120000000ULL)) {
+    fail("calibration: top switch not reached");
+    return false;
+  }
+
+  simSerialInput("CALIB_DOWN_START");
+  // «Оператор» жмёт F1, когда кабина дошла до нижнего упора
+  if (!runUntil([] { return plantCabinPos() <= 0; }, 120000000ULL)) {
+    fail("calibration: bottom not reached");
+    return false;
+  }
+  simSerialInput("CALIB_DOWN_SAVE");
+  if (!waitState(STATE_IDLE, 1000000ULL)) {
+    fail("calibration: not IDLE after save");
+    return false;
+  }
+  // Спуск встал сразу, без торможения (точка калибровки) — «оператор» отпускает F1 не мгновенно,
+  // и вал успевает остановиться до первой поездки вверх
+  runLoops(200000);
+
+  g_plantOffset = plantCabinPos() - motorGetCurrentPosition();
+  g_calibrated  = true;
+  g_stats.calibTimeUs += simNowUs() - t0;
+  return true;
+}
+
+static bool doTrip(uint8_t floor) {
+  char cmd[8];
+  snprintf(cmd, sizeof(cmd), "F%u", floor);
+  // Время поездки — без стоянки на этаже после предыдущей
+  runUntil([] { return !smIsDwelling(); }, 60000000ULL);
+  uint64_t t0 = simNowUs();
+  simSerialInput(cmd);
+
+  // Вызов ставится в очередь, поездку начинает тик автомата
+  if (!waitState(STATE_MOVING, 1000000ULL)) {
+    fail(std::string("trip to floor ") + std::to_string(floor) + " did not start");
+    return false;
+  }
+  uint64_t tMove = simNowUs();
+  uint32_t eta   = motorGetEtaMs();
+  bool etaExact  = motorEtaIsExact();
+  // Длинный ход на малой скорости идёт минутами — ждём по плану прошивки с запасом;
+  // в STEP_POLL шаг не чаще прохода loop() — поездка в разы дольше плана
+  uint64_t waitUs = (uint64_t)eta * 1000 * (etaExact ? 1 : 8) + 5000000ULL;
+  if (!waitState(STATE_IDLE, waitUs)) {
+    fail(std::string("trip to floor ") + std::to_string(floor) + " did not finish");
+    return false;
+  }
+  if (smGetCurrentFloor() != floor) {
+    fail("arrived at wrong floor " + std::to_string(smGetCurrentFloor()));
+    return false;
+  }
+
+  int64_t etaErr = (int64_t)(simNowUs() - tMove) - (int64_t)eta * 1000;
+  if (etaExact && llabs(etaErr) > llabs(g_stats.etaErrMaxUs)) g_stats.etaErrMaxUs = etaErr;
+
+  uint64_t dt = simNowUs() - t0;
+  g_stats.trips++;
+  g_stats.tripTimeUs += dt;
+  if (dt > g_stats.tripTimeMax) g_stats.tripTimeMax = dt;
+
+  long err = labs(positionError());
+  if (err > g_stats.maxPosError) g_stats.maxPosError = err;
+  return true;
+}
+
+static bool doTrips(uint32_t n) {
+  if (!g_calibrated) {
+    fail("trips: not calibrated");
+    return false;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t cur = smGetCurrentFloor();
+    uint8_t next;
+    do {
+      next = (uint8_t)(1 + rand() % floorGetCount());
+    } while (next == cur);
+    if (!doTrip(next)) return false;
+  }
+  return true;
+}
+
+// Положение стенда тоже «переживает» перезапуск liftsim: кладём его в NVS рядом
+// с калибровкой, в своём пространстве имён (прошивка его не видит)
+static void plantSave() {
+  if (g_opt.nvsFile.empty()) return;
+  Preferences p;
+  p.begin("sim");
+  p.putLong("cabin", plantCabinPos());
+  p.putLong("offset", g_plantOffset);
+  p.end();
+}
+
+static void plantRestore() {
+  if (g_opt.nvsFile.empty()) return;
+  Preferences p;
+  p.begin("sim", true);
+  if (p.isKey("cabin")) {
+    g_opt.plant.startAt = p.getLong("cabin");
+    g_plantOffset       = p.getLong("offset");
+  }
+  p.end();
+}
+
+// Параметры командной строки поверх того, что выставила setup()
+static void applyOptions() {
+  if (g_opt.pollSteps) motorSetStepMode(STEPGEN_POLLING);
+  if (g_opt.rmtSteps)  motorSetStepMode(STEPGEN_RMT);
+  if (g_opt.floors && !calibHasValidData()) floorSetCount((uint8_t)g_opt.floors);
+  if (g_opt.sCurve)    motorSetProfile(RAMP_SCURVE);
+  if (g_opt.accel)     motorSetAccel((float)g_opt.accel);
+  if (g_opt.jerk)      motorSetJerk((float)g_opt.jerk);
+  if (g_opt.encoder)   motorSetEncoder(true);
+}
+
+// Включение питания: setup() и ожидание готовности (IDLE без проверочного хоминга
+// или после него). Кабина стоит, где её застало выключение.
+static bool doBoot() {
+  uint64_t t0 = simNowUs();
+  uint32_t w0 = simNvsWriteCount();
+  g_stats.topEdgesPrev = topSwitchEdges();
+  setup();
+  applyOptions();
+  g_calibrated = calibHasValidData();
+
+  if (!g_calibrated) {
+    printf("[SIM] boot: no calibration in NVS\n");
+    return true;
+  }
+  if (!runUntil([] { return smGetState() == STATE_IDLE; }, 120000000ULL)) {
+    fail("boot: not IDLE");
+    return false;
+  }
+  uint64_t idleUs = simNowUs() - t0;
+  if (!runUntil([] { return smGetState() == STATE_IDLE && !smIsVerifyPending(); }, 120000000ULL)) {
+    fail("boot: verify homing did not finish");
+    return false;
+  }
+  if (calibBootPositionTrusted()) {
+    long err = labs(positionError());
+    if (err > g_stats.maxPosError) g_stats.maxPosError = err;
+  } else {
+    // Позиция была неизвестна: хоминг заново задал начало отсчёта (с точностью
+    // до момента опроса концевика, как и при калибровке) — от него и считаем
+    printf("[SIM] boot: homing moved origin by %ld steps\n", positionError());
+    g_plantOffset = plantCabinPos() - motorGetCurrentPosition();
+  }
+
+  g_stats.reboots++;
+  g_stats.bootToIdleUs += idleUs;
+  printf("[SIM] boot: IDLE after %.3f s, verified after %.3f s, floor %u, NVS writes %u\n",
+         idleUs / 1e6, (simNowUs() - t0) / 1e6, smGetCurrentFloor(), simNvsWriteCount() - w0);
+  return true;
+}
+
+// Поток команд по Serial: n строк с частотой perSec, каждая пятая — с ошибкой.
+// Проверяет, что парсер принял ровно правильные и отверг ровно неправильные.
+static bool doFlood(uint32_t n, uint32_t perSec) {
+  static const char *const BAD[] = {
+    "GOTO x12", "SET SPEED 5", "F", "XYZZY", "JOG 1 2",
+    "STATUS 0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789",
+  };
+  const uint32_t badCount = sizeof(BAD) / sizeof(BAD[0]);
+  char good[32];
+  uint32_t cmd0 = serialGetCommandCount(), err0 = serialGetErrorCount();
+  uint64_t blocked0 = simSerialBlockedUs(), t0 = simNowUs();
+  uint32_t expectBad = 0;
+  uint64_t gapUs = perSec ? 1000000ULL / perSec : 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    if (i % 5 == 4) {
+      simSerialInput(BAD[(i / 5) % badCount]);
+      expectBad++;
+    } else {
+      switch (i % 5) {
+        case 0: snprintf(good, sizeof(good), "STOP"); break;
+        case 1: snprintf(good, sizeof(good), "set accel %ld", (long)motorGetAccel()); break;
+        case 2: snprintf(good, sizeof(good), "SET MAXSPEED 0"); break;
+        default: snprintf(good, sizeof(good), "CLEAR"); break;
+      }
+      simSerialInput(good);
+    }
+    runLoops(gapUs ? gapUs : g_opt.loopCostUs);
+  }
+  runLoops(10000);
+
+  uint32_t okCmds = serialGetCommandCount() - cmd0, errs = serialGetErrorCount() - err0;
+  printf("[SIM] flood: %u lines at %u/s, accepted %u, rejected %u, loop blocked %.1f ms over %.2f s\n",
+         n, perSec, okCmds, errs, (simSerialBlockedUs() - blocked0) / 1000.0, (simNowUs() - t0) / 1e6);
+  if (okCmds != n - expectBad || errs != expectBad) {
+    fail("flood: expected " + std::to_string(n - expectBad) + " accepted / " +
+         std::to_string(expectBad) + " rejected");
+    return false;
+  }
+  return true;
+}
+
+// Нагрузка вызовами: n вызовов со случайными (экспоненциальными, в среднем meanMs)
+// интервалами, случайный этаж и тип (кабина / площадка вверх / вниз).
+// Ожидание считается по этажу: от первого вызова до снятия его из очереди.
+static bool doCallLoad(uint32_t n, uint32_t meanMs) {
+  if (!g_calibrated) {
+    fail("calls: not calibrated");
+    return false;
+  }
+  uint8_t floors = floorGetCount();
+  std::vector<uint64_t> pressUs(floors + 1, 0);
+  uint64_t t0       = simNowUs();
+  uint64_t nextAt   = t0;
+  uint64_t deadline = t0 + (uint64_t)n * meanMs * 1000 * 4 + 120000000ULL;
+  uint32_t issued   = 0;
+
+  while (issued < n || smGetPendingCalls() || smGetState() != STATE_IDLE) {
+    if (simNowUs() > deadline) {
+      fail("calls: load not served in time");
+      return false;
+    }
+    if (smGetState() == STATE_ERROR) {
+      fail("calls: lift went to ERROR");
+      return false;
+    }
+
+    if (issued < n && simNowUs() >= nextAt) {
+      uint8_t f = (uint8_t)(1 + rand() % floors);
+      int kind  = rand() % 3;
+      char cmd[8];
+      // С крайних этажей площадочный вызов только в одну сторону
+      if (kind == 1 && f < floors)  snprintf(cmd, sizeof(cmd), "U%u", f);
+      else if (kind == 2 && f > 1)  snprintf(cmd, sizeof(cmd), "D%u", f);
+      else                          snprintf(cmd, sizeof(cmd), "F%u", f);
+      simSerialInput(cmd);
+      if (!pressUs[f]) pressUs[f] = simNowUs();
+      issued++;
+
+      double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+      nextAt += (uint64_t)(-log(u) * meanMs * 1000.0);
+    }
+
+    LiftState prev = smGetState();
+    stepOnce();
+    if (prev == STATE_MOVING && smGetState() == STATE_IDLE) g_stats.stops++;
+
+    // Вызов обработан в этой же итерации loop(): нет бита — этаж обслужен
+    // (или кабина уже стояла на нём)
+    uint16_t calls = smGetPendingCalls();
+    for (uint8_t f = 1; f <= floors; f++) {
+      if (!pressUs[f] || (calls & (1u << f))) continue;
+      uint64_t w = simNowUs() - pressUs[f];
+      g_stats.calls++;
+      g_stats.waitUs += w;
+      if (w > g_stats.waitMax) g_stats.waitMax = w;
+      pressUs[f] = 0;
+    }
+  }
+
+  g_stats.loadTimeUs += simNowUs() - t0;
+  long err = labs(positionError());
+  if (err > g_stats.maxPosError) g_stats.maxPosError = err;
+  return true;
+}
+
+static void report(double wallMs) {
+  double simS = simNowUs() / 1e6;
+  printf("[SIM] virtual time   : %.3f s\n", simS);
+  printf("[SIM] wall time      : %.1f ms (x%.0f real time)\n", wallMs,
+         wallMs > 0 ? simS * 1000.0 / wallMs : 0.0);
+  printf("[SIM] loop() calls   : %llu\n", (unsigned long long)g_stats.loops);
+  printf("[SIM] calibration    : %.3f s\n", g_stats.calibTimeUs / 1e6);
+  if (g_stats.trips) {
+    printf("[SIM] trips          : %u, avg %.3f s, max %.3f s\n", g_stats.trips,
+           g_stats.tripTimeUs / 1e6 / g_stats.trips, g_stats.tripTimeMax / 1e6);
+    printf("[SIM] trip ETA       : worst %+.1f ms off the planned move time\n", g_stats.etaErrMaxUs / 1000.0);
+  }
+  if (g_stats.reboots) {
+    printf("[SIM] reboots        : %u, boot to IDLE avg %.3f s\n", g_stats.reboots,
+           g_stats.bootToIdleUs / 1e6 / g_stats.reboots);
+  }
+  if (g_stats.calls) {
+    printf("[SIM] call load      : %u floor calls served, wait avg %.3f s, max %.3f s\n",
+           g_stats.calls, g_stats.waitUs / 1e6 / g_stats.calls, g_stats.waitMax / 1e6);
+    printf("[SIM] stops          : %u in %.1f s (%.1f trips/min)\n", g_stats.stops,
+           g_stats.loadTimeUs / 1e6, g_stats.stops * 60e6 / g_stats.loadTimeUs);
+  }
+  printf("[SIM] steps          : %llu (stalled %llu)\n",
+         (unsigned long long)plantStepCount(), (unsigned long long)plantStalledSteps());
+  printf("[SIM] max pos error  : %ld steps\n", g_stats.maxPosError);
+  if (plantReversalLost()) {
+    printf("[SIM] reversal       : %llu steps lost reversing before the shaft stopped\n",
+           (unsigned long long)plantReversalLost());
+  }
+  if (plantSlippedSteps() || motorEncoderActive()) {
+    printf("[SIM] encoder        : %s, %llu steps slipped or jammed, plant count %ld\n",
+           motorEncoderActive() ? "on" : "off", (unsigned long long)plantSlippedSteps(), plantEncoderCount());
+  }
+  printf("[SIM] inputs         : top switch %u crossings, %u edges after debounce; "
+         "speed limit changed %u times mid-trip\n",
+         plantTopCrossings(), topSwitchEdges(), g_stats.speedChanges);
+  if (g_opt.rmtSteps) {
+    StepGenSimRmtStats r;
+    stepGenSimRmtGetStats(&r);
+    printf("[SIM] RMT stream     : %u intervals checked, %u mismatches, %u refills, "
+           "max %u steps ahead, %u underruns\n",
+           r.checked, r.mismatches, r.refills, r.maxAhead, r.underruns);
+  }
+  if (g_link.full) {
+    printf("[SIM] status link    : %u frames (%u B): %u full + %u motion + %u ACKs, idle %.2f frames/s\n",
+           g_link.frames, g_link.bytes, g_link.full, g_link.motion, g_link.acks,
+           g_link.idleUs ? g_link.idleFrames * 1e6 / g_link.idleUs : 0.0);
+    if (g_link.changes) {
+      printf("[SIM] status latency : %u changes, avg %.1f ms, max %.1f ms\n", g_link.changes,
+             g_link.latencySum / 1000.0 / g_link.changes, g_link.latencyMax / 1000.0);
+    }
+    if (g_link.syncs) {
+      printf("[SIM] status request : %u answered, max %.1f ms\n", g_link.syncs, g_link.syncMaxUs / 1000.0);
+    }
+  }
+  printf("[SIM] NVS writes     : %u\n", simNvsWriteCount());
+  printf("[SIM] log dropped    : %u\n", logGetDropped());
+  printf("[SIM] command queue  : remote %u (lost %u, max depth %u), serial %u (lost %u, max depth %u)\n",
+         cmdQueueGetPushed(CMD_SRC_REMOTE), cmdQueueGetOverflow(CMD_SRC_REMOTE),
+         cmdQueueGetHighWater(CMD_SRC_REMOTE), cmdQueueGetPushed(CMD_SRC_SERIAL),
+         cmdQueueGetOverflow(CMD_SRC_SERIAL), cmdQueueGetHighWater(CMD_SRC_SERIAL));
+  printf("[SIM] serial TX      : %llu bytes, loop blocked %.1f ms\n",
+         (unsigned long long)simSerialTxBytes(), simSerialBlockedUs() / 1000.0);
+}
+
+// ================== Сценарий ==================
+
+// Пульт для команды сценария remote: MAC, номер и последний кадр (для remote-repeat)
+static const uint8_t REMOTE_MAC[6] = { 0x24, 0x6F, 0x28, 0x0A, 0x0B, 0x0C };
+static uint16_t      g_remoteSeq = 0;
+static uint8_t       g_remoteFrame[LIFT_FRAME_MAX];
+static uint8_t       g_remoteFrameLen = 0;
+
+// Одна строка сценария. false — сценарий надо прервать.
+static bool runScriptLine(const std::string &raw) {
+  std::string line = raw.substr(0, raw.find('#'));
+  std::istringstream in(line);
+  std::string cmd;
+  if (!(in >> cmd)) return true;
+
+  if (cmd == "send") {
+    std::string rest;
+    std::getline(in, rest);
+    size_t b = rest.find_first_not_of(' ');
+    simSerialInput(b == std::string::npos ? "" : rest.c_str() + b);
+  } else if (cmd == "wait") {
+    uint64_t ms = 0;
+    in >> ms;
+    runLoops(ms * 1000);
+  } else if (cmd == "until") {
+    std::string what;
+    in >> what;
+    uint64_t timeoutMs = 60000;
+    if (what == "state") {
+      std::string name;
+      in >> name >> timeoutMs;
+      int s = stateFromName(name);
+      if (s < 0) { fail("unknown state " + name); return false; }
+      if (!waitState((LiftState)s, timeoutMs * 1000)) { fail("timeout waiting state " + name); return false; }
+    } else if (what == "cabin") {
+      std::string op;
+      long v = 0;
+      in >> op >> v >> timeoutMs;
+      bool ok = (op == "<=")
+        ? runUntil([&] { return plantCabinPos() <= v; }, timeoutMs * 1000)
+        : runUntil([&] { return plantCabinPos() >= v; }, timeoutMs * 1000);
+      if (!ok) { fail("timeout waiting cabin " + op + " " + std::to_string(v)); return false; }
+    } else {
+      fail("unknown until: " + what);
+      return false;
+    }
+  } else if (cmd == "expect") {
+    std::string what, name;
+    in >> what >> name;
+    if (what == "pos") {
+      if (std::to_string(motorGetCurrentPosition()) != name) {
+        fail("expect pos " + name);
+        return false;
+      }
+    } else if (what == "floor") {
+      if (std::to_string(smGetCurrentFloor()) != name) {
+        fail("expect floor " + name + ", got " + std::to_string(smGetCurrentFloor()));
+        return false;
+      }
+    } else if (what == "error") {
+      if (std::to_string(smGetErrorCode()) != name) {
+        fail("expect error " + name + ", got " + std::to_string(smGetErrorCode()));
+        return false;
+      }
+    } else if (what != "state" || stateFromName(name) != (int)smGetState()) {
+      fail("expect " + what + " " + name);
+      return false;
+    }
+  } else if (cmd == "pot") {
+    unsigned v = 0;
+    in >> v;
+    plantSetPot((uint16_t)v);
+  } else if (cmd == "pot-noise") {
+    unsigned v = 0;
+    in >> v;
+    plantSetPotNoise((uint16_t)v);
+  } else if (cmd == "slip") {
+    unsigned v = 0;
+    in >> v;
+    plantSetSlip((uint16_t)v);
+  } else if (cmd == "step-hold") {
+    unsigned ms = 0;
+    in >> ms;
+    simStepTimerHold((uint64_t)ms * 1000);
+  } else if (cmd == "jam") {
+    unsigned ms = 0;
+    in >> ms;
+    plantJam(ms * 1000);
+  } else if (cmd == "switch-bounce") {
+    unsigned ms = 0;
+    in >> ms;
+    plantSetSwitchBounce(ms * 1000);
+  } else if (cmd == "calib-button") {
+    int v = 0;
+    in >> v;
+    plantSetCalibButton(v != 0);
+  } else if (cmd == "calibrate") {
+    return doCalibrate();
+  } else if (cmd == "trips") {
+    uint32_t n = 0;
+    in >> n;
+    return doTrips(n);
+  } else if (cmd == "calls") {
+    uint32_t n = 0, meanMs = 10000;
+    in >> n >> meanMs;
+    return doCallLoad(n, meanMs);
+  } else if (cmd == "remote") {
+    // Кадр(ы) пульта по ESP-NOW; count > 1 — пачкой за один проход loop()
+    unsigned type = 0, arg = 0, count = 1;
+    in >> type >> arg >> count;
+    for (unsigned i = 0; i < count; i++) {
+      FrameWriter w;
+      w.begin(g_remoteFrame, sizeof(g_remoteFrame));
+      RemoteCommand *c = w.add<RemoteCommand>();
+      c->type = (uint8_t)type;
+      c->arg  = (uint8_t)arg;
+      c->seq  = g_remoteSeq++;
+      g_remoteFrameLen = w.finish();
+      if (type == CMD_STATUS_REQUEST && !g_link.syncPending) {
+        g_link.syncPending = true;
+        g_link.syncReqUs   = simNowUs();
+      }
+      simEspNowDeliver(REMOTE_MAC, g_remoteFrame, g_remoteFrameLen);
+    }
+  } else if (cmd == "remote-repeat") {
+    // Повтор последнего кадра с тем же seq — как будто пульт не получил ACK
+    simEspNowDeliver(REMOTE_MAC, g_remoteFrame, g_remoteFrameLen);
+  } else if (cmd == "remote-corrupt") {
+    // Последний кадр пульта, испорченный: version — чужая версия протокола, crc — бит в данных
+    std::string what;
+    in >> what;
+    if (!g_remoteFrameLen) {
+      fprintf(stderr, "[SIM] remote-corrupt: no remote frame sent yet\n");
+      return false;
+    }
+    uint8_t bad[LIFT_FRAME_MAX];
+    memcpy(bad, g_remoteFrame, g_remoteFrameLen);
+    if (what == "version") {
+      bad[1] = LIFT_PROTO_VERSION + 1;
+    } else if (what == "crc") {
+      bad[sizeof(WireHeader) + sizeof(TlvHeader)] ^= 0x01;
+    } else {
+      fprintf(stderr, "[SIM] remote-corrupt: expected version|crc, got '%s'\n", what.c_str());
+      return false;
+    }
+    simEspNowDeliver(REMOTE_MAC, bad, g_remoteFrameLen);
+  } else if (cmd == "flood") {
+    uint32_t n = 0, perSec = 500;
+    in >> n >> perSec;
+    return doFlood(n, perSec);
+  } else if (cmd == "reboot") {
+    // Выключение в любой момент (в том числе на ходу) и включение заново
+    return doBoot();
+  } else if (cmd == "ready") {
+    uint64_t timeoutMs = 120000;
+    in >> timeoutMs;
+    if (!runUntil([] { return smGetState() == STATE_IDLE && !smIsVerifyPending() && !smIsDwelling(); },
+                  timeoutMs * 1000)) {
+      fail("timeout waiting ready");
+      return false;
+    }
+  } else if (cmd == "bench") {
+    // Бенчмарк прошивки (команда BENCH), отчёт печатает сама прошивка
+    simSerialInput("BENCH");
+    runLoops(g_opt.loopCostUs * 4);
+    if (!runUntil([] { return !benchIsRunning(); }, 600000000ULL)) {
+      fail("bench did not finish");
+      return false;
+    }
+  } else if (cmd == "echo") {
+    int v = 0;
+    in >> v;
+    simSerialSetEcho(v != 0 || g_opt.verbose);
+  } else {
+    fail("unknown script command: " + cmd);
+    return false;
+  }
+  return true;
+}
+
+static bool runScript(const std::vector<std::string> &lines) {
+  for (const std::string &l : lines) {
+    if (!runScriptLine(l)) return false;
+  }
+  return true;
+}
+
+// ================== main ==================
+
+static void usage() {
+  fprintf(stderr,
+    "usage: liftsim [options] [script]\n"
+    "  --top N         top switch height, steps (default 12000)\n"
+    "  --start N       cabin start position, steps (default 3000)\n"
+    "  --pot N         pot ADC value 0..4095 (default 4095)\n"
+    "  --loop-cost US  virtual cost of one loop() call (default 20)\n"
+    "  --fast          loop() once per 1 ms of virtual time (timer ISR still exact)\n"
+    "  --seed N        random seed for trips\n"
+    "  --poll          polling step generator instead of timer ISR\n"
+    "  --rmt           RMT pulse train (model) instead of timer ISR\n"
+    "  --encoder       encoder feedback on (plant quadrature encoder via PCNT model)\n"
+    "  --floors N      number of floors, laid out evenly (default: firmware value)\n"
+    "  --scurve        jerk-limited S-curve profile instead of trapezoid\n"
+    "  --accel N       acceleration, steps/s^2 (default: firmware value)\n"
+    "  --jerk N        jerk for --scurve, steps/s^3 (default: firmware value)\n"
+    "  --nvs FILE      keep NVS (calibration, cabin position) in FILE across runs\n"
+    "  --serial-out FILE  write raw UART output (text + TELEMETRY frames) to FILE\n"
+    "  -v              echo firmware serial output\n"
+    "script commands: send <line> | wait <ms> | until state <S> [ms] |\n"
+    "  until cabin <=|>= <steps> [ms] | expect state <S> | expect pos <steps> | expect floor <n> |\n"
+    "  expect error <n> | pot <raw> | pot-noise <amp> | switch-bounce <ms> | slip <per mille> | jam <ms> |\n"
+    "  step-hold <ms> | calib-button 0|1 | calibrate | trips <n> |\n  calls <n> [mean interval ms] | flood <n> [lines/s] |\n  remote <type> <arg> [count] | remote-repeat | remote-corrupt version|crc |\n  reboot | ready [ms] | bench | echo 0|1\n");
+}
+
+static bool parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> long {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return strtol(argv[++i], nullptr, 10);
+    };
+    if      (a == "--top")       g_opt.plant.topSwitchAt = next();
+    else if (a == "--start")     g_opt.plant.startAt = next();
+    else if (a == "--pot")       g_opt.plant.pot = (uint16_t)next();
+    else if (a == "--loop-cost") g_opt.loopCostUs = (uint32_t)next();
+    else if (a == "--fast")      g_opt.loopCostUs = 1000;
+    else if (a == "--seed")      g_opt.seed = (uint32_t)next();
+    else if (a == "--poll")      g_opt.pollSteps = true;
+    else if (a == "--rmt")       g_opt.rmtSteps = true;
+    else if (a == "--encoder")   g_opt.encoder = true;
+    else if (a == "--floors")    g_opt.floors = next();
+    else if (a == "--scurve")    g_opt.sCurve = true;
+    else if (a == "--accel")     g_opt.accel = next();
+    else if (a == "--jerk")      g_opt.jerk = next();
+    else if (a == "--nvs") {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      g_opt.nvsFile = argv[++i];
+    }
+    else if (a == "--serial-out") {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      g_opt.serialOut = argv[++i];
+    }
+    else if (a == "-v")          g_opt.verbose = true;
+    else if (a == "-h" || a == "--help") { usage(); exit(0); }
+    else if (a[0] != '-')        g_opt.script = a;
+    else { usage(); return false; }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (!parseArgs(argc, argv)) return 2;
+
+  std::vector<std::string> lines;
+  if (!g_opt.script.empty()) {
+    std::ifstream f(g_opt.script);
+    if (!f) {
+      fprintf(stderr, "[SIM] cannot open %s\n", g_opt.script.c_str());
+      return 2;
+    }
+    for (std::string l; std::getline(f, l);) lines.push_back(l);
+  } else {
+    lines = { "calibrate", "trips 200" };
+  }
+
+  srand(g_opt.seed);
+  if (!g_opt.nvsFile.empty() && !simNvsSetFile(g_opt.nvsFile.c_str())) {
+    fprintf(stderr, "[SIM] NVS image %s is damaged, loaded what was readable\n", g_opt.nvsFile.c_str());
+  }
+  plantRestore();
+  plantInit(g_opt.plant);
+  simSetLoopCostUs(g_opt.loopCostUs);
+  simSerialSetEcho(g_opt.verbose);
+  FILE *serialOut = nullptr;
+  if (!g_opt.serialOut.empty()) {
+    serialOut = fopen(g_opt.serialOut.c_str(), "wb");
+    if (!serialOut) {
+      fprintf(stderr, "[SIM] cannot write %s\n", g_opt.serialOut.c_str());
+      return 2;
+    }
+    simSerialSetCapture(serialOut);
+  }
+  simEspNowSetTxHook(onBaseTx);
+
+  auto wall0 = std::chrono::steady_clock::now();
+
+  bool ok = doBoot() && runScript(lines);
+  plantSave();
+  if (ok && (g_link.syncPending || g_link.syncMaxUs > SYNC_MAX_US)) {
+    fail("status request not answered in " + std::to_string(SYNC_MAX_US / 1000) + " ms");
+    ok = false;
+  }
+  if (ok && topSwitchEdges() != plantTopCrossings()) {
+    fail("top switch: " + std::to_string(topSwitchEdges()) + " edges for " +
+         std::to_string(plantTopCrossings()) + " crossings");
+    ok = false;
+  }
+  if (ok && g_stats.speedChanges) {
+    fail("speed limit changed mid-trip " + std::to_string(g_stats.speedChanges) + " times with the pot still");
+    ok = false;
+  }
+  if (ok && g_opt.rmtSteps) {
+    StepGenSimRmtStats r;
+    stepGenSimRmtGetStats(&r);
+    if (r.mismatches || r.underruns || (plantStepCount() > 1 && r.checked == 0)) {
+      fail("RMT stream: " + std::to_string(r.mismatches) + " intervals off profile, " +
+           std::to_string(r.underruns) + " underruns, " + std::to_string(r.checked) + " checked");
+      ok = false;
+    }
+  }
+  if (ok && !motorEncoderActive() && llabs(g_stats.etaErrMaxUs) > ETA_TOLERANCE_US) {
+    fail("trip time off the planned ETA by " + std::to_string(g_stats.etaErrMaxUs / 1000) + " ms");
+    ok = false;
+  }
+  if (ok && plantReversalLost()) {
+    fail("lost steps: " + std::to_string(plantReversalLost()) + " reversed before the shaft stopped");
+    ok = false;
+  }
+  // С энкодером расхождение в пределах зоны нечувствительности прошивка не правит
+  if (ok && g_stats.maxPosError > (motorEncoderActive() ? ENC_DEADBAND_STEPS : 0)) {
+    fail("lost steps: position error " + std::to_string(g_stats.maxPosError));
+    ok = false;
+  }
+
+  logFlush();
+  if (serialOut) {
+    simSerialSetCapture(nullptr);
+    fclose(serialOut);
+  }
+  double wallMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - wall0).count();
+  report(wallMs);
+  printf("[SIM] result         : %s\n", ok && !g_failed ? "OK" : "FAIL");
+  return ok && !g_failed ? 0 : 1;
+}
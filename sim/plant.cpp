@@ -0,0 +1,224 @@
+#include "plant.h"
+#include "sim.h"
+#include <Arduino.h>
+
+static PlantConfig g_cfg;
+
+static long     g_pos       = 0;
+static uint64_t g_steps     = 0;
+static uint64_t g_stalled   = 0;
+static uint64_t g_slipped   = 0;
+static uint64_t g_jamUntilUs = 0;   // затор вала до этого момента
+static uint64_t g_reversalLost = 0;
+static uint64_t g_turnUs     = 0;   // два последних поворота вала: по ним скорость перед разворотом
+static uint64_t g_prevTurnUs = 0;
+static int8_t   g_turnDir    = 0;
+static long     g_encCount  = 0;
+static uint8_t  g_stepLevel = LOW;
+static uint8_t  g_dirLevel  = LOW;
+static uint8_t  g_enLevel   = HIGH;  // EN активен по LOW
+static bool     g_calibBtn  = false;
+static uint32_t g_topCrossings = 0;
+static uint64_t g_topChangedUs = 0;
+
+static uint32_t *g_capture    = nullptr;
+static size_t    g_captureCap = 0;
+static size_t    g_captured   = 0;
+
+void plantInit(const PlantConfig &cfg) {
+  g_cfg       = cfg;
+  g_pos       = cfg.startAt;
+  g_steps     = 0;
+  g_stalled   = 0;
+  g_slipped   = 0;
+  g_jamUntilUs = 0;
+  g_reversalLost = 0;
+  g_turnUs     = 0;
+  g_prevTurnUs = 0;
+  g_turnDir    = 0;
+  g_encCount  = cfg.startAt * cfg.encCountsPerRev / cfg.motorStepsPerRev;
+  g_stepLevel = LOW;
+  g_dirLevel  = LOW;
+  g_enLevel   = HIGH;
+  g_calibBtn  = false;
+  g_topCrossings = 0;
+  g_topChangedUs = 0;
+}
+
+const PlantConfig &plantConfig() {
+  return g_cfg;
+}
+
+void plantPinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+// Квадратура: счёт & 3 → (A, B) = 00, 10, 11, 01; вверх — A опережает B
+static uint8_t encLevelA(long count) {
+  uint8_t q = (uint8_t)(count & 3);
+  return (q == 1 || q == 2) ? HIGH : LOW;
+}
+
+static uint8_t encLevelB(long count) {
+  return (count & 2) ? HIGH : LOW;
+}
+
+// Вал повернулся до pos: энкодер проходит все промежуточные отсчёты, фронт за фронтом
+static void encoderFollow(long pos) {
+  long target = pos * g_cfg.encCountsPerRev / g_cfg.motorStepsPerRev;
+  while (g_encCount != target) {
+    long next = g_encCount + (target > g_encCount ? 1 : -1);
+    bool aChanged = encLevelA(next) != encLevelA(g_encCount);
+    g_encCount = next;
+    if (aChanged) simPcntPinChanged(g_cfg.encPinA, encLevelA(next));
+    else          simPcntPinChanged(g_cfg.encPinB, encLevelB(next));
+  }
+}
+
+static void onStepEdge() {
+  if (g_enLevel != LOW) return;  // драйвер выключен
+
+  if (g_capture && g_captured < g_captureCap) {
+    g_capture[g_captured] = (uint32_t)simNowUs();
+  }
+  g_captured++;
+  g_steps++;
+
+  // DIR HIGH = вверх (как в motor_controller)
+  int8_t dir = (g_dirLevel == HIGH) ? 1 : -1;
+  long next = g_pos + dir;
+
+  // Вал шёл в другую сторону со скоростью v выше startStopSpeed — остановить его можно
+  // не быстрее (v − startStopSpeed) / reverseAccel. Импульс назад раньше этого вал не отрабатывает:
+  // шаг потерян (обрыв шагов на ходу и сразу разворот).
+  uint64_t now = simNowUs();
+  if (g_cfg.reverseAccel && g_turnDir && dir != g_turnDir && g_turnUs > g_prevTurnUs) {
+    double v      = 1e6 / (double)(g_turnUs - g_prevTurnUs);
+    double stopUs = (v - g_cfg.startStopSpeed) / g_cfg.reverseAccel * 1e6;
+    if ((double)(now - g_turnUs) < stopUs) {
+      g_reversalLost++;
+      return;
+    }
+  }
+  if (next < 0 || next > g_cfg.topSwitchAt + g_cfg.overTravel) {
+    g_stalled++;  // упор: мотор шагает, кабина стоит
+    g_turnDir = 0;  // вал остановлен упором
+    return;
+  }
+  if (simNowUs() < g_jamUntilUs ||
+      (g_cfg.slipPerMille && (uint32_t)(rand() % 1000) < g_cfg.slipPerMille)) {
+    g_slipped++;  // вал не повернулся: шаг потерян
+    return;
+  }
+  bool wasTop = plantTopSwitch();
+  g_pos = next;
+  g_prevTurnUs = (dir == g_turnDir) ? g_turnUs : 0;
+  g_turnUs     = now;
+  g_turnDir    = dir;
+  encoderFollow(g_pos);
+  if (plantTopSwitch() != wasTop) {
+    g_topCrossings++;
+    g_topChangedUs = simNowUs();
+  }
+}
+
+void plantDigitalWrite(uint8_t pin, uint8_t val) {
+  if (pin == g_cfg.stepPin) {
+    if (val == HIGH && g_stepLevel == LOW) onStepEdge();
+    g_stepLevel = val;
+  } else if (pin == g_cfg.dirPin) {
+    g_dirLevel = val;
+  } else if (pin == g_cfg.enPin) {
+    g_enLevel = val;
+  }
+}
+
+int plantDigitalRead(uint8_t pin) {
+  // Концевик и кнопки замыкают на GND (INPUT_PULLUP)
+  if (pin == g_cfg.topSwitchPin) {
+    bool closed = plantTopSwitch();
+    // Дребезг: сразу после смены уровня контакт замыкается через раз
+    if (g_topCrossings && simNowUs() - g_topChangedUs < g_cfg.bounceUs) closed = rand() & 1;
+    return closed ? LOW : HIGH;
+  }
+  if (pin == g_cfg.calibBtnPin)  return g_calibBtn ? LOW : HIGH;
+  if (pin == g_cfg.encPinA)      return encLevelA(g_encCount);
+  if (pin == g_cfg.encPinB)      return encLevelB(g_encCount);
+  return HIGH;
+}
+
+uint16_t plantAnalogRead(uint8_t pin) {
+  if (pin == g_cfg.potPin) {
+    if (!g_cfg.potNoise) return g_cfg.pot;
+    long v = (long)g_cfg.pot + rand() % (2 * g_cfg.potNoise + 1) - g_cfg.potNoise;
+    return (uint16_t)(v < 0 ? 0 : v > 4095 ? 4095 : v);
+  }
+  return 0;
+}
+
+long plantCabinPos() {
+  return g_pos;
+}
+
+uint64_t plantStepCount() {
+  return g_steps;
+}
+
+uint64_t plantStalledSteps() {
+  return g_stalled;
+}
+
+uint64_t plantSlippedSteps() {
+  return g_slipped;
+}
+
+uint64_t plantReversalLost() {
+  return g_reversalLost;
+}
+
+long plantEncoderCount() {
+  return g_encCount;
+}
+
+bool plantTopSwitch() {
+  return g_pos >= g_cfg.topSwitchAt;
+}
+
+void plantSetPot(uint16_t raw) {
+  g_cfg.pot = raw > 4095 ? 4095 : raw;
+}
+
+uint32_t plantTopCrossings() {
+  return g_topCrossings;
+}
+
+void plantSetPotNoise(uint16_t amp) {
+  g_cfg.potNoise = amp;
+}
+
+void plantSetSwitchBounce(uint32_t us) {
+  g_cfg.bounceUs = us;
+}
+
+void plantSetCalibButton(bool pressed) {
+  g_calibBtn = pressed;
+}
+
+void plantSetSlip(uint16_t perMille) {
+  g_cfg.slipPerMille = perMille > 1000 ? 1000 : perMille;
+}
+
+void plantJam(uint32_t us) {
+  g_jamUntilUs = simNowUs() + us;
+}
+
+void plantCapturePulses(uint32_t *buf, size_t capacity) {
+  g_capture    = buf;
+  g_captureCap = capacity;
+  g_captured   = 0;
+}
+
+size_t plantCapturedPulses() {
+  return g_captured;
+}
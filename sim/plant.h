@@ -0,0 +1,62 @@
+#pragma once
+// Виртуальный стенд лифта: шаговик (интегрирует импульсы STEP/DIR в положение кабины),
+// верхний концевик, потенциометр скорости, кнопка перекалибровки, квадратурный энкодер
+// на валу мотора (выводы A/B → PCNT симулятора). Пропуск шага (проскальзывание, затор):
+// импульс пришёл, а вал и кабина не сдвинулись — энкодер это видит.
+// Инерция: разворот раньше, чем вал успел остановиться, тоже теряет шаги.
+// Положение кабины — в шагах от нижнего упора (0).
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct PlantConfig {
+  long     topSwitchAt = 12000;  // высота срабатывания верхнего концевика
+  long     overTravel  = 300;    // сколько кабина может пройти выше концевика до упора
+  long     startAt     = 3000;   // положение кабины при включении
+  uint16_t pot         = 4095;   // значение АЦП потенциометра
+  uint16_t potNoise    = 0;      // шум АЦП: ± столько к каждому чтению
+  uint32_t bounceUs    = 0;      // дребезг концевика после каждой смены уровня
+  uint16_t slipPerMille = 0;     // доля импульсов STEP, после которых вал не повернулся
+  long     encCountsPerRev  = 4000;  // энкодер 1000 линий, счёт x4
+  long     motorStepsPerRev = 1600;  // 200 шагов x 1/8
+  uint32_t startStopSpeed   = 500;   // шагов/с: с этой скорости вал встаёт сразу (без разгона)
+  uint32_t reverseAccel     = 40000; // шагов/с²: выше неё быстрее не остановить (0 — без инерции)
+
+  // Пины — как в прошивке
+  uint8_t stepPin      = 18;
+  uint8_t dirPin       = 19;
+  uint8_t enPin        = 21;
+  uint8_t topSwitchPin = 32;
+  uint8_t calibBtnPin  = 33;
+  uint8_t potPin       = 34;
+  uint8_t encPinA      = 26;
+  uint8_t encPinB      = 27;
+};
+
+void plantInit(const PlantConfig &cfg);
+const PlantConfig &plantConfig();
+
+// Вызывается из Arduino-заглушки
+void     plantPinMode(uint8_t pin, uint8_t mode);
+void     plantDigitalWrite(uint8_t pin, uint8_t val);
+int      plantDigitalRead(uint8_t pin);
+uint16_t plantAnalogRead(uint8_t pin);
+
+long     plantCabinPos();
+uint64_t plantStepCount();
+uint64_t plantStalledSteps();   // импульсы, ушедшие в упор (потерянные шаги)
+uint64_t plantSlippedSteps();   // импульсы, потерянные проскальзыванием / затором
+uint64_t plantReversalLost();   // импульсы назад, пока вал ещё шёл вперёд (разворот без торможения)
+long     plantEncoderCount();   // счёт энкодера (x4) от нулевого положения кабины
+bool     plantTopSwitch();       // уровень без дребезга
+uint32_t plantTopCrossings();    // смен уровня концевика с plantInit()
+void     plantSetPot(uint16_t raw);
+void     plantSetPotNoise(uint16_t amp);
+void     plantSetSwitchBounce(uint32_t us);
+void     plantSetCalibButton(bool pressed);
+void     plantSetSlip(uint16_t perMille);  // случайные пропуски шагов
+void     plantJam(uint32_t us);            // затор: столько мкс вал не поворачивается
+
+// Метки времени (мкс) всех фронтов STEP при включённом драйвере
+void   plantCapturePulses(uint32_t *buf, size_t capacity);
+size_t plantCapturedPulses();
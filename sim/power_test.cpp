@@ -0,0 +1,208 @@
+// Тест питания пульта (remote/power_manager.h): ступени простоя, сон, оценка заряда.
+//
+//   power_test [--days N] [--sessions N] [--lost %] [--dim s] [--blank s] [--sleep s] [--seed N]
+//
+// Модель в виртуальном времени (мс), loop() — как на пульте: просыпается от нажатия, ACK,
+// статуса базы или дедлайна (20 мс, 250 мс при погашенном экране, смена ступени) и ставит
+// ступень по простою. Сценарий: --sessions подходов к пульту в сутки, в подходе 1..3
+// нажатия; вызов этажа — поездка 8..20 с (лифт в движении держит экран). --lost % нажатий
+// уходят в пропадающий канал: команда ждёт ACK 2 с (повторы).
+// Проверяется: DIM/BLANK — не позже 1 мс после таймаута; SLEEP — никогда, пока команда
+// ждёт ACK или лифт едет; время по ступеням сходится с длительностью прогона; с таймаутами
+// по умолчанию батареи хватает хотя бы в 10 раз дольше, чем без управления питанием.
+// Часы стартуют за час до переполнения millis().
+// Код возврата 0 — всё сошлось.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "power_manager.h"
+
+struct Options {
+  uint32_t days     = 7;
+  double   sessions = 20;   // в сутки
+  double   lostPct  = 5;
+  double   dimS     = POWER_DEFAULTS.dimMs / 1000.0;
+  double   blankS   = POWER_DEFAULTS.blankMs / 1000.0;
+  double   sleepS   = POWER_DEFAULTS.sleepMs / 1000.0;
+  uint32_t seed     = 1;
+};
+
+static Options g_opt;
+
+static const uint32_t DAY_MS        = 86400000;
+static const uint32_t LOOP_IDLE_MS  = 20;    // как в remote.ino
+static const uint32_t LOOP_LINK_MS  = 5;
+static const uint32_t LOOP_BLANK_MS = 250;
+static const uint32_t ACK_MS        = 5;     // ACK базы на команду
+static const uint32_t LOST_ACK_MS   = 2000;  // канал пропал: повторы, потом потеря
+
+static double rnd() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+// Нажатие и что за ним: ожидание ACK и, для вызова этажа, поездка
+struct Press {
+  uint32_t at;         // от начала прогона, мс
+  uint32_t ackAt;
+  uint32_t tripFrom;   // tripFrom == tripTo — без поездки
+  uint32_t tripTo;
+};
+
+static std::vector<Press> g_presses;
+
+static void buildScenario(uint32_t durationMs) {
+  double meanGapMs = DAY_MS / g_opt.sessions;
+  double t = 0;
+  for (;;) {
+    t += -meanGapMs * log(1.0 - rnd());
+    if (t >= durationMs) break;
+    uint32_t at = (uint32_t)t;
+    uint32_t n = 1 + rand() % 3;
+    for (uint32_t i = 0; i < n && at < durationMs; i++) {
+      Press p;
+      p.at       = at;
+      p.ackAt    = at + (rnd() * 100 < g_opt.lostPct ? LOST_ACK_MS : ACK_MS);
+      p.tripFrom = p.tripTo = at;
+      if (rnd() < 0.7) {
+        p.tripFrom = at + 200;
+        p.tripTo   = p.tripFrom + 8000 + rand() % 12000;
+      }
+      g_presses.push_back(p);
+      at += 2000 + rand() % 6000;
+    }
+    t = at;
+  }
+}
+
+static bool parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "missing value for %s\n", a.c_str());
+      return false;
+    }
+    double v = atof(argv[++i]);
+    if      (a == "--days")     g_opt.days = (uint32_t)v;
+    else if (a == "--sessions") g_opt.sessions = v;
+    else if (a == "--lost")     g_opt.lostPct = v;
+    else if (a == "--dim")      g_opt.dimS = v;
+    else if (a == "--blank")    g_opt.blankS = v;
+    else if (a == "--sleep")    g_opt.sleepS = v;
+    else if (a == "--seed")     g_opt.seed = (uint32_t)v;
+    else {
+      fprintf(stderr, "unknown option %s\n", a.c_str());
+      return false;
+    }
+  }
+  return g_opt.days > 0 && g_opt.days < 40 && g_opt.sessions > 0;
+}
+
+int main(int argc, char **argv) {
+  if (!parseArgs(argc, argv)) return 2;
+  srand(g_opt.seed);
+
+  const uint32_t duration = g_opt.days * DAY_MS;
+  buildScenario(duration);
+
+  // Моменты, когда loop() будит не дедлайн: нажатие, ACK, статус базы (поездка началась/кончилась)
+  std::vector<uint32_t> wakeups;
+  for (const Press &p : g_presses) {
+    wakeups.push_back(p.at);
+    wakeups.push_back(p.ackAt);
+    if (p.tripTo != p.tripFrom) {
+      wakeups.push_back(p.tripFrom);
+      wakeups.push_back(p.tripTo);
+    }
+  }
+  std::sort(wakeups.begin(), wakeups.end());
+
+  PowerConfig cfg = { (uint32_t)(g_opt.dimS * 1000), (uint32_t)(g_opt.blankS * 1000),
+                      (uint32_t)(g_opt.sleepS * 1000) };
+  const uint32_t base = 0xFFFFFFFFu - 3600000;   // millis() переполнится через час
+  PowerManager pm;
+  pm.begin(cfg, base);
+
+  bool ok = true;
+  uint32_t fails = 0;
+  auto failAt = [&](uint32_t t, const char *what) {
+    if (fails++ < 10) fprintf(stderr, "[PWR] FAIL at %.3f s: %s\n", t / 1000.0, what);
+    ok = false;
+  };
+
+  size_t nextPress = 0, nextWake = 0, lo = 0;
+  uint32_t loops = 0, sleeps = 0, maxLagMs = 0;
+  uint32_t t = 0;
+  while (t < duration) {
+    uint32_t now = base + t;
+    loops++;
+
+    // Нажатия к этому моменту: PRESS -> powerWake()
+    while (nextPress < g_presses.size() && g_presses[nextPress].at <= t) {
+      pm.activity(now);
+      pm.enter(PWR_ACTIVE, now);
+      nextPress++;
+    }
+    bool cmdBusy = false, liftBusy = false;
+    while (lo < g_presses.size() && g_presses[lo].ackAt <= t && g_presses[lo].tripTo <= t) lo++;
+    for (size_t i = lo; i < nextPress; i++) {
+      if (g_presses[i].ackAt > t) cmdBusy = true;
+      if (g_presses[i].tripFrom <= t && t < g_presses[i].tripTo) liftBusy = true;
+    }
+
+    // powerUpdate()
+    if (liftBusy) pm.activity(now);
+    bool canSleep = !cmdBusy;
+    PowerState s = pm.due(now, canSleep);
+    if (s != pm.state && s > pm.state && (s == PWR_DIM || s == PWR_BLANK)) {
+      uint32_t timeout = (s == PWR_DIM) ? cfg.dimMs : cfg.blankMs;
+      uint32_t lag = (now - pm.lastActivityMs) - timeout;
+      if (lag > maxLagMs) maxLagMs = lag;
+      if (lag > 1) failAt(t, "dim/blank late");
+    }
+    if (s == PWR_SLEEP) {
+      if (cmdBusy || liftBusy) failAt(t, "sleep with command or trip in progress");
+      // Light sleep до следующего нажатия; пробуждение — это нажатие (обработается в начале прохода)
+      pm.enter(PWR_SLEEP, now);
+      sleeps++;
+      t = (nextPress < g_presses.size()) ? g_presses[nextPress].at : duration;
+      continue;
+    }
+    if (s != pm.state) pm.enter(s, now);
+
+    // waitForEvents()
+    uint32_t waitMs = cmdBusy ? LOOP_LINK_MS : (pm.state >= PWR_BLANK ? LOOP_BLANK_MS : LOOP_IDLE_MS);
+    uint32_t powerMs = pm.msUntilNext(now, canSleep);
+    if (powerMs < waitMs) waitMs = powerMs;
+    while (nextWake < wakeups.size() && wakeups[nextWake] <= t) nextWake++;
+    uint32_t next = t + (waitMs ? waitMs : 1);
+    if (nextWake < wakeups.size() && wakeups[nextWake] < next) next = wakeups[nextWake];
+    t = std::min(next, duration);
+  }
+  pm.account(base + duration);
+
+  if (pm.totalMs() != duration) failAt(duration, "time by state does not add up to the run");
+
+  float avg = pm.averageMa();
+  double lifeH = 1000.0 / avg, alwaysH = 1000.0 / POWER_STATE_MA[PWR_ACTIVE];
+  bool defaults = cfg.dimMs == POWER_DEFAULTS.dimMs && cfg.blankMs == POWER_DEFAULTS.blankMs &&
+                  cfg.sleepMs == POWER_DEFAULTS.sleepMs;
+  if (defaults && lifeH < 10 * alwaysH) failAt(duration, "default timeouts save less than 10x");
+
+  printf("[PWR] scenario: %u days, %zu presses (%.0f sessions/day), %.0f%% on a lost link; "
+         "timeouts dim %.0f s, blank %.0f s, sleep %.0f s\n",
+         g_opt.days, g_presses.size(), g_opt.sessions, g_opt.lostPct, g_opt.dimS, g_opt.blankS, g_opt.sleepS);
+  printf("[PWR] time  :");
+  for (uint8_t i = 0; i < PWR_STATE_COUNT; i++) {
+    printf(" %s %.2f%% (%u)", POWER_STATE_NAME[i], 100.0 * pm.timeMs[i] / duration, pm.entries[i]);
+  }
+  printf("\n[PWR] loop  : %u passes, %u light sleeps, dim/blank late by up to %u ms\n", loops, sleeps, maxLagMs);
+  printf("[PWR] charge: %.1f mAh/day, avg %.2f mA -> %.1f days on 1000 mAh (always ACTIVE: %.1f h)\n",
+         pm.chargeMah() / g_opt.days, avg, lifeH / 24, alwaysH);
+  printf("[PWR] result: %s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,346 @@
+// Тест формата кадров база <-> пульт (LiftController/lift_protocol.h) на хосте.
+//
+//   proto_test [--iterations N] [--seed N]
+//
+// 1. Кругом: каждое сообщение и смесь в одном кадре — собрать, разобрать, сравнить поля.
+// 2. Порча: любой одиночный бит и любое укорочение/удлинение кадра — кадр отвергается.
+// 3. Фазз: случайные байты, случайные TLV под верной CRC, мутации верных кадров —
+//    разбор не читает за буфер (собирается с ASan/UBSan) и не отдаёт записей из битого кадра.
+// Код возврата 0 — всё сошлось.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "lift_protocol.h"
+
+static uint32_t g_failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "[PROTO] FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      g_failures++;                                                            \
+    }                                                                          \
+  } while (0)
+
+static uint32_t g_rng = 1;
+
+static uint32_t rnd() {
+  // xorshift32: воспроизводимо и одинаково на любой libc
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 17;
+  g_rng ^= g_rng << 5;
+  return g_rng;
+}
+
+// Разбор в копию ровно нужной длины в куче: ASan ловит чтение за конец кадра
+static FrameError decode(const uint8_t *data, size_t len, std::vector<FrameRecord> *out,
+                         std::vector<uint8_t> &storage) {
+  storage.assign(data, data + len);
+  FrameReader rd;
+  FrameError err = rd.open(storage.empty() ? nullptr : storage.data(), (int)len);
+  if (err != FRAME_OK) return err;
+  FrameRecord rec;
+  while (rd.next(rec)) {
+    if (out) out->push_back(rec);
+  }
+  return err;
+}
+
+// ---------------- кругом ----------------
+
+static void testRoundTrip() {
+  uint8_t buf[LIFT_FRAME_MAX];
+  FrameWriter w;
+  w.begin(buf, sizeof(buf));
+
+  RemoteCommand *c = w.add<RemoteCommand>();
+  c->type = CMD_CALL_FLOOR;
+  c->arg  = 7;
+  c->seq  = 0xBEEF;
+
+  CommandAck *a = w.add<CommandAck>();
+  a->seq    = 0x1234;
+  a->type   = CMD_STOP;
+  a->status = LINK_ACK_DUPLICATE;
+
+  LiftStatus *st = w.add<LiftStatus>();
+  st->state        = STATE_MOVING;
+  st->currentFloor = 3;
+  st->targetFloor  = 12;
+  st->direction    = 1;
+  st->error        = 0;
+  st->speedPercent = 87;
+  st->needCalib    = 0;
+  st->uptimeMs     = 0xA1B2C3D4;
+  st->pendingCalls = 0x9009;
+  st->floorCount   = 15;
+
+  LiftMotion *m = w.add<LiftMotion>();
+  m->position     = -123456;
+  m->speed        = 4000;
+  m->speedPercent = 100;
+  m->direction    = -1;
+
+  CHECK(w.addText("F3 reached"));
+  uint8_t len = w.finish();
+  CHECK(len == LIFT_FRAME_OVERHEAD + 5 * sizeof(TlvHeader) + sizeof(RemoteCommand) + sizeof(CommandAck) +
+                   sizeof(LiftStatus) + sizeof(LiftMotion) + strlen("F3 reached"));
+
+  // Поля на проводе — little-endian по фиксированным смещениям
+  CHECK(buf[0] == LIFT_PROTO_MAGIC && buf[1] == LIFT_PROTO_VERSION && buf[2] == len - LIFT_FRAME_OVERHEAD);
+  CHECK(buf[3] == MSG_COMMAND && buf[4] == 4 && buf[5] == CMD_CALL_FLOOR && buf[6] == 7 &&
+        buf[7] == 0xEF && buf[8] == 0xBE);
+
+  std::vector<uint8_t> storage;
+  std::vector<FrameRecord> recs;
+  CHECK(decode(buf, len, &recs, storage) == FRAME_OK);
+  CHECK(recs.size() == 5);
+  if (recs.size() != 5) return;
+
+  const RemoteCommand *rc = recs[0].as<RemoteCommand>();
+  CHECK(rc && rc->type == CMD_CALL_FLOOR && rc->arg == 7 && rc->seq == 0xBEEF);
+  CHECK(!recs[0].as<CommandAck>());   // тот же размер, другой тип — не подменяется
+
+  const CommandAck *ra = recs[1].as<CommandAck>();
+  CHECK(ra && ra->seq == 0x1234 && ra->type == CMD_STOP && ra->status == LINK_ACK_DUPLICATE);
+
+  const LiftStatus *rs = recs[2].as<LiftStatus>();
+  CHECK(rs && rs->state == STATE_MOVING && rs->currentFloor == 3 && rs->targetFloor == 12 &&
+        rs->direction == 1 && rs->speedPercent == 87 && rs->uptimeMs == 0xA1B2C3D4 &&
+        rs->pendingCalls == 0x9009 && rs->floorCount == 15);
+
+  const LiftMotion *rm = recs[3].as<LiftMotion>();
+  CHECK(rm && rm->position == -123456 && rm->speed == 4000 && rm->speedPercent == 100 && rm->direction == -1);
+
+  CHECK(recs[4].type == MSG_TEXT && recs[4].length == strlen("F3 reached") &&
+        memcmp(recs[4].value, "F3 reached", recs[4].length) == 0);
+
+  // Ноль копий: записи указывают прямо в буфер разбора
+  CHECK(recs[2].value >= storage.data() && recs[2].value + sizeof(LiftStatus) <= storage.data() + storage.size());
+}
+
+static void testLimits() {
+  uint8_t buf[LIFT_FRAME_MAX];
+  FrameWriter w;
+
+  // Пустой кадр корректен (ноль записей)
+  w.begin(buf, sizeof(buf));
+  CHECK(w.empty());
+  uint8_t len = w.finish();
+  std::vector<uint8_t> storage;
+  std::vector<FrameRecord> recs;
+  CHECK(len == LIFT_FRAME_OVERHEAD && decode(buf, len, &recs, storage) == FRAME_OK && recs.empty());
+
+  // Заполнение до отказа: add() возвращает nullptr, кадр не портится
+  w.begin(buf, sizeof(buf));
+  uint32_t n = 0;
+  while (CommandAck *a = w.add<CommandAck>()) {
+    a->seq = (uint16_t)n++;
+    a->type = CMD_NONE;
+    a->status = LINK_ACK_OK;
+  }
+  CHECK(n == (LIFT_FRAME_MAX - LIFT_FRAME_OVERHEAD) / (sizeof(TlvHeader) + sizeof(CommandAck)));
+  CHECK(n >= LIFT_MAX_ACKS_PER_FRAME);
+  len = w.finish();
+  recs.clear();
+  CHECK(len <= LIFT_FRAME_MAX && decode(buf, len, &recs, storage) == FRAME_OK && recs.size() == n);
+  for (uint32_t i = 0; i < recs.size(); i++) {
+    const CommandAck *a = recs[i].as<CommandAck>();
+    CHECK(a && a->seq == i);
+  }
+
+  // Текст длиннее LIFT_TEXT_MAX обрезается
+  w.begin(buf, sizeof(buf));
+  std::string longText(200, 'x');
+  CHECK(w.addText(longText.c_str()));
+  len = w.finish();
+  recs.clear();
+  CHECK(decode(buf, len, &recs, storage) == FRAME_OK && recs.size() == 1 && recs[0].length == LIFT_TEXT_MAX);
+
+  // Неизвестный тип пропускается, записи после него читаются
+  w.begin(buf, sizeof(buf));
+  uint8_t *future = w.reserve((MsgType)0x7E, 9);
+  CHECK(future != nullptr);
+  memset(future, 0xAA, 9);
+  RemoteCommand *c = w.add<RemoteCommand>();
+  c->type = CMD_STOP;
+  c->arg  = 0;
+  c->seq  = 42;
+  len = w.finish();
+  recs.clear();
+  CHECK(decode(buf, len, &recs, storage) == FRAME_OK && recs.size() == 2);
+  if (recs.size() == 2) {
+    CHECK(recs[0].type == 0x7E && !recs[0].as<RemoteCommand>());
+    CHECK(recs[1].as<RemoteCommand>() && recs[1].as<RemoteCommand>()->seq == 42);
+  }
+
+  // Известный тип с чужой длиной — кадр отвергается целиком
+  w.begin(buf, sizeof(buf));
+  w.reserve(MSG_STATUS, sizeof(LiftStatus) - 1);
+  len = w.finish();
+  CHECK(decode(buf, len, nullptr, storage) == FRAME_BAD_RECORD);
+
+  // Чужая версия и магия
+  w.begin(buf, sizeof(buf));
+  w.add<LiftMotion>();
+  len = w.finish();
+  buf[1] = LIFT_PROTO_VERSION - 1;
+  CHECK(decode(buf, len, nullptr, storage) == FRAME_BAD_VERSION);
+  buf[0] = 0;
+  CHECK(decode(buf, len, nullptr, storage) == FRAME_BAD_MAGIC);
+  CHECK(decode(buf, 0, nullptr, storage) == FRAME_TOO_SHORT);
+}
+
+// ---------------- порча ----------------
+
+static uint8_t randomFrame(uint8_t *buf, uint8_t cap) {
+  FrameWriter w;
+  w.begin(buf, cap);
+  uint32_t records = rnd() % 8;
+  for (uint32_t i = 0; i < records; i++) {
+    uint8_t *v = nullptr;
+    uint8_t len = 0;
+    switch (rnd() % 6) {
+      case 0: v = (uint8_t *)w.add<RemoteCommand>(); len = sizeof(RemoteCommand); break;
+      case 1: v = (uint8_t *)w.add<CommandAck>();    len = sizeof(CommandAck);    break;
+      case 2: v = (uint8_t *)w.add<LiftStatus>();    len = sizeof(LiftStatus);    break;
+      case 3: v = (uint8_t *)w.add<LiftMotion>();    len = sizeof(LiftMotion);    break;
+      case 4: len = (uint8_t)(rnd() % (LIFT_TEXT_MAX + 1)); v = w.reserve(MSG_TEXT, len); break;
+      default: len = (uint8_t)(rnd() % 20); v = w.reserve((MsgType)(0x40 + rnd() % 0x40), len); break;
+    }
+    if (!v) break;
+    for (uint8_t j = 0; j < len; j++) v[j] = (uint8_t)rnd();
+  }
+  return w.finish();
+}
+
+static void testCorruption(uint32_t frames) {
+  std::vector<uint8_t> storage;
+  uint8_t buf[LIFT_FRAME_MAX + 8];
+  uint32_t flips = 0;
+  for (uint32_t f = 0; f < frames; f++) {
+    uint8_t len = randomFrame(buf, LIFT_FRAME_MAX);
+    CHECK(decode(buf, len, nullptr, storage) == FRAME_OK);
+
+    // CRC-16 ловит любую одиночную ошибку; заголовок — раньше CRC
+    for (uint16_t bit = 0; bit < len * 8u; bit++) {
+      buf[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+      CHECK(decode(buf, len, nullptr, storage) != FRAME_OK);
+      buf[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+      flips++;
+    }
+    // Обрезка и хвост лишних байт
+    for (uint8_t cut = 0; cut < len; cut++) CHECK(decode(buf, cut, nullptr, storage) != FRAME_OK);
+    buf[len] = (uint8_t)rnd();
+    CHECK(decode(buf, len + 1, nullptr, storage) == FRAME_BAD_LENGTH);
+  }
+  printf("[PROTO] corruption: %u frames, %u single-bit flips, all rejected\n", frames, flips);
+}
+
+// ---------------- фазз ----------------
+
+static void testFuzz(uint32_t iterations) {
+  std::vector<uint8_t> storage;
+  uint8_t buf[512];
+  uint32_t accepted = 0, records = 0;
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint32_t mode = rnd() % 3;
+    size_t len;
+    if (mode == 0) {
+      // Чистый шум
+      len = rnd() % (LIFT_FRAME_MAX + 16);
+      for (size_t j = 0; j < len; j++) buf[j] = (uint8_t)rnd();
+      if (len >= 2 && rnd() % 2) {
+        buf[0] = LIFT_PROTO_MAGIC;
+        buf[1] = LIFT_PROTO_VERSION;
+      }
+    } else if (mode == 1) {
+      // Случайные TLV (любые длины, в том числе за край) под верным заголовком и CRC:
+      // CRC не спасает, должна сработать проверка границ
+      uint8_t body = (uint8_t)(rnd() % (LIFT_FRAME_MAX - LIFT_FRAME_OVERHEAD + 1));
+      buf[0] = LIFT_PROTO_MAGIC;
+      buf[1] = LIFT_PROTO_VERSION;
+      buf[2] = body;
+      for (uint8_t j = 0; j < body; j++) buf[sizeof(WireHeader) + j] = (uint8_t)rnd();
+      // Типы чаще известные, длины чаще «почти правильные»
+      for (uint16_t j = 0; j + 1 < body;) {
+        uint8_t type  = (uint8_t)(1 + rnd() % 6);
+        uint8_t fixed = msgFixedLength(type);
+        uint8_t rlen  = (rnd() % 4 == 0) ? (uint8_t)rnd() :
+                        (fixed == 0xFF || fixed == 0) ? (uint8_t)(rnd() % 20) : fixed;
+        buf[3 + j]     = type;
+        buf[3 + j + 1] = rlen;
+        j += 2 + rlen;
+      }
+      uint16_t crc = liftCrc16(buf, sizeof(WireHeader) + body);
+      buf[sizeof(WireHeader) + body]     = (uint8_t)(crc & 0xFF);
+      buf[sizeof(WireHeader) + body + 1] = (uint8_t)(crc >> 8);
+      len = body + LIFT_FRAME_OVERHEAD;
+    } else {
+      // Верный кадр с несколькими мутациями (байт, вставка, удаление)
+      len = randomFrame(buf, LIFT_FRAME_MAX);
+      uint32_t muts = 1 + rnd() % 4;
+      for (uint32_t k = 0; k < muts && len > 0; k++) {
+        size_t at = rnd() % len;
+        switch (rnd() % 3) {
+          case 0: buf[at] = (uint8_t)rnd(); break;
+          case 1: if (len < sizeof(buf)) { memmove(buf + at + 1, buf + at, len - at); buf[at] = (uint8_t)rnd(); len++; } break;
+          default: memmove(buf + at, buf + at + 1, len - at - 1); len--; break;
+        }
+      }
+    }
+
+    std::vector<FrameRecord> recs;
+    FrameError err = decode(buf, len, &recs, storage);
+    CHECK(err <= FRAME_BAD_RECORD);
+    if (err != FRAME_OK) {
+      CHECK(recs.empty());
+      continue;
+    }
+    accepted++;
+    // Принятый кадр: все записи внутри буфера, известные — своей длины
+    for (const FrameRecord &r : recs) {
+      CHECK(r.value >= storage.data() && r.value + r.length <= storage.data() + len - 2);
+      uint8_t fixed = msgFixedLength(r.type);
+      CHECK(fixed == 0xFF || fixed == 0 || r.length == fixed);
+      // Чтение полей на месте (невыровненные упакованные структуры — UBSan смотрит)
+      if (const LiftStatus *st = r.as<LiftStatus>()) records += st->uptimeMs & 1;
+      if (const LiftMotion *m = r.as<LiftMotion>()) records += m->position & 1;
+      if (const RemoteCommand *c = r.as<RemoteCommand>()) records += c->seq & 1;
+      if (const CommandAck *a = r.as<CommandAck>()) records += a->seq & 1;
+      records++;
+    }
+  }
+  printf("[PROTO] fuzz: %u inputs, %u accepted (%u records read), none read past the frame\n",
+         iterations, accepted, records);
+}
+
+int main(int argc, char **argv) {
+  uint32_t iterations = 200000;
+  uint32_t seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string a = argv[i];
+    if      (a == "--iterations") iterations = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+    else if (a == "--seed")       seed = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+    else {
+      fprintf(stderr, "unknown option %s\n", a.c_str());
+      return 2;
+    }
+  }
+  g_rng = seed ? seed : 1;
+
+  printf("[PROTO] version %u, frame max %u B, status %u B, motion %u B, command %u B, ack %u B\n",
+         LIFT_PROTO_VERSION, LIFT_FRAME_MAX, (unsigned)sizeof(LiftStatus), (unsigned)sizeof(LiftMotion),
+         (unsigned)sizeof(RemoteCommand), (unsigned)sizeof(CommandAck));
+  testRoundTrip();
+  testLimits();
+  testCorruption(300);
+  testFuzz(iterations);
+  printf("[PROTO] result: %s\n", g_failures ? "FAIL" : "OK");
+  return g_failures ? 1 : 0;
+}
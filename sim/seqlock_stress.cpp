@@ -0,0 +1,158 @@
+// Стресс-тест Seqlock (LiftController/seqlock.h) на настоящих потоках: писатель — как задача
+// движения (публикует LiftSnapshot), читатели — как задача связи и прочие.
+//
+//   seqlock_stress [кол-во публикаций] [читателей]
+//
+// Все поля снимка выводятся из номера публикации n, поэтому любая смесь двух снимков
+// видна по несовпадению полей. Каждый читатель проверяет: ни одного рваного снимка,
+// номера не идут назад. Для сравнения — та же копия слов без проверки счётчика: рваные
+// снимки там бывают даже на одном ядре (вытеснение посреди записи) — тест их замечает.
+// Код возврата 0 — всё сошлось. Под -fsanitize=thread (make seqlocktest-tsan) ловит гонки.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "seqlock.h"
+#include "lift_snapshot.h"
+
+static LiftSnapshot makeSnapshot(uint32_t n) {
+  LiftSnapshot s;
+  memset(&s, 0, sizeof(s));
+  s.publishedMs  = n;
+  s.position     = (int32_t)(n * 7u);
+  s.speed        = -(int32_t)(n & 0xFFFF);
+  s.maxSpeed     = (int32_t)(~n);
+  s.etaMs        = n * 13u;
+  s.pendingCalls = (uint16_t)(n * 3u);
+  s.state        = (uint8_t)(n % 11);
+  s.currentFloor = (uint8_t)(n >> 8);
+  s.targetFloor  = (uint8_t)(n >> 16);
+  s.errorCode    = (uint8_t)(n >> 24);
+  s.floorCount   = (uint8_t)(n ^ 0x5A);
+  s.busy         = (uint8_t)(n & 1);
+  return s;
+}
+
+static bool snapshotOk(const LiftSnapshot &s) {
+  LiftSnapshot e = makeSnapshot(s.publishedMs);
+  return memcmp(&s, &e, sizeof(s)) == 0;
+}
+
+// Контроль: те же атомарные слова, но без счётчика — так выглядел бы «просто общий struct»
+struct Unguarded {
+  static constexpr size_t WORDS = (sizeof(LiftSnapshot) + 3) / 4;
+  std::atomic<uint32_t> data[WORDS] = {};
+
+  void write(const LiftSnapshot &v) {
+    uint32_t w[WORDS] = {};
+    memcpy(w, &v, sizeof(v));
+    for (size_t i = 0; i < WORDS; i++) data[i].store(w[i], std::memory_order_relaxed);
+  }
+  void read(LiftSnapshot &out) const {
+    uint32_t w[WORDS];
+    for (size_t i = 0; i < WORDS; i++) w[i] = data[i].load(std::memory_order_relaxed);
+    memcpy(&out, w, sizeof(out));
+  }
+};
+
+struct ReaderStats {
+  uint64_t reads = 0;
+  uint64_t torn  = 0;
+  uint64_t backwards = 0;
+};
+
+template <typename Lock>
+static void runCase(Lock &lock, uint32_t count, unsigned readers, std::vector<ReaderStats> &stats, double *ms) {
+  std::atomic<bool> done{false};
+  stats.assign(readers, ReaderStats());
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::thread writer([&] {
+    for (uint32_t n = 1; n <= count; n++) {
+      lock.write(makeSnapshot(n));
+      if ((n & 1023) == 0) std::this_thread::yield();  // на одноядерной машине читатели иначе не получат CPU
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> threads;
+  for (unsigned r = 0; r < readers; r++) {
+    threads.emplace_back([&, r] {
+      ReaderStats &st = stats[r];
+      uint32_t last = 0;
+      LiftSnapshot s;
+      while (!done.load(std::memory_order_relaxed)) {
+        lock.read(s);
+        st.reads++;
+        if (!snapshotOk(s)) {
+          st.torn++;
+          continue;
+        }
+        if (s.publishedMs < last) st.backwards++;
+        last = s.publishedMs;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto &t : threads) t.join();
+  *ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void sum(const std::vector<ReaderStats> &stats, ReaderStats &out) {
+  out = ReaderStats();
+  for (const ReaderStats &s : stats) {
+    out.reads += s.reads;
+    out.torn += s.torn;
+    out.backwards += s.backwards;
+  }
+}
+
+int main(int argc, char **argv) {
+  uint32_t count   = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 500000;
+  unsigned readers = (argc > 2) ? (unsigned)strtoul(argv[2], nullptr, 10) : 3;
+  if (readers == 0) readers = 1;
+
+  std::vector<ReaderStats> stats;
+  ReaderStats total;
+  double ms = 0;
+  bool ok = true;
+
+  static Seqlock<LiftSnapshot> lock;
+  runCase(lock, count, readers, stats, &ms);
+  sum(stats, total);
+  LiftSnapshot last;
+  lock.read(last);
+  printf("[SEQLOCK] seqlock  : %u writes, %u readers, %llu reads in %.1f ms, %u retries, "
+         "%llu torn, %llu backwards\n",
+         count, readers, (unsigned long long)total.reads, ms, lock.retryCount(),
+         (unsigned long long)total.torn, (unsigned long long)total.backwards);
+  if (total.torn || total.backwards) {
+    fprintf(stderr, "[SEQLOCK] reader saw a torn or older snapshot\n");
+    ok = false;
+  }
+  if (lock.version() != count || last.publishedMs != count || !snapshotOk(last)) {
+    fprintf(stderr, "[SEQLOCK] final snapshot %u (version %u), expected %u\n",
+            last.publishedMs, lock.version(), count);
+    ok = false;
+  }
+  if (total.reads == 0) {
+    fprintf(stderr, "[SEQLOCK] readers never ran\n");
+    ok = false;
+  }
+
+  // Контроль: без счётчика рваные снимки — норма (если потоки правда шли параллельно)
+  static Unguarded raw;
+  runCase(raw, count, readers, stats, &ms);
+  sum(stats, total);
+  printf("[SEQLOCK] control  : %llu reads without the sequence check, %llu torn\n",
+         (unsigned long long)total.reads, (unsigned long long)total.torn);
+
+  printf("[SEQLOCK] result: %s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
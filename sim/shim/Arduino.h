@@ -0,0 +1,152 @@
+#pragma once
+// Минимальная замена Arduino-ядра ESP32 для сборки прошивки под Linux (симулятор).
+// Время виртуальное (sim_clock), пины и АЦП обслуживает виртуальный стенд (plant).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <ctype.h>
+
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+// ---- время ----
+unsigned long micros();
+unsigned long millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// ---- GPIO / АЦП ----
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+// ---- символы ----
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+
+// ---- F() ----
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+// ---- String ----
+class String {
+public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+
+  void reserve(size_t n) { s_.reserve(n); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  const char *c_str() const { return s_.c_str(); }
+  char operator[](unsigned int i) const { return s_[i]; }
+
+  void trim() {
+    size_t b = s_.find_first_not_of(" \t\r\n");
+    size_t e = s_.find_last_not_of(" \t\r\n");
+    s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+  }
+  bool startsWith(const char *p) const { return s_.compare(0, strlen(p), p) == 0; }
+  String substring(unsigned int from) const { return String(from < s_.size() ? s_.substr(from) : std::string()); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from >= s_.size() || to <= from) return String();
+    return String(s_.substr(from, to - from));
+  }
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+  String &operator=(const char *s) { s_ = s ? s : ""; return *this; }
+  String &operator+=(char c) { s_ += c; return *this; }
+  String &operator+=(const char *s) { s_ += s; return *this; }
+  String &operator+=(const String &o) { s_ += o.s_; return *this; }
+  bool operator==(const char *o) const { return s_ == o; }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator!=(const char *o) const { return s_ != o; }
+
+private:
+  std::string s_;
+};
+
+// ---- Print / Stream / Serial ----
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    for (size_t i = 0; i < n; i++) write(buf[i]);
+    return n;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v) { return printNum("%u", (unsigned)v); }
+  size_t print(int v) { return printNum("%d", v); }
+  size_t print(unsigned int v) { return printNum("%u", v); }
+  size_t print(long v) { return printNum("%ld", v); }
+  size_t print(unsigned long v) { return printNum("%lu", v); }
+  size_t print(long long v) { return printNum("%lld", v); }
+  size_t print(unsigned long long v) { return printNum("%llu", v); }
+  size_t print(double v, int digits = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return write(buf);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  size_t println(double v, int digits) { size_t n = print(v, digits); return n + println(); }
+
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  template <typename T> size_t printNum(const char *fmt, T v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), fmt, v);
+    return write(buf);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// UART0 симулятора: RX — из сценария, TX — с моделью скорости 115200 бод
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud);
+  void end() {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush();
+  int availableForWrite();                 // свободно в TX FIFO (байт), как на ESP32
+  size_t write(uint8_t c) override;
+  using Print::write;
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,30 @@
+#pragma once
+// Заглушка Preferences (NVS ESP32) для симулятора: ключи живут в памяти процесса,
+// а если задан файл (simNvsSetFile) — сохраняются в нём после каждой записи.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+  void end();
+
+  bool   clear();
+  bool   remove(const char *key);
+  bool   isKey(const char *key);
+
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+  size_t putLong(const char *key, int32_t value);
+  int32_t getLong(const char *key, int32_t defaultValue = 0);
+
+private:
+  std::string key(const char *k) const { return ns_ + "/" + k; }
+  std::string ns_;
+  bool        open_     = false;
+  bool        readOnly_ = false;
+};
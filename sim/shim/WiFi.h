@@ -0,0 +1,19 @@
+#pragma once
+// Заглушка WiFi для симулятора: радио нет, ESP-NOW эмулируется в sim_espnow.cpp
+
+#include <Arduino.h>
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA,
+  WIFI_AP,
+  WIFI_AP_STA
+} wifi_mode_t;
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m) { (void)m; return true; }
+  bool disconnect(bool wifiOff = false) { (void)wifiOff; return true; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,13 @@
+#pragma once
+// Заглушка esp_mac.h для симулятора: фиксированный MAC базы
+
+#include <esp_now.h>
+
+typedef enum {
+  ESP_MAC_WIFI_STA = 0,
+  ESP_MAC_WIFI_SOFTAP,
+  ESP_MAC_BT,
+  ESP_MAC_ETH
+} esp_mac_type_t;
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
@@ -0,0 +1,48 @@
+#pragma once
+// Заглушка ESP-NOW для симулятора: отправка пишет кадры в журнал sim_espnow,
+// приём — через simEspNowDeliver().
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+#define ESP_ERR_ESPNOW_NOT_INIT 0x3069
+
+#define ESP_NOW_ETH_ALEN 6
+
+typedef enum {
+  ESP_NOW_SEND_SUCCESS = 0,
+  ESP_NOW_SEND_FAIL
+} esp_now_send_status_t;
+
+typedef struct {
+  const uint8_t *des_addr;
+  const uint8_t *src_addr;
+} wifi_tx_info_t;
+
+typedef struct esp_now_recv_info {
+  uint8_t *src_addr;
+  uint8_t *des_addr;
+  void    *rx_ctrl;
+} esp_now_recv_info_t;
+
+typedef struct {
+  uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+  uint8_t lmk[16];
+  uint8_t channel;
+  int     ifidx;
+  bool    encrypt;
+  void   *priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_send_cb_t)(const wifi_tx_info_t *info, esp_now_send_status_t status);
+typedef void (*esp_now_recv_cb_t)(const esp_now_recv_info_t *info, const uint8_t *data, int len);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_deinit();
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer);
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len);
@@ -0,0 +1,4 @@
+#pragma once
+// Заглушка esp_wifi.h для симулятора
+
+#include <esp_now.h>
@@ -0,0 +1,45 @@
+#pragma once
+// Ядро симулятора: виртуальные часы, UART0, ESP-NOW.
+// Прошивка видит их через Arduino-заглушки в shim/.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// ---- Виртуальное время ----
+uint64_t simNowUs();
+// Продвинуть время на us. Срабатывания аппаратного таймера шагов за этот
+// промежуток доставляются ровно в свой момент (как ISR поверх loop()).
+void simAdvance(uint64_t us);
+// Стоимость одной итерации loop() в мкс (модель нагрузки CPU)
+void simSetLoopCostUs(uint32_t us);
+uint32_t simGetLoopCostUs();
+// Одна итерация прошивки: loop() + её стоимость по времени
+void simLoopOnce();
+// Прерывание таймера шагов не обслуживается us мкс (ISR заблокирован): шаги стоят, потом
+// пропущенные срабатывания догоняются пачкой, как у таймера с отложенным прерыванием
+void simStepTimerHold(uint64_t us);
+
+// ---- UART0 ----
+void simSerialInput(const char *line);     // строка + '\n' во входной буфер
+void simSerialSetEcho(bool echo);          // печатать вывод прошивки в stdout (без кадров телеметрии)
+void simSerialSetCapture(FILE *f);         // писать весь вывод UART как есть (nullptr — не писать)
+uint64_t simSerialTxBytes();
+uint64_t simSerialBlockedUs();             // сколько loop() простоял на полном TX FIFO
+
+// ---- PCNT ----
+// Фронт на выводе (от стенда): блоки PCNT, у которых это edge_gpio, считают
+void simPcntPinChanged(uint8_t pin, uint8_t level);
+
+// ---- ESP-NOW ----
+typedef void (*SimEspNowTxHook)(const uint8_t *mac, const uint8_t *data, size_t len);
+void simEspNowSetTxHook(SimEspNowTxHook hook);
+// Доставить кадр прошивке, как будто он пришёл по радио от mac
+void simEspNowDeliver(const uint8_t mac[6], const uint8_t *data, size_t len);
+uint32_t simEspNowTxCount();
+
+// ---- NVS (Preferences) ----
+// Файл-образ NVS: загрузить сейчас и сохранять после каждой записи (nullptr — только в памяти).
+// false — файл повреждён (прочитано, сколько удалось).
+bool simNvsSetFile(const char *path);
+uint32_t simNvsWriteCount();               // записи в NVS (putBytes/remove/clear)
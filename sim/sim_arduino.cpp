@@ -0,0 +1,222 @@
+// Arduino-ядро симулятора: виртуальные часы, GPIO через стенд, UART0.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <stdarg.h>
+#include <deque>
+
+#include "sim.h"
+#include "plant.h"
+#include "step_generator.h"
+#include "telemetry_frame.h"
+
+void loop();
+
+HardwareSerial Serial;
+WiFiClass      WiFi;
+
+// ================== Время ==================
+
+static uint64_t g_nowUs      = 0;
+static int      g_isrDepth   = 0;   // > 0 — сейчас выполняется «ISR» таймера
+static uint32_t g_loopCostUs = 20;
+static uint64_t g_stepHoldEndUs = 0;  // до этого момента ISR шагов не обслуживается
+
+uint64_t simNowUs() {
+  return g_nowUs;
+}
+
+void simAdvance(uint64_t us) {
+  // Внутри ISR время просто идёт, вложенных прерываний нет
+  if (g_isrDepth) {
+    g_nowUs += us;
+    return;
+  }
+
+  uint64_t end = g_nowUs + us;
+  uint32_t at;
+  while (stepGenSimNextAlarm(&at)) {
+    int32_t  ahead = (int32_t)(at - (uint32_t)g_nowUs);
+    uint64_t t     = g_nowUs + (ahead > 0 ? (uint64_t)ahead : 0);
+    if (t < g_stepHoldEndUs) t = g_stepHoldEndUs;
+    if (t > end) break;
+
+    g_nowUs = t;
+    g_isrDepth++;
+    stepGenSimAdvanceTo((uint32_t)g_nowUs);
+    g_isrDepth--;
+  }
+  if (g_nowUs < end) g_nowUs = end;
+}
+
+void simStepTimerHold(uint64_t us) {
+  g_stepHoldEndUs = g_nowUs + us;
+}
+
+void simSetLoopCostUs(uint32_t us) {
+  g_loopCostUs = us;
+}
+
+uint32_t simGetLoopCostUs() {
+  return g_loopCostUs;
+}
+
+void simLoopOnce() {
+  loop();
+  simAdvance(g_loopCostUs);
+}
+
+unsigned long micros() {
+  return (unsigned long)(uint32_t)g_nowUs;
+}
+
+unsigned long millis() {
+  return (unsigned long)(uint32_t)(g_nowUs / 1000);
+}
+
+void delay(uint32_t ms) {
+  simAdvance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  simAdvance(us);
+}
+
+// ================== GPIO ==================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  plantPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  plantDigitalWrite(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+  return plantDigitalRead(pin);
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return plantAnalogRead(pin);
+}
+
+// ================== UART0 ==================
+
+// 115200 8N1: 10 бит на байт. Аппаратный TX FIFO ESP32 — 128 байт,
+// дальше Serial.write() блокирует loop(), пока FIFO не освободится.
+static const double   UART_BYTE_US = 10.0 * 1000000.0 / 115200.0;
+static const unsigned UART_TX_FIFO = 128;
+
+static std::deque<uint8_t> g_rx;
+static bool     g_echo          = false;
+static double   g_txBusyUntilUs = 0;
+static uint64_t g_txBytes       = 0;
+static uint64_t g_txBlockedUs   = 0;
+static FILE    *g_txCapture     = nullptr;  // --serial-out: все байты TX как есть
+
+// Эхо пропускает двоичные кадры телеметрии: A5 не бывает в тексте, длина — из заголовка
+static uint8_t  g_echoHdr[4];
+static uint8_t  g_echoHdrLen = 0;
+static uint16_t g_echoSkip   = 0;
+
+void simSerialInput(const char *line) {
+  while (*line) g_rx.push_back((uint8_t)*line++);
+  g_rx.push_back('\n');
+}
+
+void simSerialSetEcho(bool echo) {
+  g_echo = echo;
+}
+
+void simSerialSetCapture(FILE *f) {
+  g_txCapture = f;
+}
+
+static void echoByte(uint8_t c) {
+  if (g_echoSkip) {
+    g_echoSkip--;
+    return;
+  }
+  if (g_echoHdrLen || c == TELEM_SYNC0) {
+    g_echoHdr[g_echoHdrLen++] = c;
+    if (g_echoHdrLen < sizeof(g_echoHdr)) return;
+    g_echoHdrLen = 0;
+    if (g_echoHdr[1] == TELEM_SYNC1 && g_echoHdr[3] <= TELEM_FRAME_SAMPLES) {
+      g_echoSkip = (uint16_t)(telemFrameLength(g_echoHdr[3]) - sizeof(g_echoHdr));
+    }
+    return;
+  }
+  if (c != '\r') fputc(c, stdout);
+}
+
+uint64_t simSerialTxBytes() {
+  return g_txBytes;
+}
+
+uint64_t simSerialBlockedUs() {
+  return g_txBlockedUs;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  (void)baud;
+}
+
+int HardwareSerial::available() {
+  return (int)g_rx.size();
+}
+
+int HardwareSerial::read() {
+  if (g_rx.empty()) return -1;
+  uint8_t c = g_rx.front();
+  g_rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return g_rx.empty() ? -1 : g_rx.front();
+}
+
+void HardwareSerial::flush() {
+  double now = (double)g_nowUs;
+  if (!g_isrDepth && g_txBusyUntilUs > now) {
+    uint64_t wait = (uint64_t)(g_txBusyUntilUs - now + 0.5);
+    g_txBlockedUs += wait;
+    simAdvance(wait);
+  }
+}
+
+int HardwareSerial::availableForWrite() {
+  double queued = (g_txBusyUntilUs - (double)g_nowUs) / UART_BYTE_US;
+  if (queued <= 0) return (int)UART_TX_FIFO;
+  int room = (int)UART_TX_FIFO - (int)(queued + 0.999);
+  return room > 0 ? room : 0;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (g_echo) echoByte(c);
+  if (g_txCapture) fputc(c, g_txCapture);
+  g_txBytes++;
+  if (g_isrDepth) return 1;
+
+  double now = (double)g_nowUs;
+  double queued = (g_txBusyUntilUs - now) / UART_BYTE_US;
+  if (queued >= UART_TX_FIFO) {
+    uint64_t wait = (uint64_t)(g_txBusyUntilUs - UART_TX_FIFO * UART_BYTE_US - now + 0.999);
+    g_txBlockedUs += wait;
+    simAdvance(wait);
+    now = (double)g_nowUs;
+  }
+  if (g_txBusyUntilUs < now) g_txBusyUntilUs = now;
+  g_txBusyUntilUs += UART_BYTE_US;
+  return 1;
+}
+
+size_t Print::printf(const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t *)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
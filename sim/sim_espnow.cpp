@@ -0,0 +1,76 @@
+// ESP-NOW симулятора: отправленные кадры уходят в хук сценария,
+// входящие доставляются через simEspNowDeliver().
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_mac.h>
+
+#include "sim.h"
+
+static bool              g_inited = false;
+static esp_now_send_cb_t g_sendCb = nullptr;
+static esp_now_recv_cb_t g_recvCb = nullptr;
+static SimEspNowTxHook   g_txHook = nullptr;
+static uint32_t          g_txCount = 0;
+
+static const uint8_t SIM_BASE_MAC[6] = { 0x30, 0xAE, 0xA4, 0x21, 0x33, 0x28 };
+
+esp_err_t esp_now_init() {
+  g_inited = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit() {
+  g_inited = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  g_sendCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  g_recvCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+  (void)peer;
+  return g_inited ? ESP_OK : ESP_ERR_ESPNOW_NOT_INIT;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len) {
+  if (!g_inited) return ESP_ERR_ESPNOW_NOT_INIT;
+  g_txCount++;
+  if (g_txHook) g_txHook(peer_addr, data, len);
+  if (g_sendCb) {
+    wifi_tx_info_t info = { peer_addr, SIM_BASE_MAC };
+    g_sendCb(&info, ESP_NOW_SEND_SUCCESS);
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+  (void)type;
+  memcpy(mac, SIM_BASE_MAC, 6);
+  return ESP_OK;
+}
+
+void simEspNowSetTxHook(SimEspNowTxHook hook) {
+  g_txHook = hook;
+}
+
+void simEspNowDeliver(const uint8_t mac[6], const uint8_t *data, size_t len) {
+  if (!g_inited || !g_recvCb) return;
+  uint8_t src[6];
+  uint8_t dst[6];
+  memcpy(src, mac, 6);
+  memcpy(dst, SIM_BASE_MAC, 6);
+  esp_now_recv_info_t info = { src, dst, nullptr };
+  g_recvCb(&info, data, (int)len);
+}
+
+uint32_t simEspNowTxCount() {
+  return g_txCount;
+}
@@ -0,0 +1,130 @@
+// NVS симулятора: хранилище Preferences в памяти + необязательный файл-образ,
+// чтобы калибровка переживала перезапуск liftsim так же, как перезагрузку ESP32.
+//
+// Формат файла: последовательность записей [u16 длина ключа][ключ][u32 длина][данные].
+
+#include <Preferences.h>
+#include <map>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+static std::map<std::string, std::vector<uint8_t>> g_store;
+static std::string g_file;
+static uint32_t    g_writes = 0;
+
+static void storeFlush() {
+  g_writes++;
+  if (g_file.empty()) return;
+  FILE *f = fopen(g_file.c_str(), "wb");
+  if (!f) return;
+  for (const auto &kv : g_store) {
+    uint16_t kl = (uint16_t)kv.first.size();
+    uint32_t vl = (uint32_t)kv.second.size();
+    fwrite(&kl, sizeof(kl), 1, f);
+    fwrite(kv.first.data(), 1, kl, f);
+    fwrite(&vl, sizeof(vl), 1, f);
+    fwrite(kv.second.data(), 1, vl, f);
+  }
+  fclose(f);
+}
+
+bool simNvsSetFile(const char *path) {
+  g_store.clear();
+  g_file = path ? path : "";
+  if (g_file.empty()) return true;
+
+  FILE *f = fopen(g_file.c_str(), "rb");
+  if (!f) return true;  // ещё нет — создастся при первой записи
+  bool ok = true;
+  for (;;) {
+    uint16_t kl;
+    if (fread(&kl, sizeof(kl), 1, f) != 1) break;
+    std::string k(kl, '\0');
+    uint32_t vl;
+    if (fread(&k[0], 1, kl, f) != kl || fread(&vl, sizeof(vl), 1, f) != 1 || vl > (1u << 20)) {
+      ok = false;
+      break;
+    }
+    std::vector<uint8_t> v(vl);
+    if (fread(v.data(), 1, vl, f) != vl) {
+      ok = false;
+      break;
+    }
+    g_store[k] = v;
+  }
+  fclose(f);
+  return ok;
+}
+
+uint32_t simNvsWriteCount() {
+  return g_writes;
+}
+
+// ---- Preferences ----
+
+bool Preferences::begin(const char *name, bool readOnly, const char *) {
+  ns_       = name ? name : "";
+  readOnly_ = readOnly;
+  open_     = !ns_.empty();
+  return open_;
+}
+
+void Preferences::end() {
+  open_ = false;
+}
+
+bool Preferences::clear() {
+  if (!open_ || readOnly_) return false;
+  std::string prefix = ns_ + "/";
+  for (auto it = g_store.begin(); it != g_store.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) it = g_store.erase(it);
+    else ++it;
+  }
+  storeFlush();
+  return true;
+}
+
+bool Preferences::remove(const char *k) {
+  if (!open_ || readOnly_) return false;
+  bool had = g_store.erase(key(k)) != 0;
+  if (had) storeFlush();
+  return had;
+}
+
+bool Preferences::isKey(const char *k) {
+  return open_ && g_store.count(key(k)) != 0;
+}
+
+size_t Preferences::putBytes(const char *k, const void *value, size_t len) {
+  if (!open_ || readOnly_) return 0;
+  const uint8_t *p = (const uint8_t *)value;
+  g_store[key(k)].assign(p, p + len);
+  storeFlush();
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *k) {
+  if (!open_) return 0;
+  auto it = g_store.find(key(k));
+  return it == g_store.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *k, void *buf, size_t maxLen) {
+  if (!open_) return 0;
+  auto it = g_store.find(key(k));
+  if (it == g_store.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::putLong(const char *k, int32_t value) {
+  return putBytes(k, &value, sizeof(value));
+}
+
+int32_t Preferences::getLong(const char *k, int32_t defaultValue) {
+  int32_t v;
+  return getBytes(k, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
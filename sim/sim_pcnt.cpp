@@ -0,0 +1,163 @@
+// Драйвер PCNT симулятора (shim/driver/pulse_cnt.h): блоки счёта на фронтах выводов стенда.
+
+#include <driver/pulse_cnt.h>
+#include <Arduino.h>
+
+#include "sim.h"
+#include "plant.h"
+
+static const int PCNT_UNITS    = 4;
+static const int PCNT_CHANNELS = 2;   // на блок, как в ESP32
+static const int PCNT_WATCH    = 5;
+
+struct sim_pcnt_channel {
+  bool                        used;
+  int                         edgeGpio;
+  int                         levelGpio;
+  pcnt_channel_edge_action_t  posAct, negAct;
+  pcnt_channel_level_action_t highAct, lowAct;
+};
+
+struct sim_pcnt_unit {
+  bool             used;
+  bool             enabled;
+  bool             running;
+  bool             accum;
+  int              low, high;
+  int              count;      // аппаратный счётчик (между пределами)
+  long             accumVal;   // накопленное на точках наблюдения (accum_count)
+  int              watch[PCNT_WATCH];
+  int              watchCount;
+  sim_pcnt_channel chan[PCNT_CHANNELS];
+};
+
+static sim_pcnt_unit g_units[PCNT_UNITS];
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *config, pcnt_unit_handle_t *ret_unit) {
+  if (config->low_limit >= 0 || config->high_limit <= 0) return ESP_FAIL;
+  for (sim_pcnt_unit &u : g_units) {
+    if (u.used) continue;
+    u = sim_pcnt_unit();
+    u.used  = true;
+    u.low   = config->low_limit;
+    u.high  = config->high_limit;
+    u.accum = config->flags.accum_count;
+    *ret_unit = &u;
+    return ESP_OK;
+  }
+  return ESP_FAIL;
+}
+
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit) {
+  unit->used = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *config,
+                           pcnt_channel_handle_t *ret_chan) {
+  for (sim_pcnt_channel &c : unit->chan) {
+    if (c.used) continue;
+    c = sim_pcnt_channel();
+    c.used      = true;
+    c.edgeGpio  = config->edge_gpio_num;
+    c.levelGpio = config->level_gpio_num;
+    *ret_chan = &c;
+    return ESP_OK;
+  }
+  return ESP_FAIL;
+}
+
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t chan) {
+  chan->used = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan, pcnt_channel_edge_action_t pos_act,
+                                       pcnt_channel_edge_action_t neg_act) {
+  chan->posAct = pos_act;
+  chan->negAct = neg_act;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan, pcnt_channel_level_action_t high_act,
+                                        pcnt_channel_level_action_t low_act) {
+  chan->highAct = high_act;
+  chan->lowAct  = low_act;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t *config) {
+  (void)unit;
+  (void)config;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int watch_point) {
+  if (unit->watchCount >= PCNT_WATCH || watch_point < unit->low || watch_point > unit->high) return ESP_FAIL;
+  unit->watch[unit->watchCount++] = watch_point;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit) {
+  unit->enabled = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unit) {
+  unit->enabled = false;
+  unit->running = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) {
+  if (!unit->enabled) return ESP_FAIL;
+  unit->running = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unit) {
+  unit->running = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) {
+  unit->count    = 0;
+  unit->accumVal = 0;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value) {
+  *value = (int)(unit->accumVal + unit->count);
+  return ESP_OK;
+}
+
+// На пределе счётчик сбрасывается в 0; с accum_count и точкой наблюдения на пределе
+// драйвер прибавляет предел к накопленному
+static void reachLimit(sim_pcnt_unit &u, int limit) {
+  if (u.accum) {
+    for (int i = 0; i < u.watchCount; i++) {
+      if (u.watch[i] == limit) u.accumVal += limit;
+    }
+  }
+  u.count = 0;
+}
+
+void simPcntPinChanged(uint8_t pin, uint8_t level) {
+  for (sim_pcnt_unit &u : g_units) {
+    if (!u.used || !u.running) continue;
+    for (const sim_pcnt_channel &c : u.chan) {
+      if (!c.used || c.edgeGpio != pin) continue;
+      pcnt_channel_edge_action_t act = (level == HIGH) ? c.posAct : c.negAct;
+      if (act == PCNT_CHANNEL_EDGE_ACTION_HOLD) continue;
+      int delta = (act == PCNT_CHANNEL_EDGE_ACTION_INCREASE) ? 1 : -1;
+      if (c.levelGpio >= 0) {
+        pcnt_channel_level_action_t mod = (plantDigitalRead((uint8_t)c.levelGpio) == HIGH) ? c.highAct : c.lowAct;
+        if (mod == PCNT_CHANNEL_LEVEL_ACTION_HOLD) continue;
+        if (mod == PCNT_CHANNEL_LEVEL_ACTION_INVERSE) delta = -delta;
+      }
+      u.count += delta;
+      if (u.count >= u.high) reachLimit(u, u.high);
+      else if (u.count <= u.low) reachLimit(u, u.low);
+    }
+  }
+}
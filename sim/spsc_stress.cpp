@@ -0,0 +1,134 @@
+// Стресс-тест SpscQueue (LiftController/spsc_queue.h) на двух настоящих потоках:
+// писатель — как задача WiFi, читатель — как loop().
+//
+//   spsc_stress [кол-во элементов]
+//
+// 1) Без потерь: писатель ждёт места, читатель проверяет, что пришло всё,
+//    по порядку и без рваных записей.
+// 2) С потерями: писатель не ждёт (как колбэк ESP-NOW), проверяется
+//    принято + переполнения == отправлено и порядок оставшихся.
+// Код возврата 0 — всё сошлось. Под -fsanitize=thread (make stress-tsan) ловит гонки.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "spsc_queue.h"
+
+// Элемент крупнее слова — рваная запись видна по несовпадению полей
+struct Item {
+  uint32_t seq;
+  uint32_t inv;     // ~seq
+  uint64_t mix;     // seq * константа
+};
+
+static const uint64_t MIX = 0x9E3779B97F4A7C15ULL;
+
+static bool itemOk(const Item &it) {
+  return it.inv == ~it.seq && it.mix == it.seq * MIX;
+}
+
+static Item makeItem(uint32_t seq) {
+  return Item{ seq, ~seq, seq * MIX };
+}
+
+template <uint16_t N>
+static bool runLossless(uint32_t count) {
+  static SpscQueue<Item, N> q;
+  std::atomic<bool> bad{false};
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < count; i++) {
+      while (!q.push(makeItem(i))) std::this_thread::yield();
+    }
+  });
+
+  std::thread consumer([&] {
+    uint32_t expect = 0;
+    Item it;
+    while (expect < count) {
+      if (!q.pop(it)) {
+        std::this_thread::yield();  // на одноядерной машине писатель иначе не получит CPU
+        continue;
+      }
+      if (it.seq != expect || !itemOk(it)) {
+        fprintf(stderr, "[STRESS] lossless N=%u: got seq %u, expected %u\n", N, it.seq, expect);
+        bad = true;
+        return;
+      }
+      expect++;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  // Переполнения здесь — отказы push() при полной очереди, писатель их повторял
+  printf("[STRESS] lossless N=%-3u: %u items in %.1f ms (%.1f M/s), full-queue retries %u\n",
+         N, count, ms, ms > 0 ? count / ms / 1000.0 : 0.0, q.overflowCount());
+  return !bad && q.size() == 0;
+}
+
+template <uint16_t N>
+static bool runLossy(uint32_t count) {
+  static SpscQueue<Item, N> q;
+  std::atomic<bool> done{false};
+  std::atomic<bool> bad{false};
+  uint32_t received = 0;
+
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < count; i++) {
+      q.push(makeItem(i));
+      if ((i & 63) == 63) std::this_thread::yield();  // пачками, как кадры по радио
+    }
+    done = true;
+  });
+
+  std::thread consumer([&] {
+    int64_t last = -1;
+    Item it;
+    for (;;) {
+      bool finished = done.load();
+      if (q.pop(it)) {
+        if ((int64_t)it.seq <= last || !itemOk(it)) {
+          fprintf(stderr, "[STRESS] lossy N=%u: got seq %u after %lld\n", N, it.seq, (long long)last);
+          bad = true;
+          return;
+        }
+        last = it.seq;
+        received++;
+      } else if (finished) {
+        return;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  producer.join();
+  consumer.join();
+  uint32_t lost = q.overflowCount();
+  printf("[STRESS] lossy    N=%-3u: %u sent, %u received, %u overflow\n", N, count, received, lost);
+  if (received + lost != count) {
+    fprintf(stderr, "[STRESS] lossy N=%u: received + overflow != sent\n", N);
+    return false;
+  }
+  return !bad;
+}
+
+int main(int argc, char **argv) {
+  uint32_t count = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 2000000;
+
+  bool ok = true;
+  ok &= runLossless<2>(count / 4);
+  ok &= runLossless<16>(count);
+  ok &= runLossless<256>(count);
+  ok &= runLossy<16>(count);
+  ok &= runLossy<256>(count);
+
+  printf("[STRESS] result: %s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
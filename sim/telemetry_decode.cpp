@@ -0,0 +1,142 @@
+// Разбор записи UART базы с кадрами телеметрии (TELEMETRY <hz>) в CSV для графиков.
+//
+//   telemetry_decode [--strict] [--text] [-o out.csv] [capture]
+//
+// capture — сырой вывод порта (cat /dev/ttyUSB0 > capture.bin, liftsim --serial-out),
+// без аргумента — stdin. CSV — в stdout или в -o. Текст лога между кадрами пропускается
+// (--text — печатать его в stderr). Кадр ищется по A5 5A и принимается только с верной
+// длиной и CRC (LiftController/telemetry_frame.h); битый — поиск со следующего байта.
+//
+// Номер выборки идёт подряд: скачок вперёд — выборки потеряны (кольцо на базе было полно
+// или кадр побит), скачок назад — новая запись (TELEMETRY <hz> заново).
+// --strict: код возврата 1 при битых кадрах, пропусках, времени назад или пустой записи.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "telemetry_frame.h"
+
+static const char *STATE_NAMES[] = {
+  "BOOT", "NEED_CALIB", "CALIB_HOMING_UP", "CALIB_MOVING_DOWN",
+  "IDLE", "MOVING", "MANUAL_MOVE", "ERROR", "VERIFY_HOMING"
+};
+static const unsigned STATE_COUNT = sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]);
+
+struct DecodeStats {
+  uint64_t frames     = 0;
+  uint64_t samples    = 0;
+  uint64_t recordings = 0;
+  uint64_t gaps       = 0;
+  uint64_t lost       = 0;   // выборок в пропусках
+  uint64_t badFrames  = 0;   // A5 5A без верной длины / CRC
+  uint64_t backwards  = 0;   // время выборки меньше предыдущей в той же записи
+  uint64_t textBytes  = 0;
+  bool     truncated  = false;
+};
+
+static void usage() {
+  fprintf(stderr, "usage: telemetry_decode [--strict] [--text] [-o out.csv] [capture]\n");
+}
+
+static bool readAll(FILE *f, std::vector<uint8_t> &out) {
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  return !ferror(f);
+}
+
+int main(int argc, char **argv) {
+  bool strict = false, text = false;
+  const char *inPath = nullptr, *outPath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if      (!strcmp(argv[i], "--strict")) strict = true;
+    else if (!strcmp(argv[i], "--text"))   text = true;
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+    else if (argv[i][0] != '-' && !inPath) inPath = argv[i];
+    else { usage(); return 2; }
+  }
+
+  FILE *in = inPath ? fopen(inPath, "rb") : stdin;
+  if (!in) {
+    fprintf(stderr, "[TELEM] cannot open %s\n", inPath);
+    return 2;
+  }
+  std::vector<uint8_t> data;
+  bool readOk = readAll(in, data);
+  if (inPath) fclose(in);
+  if (!readOk) {
+    fprintf(stderr, "[TELEM] read error\n");
+    return 2;
+  }
+
+  FILE *out = outPath ? fopen(outPath, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "[TELEM] cannot write %s\n", outPath);
+    return 2;
+  }
+  fprintf(out, "seq,t_us,position,target,cmd_speed,act_speed,loop_us,state,state_name,busy\n");
+
+  DecodeStats st;
+  bool     haveLast = false;
+  uint32_t nextSeq  = 0;
+  uint32_t lastUs   = 0;
+
+  for (size_t i = 0; i < data.size();) {
+    int len = telemFrameCheck(&data[i], data.size() - i);
+    if (len < 0) {  // запись оборвалась посреди кадра
+      st.truncated = true;
+      break;
+    }
+    if (len == 0) {
+      if (data[i] == TELEM_SYNC0 && i + 1 < data.size() && data[i + 1] == TELEM_SYNC1) st.badFrames++;
+      else st.textBytes++;
+      if (text && data[i] != '\r' && data[i] != TELEM_SYNC0) fputc(data[i], stderr);
+      i++;
+      continue;
+    }
+
+    TelemFrameHeader h;
+    memcpy(&h, &data[i], sizeof(h));
+    if (!haveLast || h.seq < nextSeq) {
+      st.recordings++;
+      haveLast = false;
+    } else if (h.seq > nextSeq) {
+      st.gaps++;
+      st.lost += h.seq - nextSeq;
+    }
+    for (uint8_t k = 0; k < h.count; k++) {
+      TelemSample s;
+      memcpy(&s, &data[i + sizeof(h) + k * sizeof(TelemSample)], sizeof(s));
+      uint32_t seq = h.seq + k;
+      if (haveLast && (int32_t)(s.tUs - lastUs) < 0) st.backwards++;
+      fprintf(out, "%u,%u,%d,%d,%d,%d,%u,%u,%s,%u\n", seq, s.tUs, s.position, s.target, s.cmdSpeed,
+              s.actSpeed, s.loopUs, s.state, s.state < STATE_COUNT ? STATE_NAMES[s.state] : "?",
+              (s.flags & TELEM_FLAG_BUSY) ? 1 : 0);
+      haveLast = true;
+      lastUs   = s.tUs;
+    }
+    nextSeq = h.seq + h.count;
+    st.frames++;
+    st.samples += h.count;
+    i += (size_t)len;
+  }
+  if (outPath) fclose(out);
+
+  fprintf(stderr, "[TELEM] %llu frames, %llu samples in %llu recording(s), %llu gaps (%llu samples lost), "
+          "%llu bad frames, %llu text bytes%s\n",
+          (unsigned long long)st.frames, (unsigned long long)st.samples, (unsigned long long)st.recordings,
+          (unsigned long long)st.gaps, (unsigned long long)st.lost, (unsigned long long)st.badFrames,
+          (unsigned long long)st.textBytes, st.truncated ? ", last frame truncated" : "");
+  if (st.backwards) {
+    fprintf(stderr, "[TELEM] %llu samples went back in time\n", (unsigned long long)st.backwards);
+  }
+
+  if (strict && (st.badFrames || st.gaps || st.backwards || st.samples == 0)) {
+    fprintf(stderr, "[TELEM] result: FAIL\n");
+    return 1;
+  }
+  return 0;
+}